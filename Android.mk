@@ -77,6 +77,7 @@ BUILD_SRC = \
     source/build/src/pragmas.cpp \
     source/build/src/scriptfile.cpp \
     source/build/src/mutex.cpp \
+    source/build/src/thread.cpp \
     source/build/src/xxhash.c \
     source/build/src/voxmodel.cpp \
     source/build/src/rev.cpp \
@@ -84,6 +85,7 @@ BUILD_SRC = \
     source/build/src/screenshot.cpp \
     source/build/src/tiles.cpp \
     source/build/src/mhk.cpp \
+    source/build/src/pvs.cpp \
     source/build/src/palette.cpp \
 
 MACT_SRC = \
@@ -364,6 +364,12 @@ endif
 FORCEDEBUG := 0
 KRANDDEBUG := 0
 PROFILER := 0
+# Sampling profiler for CON scripts (con_profile)
+CON_PROFILER := 0
+# Native code for hot CON actors and events (con_jit), x86-64 only
+CON_JIT := 0
+# Per-actor gamevars as sparse 32-bit pages (con_varmem); changes the savegame format
+CON_PAGED_ACTORVARS := 0
 # Make allocache() a wrapper around malloc()? Useful for debugging
 # allocache()-allocated memory accesses with e.g. Valgrind.
 # For debugging with Valgrind + GDB, see
@@ -406,6 +412,7 @@ else ifeq ($(PLATFORM),PSP)
     override HAVE_VORBIS := 0
     override HAVE_FLAC := 0
     override HAVE_XMP := 0
+    override CON_PROFILER := 0
     SDL_TARGET := 2
 else ifeq ($(PLATFORM),$(filter $(PLATFORM),DINGOO GCW QNX SUNOS SYLLABLE))
     override USE_OPENGL := 0
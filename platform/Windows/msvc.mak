@@ -187,6 +187,7 @@ ENGINE_OBJS= \
 	$(ENGINE_OBJ)\screenshot.$o \
 	$(ENGINE_OBJ)\softsurface.$o \
 	$(ENGINE_OBJ)\mhk.$o \
+	$(ENGINE_OBJ)\pvs.$o \
 	$(ENGINE_OBJ)\pngwrite.$o \
 	$(ENGINE_OBJ)\miniz.$o \
 	$(ENGINE_OBJ)\miniz_tinfl.$o \
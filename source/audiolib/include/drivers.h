@@ -37,6 +37,7 @@ typedef enum
 } soundcardnames;
 
 extern int32_t ASS_SoundDriver;
+extern int32_t ASS_PreferredSoundDriver;  // used by FX_Init() instead of the platform driver when >= 0
 
 int32_t SoundDriver_IsSupported(int32_t driver);
 
@@ -49,4 +50,26 @@ void SoundDriver_StopPlayback(void);
 void SoundDriver_Lock(void);
 void SoundDriver_Unlock(void);
 
+// Without a sound card, the NoSound driver can still run the mixer and
+// write what it mixes to a WAV file. Set up before FX_Init(); without a
+// file the sound is mixed and timed, then thrown away.
+enum
+{
+    ASS_RENDER_NONE,      // nothing is mixed
+    ASS_RENDER_REALTIME,  // a thread mixes at the rate a sound card would play
+    ASS_RENDER_FAST,      // a thread mixes as fast as it can
+    ASS_RENDER_STEPPED,   // only NoSoundDrv_Render() mixes, so the sound follows the caller's clock
+};
+
+typedef struct
+{
+    double seconds;      // sound mixed
+    double mixseconds;   // time spent mixing it
+    double wallseconds;  // time since playback began
+} soundrenderstats_t;
+
+void NoSoundDrv_SetRender(int32_t mode, char const *filename);
+void NoSoundDrv_Render(int32_t frames);
+void NoSoundDrv_GetRenderStats(soundrenderstats_t *stats);
+
 #endif
@@ -67,6 +67,7 @@ int32_t FX_Play(char *ptr, uint32_t ptrlength, int32_t loopstart, int32_t loopen
                       int32_t vol, int32_t left, int32_t right, int32_t priority, float volume, uint32_t callbackval);
 int32_t FX_Play3D(char *ptr, uint32_t ptrlength, int32_t loophow, int32_t pitchoffset, int32_t angle,
                   int32_t distance, int32_t priority, float volume, uint32_t callbackval);
+void FX_PrecacheSound(char const *ptr, uint32_t ptrlength);
 
 
 int32_t FX_SetPrintf(void(*function)(const char *, ...));
@@ -109,6 +110,10 @@ static FORCE_INLINE int32_t FX_Pan3D(int32_t handle, int32_t angle, int32_t dist
 {
     return FX_CheckMVErr(MV_Pan3D(handle, angle, distance));
 }
+static FORCE_INLINE int32_t FX_Pan3DBatch(voicepan3d_t const *pans, int32_t count)
+{
+    return FX_CheckMVErr(MV_Pan3DBatch(pans, count));
+}
 static FORCE_INLINE int32_t FX_SoundActive(int32_t handle) { return MV_VoicePlaying(handle); }
 static FORCE_INLINE int32_t FX_SoundsPlaying(void) { return MV_VoicesPlaying(); }
 static FORCE_INLINE int32_t FX_StopSound(int32_t handle) { return FX_CheckMVErr(MV_Kill(handle)); }
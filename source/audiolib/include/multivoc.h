@@ -47,6 +47,7 @@ typedef enum
     FMT_FLAC,
     FMT_XA,
     FMT_XMP,
+    FMT_STREAM,  // music decoded ahead on the stream thread, never detected
     FMT_MAX
 } wavefmt_t;
 
@@ -79,6 +80,15 @@ int32_t MV_PauseVoice(int32_t handle, int32_t pause);
 int32_t MV_EndLooping(int32_t handle);
 int32_t MV_SetPan(int32_t handle, int32_t vol, int32_t left, int32_t right);
 int32_t MV_Pan3D(int32_t handle, int32_t angle, int32_t distance);
+
+typedef struct
+{
+    int32_t handle;
+    int32_t angle;
+    int32_t distance;
+} voicepan3d_t;
+
+int32_t MV_Pan3DBatch(voicepan3d_t const *pans, int32_t count);
 void MV_SetReverb(int32_t reverb);
 int32_t MV_GetMaxReverbDelay(void);
 int32_t MV_GetReverbDelay(void);
@@ -113,6 +123,39 @@ int32_t MV_PlayXMP(char *ptr, uint32_t length, int32_t loopstart, int32_t loopen
 
 int MV_IdentifyXMP(char const *ptr, uint32_t length);
 
+// decoded sound cache: short Vorbis, FLAC and XA effects are decoded once and
+// then played from memory like WAV data
+typedef struct
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t entries;
+    uint32_t bytes;
+} decodecachestats_t;
+
+extern int32_t MV_DecodeCacheSize;  // memory budget in KB, 0 disables the cache
+
+int32_t MV_PlayDecoded3D(wavefmt_t fmt, char *ptr, uint32_t length, int32_t loophow, int32_t pitchoffset, int32_t angle, int32_t distance,
+                         int32_t priority, float volume, uint32_t callbackval);
+int32_t MV_PlayDecoded(wavefmt_t fmt, char *ptr, uint32_t length, int32_t loopstart, int32_t loopend, int32_t pitchoffset, int32_t vol,
+                       int32_t left, int32_t right, int32_t priority, float volume, uint32_t callbackval);
+void MV_PrecacheDecoded(wavefmt_t fmt, char const *ptr, uint32_t length);
+void MV_GetDecodeCacheStats(decodecachestats_t *stats);
+
+// streamed music: Vorbis, FLAC, XA and XMP music decodes on its own thread
+typedef struct
+{
+    uint32_t underruns;  // blocks the mixer found nothing decoded and played silence
+    uint32_t blocks;     // blocks the mixer took from a stream
+    int32_t  streams;
+    int32_t  buffered;   // milliseconds decoded ahead of the mixer, roughly
+} streamstats_t;
+
+extern int32_t MV_StreamLead;  // milliseconds to decode ahead, 0 decodes music in the mixer
+
+void MV_GetStreamStats(streamstats_t *stats);
+
 int32_t MV_GetPosition(int32_t handle, int32_t *position);
 int32_t MV_SetPosition(int32_t handle, int32_t position);
 
@@ -127,6 +170,80 @@ int32_t MV_Init(int32_t soundcard, int32_t MixRate, int32_t Voices, int32_t numc
 int32_t MV_Shutdown(void);
 void MV_SetPrintf(void (*function)(const char *fmt, ...));
 
+// nonzero: mix all voices into a 32-bit bus and clamp once per buffer
+extern int32_t MV_MixBus;
+
+// voice virtualization: only the MV_RealVoices most audible voices are
+// mixed, the rest keep playing silently
+typedef struct
+{
+    int32_t real;         // voices mixed in the last buffer
+    int32_t binaural;     // of those, voices mixed through the HRTF
+    int32_t virtualized;  // voices stepped through without mixing in the last buffer
+    int32_t peak;         // most voices playing at once
+} voicestats_t;
+
+extern int32_t MV_RealVoices;  // 0 mixes every audible voice
+
+// binaural sound: the MV_HrtfVoices loudest voices placed by MV_Pan3D() are
+// mixed through an HRTF instead of the pan table, with MV_MixBus in stereo
+extern int32_t MV_HrtfVoices;
+
+void MV_GetVoiceStats(voicestats_t *stats);
+
+// audio thread profiling, times in microseconds
+#define MV_PROFILEBUCKETS 12  // tenths of the buffer period, the last one counts anything longer
+
+typedef struct
+{
+    uint32_t buffers;                       // buffers mixed
+    uint32_t misses;                        // buffers that took longer to mix than they play
+    uint32_t histogram[MV_PROFILEBUCKETS];  // buffers by time taken to mix them
+    float    period;                        // time one buffer plays
+    float    average, worst;                // time taken to mix a buffer
+
+    float decode[FMT_MAX];        // total time decoding each format in the mixer
+    float mix[FMT_MAX];           // total time mixing each format
+    float streamdecode[FMT_MAX];  // total time decoding music on the stream thread
+
+    uint32_t callbacks;       // driver callbacks
+    uint32_t callbackmisses;  // callbacks that took longer than the audio they delivered plays
+    float    callbackaverage, callbackworst;
+} mvprofile_t;
+
+typedef struct
+{
+    int32_t   handle;
+    wavefmt_t wavetype;
+    float     decode, mix;  // since the voice started or the profile was reset
+} voiceprofile_t;
+
+extern int32_t MV_Profile;  // nonzero times the mixer
+
+void MV_GetProfile(mvprofile_t *profile);
+int32_t MV_GetVoiceProfile(voiceprofile_t *voices, int32_t count);
+void MV_ResetProfile(void);
+
+// for the drivers, around each callback; MV_ProfileStart() returns 0 while profiling is off
+uint64_t MV_ProfileStart(void);
+void MV_ProfileCallback(uint64_t start, int32_t bytes);
+
+// resampling used by the bus mixers
+enum
+{
+    MV_INTERP_NEAREST,
+    MV_INTERP_LINEAR,
+    MV_INTERP_CUBIC,
+    MV_INTERP_SINC,
+    MV_INTERP_COUNT
+};
+
+extern int32_t MV_Interpolation;
+int32_t MV_MeasureResampler(int32_t interp, float frequency, float rate, float *alias);
+int32_t MV_BenchmarkMix(int32_t numvoices, int32_t numbuffers, int32_t bus);
+int32_t MV_BenchmarkReverb(int32_t numbuffers);
+int32_t MV_BenchmarkHrtf(int32_t numvoices, int32_t numbuffers, int32_t moving);
+
 #ifdef __cplusplus
 }
 #endif
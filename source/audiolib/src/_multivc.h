@@ -33,6 +33,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "multivoc.h"
 
+#include <atomic>
+
 #define VOC_8BIT            0x0
 #define VOC_16BIT           0x4
 
@@ -101,6 +103,18 @@ typedef enum
     KeepPlaying
 } playbackstatus;
 
+// HRTF: a spherical head model as a pair of MV_HRTFTAPS tap FIR kernels
+// for each of MV_HRTFANGLES directions around the listener, built for the
+// mixing rate. Angle 0 is straight ahead and the angles run clockwise,
+// like MV_PanTable.
+#define MV_HRTFTAPS   64
+#define MV_HRTFANGLES 32
+
+typedef struct
+{
+    float   history[MV_HRTFTAPS];  // the last mono input samples
+    int32_t angle;                 // kernel of the previous buffer, -1 if the voice was not binaural
+} hrtfstate_t;
 
 typedef struct VoiceNode
 {
@@ -110,6 +124,7 @@ typedef struct VoiceNode
     playbackstatus (*GetSound)(struct VoiceNode *);
 
     uint32_t (*mix)(struct VoiceNode const *, uint32_t);
+    uint32_t (*busmix)(struct VoiceNode const *, uint32_t);  // MV_MixBus counterpart of mix
 
     const char *sound;
 
@@ -142,6 +157,13 @@ typedef struct VoiceNode
     uint32_t RateScale;
     uint32_t position;
     int32_t Paused;
+    int32_t Virtual;  // stepped through but not mixed this buffer, see MV_CullVoices()
+
+    int32_t Angle;     // direction from MV_Pan3D(), or -1 if the voice was panned with MV_SetPan()
+    int32_t Binaural;  // mixed through the HRTF this buffer, see MV_CullVoices()
+    hrtfstate_t hrtf;
+
+    uint64_t decodeticks, mixticks;  // with MV_Profile, see MV_GetVoiceProfile()
 
     int32_t handle;
     int32_t priority;
@@ -209,12 +231,44 @@ void MV_ReleaseFLACVoice(VoiceNode *voice);
 void MV_ReleaseXAVoice(VoiceNode *voice);
 void MV_ReleaseXMPVoice(VoiceNode *voice);
 
+void MV_SetFLACOwner(VoiceNode *voice);
+
+// a compressed sound effect decoded in full to 16-bit PCM, kept by the
+// decoded sound cache in formats.cpp and shared by every voice playing it
+typedef struct decoded_sound
+{
+    struct decoded_sound *prev;
+    struct decoded_sound *next;
+
+    // the compressed data; its length and a hash of its ends tell apart
+    // sounds that were loaded at the same address
+    char const *ptr;
+    uint32_t    length;
+    uint32_t    hash;
+
+    int16_t *data;  // NULL if the sound can not be cached
+    uint32_t size;  // bytes allocated for data
+    uint32_t numframes;
+    int32_t  channels;
+    int32_t  rate;
+
+    std::atomic<int32_t> refs;  // voices still reading data
+} decoded_sound;
+
+void MV_AppendDecoded(decoded_sound *snd, void const *pcm, uint32_t numframes);
+
+int32_t MV_DecodeVorbis(char const *ptr, uint32_t length, uint32_t maxbytes, decoded_sound *snd);
+int32_t MV_DecodeFLAC(char const *ptr, uint32_t length, uint32_t maxbytes, decoded_sound *snd);
+int32_t MV_DecodeXA(char const *ptr, uint32_t length, uint32_t maxbytes, decoded_sound *snd);
+
+void MV_ReleaseDecodedVoice(VoiceNode *voice);
+void MV_ClearDecodeCache(void);
+
 // implemented in mix.c
 uint32_t MV_Mix16BitMono(struct VoiceNode const *voice, uint32_t length);
 uint32_t MV_Mix16BitStereo(struct VoiceNode const *voice, uint32_t length);
 uint32_t MV_Mix16BitMono16(struct VoiceNode const *voice, uint32_t length);
 uint32_t MV_Mix16BitStereo16(struct VoiceNode const *voice, uint32_t length);
-void MV_16BitReverb(char const *src, char *dest, const int16_t *volume, int32_t count);
 
 // implemented in mixst.c
 uint32_t MV_Mix16BitMono8Stereo(struct VoiceNode const *voice, uint32_t length);
@@ -222,12 +276,257 @@ uint32_t MV_Mix16BitStereo8Stereo(struct VoiceNode const *voice, uint32_t length
 uint32_t MV_Mix16BitMono16Stereo(struct VoiceNode const *voice, uint32_t length);
 uint32_t MV_Mix16BitStereo16Stereo(struct VoiceNode const *voice, uint32_t length);
 
+// 32-bit bus mixers: same sources and layouts as above, but they add into the
+// int32_t bus at MV_MixDestination, scaled by MV_LeftGain/MV_RightGain
+uint32_t MV_MixBusMono(struct VoiceNode const *voice, uint32_t length);
+uint32_t MV_MixBusStereo(struct VoiceNode const *voice, uint32_t length);
+uint32_t MV_MixBusMono16(struct VoiceNode const *voice, uint32_t length);
+uint32_t MV_MixBusStereo16(struct VoiceNode const *voice, uint32_t length);
+uint32_t MV_MixBusMono8Stereo(struct VoiceNode const *voice, uint32_t length);
+uint32_t MV_MixBusStereo8Stereo(struct VoiceNode const *voice, uint32_t length);
+uint32_t MV_MixBusMono16Stereo(struct VoiceNode const *voice, uint32_t length);
+uint32_t MV_MixBusStereo16Stereo(struct VoiceNode const *voice, uint32_t length);
+void MV_BusToInt16(int32_t const *src, int16_t *dest, int32_t count);
+
+// Reverb: a feedback delay network of MV_REVERBLINES delay lines mixed
+// through a Hadamard matrix, with a lowpass in each line so that highs
+// die out sooner than lows. Line lengths are set for the mixing rate.
+#define MV_REVERBLINES 8
+
+typedef struct
+{
+    float *ring;  // frames of MV_REVERBLINES interleaved line samples
+    uint32_t ringmask;
+    uint32_t pos;
+
+    int32_t length[MV_REVERBLINES];   // delay of each line in frames
+    float   gain[MV_REVERBLINES];     // feedback per pass through each line
+    float   lowpass[MV_REVERBLINES];  // filter state
+    float   damp;                     // lowpass pole
+    float   wet;
+} reverb_t;
+
+void MV_InitReverb(reverb_t *rv, int32_t rate);
+void MV_FreeReverb(reverb_t *rv);
+void MV_ClearReverb(reverb_t *rv);
+void MV_SetReverbDecay(reverb_t *rv, int32_t rate, float seconds, float wet);
+void MV_ProcessReverb(reverb_t *rv, float *buffer, int32_t count, int32_t channels);
+
+void MV_InitHrtf(int32_t rate);
+void MV_ProcessHrtf(hrtfstate_t *state, int32_t const *src, bool leftonly, int32_t *dest, int32_t count, int32_t angle);
+
 extern char *MV_MixDestination;  // pointer to the next output sample
 extern const int16_t *MV_LeftVolume;
 extern const int16_t *MV_RightVolume;
+extern float MV_LeftGain, MV_RightGain;  // linear voice gains for the bus mixers
 extern int32_t MV_SampleSize;
 extern int32_t MV_RightChannelOffset;
 
+#if defined __SSE2__ || (defined _MSC_VER && (defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)))
+# include <emmintrin.h>
+# define MV_BUS_SSE2
+#elif defined __ARM_NEON || defined __ARM_NEON__
+# include <arm_neon.h>
+# define MV_BUS_NEON
+#endif
+
+// sample value in 16-bit range, as a float for the bus mixers
+static FORCE_INLINE float MV_BusSample(uint8_t const *src, uint32_t i) { return (float)(((int32_t)src[i] - 128) << 8); }
+static FORCE_INLINE float MV_BusSample(int16_t const *src, uint32_t i) { return (float)(int16_t)B_LITTLE16(src[i]); }
+
+#if defined MV_BUS_SSE2
+// frames <first> .. <first>+3 of channel <ch>, clamped to 0 .. <last> unless <inrange>
+static FORCE_INLINE __m128 MV_BusLoad4(uint8_t const *src)
+{
+    int32_t packed;
+    Bmemcpy(&packed, src, sizeof(packed));
+
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const x = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+
+    return _mm_cvtepi32_ps(_mm_slli_epi32(_mm_sub_epi32(x, _mm_set1_epi32(128)), 8));
+}
+
+static FORCE_INLINE __m128 MV_BusLoad4(int16_t const *src)
+{
+    __m128i const x = _mm_loadl_epi64((__m128i const *)src);
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+
+template <typename S>
+static FORCE_INLINE __m128 MV_BusTaps4(S const *src, int32_t first, int32_t last, int nch, int ch, bool inrange)
+{
+    if (inrange && nch == 1)
+        return MV_BusLoad4(src + first);
+
+    if (inrange)
+        return _mm_setr_ps(MV_BusSample(src, first*nch + ch), MV_BusSample(src, (first + 1)*nch + ch),
+                           MV_BusSample(src, (first + 2)*nch + ch), MV_BusSample(src, (first + 3)*nch + ch));
+
+    return _mm_setr_ps(MV_BusSample(src, clamp(first, 0, last)*nch + ch), MV_BusSample(src, clamp(first + 1, 0, last)*nch + ch),
+                       MV_BusSample(src, clamp(first + 2, 0, last)*nch + ch), MV_BusSample(src, clamp(first + 3, 0, last)*nch + ch));
+}
+#endif
+
+// dest[0..3] += samples[0..3] * gains[0..3]
+static FORCE_INLINE void MV_BusAdd4(int32_t *dest, float const *samples, float const *gains)
+{
+#if defined MV_BUS_SSE2
+    __m128i const mixed = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(samples), _mm_loadu_ps(gains)));
+    _mm_storeu_si128((__m128i *)dest, _mm_add_epi32(_mm_loadu_si128((__m128i const *)dest), mixed));
+#elif defined MV_BUS_NEON
+    int32x4_t const mixed = vcvtq_s32_f32(vmulq_f32(vld1q_f32(samples), vld1q_f32(gains)));
+    vst1q_s32(dest, vaddq_s32(vld1q_s32(dest), mixed));
+#else
+    for (int i = 0; i < 4; i++)
+        dest[i] += Blrintf(samples[i] * gains[i]);
+#endif
+}
+
+/*---------------------------------------------------------------------
+   Resampling for the bus mixers, selected by MV_Interpolation.
+
+   The source is read at 16.16 frame positions. Cubic and sinc look up
+   one row of filter taps per output sample by the top
+   MV_RESAMPLEPHASEBITS of the fraction. Taps that would fall outside
+   the current block are clamped to its first or last frame.
+---------------------------------------------------------------------*/
+
+#define MV_RESAMPLEPHASEBITS 9
+#define MV_RESAMPLEPHASES    (1 << MV_RESAMPLEPHASEBITS)
+#define MV_SINCTAPS          8
+#define MV_SINCCUTOFFS       3
+
+extern float MV_CubicTable[MV_RESAMPLEPHASES][4];
+extern float MV_SincTable[MV_SINCCUTOFFS][MV_RESAMPLEPHASES][MV_SINCTAPS];
+
+void MV_CalcResampleTables(void);
+
+template <int interp> struct MV_ResampleTaps { static constexpr int count = (interp == MV_INTERP_CUBIC) ? 4 : MV_SINCTAPS; };
+
+// filter table for a voice stepping <rate> source frames per output sample (16.16)
+template <int interp>
+static FORCE_INLINE float const *MV_ResampleTable(uint32_t rate)
+{
+    if (interp == MV_INTERP_CUBIC)
+        return MV_CubicTable[0];
+
+    // lower the cutoff when the voice is pitched above the output rate
+    return MV_SincTable[(rate <= 0x10000) ? 0 : (rate <= 0x18000) ? 1 : 2][0];
+}
+
+// sample of channel <ch> of an <nch>-channel source at 16.16 frame <position>
+template <int interp, typename S>
+static FORCE_INLINE float MV_BusFetch(S const *src, uint32_t position, int32_t last, int nch, int ch, float const *table)
+{
+    int32_t const i = position >> 16;
+
+    if (interp == MV_INTERP_NEAREST)
+        return MV_BusSample(src, i*nch + ch);
+
+    if (interp == MV_INTERP_LINEAR)
+    {
+        float const sample0 = MV_BusSample(src, i*nch + ch);
+        float const sample1 = MV_BusSample(src, min(i + 1, last)*nch + ch);
+
+        return sample0 + (sample1 - sample0) * (float)(position & 0xffff) * (1.f / 65536.f);
+    }
+
+    int const N = MV_ResampleTaps<interp>::count;
+    float const *const coefs = table + ((position & 0xffff) >> (16 - MV_RESAMPLEPHASEBITS)) * N;
+    float acc = 0.f;
+
+    for (int t = 0; t < N; t++)
+        acc += MV_BusSample(src, clamp(i + t - (N/2 - 1), 0, last)*nch + ch) * coefs[t];
+
+    return acc;
+}
+
+// dest[k] = sample of channel <ch> at <position> + k*<rate>, for k = 0..3
+template <int interp, typename S>
+static FORCE_INLINE void MV_BusFetch4(float *dest, S const *src, uint32_t position, uint32_t rate, int32_t last, int nch, int ch,
+                                      float const *table)
+{
+    if (interp == MV_INTERP_NEAREST || interp == MV_INTERP_LINEAR)
+    {
+        // unrolled by hand so that the four samples stay in registers
+        dest[0] = MV_BusFetch<interp>(src, position, last, nch, ch, table);
+        dest[1] = MV_BusFetch<interp>(src, position + rate, last, nch, ch, table);
+        dest[2] = MV_BusFetch<interp>(src, position + rate*2, last, nch, ch, table);
+        dest[3] = MV_BusFetch<interp>(src, position + rate*3, last, nch, ch, table);
+        return;
+    }
+
+    int const N = MV_ResampleTaps<interp>::count;
+
+#if defined MV_BUS_SSE2
+    __m128 r[4];
+
+    for (int k = 0; k < 4; k++, position += rate)
+    {
+        int32_t const first = (int32_t)(position >> 16) - (N/2 - 1);
+        float const *const coefs = table + ((position & 0xffff) >> (16 - MV_RESAMPLEPHASEBITS)) * N;
+        bool const inrange = (first >= 0 && first + N - 1 <= last);
+
+        r[k] = _mm_mul_ps(MV_BusTaps4(src, first, last, nch, ch, inrange), _mm_loadu_ps(coefs));
+
+        for (int t = 4; t < N; t += 4)
+            r[k] = _mm_add_ps(r[k], _mm_mul_ps(MV_BusTaps4(src, first + t, last, nch, ch, inrange), _mm_loadu_ps(coefs + t)));
+    }
+
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+    _mm_storeu_ps(dest, _mm_add_ps(_mm_add_ps(r[0], r[1]), _mm_add_ps(r[2], r[3])));
+#else
+    for (int k = 0; k < 4; k++, position += rate)
+    {
+        int32_t const first = (int32_t)(position >> 16) - (N/2 - 1);
+        float const *const coefs = table + ((position & 0xffff) >> (16 - MV_RESAMPLEPHASEBITS)) * N;
+        float taps[N];
+
+        if (first >= 0 && first + N - 1 <= last)
+        {
+            for (int t = 0; t < N; t++)
+                taps[t] = MV_BusSample(src, (first + t)*nch + ch);
+        }
+        else
+        {
+            for (int t = 0; t < N; t++)
+                taps[t] = MV_BusSample(src, clamp(first + t, 0, last)*nch + ch);
+        }
+
+# if defined MV_BUS_NEON
+        float32x4_t acc = vmulq_f32(vld1q_f32(taps), vld1q_f32(coefs));
+
+        for (int t = 4; t < N; t += 4)
+            acc = vmlaq_f32(acc, vld1q_f32(taps + t), vld1q_f32(coefs + t));
+
+        float32x2_t const sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+        dest[k] = vget_lane_f32(vpadd_f32(sum, sum), 0);
+# else
+        float acc = 0.f;
+
+        for (int t = 0; t < N; t++)
+            acc += taps[t] * coefs[t];
+
+        dest[k] = acc;
+# endif
+    }
+#endif
+}
+
+// calls mixer<S, interp>(voice, length) for the current MV_Interpolation
+#define MV_MIXBUS_INTERP(mixer, S)                                                     \
+    do                                                                                 \
+    {                                                                                  \
+        switch (MV_Interpolation)                                                      \
+        {                                                                              \
+            case MV_INTERP_LINEAR: return mixer<S, MV_INTERP_LINEAR>(voice, length);   \
+            case MV_INTERP_CUBIC: return mixer<S, MV_INTERP_CUBIC>(voice, length);     \
+            case MV_INTERP_SINC: return mixer<S, MV_INTERP_SINC>(voice, length);       \
+            default: return mixer<S, MV_INTERP_NEAREST>(voice, length);                \
+        }                                                                              \
+    } while (0)
+
 #define loopStartTagCount 3
 extern const char *loopStartTags[loopStartTagCount];
 #define loopEndTagCount 2
@@ -118,12 +118,16 @@ static void FillBuffer(int32_t bufnum)
     }
     while (1);
 
+    uint64_t const profileStart = MV_ProfileStart();
+
     if (ptr && remaining)
         FillBufferPosition((char *)ptr, remaining);
 
     if (ptr2 && remaining2)
         FillBufferPosition((char *)ptr2, remaining2);
 
+    MV_ProfileCallback(profileStart, remaining + remaining2);
+
     IDirectSoundBuffer_Unlock(lpdsbsec, ptr, remaining, ptr2, remaining2);
 }
 
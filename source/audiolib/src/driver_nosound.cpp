@@ -19,53 +19,310 @@
  */
 
 /**
- * Stub driver for no output
+ * Stub driver for no output, which can also run the mixer without a sound
+ * card and write what it mixes to a WAV file
  */
 
 #include "compat.h"
+#include "baselayer.h"
+#include "renderlayer.h"
+#include "thread.h"
+#include "vfs.h"
+#include "drivers.h"
+#include "driver_nosound.h"
+#include "multivoc.h"
 
+#include <atomic>
 
-int32_t NoSoundDrv_GetError(void)
+enum {
+   NSErr_Warning = -2,
+   NSErr_Error   = -1,
+   NSErr_Ok      = 0,
+   NSErr_OpenFile,
+   NSErr_CreateThread,
+};
+
+static int32_t ErrorCode = NSErr_Ok;
+
+static int32_t RenderMode = ASS_RENDER_NONE;
+static char *RenderFileName;
+
+static buildvfs_FILE RenderFile;
+static int32_t RenderRate;
+static int32_t RenderChannels;
+
+static char *MixBuffer;
+static int32_t MixBufferSize;
+static int32_t MixBufferCount;
+static int32_t MixBufferCurrent;
+static void (*MixCallBack)(void);
+
+static int32_t RenderPending;  // frames asked for by NoSoundDrv_Render() and not mixed yet
+static uint32_t RenderFrames;
+static uint64_t RenderMixTicks;
+static uint64_t RenderStartTicks;
+
+static thread_t RenderThread;
+static semaphore_t RenderLock;
+static bool RenderLockInited;
+static std::atomic<bool> RenderQuit;
+static bool RenderThreadRunning;
+
+static void WriteWaveHeader(uint32_t datasize)
+{
+    uint8_t header[44];
+    int32_t const blockalign = RenderChannels * sizeof(int16_t);
+
+    Bmemcpy(header, "RIFF", 4);
+    *(uint32_t *)(header + 4) = B_LITTLE32(datasize + 36);
+    Bmemcpy(header + 8, "WAVEfmt ", 8);
+    *(uint32_t *)(header + 16) = B_LITTLE32(16);
+    *(uint16_t *)(header + 20) = B_LITTLE16(1);
+    *(uint16_t *)(header + 22) = B_LITTLE16(RenderChannels);
+    *(uint32_t *)(header + 24) = B_LITTLE32(RenderRate);
+    *(uint32_t *)(header + 28) = B_LITTLE32(RenderRate * blockalign);
+    *(uint16_t *)(header + 32) = B_LITTLE16(blockalign);
+    *(uint16_t *)(header + 34) = B_LITTLE16(16);
+    Bmemcpy(header + 36, "data", 4);
+    *(uint32_t *)(header + 40) = B_LITTLE32(datasize);
+
+    buildvfs_fwrite(header, sizeof(header), 1, RenderFile);
+}
+
+// mixes one buffer and writes it out; the caller holds the lock
+static void RenderBuffer(void)
+{
+    uint64_t const start = timerGetTicksU64();
+    uint64_t const profileStart = MV_ProfileStart();
+
+    MixCallBack();
+
+    if (++MixBufferCurrent >= MixBufferCount)
+        MixBufferCurrent -= MixBufferCount;
+
+    RenderMixTicks += timerGetTicksU64() - start;
+    RenderFrames += MixBufferSize / (RenderChannels * sizeof(int16_t));
+
+    MV_ProfileCallback(profileStart, MixBufferSize);
+
+    if (!RenderFile)
+        return;
+
+    auto const buffer = (int16_t *)(MixBuffer + MixBufferCurrent * MixBufferSize);
+
+#if B_BIG_ENDIAN != 0
+    for (int i = 0; i < (MixBufferSize >> 1); i++)
+        buffer[i] = B_LITTLE16(buffer[i]);
+#endif
+
+    buildvfs_fwrite(buffer, MixBufferSize, 1, RenderFile);
+}
+
+static int32_t RenderThreadFunc(void *arg)
 {
+    UNREFERENCED_PARAMETER(arg);
+
+    uint64_t const frequency = timerGetFreqU64();
+
+    while (!RenderQuit.load(std::memory_order_relaxed))
+    {
+        semaphore_wait(&RenderLock);
+        RenderBuffer();
+        semaphore_post(&RenderLock);
+
+        if (RenderMode != ASS_RENDER_REALTIME)
+            continue;
+
+        // hold back to the rate a sound card would take the buffers at
+        uint64_t const due = RenderStartTicks + (uint64_t)RenderFrames * frequency / RenderRate;
+
+        while (timerGetTicksU64() < due && !RenderQuit.load(std::memory_order_relaxed))
+            idle();
+    }
+
     return 0;
 }
 
+void NoSoundDrv_SetRender(int32_t mode, char const *filename)
+{
+    DO_FREE_AND_NULL(RenderFileName);
+
+    RenderMode = mode;
+
+    if (filename)
+        RenderFileName = Xstrdup(filename);
+}
+
+void NoSoundDrv_Render(int32_t frames)
+{
+    if (RenderMode != ASS_RENDER_STEPPED || !MixCallBack)
+        return;
+
+    int32_t const buffer = MixBufferSize / (RenderChannels * sizeof(int16_t));
+
+    for (RenderPending += frames; RenderPending >= buffer; RenderPending -= buffer)
+        RenderBuffer();
+}
+
+void NoSoundDrv_GetRenderStats(soundrenderstats_t *stats)
+{
+    double const frequency = (double)timerGetFreqU64();
+
+    if (RenderLockInited)
+        semaphore_wait(&RenderLock);
+
+    stats->seconds    = RenderRate ? (double)RenderFrames / RenderRate : 0.0;
+    stats->mixseconds = (double)RenderMixTicks / frequency;
+    stats->wallseconds = RenderStartTicks ? (double)(timerGetTicksU64() - RenderStartTicks) / frequency : 0.0;
+
+    if (RenderLockInited)
+        semaphore_post(&RenderLock);
+}
+
+int32_t NoSoundDrv_GetError(void)
+{
+    return ErrorCode;
+}
+
 const char *NoSoundDrv_ErrorString( int32_t ErrorNumber )
 {
-    UNREFERENCED_PARAMETER(ErrorNumber);
-    return "No sound, Ok.";
+    const char *ErrorString;
+
+    switch( ErrorNumber ) {
+        case NSErr_Warning :
+        case NSErr_Error :
+            ErrorString = NoSoundDrv_ErrorString( ErrorCode );
+            break;
+
+        case NSErr_Ok :
+            ErrorString = "No sound, Ok.";
+            break;
+
+        case NSErr_OpenFile :
+            ErrorString = "Could not open the sound output file.";
+            break;
+
+        case NSErr_CreateThread :
+            ErrorString = "Could not start the mixing thread.";
+            break;
+
+        default:
+            ErrorString = "Unknown NoSound driver error.";
+            break;
+    }
+
+    return ErrorString;
 }
 
 int32_t NoSoundDrv_PCM_Init(int32_t *mixrate, int32_t *numchannels, void * initdata)
 {
-    UNREFERENCED_PARAMETER(mixrate);
-    UNREFERENCED_PARAMETER(numchannels);
     UNREFERENCED_PARAMETER(initdata);
-    return 0;
+
+    RenderRate     = *mixrate;
+    RenderChannels = *numchannels;
+    RenderFrames   = 0;
+    RenderMixTicks = 0;
+    RenderPending  = 0;
+
+    if (RenderMode == ASS_RENDER_NONE)
+        return NSErr_Ok;
+
+    if (RenderFileName)
+    {
+        RenderFile = buildvfs_fopen_write(RenderFileName);
+
+        if (!RenderFile)
+        {
+            ErrorCode = NSErr_OpenFile;
+            return NSErr_Error;
+        }
+
+        // the sizes are filled in on shutdown
+        WriteWaveHeader(0);
+    }
+
+    if (semaphore_init(&RenderLock, 1) == 0)
+        RenderLockInited = true;
+
+    return NSErr_Ok;
 }
 
 void NoSoundDrv_PCM_Shutdown(void)
 {
+    if (RenderMode != ASS_RENDER_NONE && MV_Printf)
+    {
+        soundrenderstats_t stats;
+        NoSoundDrv_GetRenderStats(&stats);
+
+        MV_Printf("Mixed %.1f s of sound in %.2f s, %.1fx real time\n", stats.seconds, stats.mixseconds,
+                  stats.seconds / max(stats.mixseconds, 1e-6));
+    }
+
+    if (RenderFile)
+    {
+        buildvfs_rewind(RenderFile);
+        WriteWaveHeader(RenderFrames * RenderChannels * sizeof(int16_t));
+        buildvfs_fclose(RenderFile);
+        RenderFile = NULL;
+    }
+
+    if (RenderLockInited)
+    {
+        semaphore_destroy(&RenderLock);
+        RenderLockInited = false;
+    }
 }
 
 int32_t NoSoundDrv_PCM_BeginPlayback(char *BufferStart, int32_t BufferSize,
                         int32_t NumDivisions, void ( *CallBackFunc )( void ) )
 {
-    UNREFERENCED_PARAMETER(BufferStart);
-    UNREFERENCED_PARAMETER(BufferSize);
-    UNREFERENCED_PARAMETER(NumDivisions);
-    UNREFERENCED_PARAMETER(CallBackFunc);
-    return 0;
+    if (RenderMode == ASS_RENDER_NONE)
+        return NSErr_Ok;
+
+    MixBuffer        = BufferStart;
+    MixBufferSize    = BufferSize;
+    MixBufferCount   = NumDivisions;
+    MixBufferCurrent = 1;  // MultiVoc starts on this buffer, and moves to the next before mixing each
+    MixCallBack      = CallBackFunc;
+    RenderStartTicks = timerGetTicksU64();
+
+    if (RenderMode == ASS_RENDER_STEPPED)
+        return NSErr_Ok;
+
+    RenderQuit.store(false, std::memory_order_relaxed);
+
+    if (!RenderLockInited || thread_create(&RenderThread, RenderThreadFunc, NULL, "mv_render"))
+    {
+        MixCallBack = NULL;
+        ErrorCode = NSErr_CreateThread;
+        return NSErr_Error;
+    }
+
+    RenderThreadRunning = true;
+
+    return NSErr_Ok;
 }
 
 void NoSoundDrv_PCM_StopPlayback(void)
 {
+    if (RenderThreadRunning)
+    {
+        RenderQuit.store(true, std::memory_order_relaxed);
+        thread_join(&RenderThread);
+        RenderThreadRunning = false;
+    }
+
+    MixCallBack = NULL;
 }
 
 void NoSoundDrv_PCM_Lock(void)
 {
+    if (RenderThreadRunning)
+        semaphore_wait(&RenderLock);
 }
 
 void NoSoundDrv_PCM_Unlock(void)
 {
+    if (RenderThreadRunning)
+        semaphore_post(&RenderLock);
 }
@@ -68,6 +68,9 @@ static inline void fillData(int chan, void *ptr, int remaining, void *udata)
 
     sceKernelWaitSema(psp_driver.semaUID, 1, NULL);
 
+    uint64_t const profileStart = MV_ProfileStart();
+    int32_t const bytes = remaining;
+
     while (remaining > 0)
     {
         if (MixBufferUsed == MixBufferSize)
@@ -96,6 +99,8 @@ static inline void fillData(int chan, void *ptr, int remaining, void *udata)
         }
     }
 
+    MV_ProfileCallback(profileStart, bytes);
+
     sceKernelSignalSema(psp_driver.semaUID, 1);
 }
 
@@ -72,6 +72,9 @@ static void fillData(int chan, void *ptr, int remaining, void *udata)
 
     SDL_LockMutex(EffectFence);
 
+    uint64_t const profileStart = MV_ProfileStart();
+    int32_t const bytes = remaining;
+
     while (remaining > 0) {
         if (MixBufferUsed == MixBufferSize) {
             MixCallBack();
@@ -99,6 +102,8 @@ static void fillData(int chan, void *ptr, int remaining, void *udata)
         }
     }
 
+    MV_ProfileCallback(profileStart, bytes);
+
     SDL_UnlockMutex(EffectFence);
 }
 
@@ -36,6 +36,7 @@
 #endif
 
 int32_t ASS_SoundDriver = -1;
+int32_t ASS_PreferredSoundDriver = -1;
 
 #define UNSUPPORTED { 0,0,0,0,0,0,0,0, },
 
@@ -303,6 +303,15 @@ void MV_SetFLACPosition(VoiceNode *voice, int32_t position)
     FLAC__stream_decoder_seek_absolute(fd->stream, position);
 }
 
+// write_flac_stream() fills in the owner voice, so a voice whose decoder
+// was moved to another VoiceNode has to say so
+void MV_SetFLACOwner(VoiceNode *voice)
+{
+    flac_data *fd = (flac_data *)voice->rawdataptr;
+
+    fd->owner = voice;
+}
+
 /*---------------------------------------------------------------------
 Function: MV_GetNextFLACBlock
 
@@ -366,130 +375,16 @@ static playbackstatus MV_GetNextFLACBlock(VoiceNode *voice)
 
 
 /*---------------------------------------------------------------------
-Function: MV_PlayFLAC3D
+Function: MV_GetFLACMetadata
 
-Begin playback of sound data at specified angle and distance
-from listener.
+Reads the stream info and loop tags of a FLAC sound into voice.
+Returns MV_Error if the sound has neither one nor two channels.
 ---------------------------------------------------------------------*/
 
-int32_t MV_PlayFLAC3D(char *ptr, uint32_t length, int32_t loophow, int32_t pitchoffset, int32_t angle, int32_t distance, int32_t priority, float volume, uint32_t callbackval)
+static int32_t MV_GetFLACMetadata(VoiceNode *voice, flac_data *fd)
 {
-    int32_t left;
-    int32_t right;
-    int32_t mid;
-    int32_t vol;
-    int32_t status;
-
-    if (!MV_Installed)
-    {
-        MV_SetErrorCode(MV_NotInstalled);
-        return MV_Error;
-    }
-
-    if (distance < 0)
-    {
-        distance = -distance;
-        angle += MV_NUMPANPOSITIONS / 2;
-    }
-
-    vol = MIX_VOLUME(distance);
-
-    // Ensure angle is within 0 - 127
-    angle &= MV_MAXPANPOSITION;
-
-    left = MV_PanTable[angle][vol].left;
-    right = MV_PanTable[angle][vol].right;
-    mid = max(0, 255 - distance);
-
-    status = MV_PlayFLAC(ptr, length, loophow, -1, pitchoffset, mid, left, right, priority, volume, callbackval);
-
-    return status;
-}
-
-
-/*---------------------------------------------------------------------
-Function: MV_PlayFLAC
-
-Begin playback of sound data with the given sound levels and
-priority.
----------------------------------------------------------------------*/
-
-int32_t MV_PlayFLAC(char *ptr, uint32_t length, int32_t loopstart, int32_t loopend, int32_t pitchoffset, int32_t vol, int32_t left, int32_t right, int32_t priority, float volume, uint32_t callbackval)
-{
-    VoiceNode *voice;
-    flac_data *fd = 0;
     FLAC__Metadata_Chain *metadata_chain;
 
-    UNREFERENCED_PARAMETER(loopend);
-
-    if (!MV_Installed)
-    {
-        MV_SetErrorCode(MV_NotInstalled);
-        return MV_Error;
-    }
-
-    fd = (flac_data *)calloc(1, sizeof(flac_data));
-    if (!fd)
-    {
-        MV_SetErrorCode(MV_InvalidFile);
-        return MV_Error;
-    }
-
-    fd->ptr = ptr;
-    fd->pos = 0;
-    fd->blocksize = 0;
-    fd->length = length;
-
-    fd->block = NULL;
-
-    fd->stream = FLAC__stream_decoder_new();
-    fd->sample_pos = 0;
-
-    FLAC__stream_decoder_set_metadata_ignore_all(fd->stream);
-
-    if (FLAC__stream_decoder_init_stream(fd->stream, read_flac_stream, seek_flac_stream, tell_flac_stream,
-                                         length_flac_stream, eof_flac_stream, write_flac_stream,
-                                         /*metadata_flac_stream*/ NULL, error_flac_stream,
-                                         (void *)fd) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
-    {
-        free(fd);
-        MV_Printf("MV_PlayFLAC: %s\n", FLAC__stream_decoder_get_resolved_state_string(fd->stream));
-        MV_SetErrorCode(MV_InvalidFile);
-        return MV_Error;
-    }
-
-    // Request a voice from the voice pool
-    voice = MV_AllocVoice(priority);
-    if (voice == NULL)
-    {
-        FLAC__stream_decoder_finish(fd->stream);
-        FLAC__stream_decoder_delete(fd->stream);
-        free(fd);
-        MV_SetErrorCode(MV_NoVoices);
-        return MV_Error;
-    }
-
-    fd->owner = voice;
-
-    voice->wavetype = FMT_FLAC;
-    voice->rawdataptr = (void *)fd;
-    voice->GetSound = MV_GetNextFLACBlock;
-    voice->NextBlock = fd->block;
-    voice->LoopCount = 0;
-    voice->BlockLength = 0;
-    voice->PitchScale = PITCH_GetScale(pitchoffset);
-    voice->next = NULL;
-    voice->prev = NULL;
-    voice->priority = priority;
-    voice->callbackval = callbackval;
-
-    voice->Paused = FALSE;
-
-    voice->LoopStart = 0;
-    voice->LoopEnd = 0;
-    voice->LoopSize = (loopstart >= 0 ? 1 : 0);
-
-    // parse metadata
     // loop parsing designed with multiple repetitions in mind
     // In retrospect, it may be possible to MV_GetVorbisCommentLoops(voice, (vorbis_comment *)
     // &tags->data.vorbis_comment)
@@ -522,10 +417,6 @@ int32_t MV_PlayFLAC(char *ptr, uint32_t length, int32_t loopstart, int32_t loope
                             FLAC__metadata_object_delete(tags);
                             FLAC__metadata_iterator_delete(metadata_iterator);
                             // FLAC__metadata_chain_delete(metadata_chain);
-                            FLAC__stream_decoder_finish(fd->stream);
-                            FLAC__stream_decoder_delete(fd->stream);
-                            free(fd);
-                            MV_SetErrorCode(MV_InvalidFile);
                             return MV_Error;
                         }
 
@@ -622,6 +513,142 @@ int32_t MV_PlayFLAC(char *ptr, uint32_t length, int32_t loopstart, int32_t loope
     else
         MV_Printf("Error allocating FLAC__Metadata_Chain!\n");
 
+    return MV_Ok;
+}
+
+/*---------------------------------------------------------------------
+Function: MV_PlayFLAC3D
+
+Begin playback of sound data at specified angle and distance
+from listener.
+---------------------------------------------------------------------*/
+
+int32_t MV_PlayFLAC3D(char *ptr, uint32_t length, int32_t loophow, int32_t pitchoffset, int32_t angle, int32_t distance, int32_t priority, float volume, uint32_t callbackval)
+{
+    int32_t left;
+    int32_t right;
+    int32_t mid;
+    int32_t vol;
+    int32_t status;
+
+    if (!MV_Installed)
+    {
+        MV_SetErrorCode(MV_NotInstalled);
+        return MV_Error;
+    }
+
+    if (distance < 0)
+    {
+        distance = -distance;
+        angle += MV_NUMPANPOSITIONS / 2;
+    }
+
+    vol = MIX_VOLUME(distance);
+
+    // Ensure angle is within 0 - 127
+    angle &= MV_MAXPANPOSITION;
+
+    left = MV_PanTable[angle][vol].left;
+    right = MV_PanTable[angle][vol].right;
+    mid = max(0, 255 - distance);
+
+    status = MV_PlayFLAC(ptr, length, loophow, -1, pitchoffset, mid, left, right, priority, volume, callbackval);
+
+    return status;
+}
+
+
+/*---------------------------------------------------------------------
+Function: MV_PlayFLAC
+
+Begin playback of sound data with the given sound levels and
+priority.
+---------------------------------------------------------------------*/
+
+int32_t MV_PlayFLAC(char *ptr, uint32_t length, int32_t loopstart, int32_t loopend, int32_t pitchoffset, int32_t vol, int32_t left, int32_t right, int32_t priority, float volume, uint32_t callbackval)
+{
+    VoiceNode *voice;
+    flac_data *fd = 0;
+
+    UNREFERENCED_PARAMETER(loopend);
+
+    if (!MV_Installed)
+    {
+        MV_SetErrorCode(MV_NotInstalled);
+        return MV_Error;
+    }
+
+    fd = (flac_data *)calloc(1, sizeof(flac_data));
+    if (!fd)
+    {
+        MV_SetErrorCode(MV_InvalidFile);
+        return MV_Error;
+    }
+
+    fd->ptr = ptr;
+    fd->pos = 0;
+    fd->blocksize = 0;
+    fd->length = length;
+
+    fd->block = NULL;
+
+    fd->stream = FLAC__stream_decoder_new();
+    fd->sample_pos = 0;
+
+    FLAC__stream_decoder_set_metadata_ignore_all(fd->stream);
+
+    if (FLAC__stream_decoder_init_stream(fd->stream, read_flac_stream, seek_flac_stream, tell_flac_stream,
+                                         length_flac_stream, eof_flac_stream, write_flac_stream,
+                                         /*metadata_flac_stream*/ NULL, error_flac_stream,
+                                         (void *)fd) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+    {
+        free(fd);
+        MV_Printf("MV_PlayFLAC: %s\n", FLAC__stream_decoder_get_resolved_state_string(fd->stream));
+        MV_SetErrorCode(MV_InvalidFile);
+        return MV_Error;
+    }
+
+    // Request a voice from the voice pool
+    voice = MV_AllocVoice(priority);
+    if (voice == NULL)
+    {
+        FLAC__stream_decoder_finish(fd->stream);
+        FLAC__stream_decoder_delete(fd->stream);
+        free(fd);
+        MV_SetErrorCode(MV_NoVoices);
+        return MV_Error;
+    }
+
+    fd->owner = voice;
+
+    voice->wavetype = FMT_FLAC;
+    voice->rawdataptr = (void *)fd;
+    voice->GetSound = MV_GetNextFLACBlock;
+    voice->NextBlock = fd->block;
+    voice->LoopCount = 0;
+    voice->BlockLength = 0;
+    voice->PitchScale = PITCH_GetScale(pitchoffset);
+    voice->next = NULL;
+    voice->prev = NULL;
+    voice->priority = priority;
+    voice->callbackval = callbackval;
+
+    voice->Paused = FALSE;
+
+    voice->LoopStart = 0;
+    voice->LoopEnd = 0;
+    voice->LoopSize = (loopstart >= 0 ? 1 : 0);
+
+    // parse metadata
+    if (MV_GetFLACMetadata(voice, fd) != MV_Ok)
+    {
+        FLAC__stream_decoder_finish(fd->stream);
+        FLAC__stream_decoder_delete(fd->stream);
+        free(fd);
+        MV_SetErrorCode(MV_InvalidFile);
+        return MV_Error;
+    }
+
     // CODEDUP multivoc.c MV_SetVoicePitch
     voice->RateScale = (voice->SamplingRate * voice->PitchScale) / MV_MixRate;
     voice->FixedPointBufferSize = (voice->RateScale * MV_MIXBUFFERSIZE) - voice->RateScale;
@@ -634,6 +661,78 @@ int32_t MV_PlayFLAC(char *ptr, uint32_t length, int32_t loopstart, int32_t loope
 }
 
 
+/*---------------------------------------------------------------------
+Function: MV_DecodeFLAC
+
+Decodes a whole 16-bit FLAC sound for the decoded sound cache. Sounds
+with loop tags or more than maxbytes of PCM are left to MV_PlayFLAC.
+---------------------------------------------------------------------*/
+
+int32_t MV_DecodeFLAC(char const *ptr, uint32_t length, uint32_t maxbytes, decoded_sound *snd)
+{
+    auto fd = (flac_data *)calloc(1, sizeof(flac_data));
+
+    if (!fd)
+        return MV_Error;
+
+    // write_flac_stream() reports each frame through its owner voice
+    VoiceNode voice;
+    Bmemset(&voice, 0, sizeof(voice));
+
+    fd->ptr    = const_cast<char *>(ptr);
+    fd->length = length;
+    fd->owner  = &voice;
+    fd->stream = FLAC__stream_decoder_new();
+
+    FLAC__stream_decoder_set_metadata_ignore_all(fd->stream);
+
+    int32_t status = MV_Error;
+
+    if (FLAC__stream_decoder_init_stream(fd->stream, read_flac_stream, seek_flac_stream, tell_flac_stream,
+                                         length_flac_stream, eof_flac_stream, write_flac_stream,
+                                         /*metadata_flac_stream*/ NULL, error_flac_stream,
+                                         (void *)fd) == FLAC__STREAM_DECODER_INIT_STATUS_OK &&
+        MV_GetFLACMetadata(&voice, fd) == MV_Ok && voice.LoopSize == 0 && voice.bits == 16)
+    {
+        snd->channels = voice.channels;
+        snd->rate     = voice.SamplingRate;
+        status        = MV_Ok;
+
+        while (status == MV_Ok)
+        {
+            voice.length = 0;
+
+            FLAC__bool const decoded = FLAC__stream_decoder_process_single(fd->stream);
+            FLAC__StreamDecoderState const decode_state = FLAC__stream_decoder_get_state(fd->stream);
+
+            if (voice.length > 0)
+            {
+                uint32_t const numframes = voice.length >> 16;
+
+                if (voice.bits != 16 || voice.channels != snd->channels ||
+                    (snd->numframes + numframes) * snd->channels * 2 > maxbytes)
+                    status = MV_Error;
+                else
+                    MV_AppendDecoded(snd, fd->block, numframes);
+            }
+
+            if (decode_state == FLAC__STREAM_DECODER_END_OF_STREAM)
+                break;
+
+            if (!decoded || decode_state > FLAC__STREAM_DECODER_END_OF_STREAM)
+                status = MV_Error;
+        }
+    }
+
+    FLAC__stream_decoder_finish(fd->stream);
+    FLAC__stream_decoder_delete(fd->stream);
+    free(fd->block);
+    free(fd);
+
+    return status;
+}
+
+
 void MV_ReleaseFLACVoice(VoiceNode *voice)
 {
     flac_data *fd = (flac_data *)voice->rawdataptr;
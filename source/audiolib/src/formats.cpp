@@ -21,7 +21,7 @@
  */
 
 /**
- * Raw, WAV, and VOC source support for MultiVoc
+ * Raw, WAV, and VOC source support for MultiVoc, and the decoded sound cache
  */
 
 #include "compat.h"
@@ -486,3 +486,293 @@ int32_t MV_PlayVOC(char *ptr, uint32_t length, int32_t loopstart, int32_t loopen
     return voice->handle;
 }
 
+
+/*---------------------------------------------------------------------
+   Decoded sound cache
+
+   Compressed sound effects are decoded in full the first time they
+   are played (or precached) and then mixed from memory through
+   MV_GetNextWAVBlock, so overlapping copies of one effect share a
+   single buffer instead of running a decoder each. The entries form
+   a list in least recently used order. The oldest ones that no voice
+   is reading are freed when the cache grows past its budget.
+
+   Everything here runs on the thread that starts sounds. The mixer
+   only drops references in MV_ReleaseDecodedVoice.
+---------------------------------------------------------------------*/
+
+#if defined MIXERTYPEPSP
+int32_t MV_DecodeCacheSize = 2048;
+#else
+int32_t MV_DecodeCacheSize = 8192;
+#endif
+
+static decoded_sound *MV_DecodedHead;
+static decoded_sound *MV_DecodedTail;
+static decodecachestats_t MV_DecodeCacheStats;
+
+// sounds decoding to more than this share of the budget stay compressed
+#define MV_DECODEDMAXSHARE 8
+
+static uint32_t MV_DecodedCost(decoded_sound const *snd) { return sizeof(decoded_sound) + snd->size; }
+
+static uint32_t MV_HashSound(char const *ptr, uint32_t length)
+{
+    uint32_t const count = min(length, 256u);
+    uint32_t hash = 2166136261u ^ length;
+
+    for (uint32_t i = 0; i < count; i++)
+        hash = (hash ^ (uint8_t)ptr[i]) * 16777619u;
+
+    for (uint32_t i = length - count; i < length; i++)
+        hash = (hash ^ (uint8_t)ptr[i]) * 16777619u;
+
+    return hash;
+}
+
+static void MV_UnlinkDecoded(decoded_sound *snd)
+{
+    if (snd->prev)
+        snd->prev->next = snd->next;
+    else
+        MV_DecodedHead = snd->next;
+
+    if (snd->next)
+        snd->next->prev = snd->prev;
+    else
+        MV_DecodedTail = snd->prev;
+}
+
+static void MV_LinkDecoded(decoded_sound *snd)
+{
+    snd->prev = NULL;
+    snd->next = MV_DecodedHead;
+
+    if (MV_DecodedHead)
+        MV_DecodedHead->prev = snd;
+    else
+        MV_DecodedTail = snd;
+
+    MV_DecodedHead = snd;
+}
+
+static void MV_FreeDecoded(decoded_sound *snd)
+{
+    MV_UnlinkDecoded(snd);
+
+    MV_DecodeCacheStats.entries--;
+    MV_DecodeCacheStats.bytes -= MV_DecodedCost(snd);
+
+    Bfree(snd->data);
+    Bfree(snd);
+}
+
+// frees the least recently used entries other than <keep> until the cache fits in <budget> bytes
+static void MV_TrimDecodeCache(uint32_t budget, decoded_sound const *keep)
+{
+    for (decoded_sound *snd = MV_DecodedTail, *prev; snd && MV_DecodeCacheStats.bytes > budget; snd = prev)
+    {
+        prev = snd->prev;
+
+        if (snd != keep && snd->refs.load(std::memory_order_acquire) == 0)
+        {
+            MV_FreeDecoded(snd);
+            MV_DecodeCacheStats.evictions++;
+        }
+    }
+}
+
+void MV_AppendDecoded(decoded_sound *snd, void const *pcm, uint32_t numframes)
+{
+    uint32_t const framesize = snd->channels * sizeof(int16_t);
+    uint32_t const needed = (snd->numframes + numframes) * framesize;
+
+    if (needed > snd->size)
+    {
+        snd->size = max(needed, snd->size * 2);
+        snd->data = (int16_t *)Xrealloc(snd->data, snd->size);
+    }
+
+    Bmemcpy((char *)snd->data + snd->numframes * framesize, pcm, numframes * framesize);
+    snd->numframes += numframes;
+}
+
+static decoded_sound *MV_GetDecodedSound(wavefmt_t fmt, char const *ptr, uint32_t length, int32_t count)
+{
+    uint32_t const budget = (uint32_t)MV_DecodeCacheSize << 10;
+
+    if (budget == 0)
+    {
+        MV_TrimDecodeCache(0, NULL);
+        return NULL;
+    }
+
+    uint32_t const hash = MV_HashSound(ptr, length);
+
+    for (decoded_sound *snd = MV_DecodedHead; snd; snd = snd->next)
+    {
+        if (snd->ptr == ptr && snd->length == length && snd->hash == hash)
+        {
+            MV_UnlinkDecoded(snd);
+            MV_LinkDecoded(snd);
+
+            if (snd->data)
+                MV_DecodeCacheStats.hits += count;
+            else
+                MV_DecodeCacheStats.misses += count;
+
+            return snd;
+        }
+    }
+
+    MV_DecodeCacheStats.misses += count;
+
+    auto snd = (decoded_sound *)Xcalloc(1, sizeof(decoded_sound));
+
+    snd->ptr    = ptr;
+    snd->length = length;
+    snd->hash   = hash;
+
+    uint32_t const maxbytes = budget / MV_DECODEDMAXSHARE;
+    int32_t status = MV_Error;
+
+    switch (fmt)
+    {
+#ifdef HAVE_VORBIS
+        case FMT_VORBIS: status = MV_DecodeVorbis(ptr, length, maxbytes, snd); break;
+#endif
+#ifdef HAVE_FLAC
+        case FMT_FLAC: status = MV_DecodeFLAC(ptr, length, maxbytes, snd); break;
+#endif
+        case FMT_XA: status = MV_DecodeXA(ptr, length, maxbytes, snd); break;
+        default: break;
+    }
+
+    // an entry without data remembers not to try again
+    if (status != MV_Ok || snd->numframes == 0)
+    {
+        DO_FREE_AND_NULL(snd->data);
+        snd->size = snd->numframes = 0;
+    }
+    else if (snd->size > snd->numframes * snd->channels * sizeof(int16_t))
+    {
+        snd->size = snd->numframes * snd->channels * sizeof(int16_t);
+        snd->data = (int16_t *)Xrealloc(snd->data, snd->size);
+    }
+
+    MV_LinkDecoded(snd);
+
+    MV_DecodeCacheStats.entries++;
+    MV_DecodeCacheStats.bytes += MV_DecodedCost(snd);
+
+    MV_TrimDecodeCache(budget, snd);
+
+    return snd;
+}
+
+// fills the cache ahead of play, but never evicts anything for it
+void MV_PrecacheDecoded(wavefmt_t fmt, char const *ptr, uint32_t length)
+{
+    if (MV_Installed && MV_DecodeCacheStats.bytes < ((uint32_t)MV_DecodeCacheSize << 10))
+        MV_GetDecodedSound(fmt, ptr, length, 0);
+}
+
+void MV_GetDecodeCacheStats(decodecachestats_t *stats) { *stats = MV_DecodeCacheStats; }
+
+void MV_ClearDecodeCache(void)
+{
+    MV_TrimDecodeCache(0, NULL);
+}
+
+void MV_ReleaseDecodedVoice(VoiceNode *voice)
+{
+    if (voice->wavetype != FMT_RAW)
+        return;
+
+    auto snd = (decoded_sound *)voice->rawdataptr;
+
+    snd->refs.fetch_sub(1, std::memory_order_release);
+
+    voice->rawdataptr = 0;
+}
+
+int32_t MV_PlayDecoded3D(wavefmt_t fmt, char *ptr, uint32_t length, int32_t loophow, int32_t pitchoffset, int32_t angle,
+                         int32_t distance, int32_t priority, float volume, uint32_t callbackval)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    if (distance < 0)
+    {
+        distance  = -distance;
+        angle    += MV_NUMPANPOSITIONS / 2;
+    }
+
+    int const vol = MIX_VOLUME(distance);
+
+    // Ensure angle is within 0 - 127
+    angle &= MV_MAXPANPOSITION;
+
+    return MV_PlayDecoded(fmt, ptr, length, loophow, -1, pitchoffset, max(0, 255 - distance),
+        MV_PanTable[ angle ][ vol ].left, MV_PanTable[ angle ][ vol ].right, priority, volume, callbackval);
+}
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayDecoded
+
+   Plays a compressed sound from the decoded sound cache, decoding it
+   first if it is not there yet. Returns MV_Ok without playing anything
+   when the sound is music, the cache is disabled or the sound can not
+   be cached; the caller then plays it through its own decoder.
+---------------------------------------------------------------------*/
+
+int32_t MV_PlayDecoded(wavefmt_t fmt, char *ptr, uint32_t length, int32_t loopstart, int32_t loopend, int32_t pitchoffset,
+                       int32_t vol, int32_t left, int32_t right, int32_t priority, float volume, uint32_t callbackval)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    if (priority == MV_MUSIC_PRIORITY)
+        return MV_Ok;
+
+    decoded_sound *snd = MV_GetDecodedSound(fmt, ptr, length, 1);
+
+    if (snd == NULL || snd->data == NULL)
+        return MV_Ok;
+
+    VoiceNode *voice = MV_AllocVoice(priority);
+
+    if (voice == NULL)
+    {
+        MV_SetErrorCode(MV_NoVoices);
+        return MV_Error;
+    }
+
+    snd->refs.fetch_add(1, std::memory_order_relaxed);
+
+    voice->wavetype    = FMT_RAW;
+    voice->bits        = 16;
+    voice->channels    = snd->channels;
+    voice->GetSound    = MV_GetNextWAVBlock;
+    voice->rawdataptr  = (void *)snd;
+    voice->ptrlength   = snd->size;
+    voice->Paused      = FALSE;
+    voice->LoopCount   = 0;
+    voice->position    = 0;
+    voice->length      = 0;
+    voice->BlockLength = snd->numframes;
+    voice->NextBlock   = (char const *)snd->data;
+    voice->next        = NULL;
+    voice->prev        = NULL;
+    voice->priority    = priority;
+    voice->callbackval = callbackval;
+    voice->LoopStart   = loopstart >= 0 ? voice->NextBlock : NULL;
+    voice->LoopEnd     = NULL;
+    voice->LoopSize    = loopend > 0 ? min<uint32_t>(loopend - loopstart + 1, snd->numframes) : snd->numframes;
+
+    MV_SetVoicePitch(voice, snd->rate, pitchoffset);
+    MV_SetVoiceVolume(voice, vol, left, right, volume);
+    MV_PlayVoice(voice);
+
+    return voice->handle;
+}
@@ -60,6 +60,9 @@ int32_t FX_Init(int32_t numvoices, int32_t numchannels, unsigned mixrate, void *
     int SoundCard = ASS_NoSound;
 #endif
 
+    if (ASS_PreferredSoundDriver >= 0)
+        SoundCard = ASS_PreferredSoundDriver;
+
     if (SoundDriver_IsSupported(SoundCard) == 0)
     {
         // unsupported cards fall back to no sound
@@ -136,18 +139,32 @@ static wavefmt_t FX_DetectFormat(char const * const ptr, uint32_t length)
     return fmt;
 }
 
+// formats that MV_PlayDecoded can serve from the decoded sound cache
+static inline bool FX_IsCompressed(wavefmt_t fmt) { return fmt == FMT_VORBIS || fmt == FMT_FLAC || fmt == FMT_XA; }
+
+void FX_PrecacheSound(char const *ptr, uint32_t ptrlength)
+{
+    wavefmt_t const fmt = FX_DetectFormat(ptr, ptrlength);
+
+    if (FX_IsCompressed(fmt))
+        MV_PrecacheDecoded(fmt, ptr, ptrlength);
+}
+
 int32_t FX_Play(char *ptr, uint32_t ptrlength, int32_t loopstart, int32_t loopend, int32_t pitchoffset,
                           int32_t vol, int32_t left, int32_t right, int32_t priority, float volume, uint32_t callbackval)
 {
     static int32_t(*const func[])(char *, uint32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, float, uint32_t) =
-    { NULL, NULL, MV_PlayVOC, MV_PlayWAV, MV_PlayVorbis, MV_PlayFLAC, MV_PlayXA, MV_PlayXMP };
+    { NULL, NULL, MV_PlayVOC, MV_PlayWAV, MV_PlayVorbis, MV_PlayFLAC, MV_PlayXA, MV_PlayXMP, NULL };
 
     EDUKE32_STATIC_ASSERT(FMT_MAX == ARRAY_SIZE(func));
 
     wavefmt_t const fmt = FX_DetectFormat(ptr, ptrlength);
 
-    int handle =
-    (func[fmt]) ? func[fmt](ptr, ptrlength, loopstart, loopend, pitchoffset, vol, left, right, priority, volume, callbackval) : -1;
+    int handle = FX_IsCompressed(fmt) ? MV_PlayDecoded(fmt, ptr, ptrlength, loopstart, loopend, pitchoffset, vol, left, right,
+                                                       priority, volume, callbackval) : MV_Ok;
+
+    if (handle == MV_Ok)
+        handle = (func[fmt]) ? func[fmt](ptr, ptrlength, loopstart, loopend, pitchoffset, vol, left, right, priority, volume, callbackval) : -1;
 
     if (handle <= MV_Ok)
     {
@@ -162,20 +179,25 @@ int32_t FX_Play3D(char *ptr, uint32_t ptrlength, int32_t loophow, int32_t pitcho
                       int32_t priority, float volume, uint32_t callbackval)
 {
     static int32_t (*const func[])(char *, uint32_t, int32_t, int32_t, int32_t, int32_t, int32_t, float, uint32_t) =
-    { NULL, NULL, MV_PlayVOC3D, MV_PlayWAV3D, MV_PlayVorbis3D, MV_PlayFLAC3D, MV_PlayXA3D, MV_PlayXMP3D };
+    { NULL, NULL, MV_PlayVOC3D, MV_PlayWAV3D, MV_PlayVorbis3D, MV_PlayFLAC3D, MV_PlayXA3D, MV_PlayXMP3D, NULL };
 
     EDUKE32_STATIC_ASSERT(FMT_MAX == ARRAY_SIZE(func));
 
     wavefmt_t const fmt = FX_DetectFormat(ptr, ptrlength);
 
-    int handle =
-    (func[fmt]) ? func[fmt](ptr, ptrlength, loophow, pitchoffset, angle, distance, priority, volume, callbackval) : -1;
+    int handle = FX_IsCompressed(fmt) ? MV_PlayDecoded3D(fmt, ptr, ptrlength, loophow, pitchoffset, angle, distance, priority,
+                                                         volume, callbackval) : MV_Ok;
+
+    if (handle == MV_Ok)
+        handle = (func[fmt]) ? func[fmt](ptr, ptrlength, loophow, pitchoffset, angle, distance, priority, volume, callbackval) : -1;
 
     if (handle <= MV_Ok)
     {
         FX_SetErrorCode(FX_MultiVocError);
         handle = FX_Warning;
     }
+    else
+        MV_Pan3D(handle, angle, distance);  // so that the voice can be binaural from the start
 
     return handle;
 }
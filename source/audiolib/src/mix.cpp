@@ -145,25 +145,451 @@ uint32_t MV_Mix16BitStereo16(struct VoiceNode const * const voice, uint32_t leng
     return position;
 }
 
-void MV_16BitReverb(char const *src, char *dest, const int16_t *volume, int32_t count)
+// mono source, one output channel every MV_SampleSize>>1 bus samples
+template <typename S, int interp>
+static uint32_t MV_MixBusMonoSource(struct VoiceNode const * const voice, uint32_t length)
 {
-    auto input  = (uint16_t const *)src;
-    auto output = (int16_t *)dest;
+    auto const source = (S const *)voice->sound;
+    auto       dest   = (int32_t *)MV_MixDestination;
 
-    do
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    int32_t const  last     = max<int32_t>((voice->length >> 16) - 1, 0);
+    float const   *table    = MV_ResampleTable<interp>(rate);
+    float const    gain     = MV_LeftGain;
+    int const      stride   = MV_SampleSize >> 1;
+
+    if (stride == 1)
     {
-        int const sample0 = *input++;
-#if 0  // def BIGENDIAN
-        int sample0l = sample0 >> 8;
-        int sample0h = (sample0 & 255) ^ 128;
+        float const gains[4] = { gain, gain, gain, gain };
+
+        for (; length >= 4; length -= 4, dest += 4, position += rate * 4)
+        {
+            float samples[4];
+
+            MV_BusFetch4<interp>(samples, source, position, rate, last, 1, 0, table);
+            MV_BusAdd4(dest, samples, gains);
+        }
+    }
+
+    for (; length > 0; length--, dest += stride, position += rate)
+        *dest += Blrintf(MV_BusFetch<interp>(source, position, last, 1, 0, table) * gain);
+
+    MV_MixDestination = (char *)dest;
+
+    return position;
+}
+
+// mono source, interleaved stereo output
+template <typename S, int interp>
+static uint32_t MV_MixBusMonoSourceStereo(struct VoiceNode const * const voice, uint32_t length)
+{
+    auto const source = (S const *)voice->sound;
+    auto       dest   = (int32_t *)MV_MixDestination;
+
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    int32_t const  last     = max<int32_t>((voice->length >> 16) - 1, 0);
+    float const   *table    = MV_ResampleTable<interp>(rate);
+    float const    gains[4] = { MV_LeftGain, MV_RightGain, MV_LeftGain, MV_RightGain };
+
+    for (; length >= 4; length -= 4, dest += 8, position += rate * 4)
+    {
+        float s[4];
+
+        MV_BusFetch4<interp>(s, source, position, rate, last, 1, 0, table);
+
+        float const samples[8] = { s[0], s[0], s[1], s[1], s[2], s[2], s[3], s[3] };
+
+        MV_BusAdd4(dest, samples, gains);
+        MV_BusAdd4(dest + 4, samples + 4, gains);
+    }
+
+    for (; length > 0; length--, dest += 2, position += rate)
+    {
+        float const sample0 = MV_BusFetch<interp>(source, position, last, 1, 0, table);
+
+        dest[0] += Blrintf(sample0 * gains[0]);
+        dest[1] += Blrintf(sample0 * gains[1]);
+    }
+
+    MV_MixDestination = (char *)dest;
+
+    return position;
+}
+
+uint32_t MV_MixBusMono(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusMonoSource, uint8_t); }
+uint32_t MV_MixBusStereo(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusMonoSourceStereo, uint8_t); }
+uint32_t MV_MixBusMono16(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusMonoSource, int16_t); }
+uint32_t MV_MixBusStereo16(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusMonoSourceStereo, int16_t); }
+
+// saturates the bus to 16 bits; count is a multiple of 8
+void MV_BusToInt16(int32_t const *src, int16_t *dest, int32_t count)
+{
+#if defined MV_BUS_SSE2
+    for (; count > 0; count -= 8, src += 8, dest += 8)
+        _mm_storeu_si128((__m128i *)dest, _mm_packs_epi32(_mm_loadu_si128((__m128i const *)src),
+                                                          _mm_loadu_si128((__m128i const *)(src + 4))));
+#elif defined MV_BUS_NEON
+    for (; count > 0; count -= 8, src += 8, dest += 8)
+        vst1q_s16(dest, vcombine_s16(vqmovn_s32(vld1q_s32(src)), vqmovn_s32(vld1q_s32(src + 4))));
 #else
-        int sample0l = sample0 & 255;
-        int sample0h = (sample0 >> 8) ^ 128;
+    for (; count > 0; count--)
+        *dest++ = (int16_t)clamp(*src++, INT16_MIN, INT16_MAX);
 #endif
+}
+
+/*---------------------------------------------------------------------
+   Reverb
 
-        sample0l  = (volume)[sample0l] >> 8;
-        sample0h  = (volume)[sample0h];
-        *output++ = (int16_t)(sample0l + sample0h + 128);
+   Each frame, the MV_REVERBLINES line outputs are lowpassed, scaled by
+   their feedback gains, mixed through an 8x8 Hadamard matrix and written
+   back with the new input added: the left channel into lines 0-3, the
+   right into lines 4-7. The wet output sums the line outputs with
+   different signs for each channel. The lines are processed four at a
+   time, with the matrix done as butterflies.
+---------------------------------------------------------------------*/
+
+// lengths in frames at 44100 Hz, mutually prime, 23 to 45 ms
+static int32_t const MV_ReverbLengths[MV_REVERBLINES] = { 1031, 1171, 1289, 1423, 1553, 1699, 1847, 1973 };
+
+#define MV_REVERBCUTOFF   5000.f  // Hz, where the lines' lowpass starts to bite
+#define MV_REVERBDENORMAL 1e-20f  // keeps the decaying tail out of denormals
+
+void MV_InitReverb(reverb_t *rv, int32_t rate)
+{
+    Bmemset(rv, 0, sizeof(reverb_t));
+
+    int32_t longest = 0;
+
+    for (int i = 0; i < MV_REVERBLINES; i++)
+    {
+        rv->length[i] = max(((int64_t)MV_ReverbLengths[i] * rate / 44100) | 1, (int64_t)1);
+        longest = max(longest, rv->length[i]);
     }
-    while (--count > 0);
+
+    uint32_t size = 1;
+
+    while (size <= (uint32_t)longest)
+        size <<= 1;
+
+    rv->ring     = (float *)Xaligned_alloc(16, size * MV_REVERBLINES * sizeof(float));
+    rv->ringmask = size - 1;
+    rv->damp     = expf(-2.f * (float)M_PI * MV_REVERBCUTOFF / (float)rate);
+
+    MV_ClearReverb(rv);
+}
+
+void MV_FreeReverb(reverb_t *rv)
+{
+    ALIGNED_FREE_AND_NULL(rv->ring);
+}
+
+void MV_ClearReverb(reverb_t *rv)
+{
+    if (rv->ring)
+        Bmemset(rv->ring, 0, (rv->ringmask + 1) * MV_REVERBLINES * sizeof(float));
+
+    Bmemset(rv->lowpass, 0, sizeof(rv->lowpass));
+    rv->pos = 0;
+}
+
+// <seconds> to decay by 60 dB, <wet> scales the output
+void MV_SetReverbDecay(reverb_t *rv, int32_t rate, float seconds, float wet)
+{
+    // the Hadamard matrix gains sqrt(MV_REVERBLINES), taken out here
+    float const norm = 1.f / sqrtf((float)MV_REVERBLINES);
+
+    for (int i = 0; i < MV_REVERBLINES; i++)
+        rv->gain[i] = powf(10.f, -3.f * (float)rv->length[i] / ((float)rate * seconds)) * norm;
+
+    rv->wet = wet * norm;
+}
+
+#if defined MV_BUS_SSE2
+typedef __m128 reverb4_t;
+
+static FORCE_INLINE reverb4_t MV_Reverb4(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static FORCE_INLINE reverb4_t MV_Reverb4(float a) { return _mm_set1_ps(a); }
+static FORCE_INLINE reverb4_t MV_Reverb4Load(float const *p) { return _mm_loadu_ps(p); }
+static FORCE_INLINE void MV_Reverb4Store(float *p, reverb4_t v) { _mm_storeu_ps(p, v); }
+static FORCE_INLINE reverb4_t MV_Reverb4Add(reverb4_t a, reverb4_t b) { return _mm_add_ps(a, b); }
+static FORCE_INLINE reverb4_t MV_Reverb4Sub(reverb4_t a, reverb4_t b) { return _mm_sub_ps(a, b); }
+static FORCE_INLINE reverb4_t MV_Reverb4Mul(reverb4_t a, reverb4_t b) { return _mm_mul_ps(a, b); }
+static FORCE_INLINE reverb4_t MV_Reverb4SwapPairs(reverb4_t v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)); }
+static FORCE_INLINE reverb4_t MV_Reverb4SwapHalves(reverb4_t v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)); }
+static FORCE_INLINE float MV_Reverb4Sum(reverb4_t v)
+{
+    v = _mm_add_ps(v, MV_Reverb4SwapHalves(v));
+    return _mm_cvtss_f32(_mm_add_ss(v, MV_Reverb4SwapPairs(v)));
+}
+#elif defined MV_BUS_NEON
+typedef float32x4_t reverb4_t;
+
+static FORCE_INLINE reverb4_t MV_Reverb4(float a, float b, float c, float d)
+{
+    float const v[4] = { a, b, c, d };
+    return vld1q_f32(v);
+}
+static FORCE_INLINE reverb4_t MV_Reverb4(float a) { return vdupq_n_f32(a); }
+static FORCE_INLINE reverb4_t MV_Reverb4Load(float const *p) { return vld1q_f32(p); }
+static FORCE_INLINE void MV_Reverb4Store(float *p, reverb4_t v) { vst1q_f32(p, v); }
+static FORCE_INLINE reverb4_t MV_Reverb4Add(reverb4_t a, reverb4_t b) { return vaddq_f32(a, b); }
+static FORCE_INLINE reverb4_t MV_Reverb4Sub(reverb4_t a, reverb4_t b) { return vsubq_f32(a, b); }
+static FORCE_INLINE reverb4_t MV_Reverb4Mul(reverb4_t a, reverb4_t b) { return vmulq_f32(a, b); }
+static FORCE_INLINE reverb4_t MV_Reverb4SwapPairs(reverb4_t v) { return vrev64q_f32(v); }
+static FORCE_INLINE reverb4_t MV_Reverb4SwapHalves(reverb4_t v) { return vextq_f32(v, v, 2); }
+static FORCE_INLINE float MV_Reverb4Sum(reverb4_t v)
+{
+    float32x2_t const s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+#else
+typedef struct { float v[4]; } reverb4_t;
+
+static FORCE_INLINE reverb4_t MV_Reverb4(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+static FORCE_INLINE reverb4_t MV_Reverb4(float a) { return { { a, a, a, a } }; }
+static FORCE_INLINE reverb4_t MV_Reverb4Load(float const *p) { return { { p[0], p[1], p[2], p[3] } }; }
+static FORCE_INLINE void MV_Reverb4Store(float *p, reverb4_t v) { Bmemcpy(p, v.v, sizeof(v.v)); }
+static FORCE_INLINE reverb4_t MV_Reverb4Add(reverb4_t a, reverb4_t b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+static FORCE_INLINE reverb4_t MV_Reverb4Sub(reverb4_t a, reverb4_t b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+static FORCE_INLINE reverb4_t MV_Reverb4Mul(reverb4_t a, reverb4_t b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+static FORCE_INLINE reverb4_t MV_Reverb4SwapPairs(reverb4_t v) { return { { v.v[1], v.v[0], v.v[3], v.v[2] } }; }
+static FORCE_INLINE reverb4_t MV_Reverb4SwapHalves(reverb4_t v) { return { { v.v[2], v.v[3], v.v[0], v.v[1] } }; }
+static FORCE_INLINE float MV_Reverb4Sum(reverb4_t v) { return (v.v[0] + v.v[1]) + (v.v[2] + v.v[3]); }
+#endif
+
+// 4x4 Hadamard matrix: [a+b+c+d, a-b+c-d, a+b-c-d, a-b-c+d]
+static FORCE_INLINE reverb4_t MV_Reverb4Hadamard(reverb4_t v, reverb4_t alternate, reverb4_t halves)
+{
+    v = MV_Reverb4Add(MV_Reverb4SwapPairs(v), MV_Reverb4Mul(v, alternate));
+    return MV_Reverb4Add(MV_Reverb4SwapHalves(v), MV_Reverb4Mul(v, halves));
+}
+
+// Replaces <count> frames of <channels> interleaved dry samples in
+// <buffer> with the wet signal.
+void MV_ProcessReverb(reverb_t *rv, float *buffer, int32_t count, int32_t channels)
+{
+    float *const ring = rv->ring;
+    uint32_t const mask = rv->ringmask;
+    uint32_t pos = rv->pos;
+
+    int32_t const *const length = rv->length;
+
+    reverb4_t const gain0 = MV_Reverb4Load(rv->gain), gain1 = MV_Reverb4Load(rv->gain + 4);
+    reverb4_t const damp = MV_Reverb4(rv->damp), undamp = MV_Reverb4(1.f - rv->damp);
+    reverb4_t const alternate = MV_Reverb4(1.f, -1.f, 1.f, -1.f), halves = MV_Reverb4(1.f, 1.f, -1.f, -1.f);
+    float const wet = rv->wet;
+
+    reverb4_t lowpass0 = MV_Reverb4Load(rv->lowpass), lowpass1 = MV_Reverb4Load(rv->lowpass + 4);
+
+#define LINE(i) ring[((pos - length[i]) & mask) * MV_REVERBLINES + i]
+
+    for (; count > 0; count--, buffer += channels)
+    {
+        reverb4_t const out0 = MV_Reverb4(LINE(0), LINE(1), LINE(2), LINE(3));
+        reverb4_t const out1 = MV_Reverb4(LINE(4), LINE(5), LINE(6), LINE(7));
+
+        lowpass0 = MV_Reverb4Add(MV_Reverb4Mul(out0, undamp), MV_Reverb4Mul(lowpass0, damp));
+        lowpass1 = MV_Reverb4Add(MV_Reverb4Mul(out1, undamp), MV_Reverb4Mul(lowpass1, damp));
+
+        reverb4_t const fb0 = MV_Reverb4Mul(lowpass0, gain0);
+        reverb4_t const fb1 = MV_Reverb4Mul(lowpass1, gain1);
+
+        // 8x8 Hadamard: one butterfly between the halves, then 4x4 on each
+        reverb4_t const mix0 = MV_Reverb4Hadamard(MV_Reverb4Add(fb0, fb1), alternate, halves);
+        reverb4_t const mix1 = MV_Reverb4Hadamard(MV_Reverb4Sub(fb0, fb1), alternate, halves);
+
+        float const left  = buffer[0] + MV_REVERBDENORMAL;
+        float const right = (channels == 2) ? buffer[1] + MV_REVERBDENORMAL : left;
+
+        float *const dest = &ring[pos * MV_REVERBLINES];
+
+        MV_Reverb4Store(dest, MV_Reverb4Add(mix0, MV_Reverb4(left)));
+        MV_Reverb4Store(dest + 4, MV_Reverb4Add(mix1, MV_Reverb4(right)));
+
+        pos = (pos + 1) & mask;
+
+        buffer[0] = MV_Reverb4Sum(MV_Reverb4Add(out0, MV_Reverb4Mul(out1, alternate))) * wet;
+
+        if (channels == 2)
+            buffer[1] = MV_Reverb4Sum(MV_Reverb4Add(out1, MV_Reverb4Mul(out0, alternate))) * wet;
+    }
+
+#undef LINE
+
+    MV_Reverb4Store(rv->lowpass, lowpass0);
+    MV_Reverb4Store(rv->lowpass + 4, lowpass1);
+
+    rv->pos = pos;
+}
+
+/*---------------------------------------------------------------------
+   HRTF
+
+   The kernels model the head as a sphere: each ear hears the source
+   delayed by the path around the head and through a one-pole head
+   shadow filter that lifts the highs on the near side and cuts them on
+   the far side (Brown and Duda). They are designed by sampling that
+   response at MV_HRTFDFTSIZE points, truncated to MV_HRTFTAPS taps with
+   tapered ends and scaled to sound as loud from any angle. Kernels are
+   kept reversed, so that each output sample is a dot product with the
+   input that led up to it.
+
+   A voice is mixed to mono at its distance volume and convolved with
+   the kernel pair for its angle. When the angle changes, the kernels
+   of the old and the new angle are crossfaded over the buffer.
+---------------------------------------------------------------------*/
+
+#define MV_HRTFHEADRADIUS  0.0875  // meters
+#define MV_HRTFSOUNDSPEED  343.0   // meters per second
+#define MV_HRTFMINALPHA    0.1     // head shadow at its deepest
+#define MV_HRTFMINTHETA    (150.0 * M_PI / 180.0)  // ... which is this far from the ear
+#define MV_HRTFDFTSIZE     256
+#define MV_HRTFLEAD        8   // taps before the sound reaches the near ear
+#define MV_HRTFFADEIN      4   // taps tapered at the start
+#define MV_HRTFFADEOUT     12  // ... and at the end
+
+static float MV_HrtfKernels[MV_HRTFANGLES][2][MV_HRTFTAPS];
+
+void MV_InitHrtf(int32_t rate)
+{
+    double const headdelay = MV_HRTFHEADRADIUS / MV_HRTFSOUNDSPEED;
+    double const maxdelay  = MV_HRTFTAPS - MV_HRTFLEAD - MV_HRTFFADEOUT;
+
+    for (int angle = 0; angle < MV_HRTFANGLES; angle++)
+    {
+        double const azimuth = 2.0 * M_PI * angle / MV_HRTFANGLES;
+        double theta[2], alpha[2];
+
+        for (int ear = 0; ear < 2; ear++)
+        {
+            // between the source and the ear, the left ear being at -90 degrees
+            theta[ear] = fabs(remainder(azimuth + (ear ? -0.5 * M_PI : 0.5 * M_PI), 2.0 * M_PI));
+            alpha[ear] = (1.0 + 0.5 * MV_HRTFMINALPHA) + (1.0 - 0.5 * MV_HRTFMINALPHA) * cos(M_PI * theta[ear] / MV_HRTFMINTHETA);
+        }
+
+        // the same high frequency power from every angle, so that turning does not change how loud a sound is
+        double const gain = sqrt(2.0 / (alpha[0] * alpha[0] + alpha[1] * alpha[1]));
+
+        for (int ear = 0; ear < 2; ear++)
+        {
+            double const path  = (theta[ear] < 0.5 * M_PI) ? 1.0 - cos(theta[ear]) : 1.0 + theta[ear] - 0.5 * M_PI;
+            double const delay = min(path * headdelay * rate, maxdelay) + MV_HRTFLEAD;
+
+            double h[MV_HRTFTAPS] = {};
+
+            for (int k = 0; k <= MV_HRTFDFTSIZE / 2; k++)
+            {
+                double const w = 2.0 * M_PI * k / MV_HRTFDFTSIZE;  // radians per sample
+                double const b = 0.5 * w * rate * headdelay;
+
+                // (1 + j*alpha*b) / (1 + j*b)
+                double const re = (1.0 + alpha[ear] * b * b) / (1.0 + b * b);
+                double const im = (alpha[ear] * b - b) / (1.0 + b * b);
+                double const weight = (k == 0 || k == MV_HRTFDFTSIZE / 2) ? 1.0 : 2.0;
+
+                for (int n = 0; n < MV_HRTFTAPS; n++)
+                {
+                    double const phase = w * (n - delay);
+                    h[n] += weight * (re * cos(phase) - im * sin(phase)) / MV_HRTFDFTSIZE;
+                }
+            }
+
+            double sum = 0.0;
+
+            for (int n = 0; n < MV_HRTFTAPS; n++)
+            {
+                if (n < MV_HRTFFADEIN)
+                    h[n] *= 0.5 - 0.5 * cos(M_PI * (n + 1) / (MV_HRTFFADEIN + 1));
+                else if (n >= MV_HRTFTAPS - MV_HRTFFADEOUT)
+                    h[n] *= 0.5 + 0.5 * cos(M_PI * (n - (MV_HRTFTAPS - MV_HRTFFADEOUT) + 1) / (MV_HRTFFADEOUT + 1));
+
+                sum += h[n];
+            }
+
+            // truncation moves the low end a little, put it back
+            for (int n = 0; n < MV_HRTFTAPS; n++)
+                MV_HrtfKernels[angle][ear][MV_HRTFTAPS - 1 - n] = (float)(h[n] * gain / sum);
+        }
+    }
+}
+
+// outputs for the four samples from <input>[MV_HRTFTAPS - 1] on, which are preceded by their history
+static FORCE_INLINE reverb4_t MV_HrtfConvolve4(float const *input, float const *kernel)
+{
+    reverb4_t acc = MV_Reverb4(0.f);
+
+    for (int k = 0; k < MV_HRTFTAPS; k++)
+        acc = MV_Reverb4Add(acc, MV_Reverb4Mul(MV_Reverb4Load(input + k), MV_Reverb4(kernel[k])));
+
+    return acc;
+}
+
+// Adds <count> frames of the stereo bus samples in <src>, mixed to mono
+// and placed at HRTF angle <angle>, to the stereo bus at <dest>. With
+// <leftonly>, the voice was mixed into the left channel of <src> alone.
+// <count> is a multiple of four, at most MV_MIXBUFFERSIZE.
+void MV_ProcessHrtf(hrtfstate_t *state, int32_t const *src, bool leftonly, int32_t *dest, int32_t count, int32_t angle)
+{
+    static float input[MV_HRTFTAPS + MV_MIXBUFFERSIZE];
+
+    if (state->angle < 0)
+    {
+        Bmemset(state->history, 0, sizeof(state->history));
+        state->angle = angle;
+    }
+
+    Bmemcpy(input, state->history, sizeof(state->history));
+
+    if (leftonly)
+    {
+        for (int i = 0; i < count; i++)
+            input[MV_HRTFTAPS + i] = (float)src[i * 2];
+    }
+    else
+    {
+        for (int i = 0; i < count; i++)
+            input[MV_HRTFTAPS + i] = ((float)src[i * 2] + (float)src[i * 2 + 1]) * 0.5f;
+    }
+
+    float const *const left = MV_HrtfKernels[angle][0];
+    float const *const right = MV_HrtfKernels[angle][1];
+    float const *const oldleft = MV_HrtfKernels[state->angle][0];
+    float const *const oldright = MV_HrtfKernels[state->angle][1];
+
+    bool const fade = (state->angle != angle);
+    float const step = 1.f / count;
+
+    for (int i = 0; i < count; i += 4)
+    {
+        float const *const x = &input[i + 1];
+
+        reverb4_t l = MV_HrtfConvolve4(x, left);
+        reverb4_t r = MV_HrtfConvolve4(x, right);
+
+        if (fade)
+        {
+            reverb4_t const l0 = MV_HrtfConvolve4(x, oldleft);
+            reverb4_t const r0 = MV_HrtfConvolve4(x, oldright);
+            reverb4_t const t = MV_Reverb4((i + 1) * step, (i + 2) * step, (i + 3) * step, (i + 4) * step);
+
+            l = MV_Reverb4Add(l0, MV_Reverb4Mul(MV_Reverb4Sub(l, l0), t));
+            r = MV_Reverb4Add(r0, MV_Reverb4Mul(MV_Reverb4Sub(r, r0), t));
+        }
+
+        float out[2][4];
+
+        MV_Reverb4Store(out[0], l);
+        MV_Reverb4Store(out[1], r);
+
+        for (int j = 0; j < 4; j++)
+        {
+            dest[(i + j) * 2] += Blrintf(out[0][j]);
+            dest[(i + j) * 2 + 1] += Blrintf(out[1][j]);
+        }
+    }
+
+    Bmemcpy(state->history, input + count, sizeof(state->history));
+    state->angle = angle;
 }
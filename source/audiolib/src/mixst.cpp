@@ -153,3 +153,89 @@ uint32_t MV_Mix16BitStereo16Stereo(struct VoiceNode const * const voice, uint32_
 
     return position;
 }
+
+// stereo source downmixed to one output channel every MV_SampleSize>>1 bus samples
+template <typename S, int interp>
+static uint32_t MV_MixBusStereoSource(struct VoiceNode const * const voice, uint32_t length)
+{
+    auto const source = (S const *)voice->sound;
+    auto       dest   = (int32_t *)MV_MixDestination;
+
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    int32_t const  last     = max<int32_t>((voice->length >> 16) - 1, 0);
+    float const   *table    = MV_ResampleTable<interp>(rate);
+    float const    gain     = MV_LeftGain * 0.5f;
+    int const      stride   = MV_SampleSize >> 1;
+
+    if (stride == 1)
+    {
+        float const gains[4] = { gain, gain, gain, gain };
+
+        for (; length >= 4; length -= 4, dest += 4, position += rate * 4)
+        {
+            float left[4], right[4];
+
+            MV_BusFetch4<interp>(left, source, position, rate, last, 2, 0, table);
+            MV_BusFetch4<interp>(right, source, position, rate, last, 2, 1, table);
+
+            float const samples[4] = { left[0] + right[0], left[1] + right[1], left[2] + right[2], left[3] + right[3] };
+
+            MV_BusAdd4(dest, samples, gains);
+        }
+    }
+
+    for (; length > 0; length--, dest += stride, position += rate)
+    {
+        float const sample0 = MV_BusFetch<interp>(source, position, last, 2, 0, table) +
+                              MV_BusFetch<interp>(source, position, last, 2, 1, table);
+
+        *dest += Blrintf(sample0 * gain);
+    }
+
+    MV_MixDestination = (char *)dest;
+
+    return position;
+}
+
+// stereo source, interleaved stereo output
+template <typename S, int interp>
+static uint32_t MV_MixBusStereoSourceStereo(struct VoiceNode const * const voice, uint32_t length)
+{
+    auto const source = (S const *)voice->sound;
+    auto       dest   = (int32_t *)MV_MixDestination;
+
+    uint32_t       position = voice->position;
+    uint32_t const rate     = voice->RateScale;
+    int32_t const  last     = max<int32_t>((voice->length >> 16) - 1, 0);
+    float const   *table    = MV_ResampleTable<interp>(rate);
+    float const    gains[4] = { MV_LeftGain, MV_RightGain, MV_LeftGain, MV_RightGain };
+
+    for (; length >= 4; length -= 4, dest += 8, position += rate * 4)
+    {
+        float left[4], right[4];
+
+        MV_BusFetch4<interp>(left, source, position, rate, last, 2, 0, table);
+        MV_BusFetch4<interp>(right, source, position, rate, last, 2, 1, table);
+
+        float const samples[8] = { left[0], right[0], left[1], right[1], left[2], right[2], left[3], right[3] };
+
+        MV_BusAdd4(dest, samples, gains);
+        MV_BusAdd4(dest + 4, samples + 4, gains);
+    }
+
+    for (; length > 0; length--, dest += 2, position += rate)
+    {
+        dest[0] += Blrintf(MV_BusFetch<interp>(source, position, last, 2, 0, table) * gains[0]);
+        dest[1] += Blrintf(MV_BusFetch<interp>(source, position, last, 2, 1, table) * gains[1]);
+    }
+
+    MV_MixDestination = (char *)dest;
+
+    return position;
+}
+
+uint32_t MV_MixBusMono8Stereo(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusStereoSource, uint8_t); }
+uint32_t MV_MixBusStereo8Stereo(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusStereoSourceStereo, uint8_t); }
+uint32_t MV_MixBusMono16Stereo(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusStereoSource, int16_t); }
+uint32_t MV_MixBusStereo16Stereo(struct VoiceNode const *voice, uint32_t length) { MV_MIXBUS_INTERP(MV_MixBusStereoSourceStereo, int16_t); }
@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 **********************************************************************/
 
 #include "compat.h"
+#include "baselayer.h"
 #include "pragmas.h"
 #include "linklist.h"
 #include "drivers.h"
@@ -39,9 +40,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "multivoc.h"
 #include "_multivc.h"
 #include "fx_man.h"
+#include "thread.h"
+
+#include <atomic>
 
 static void MV_StopVoice(VoiceNode *voice);
 static void MV_ServiceVoc(void);
+static void MV_ProcessCommands(void);
+
+static void MV_StartStream(VoiceNode *voice);
+static void MV_StopStreams(void);
+static void MV_ReleaseStreamVoice(VoiceNode *voice);
+static void MV_EndStreamLooping(VoiceNode *voice);
+static int32_t MV_GetStreamPosition(VoiceNode *voice);
+static void MV_SetStreamPosition(VoiceNode *voice, int32_t position);
 
 static VoiceNode *MV_GetVoice(int32_t handle);
 
@@ -51,7 +63,7 @@ static const int16_t *MV_GetVolumeTable(int32_t vol);
 
 static int32_t MV_ReverbLevel;
 static int32_t MV_ReverbDelay;
-static int16_t *MV_ReverbTable = NULL;
+static reverb_t MV_Reverb;
 
 static int16_t MV_VolumeTable[MV_MAXVOLUME + 1][256];
 Pan MV_PanTable[MV_NUMPANPOSITIONS][MV_MAXVOLUME + 1];
@@ -76,6 +88,10 @@ char *MV_MixBuffer[MV_NUMBEROFBUFFERS + 1];
 
 static VoiceNode *MV_Voices = NULL;
 
+// Playing voice for each handle. Only changed with the driver locked or from
+// the mixer, but read without locking by MV_VoicePlaying().
+static std::atomic<VoiceNode *> *MV_HandleVoice = NULL;
+
 static VoiceNode VoiceList;
 static VoiceNode VoicePool;
 
@@ -87,6 +103,7 @@ static void (*MV_CallBackFunc)(uint32_t) = NULL;
 char *MV_MixDestination;
 const int16_t *MV_LeftVolume;
 const int16_t *MV_RightVolume;
+float MV_LeftGain, MV_RightGain;
 int32_t MV_SampleSize = 1;
 int32_t MV_RightChannelOffset;
 
@@ -94,12 +111,58 @@ int32_t MV_ErrorCode = MV_NotInstalled;
 
 float MV_GlobalVolume = 1.f;
 
+int32_t MV_MixBus = 1;
+static int32_t MV_BusActive;  // MV_MixBus as sampled for the buffer being mixed
+static int32_t MV_Bus[MV_MIXBUFFERSIZE * 2];
+
+int32_t MV_Interpolation = MV_INTERP_CUBIC;
+
+int32_t MV_RealVoices = 32;
+
+int32_t MV_HrtfVoices;
+static int32_t MV_HrtfActive;  // MV_HrtfVoices, as sampled for the buffer being mixed, if it can be used
+static int32_t MV_HrtfBus[MV_MIXBUFFERSIZE * 2];  // the binaural voice being mixed
+
+typedef struct
+{
+    float audibility;
+    VoiceNode *voice;
+} voiceorder_t;
+
+static voiceorder_t *MV_VoiceOrder;  // MV_MaxVoices entries, for MV_CullVoices()
+static voicestats_t MV_VoiceStats;
+
+int32_t MV_Profile;
+static bool MV_Profiling;  // MV_Profile as sampled for the buffer being mixed
+
+// in timer ticks; everything is updated under the driver lock
+static struct
+{
+    uint64_t service, serviceworst;
+    uint64_t callback, callbackworst;
+    uint64_t decode[FMT_MAX], mix[FMT_MAX];
+    uint32_t buffers, misses;
+    uint32_t callbacks, callbackmisses;
+    uint32_t histogram[MV_PROFILEBUCKETS];
+} MV_Prof;
+
+// in microseconds, from the stream thread
+static std::atomic<uint32_t> MV_StreamDecodeTime[FMT_MAX];
+
+float MV_CubicTable[MV_RESAMPLEPHASES][4];
+float MV_SincTable[MV_SINCCUTOFFS][MV_RESAMPLEPHASES][MV_SINCTAPS];
+
 static int32_t lockdepth = 0;
 
+// Taking the lock applies all queued commands first, so that locked calls
+// observe voice changes in the order the game thread made them.
 static FORCE_INLINE void DisableInterrupts(void)
 {
     if (!lockdepth++)
+    {
         SoundDriver_Lock();
+        MV_ProcessCommands();
+    }
 }
 
 static FORCE_INLINE void RestoreInterrupts(void)
@@ -135,22 +198,64 @@ const char *MV_ErrorString(int32_t ErrorNumber)
     }
 }
 
+// The bus mixers scale by a gain instead of indexing the volume tables.
+// Row <vol> of MV_VolumeTable scales by vol/MV_MAXVOLUME, see MV_CalcVolume().
+static void MV_SetBusGains(VoiceNode const *voice)
+{
+    float const gain = voice->volume * ((voice->priority == FX_MUSIC_PRIORITY) ? 1.f : MV_GlobalVolume) * (1.f / MV_MAXVOLUME);
+
+    MV_LeftGain  = (float)((MV_LeftVolume - MV_VolumeTable[0]) >> 8) * gain;
+    MV_RightGain = (float)((MV_RightVolume - MV_VolumeTable[0]) >> 8) * gain;
+}
+
+// ticks taken by <frames> frames of output to play
+static uint64_t MV_ProfilePeriod(int32_t frames) { return (uint64_t)frames * timerGetFreqU64() / max(MV_MixRate, 1); }
+
+static playbackstatus MV_GetSound(VoiceNode *voice)
+{
+    if (!MV_Profiling)
+        return voice->GetSound(voice);
+
+    uint64_t const start = timerGetTicksU64();
+    playbackstatus const status = voice->GetSound(voice);
+    uint64_t const ticks = timerGetTicksU64() - start;
+
+    voice->decodeticks += ticks;
+    MV_Prof.decode[voice->wavetype] += ticks;
+
+    return status;
+}
+
 static bool MV_Mix(VoiceNode *voice, int const buffer)
 {
-    if (voice->length == 0 && voice->GetSound(voice) != KeepPlaying)
+    if (voice->length == 0 && MV_GetSound(voice) != KeepPlaying)
         return false;
 
     int32_t length = MV_MIXBUFFERSIZE;
     uint32_t FixedPointBufferSize = voice->FixedPointBufferSize;
+    bool const skip = voice->Virtual;
 
-    MV_MixDestination = MV_MixBuffer[buffer];
-    MV_LeftVolume = voice->LeftVolume;
-    MV_RightVolume = voice->RightVolume;
-
-    if ((MV_Channels == 2) && (IS_QUIET(MV_LeftVolume)))
+    if (voice->Binaural)
     {
-        MV_LeftVolume = MV_RightVolume;
-        MV_MixDestination += MV_RightChannelOffset;
+        // both channels at the distance volume, the HRTF does the panning
+        MV_MixDestination = (char *)MV_HrtfBus;
+        MV_LeftVolume = MV_RightVolume = max(voice->LeftVolume, voice->RightVolume);
+        MV_SetBusGains(voice);
+    }
+    else if (!skip)
+    {
+        MV_MixDestination = MV_BusActive ? (char *)MV_Bus : MV_MixBuffer[buffer];
+        MV_LeftVolume = voice->LeftVolume;
+        MV_RightVolume = voice->RightVolume;
+
+        if ((MV_Channels == 2) && (IS_QUIET(MV_LeftVolume)))
+        {
+            MV_LeftVolume = MV_RightVolume;
+            MV_MixDestination += MV_BusActive ? (int32_t)sizeof(int32_t) : MV_RightChannelOffset;
+        }
+
+        if (MV_BusActive)
+            MV_SetBusGains(voice);
     }
 
     // Add this voice to the mix
@@ -166,7 +271,7 @@ static bool MV_Mix(VoiceNode *voice, int const buffer)
         {
             if (position >= voice->length)
             {
-                voice->GetSound(voice);
+                MV_GetSound(voice);
                 return true;
             }
 
@@ -175,21 +280,39 @@ static bool MV_Mix(VoiceNode *voice, int const buffer)
         else
             voclength = length;
 
-        float const gv = MV_GlobalVolume;
+        if (skip)
+        {
+            // where the mixer would have left off
+            voice->position = position + voclength * rate;
+        }
+        else
+        {
+            float const gv = MV_GlobalVolume;
+
+            if (voice->priority == FX_MUSIC_PRIORITY)
+                MV_GlobalVolume = 1.f;
+
+            uint64_t const start = MV_Profiling ? timerGetTicksU64() : 0;
 
-        if (voice->priority == FX_MUSIC_PRIORITY)
-            MV_GlobalVolume = 1.f;
+            voice->position = (MV_BusActive ? voice->busmix : voice->mix)(voice, voclength);
+
+            if (MV_Profiling)
+            {
+                uint64_t const ticks = timerGetTicksU64() - start;
 
-        voice->position = voice->mix(voice, voclength);
+                voice->mixticks += ticks;
+                MV_Prof.mix[voice->wavetype] += ticks;
+            }
 
-        MV_GlobalVolume = gv;
+            MV_GlobalVolume = gv;
+        }
 
         length -= voclength;
 
         if (voice->position >= voice->length)
         {
             // Get the next block of sound
-            if (voice->GetSound(voice) == NoMoreData)
+            if (MV_GetSound(voice) == NoMoreData)
                 return false;
 
             if (length > (voice->channels - 1))
@@ -205,16 +328,208 @@ static bool MV_Mix(VoiceNode *voice, int const buffer)
 
 void MV_PlayVoice(VoiceNode *voice)
 {
+    if (voice->priority == MV_MUSIC_PRIORITY && MV_StreamLead > 0)
+        MV_StartStream(voice);
+
     DisableInterrupts();
     LL_SortedInsertion(&VoiceList, voice, prev, next, VoiceNode, priority);
+    MV_HandleVoice[voice->handle].store(voice, std::memory_order_release);
     RestoreInterrupts();
 }
 
-static void MV_CleanupVoice(VoiceNode *voice)
+/*---------------------------------------------------------------------
+   Voice virtualization
+
+   Each buffer, only the MV_RealVoices most audible voices are mixed.
+   The others, and any voice that can not be heard at all, are virtual:
+   MV_Mix still steps them through their data, fetching blocks and
+   looping as usual, but does not mix them. A virtual voice becomes real
+   again as soon as it is among the most audible, at the same position
+   it would have reached. Music is always mixed.
+
+   With MV_HrtfVoices, the loudest of the real voices that were placed
+   by MV_Pan3D() are binaural: they are mixed through the HRTF at their
+   angle instead of panned, which needs the bus and stereo output. The
+   rest keep the pan table.
+---------------------------------------------------------------------*/
+
+static FORCE_INLINE float MV_Audibility(VoiceNode const *voice)
 {
-    if (MV_CallBackFunc)
-        MV_CallBackFunc(voice->callbackval);
+    if (voice->priority == FX_MUSIC_PRIORITY)
+        return FLT_MAX;
+
+    // rows of MV_VolumeTable, see MV_SetBusGains()
+    int32_t const left  = (voice->LeftVolume - MV_VolumeTable[0]) >> 8;
+    int32_t const right = (voice->RightVolume - MV_VolumeTable[0]) >> 8;
+
+    return voice->volume * (float)max(left, right);
+}
+
+static void MV_CullVoices(void)
+{
+    int32_t playing = 0, audible = 0;
+
+    for (VoiceNode *voice = VoiceList.next; voice != &VoiceList; voice = voice->next)
+    {
+        playing++;
+
+        voice->Binaural = FALSE;
+
+        if (voice->Paused)
+            continue;
+
+        float const audibility = MV_Audibility(voice);
+
+        voice->Virtual = (audibility <= 0.f);
+
+        if (!voice->Virtual)
+            MV_VoiceOrder[audible++] = { audibility, voice };
+    }
+
+    int32_t real = audible;
+
+    if (MV_RealVoices > 0 && audible > MV_RealVoices)
+    {
+        std::nth_element(MV_VoiceOrder, MV_VoiceOrder + MV_RealVoices, MV_VoiceOrder + audible,
+                         [](voiceorder_t const &a, voiceorder_t const &b) { return a.audibility > b.audibility; });
+
+        for (int i = MV_RealVoices; i < audible; i++)
+            MV_VoiceOrder[i].voice->Virtual = TRUE;
+
+        real = MV_RealVoices;
+    }
+
+    int32_t binaural = 0;
+
+    if (MV_HrtfActive)
+    {
+        auto const placed = std::partition(MV_VoiceOrder, MV_VoiceOrder + real, [](voiceorder_t const &v) {
+            return v.voice->Angle >= 0 && v.voice->priority != FX_MUSIC_PRIORITY;
+        });
+
+        binaural = min<int32_t>(placed - MV_VoiceOrder, MV_HrtfActive);
+
+        if (MV_VoiceOrder + binaural < placed)
+            std::nth_element(MV_VoiceOrder, MV_VoiceOrder + binaural, placed,
+                             [](voiceorder_t const &a, voiceorder_t const &b) { return a.audibility > b.audibility; });
+
+        for (int i = 0; i < binaural; i++)
+            MV_VoiceOrder[i].voice->Binaural = TRUE;
+    }
+
+    MV_VoiceStats.real        = real;
+    MV_VoiceStats.binaural    = binaural;
+    MV_VoiceStats.virtualized = playing - real;
+    MV_VoiceStats.peak        = max(MV_VoiceStats.peak, playing);
+}
+
+void MV_GetVoiceStats(voicestats_t *stats)
+{
+    DisableInterrupts();
+    *stats = MV_VoiceStats;
+    RestoreInterrupts();
+}
+
+uint64_t MV_ProfileStart(void) { return MV_Profile ? timerGetTicksU64() : 0; }
+
+// called by the driver under its lock, after a callback that delivered <bytes>
+void MV_ProfileCallback(uint64_t start, int32_t bytes)
+{
+    if (!start)
+        return;
+
+    uint64_t const ticks = timerGetTicksU64() - start;
+
+    MV_Prof.callback += ticks;
+    MV_Prof.callbackworst = max(MV_Prof.callbackworst, ticks);
+    MV_Prof.callbacks++;
+    MV_Prof.callbackmisses += (ticks > MV_ProfilePeriod(bytes / MV_SampleSize));
+}
+
+void MV_GetProfile(mvprofile_t *profile)
+{
+    double const us = 1000000.0 / (double)timerGetFreqU64();
+
+    DisableInterrupts();
+
+    profile->buffers = MV_Prof.buffers;
+    profile->misses  = MV_Prof.misses;
+    profile->period  = (float)(MV_ProfilePeriod(MV_MIXBUFFERSIZE) * us);
+    profile->average = MV_Prof.buffers ? (float)(MV_Prof.service * us / MV_Prof.buffers) : 0.f;
+    profile->worst   = (float)(MV_Prof.serviceworst * us);
+
+    Bmemcpy(profile->histogram, MV_Prof.histogram, sizeof(profile->histogram));
+
+    for (int i = 0; i < FMT_MAX; i++)
+    {
+        profile->decode[i]       = (float)(MV_Prof.decode[i] * us);
+        profile->mix[i]          = (float)(MV_Prof.mix[i] * us);
+        profile->streamdecode[i] = (float)MV_StreamDecodeTime[i].load(std::memory_order_relaxed);
+    }
+
+    profile->callbacks       = MV_Prof.callbacks;
+    profile->callbackmisses  = MV_Prof.callbackmisses;
+    profile->callbackaverage = MV_Prof.callbacks ? (float)(MV_Prof.callback * us / MV_Prof.callbacks) : 0.f;
+    profile->callbackworst   = (float)(MV_Prof.callbackworst * us);
+
+    RestoreInterrupts();
+}
+
+// Fills <voices> with up to <count> playing voices, the costliest first,
+// and returns how many it filled.
+int32_t MV_GetVoiceProfile(voiceprofile_t *voices, int32_t count)
+{
+    if (!MV_Installed || count <= 0)
+        return 0;
+
+    double const us = 1000000.0 / (double)timerGetFreqU64();
+    int32_t found = 0;
+
+    DisableInterrupts();
+
+    for (VoiceNode const *voice = VoiceList.next; voice != &VoiceList; voice = voice->next)
+    {
+        voiceprofile_t const entry = { voice->handle, voice->wavetype, (float)(voice->decodeticks * us), (float)(voice->mixticks * us) };
+        float const cost = entry.decode + entry.mix;
+        int i = min(found, count - 1);
+
+        // insert into the sorted list, dropping the cheapest once it is full
+        if (found == count && voices[i].decode + voices[i].mix >= cost)
+            continue;
+
+        found = min(found + 1, count);
+
+        for (; i > 0 && voices[i - 1].decode + voices[i - 1].mix < cost; i--)
+            voices[i] = voices[i - 1];
+
+        voices[i] = entry;
+    }
+
+    RestoreInterrupts();
+
+    return found;
+}
+
+void MV_ResetProfile(void)
+{
+    DisableInterrupts();
+
+    Bmemset(&MV_Prof, 0, sizeof(MV_Prof));
+
+    for (auto &time : MV_StreamDecodeTime)
+        time.store(0, std::memory_order_relaxed);
+
+    if (MV_Installed)
+    {
+        for (VoiceNode *voice = VoiceList.next; voice != &VoiceList; voice = voice->next)
+            voice->decodeticks = voice->mixticks = 0;
+    }
+
+    RestoreInterrupts();
+}
 
+static void MV_ReleaseVoiceData(VoiceNode *voice)
+{
     switch (voice->wavetype)
     {
 #ifdef HAVE_VORBIS
@@ -227,9 +542,20 @@ static void MV_CleanupVoice(VoiceNode *voice)
 #ifdef HAVE_XMP
         case FMT_XMP: MV_ReleaseXMPVoice(voice); break;
 #endif
+        case FMT_RAW: MV_ReleaseDecodedVoice(voice); break;
+        case FMT_STREAM: MV_ReleaseStreamVoice(voice); break;
         default: break;
     }
+}
+
+static void MV_CleanupVoice(VoiceNode *voice)
+{
+    if (MV_CallBackFunc)
+        MV_CallBackFunc(voice->callbackval);
 
+    MV_ReleaseVoiceData(voice);
+
+    MV_HandleVoice[voice->handle].store(NULL, std::memory_order_release);
     voice->handle = 0;
 }
 
@@ -244,6 +570,70 @@ static void MV_StopVoice(VoiceNode *voice)
     RestoreInterrupts();
 }
 
+// Adds the reverb of the mix so far, from the bus or the 16-bit buffer.
+static void MV_ApplyReverb(bool const bus)
+{
+    static float block[MV_MIXBUFFERSIZE * 2];
+
+    int const count = MV_BufferSize >> 1;
+    auto const buffer = (int16_t *)MV_MixBuffer[MV_MixPage];
+
+    if (bus)
+    {
+        for (int i = 0; i < count; i++)
+            block[i] = (float)MV_Bus[i];
+    }
+    else
+    {
+        for (int i = 0; i < count; i++)
+            block[i] = (float)buffer[i];
+    }
+
+    MV_ProcessReverb(&MV_Reverb, block, MV_MIXBUFFERSIZE, MV_Channels);
+
+    if (bus)
+    {
+        for (int i = 0; i < count; i++)
+            MV_Bus[i] += Blrintf(block[i]);
+    }
+    else
+    {
+        for (int i = 0; i < count; i++)
+            buffer[i] = (int16_t)clamp(buffer[i] + Blrintf(block[i]), INT16_MIN, INT16_MAX);
+    }
+
+    MV_BufferEmpty[MV_MixPage] = FALSE;
+}
+
+// HRTF kernel for the angle of <voice>, see MV_CalcPanTable()
+static int32_t MV_HrtfAngle(VoiceNode const *voice)
+{
+    int32_t const angle = ((voice->Angle * MV_HRTFANGLES + MV_NUMPANPOSITIONS / 2) / MV_NUMPANPOSITIONS) & (MV_HRTFANGLES - 1);
+
+    return MV_ReverseStereo ? (-angle & (MV_HRTFANGLES - 1)) : angle;
+}
+
+// the mixers for mono sources with one side quiet only fill one channel
+static FORCE_INLINE bool MV_MixesLeftOnly(VoiceNode const *voice)
+{
+    return voice->busmix == MV_MixBusMono || voice->busmix == MV_MixBusMono16;
+}
+
+static void MV_MixHrtf(VoiceNode *voice)
+{
+    uint64_t const start = MV_Profiling ? timerGetTicksU64() : 0;
+
+    MV_ProcessHrtf(&voice->hrtf, MV_HrtfBus, MV_MixesLeftOnly(voice), MV_Bus, MV_MIXBUFFERSIZE, MV_HrtfAngle(voice));
+
+    if (MV_Profiling)
+    {
+        uint64_t const ticks = timerGetTicksU64() - start;
+
+        voice->mixticks += ticks;
+        MV_Prof.mix[voice->wavetype] += ticks;
+    }
+}
+
 /*---------------------------------------------------------------------
    JBF: no synchronisation happens inside MV_ServiceVoc nor the
         supporting functions it calls. This would cause a deadlock
@@ -251,54 +641,52 @@ static void MV_StopVoice(VoiceNode *voice)
         locking in the user-space functions of MultiVoc. The call
         to MV_ServiceVoc is synchronised in the driver.
 ---------------------------------------------------------------------*/
-static void MV_ServiceVoc(void)
+static void MV_ServiceBuffer(void)
 {
     // Toggle which buffer we'll mix next
     if (++MV_MixPage >= MV_NumberOfBuffers)
         MV_MixPage -= MV_NumberOfBuffers;
 
-    if (MV_ReverbLevel == 0)
+    // Initialize buffer
+    //Commented out so that the buffer is always cleared.
+    //This is so the guys at Echo Speech can mix into the
+    //buffer even when no sounds are playing.
+    if (!MV_BufferEmpty[MV_MixPage])
     {
-        // Initialize buffer
-        //Commented out so that the buffer is always cleared.
-        //This is so the guys at Echo Speech can mix into the
-        //buffer even when no sounds are playing.
-        if (!MV_BufferEmpty[MV_MixPage])
-        {
-            Bmemset(MV_MixBuffer[MV_MixPage], 0, MV_BufferSize);
-            MV_BufferEmpty[ MV_MixPage ] = TRUE;
-        }
+        Bmemset(MV_MixBuffer[MV_MixPage], 0, MV_BufferSize);
+        MV_BufferEmpty[ MV_MixPage ] = TRUE;
     }
-    else
-    {
-        char const *const end = MV_MixBuffer[0] + MV_BufferLength;
-        char *dest = MV_MixBuffer[MV_MixPage];
-        char const *source = MV_MixBuffer[MV_MixPage] - MV_ReverbDelay;
 
-        if (source < MV_MixBuffer[ 0 ])
-            source += MV_BufferLength;
+    MV_ProcessCommands();
 
-        int32_t length = MV_BufferSize;
+    // Play any waiting voices
+    //DisableInterrupts();
 
-        while (length > 0)
-        {
-            int const count = (source + length > end) ? (end - source) : length;
 
-            MV_16BitReverb(source, dest, MV_ReverbTable, count / 2);
+    if (!VoiceList.next || VoiceList.next == &VoiceList)
+    {
+        MV_VoiceStats.real = MV_VoiceStats.virtualized = 0;
 
-            // if we go through the loop again, it means that we've wrapped around the buffer
-            source  = MV_MixBuffer[ 0 ];
-            dest   += count;
-            length -= count;
-        }
+        // let the tail ring out
+        if (MV_ReverbLevel)
+            MV_ApplyReverb(false);
+
+        return;
     }
 
-    // Play any waiting voices
-    //DisableInterrupts();
+    MV_BusActive = MV_MixBus;
+    MV_HrtfActive = (MV_BusActive && MV_Channels == 2) ? MV_HrtfVoices : 0;
 
+    MV_CullVoices();
 
-    if (!VoiceList.next || VoiceList.next == &VoiceList)
-        return;
+    if (MV_BusActive)
+    {
+        // start from the cleared or reverberated buffer
+        auto const src = (int16_t const *)MV_MixBuffer[MV_MixPage];
+
+        for (int i = 0, n = MV_BufferSize >> 1; i < n; i++)
+            MV_Bus[i] = src[i];
+    }
 
     VoiceNode *voice = VoiceList.next;
 
@@ -316,10 +704,22 @@ static void MV_ServiceVoc(void)
         if (voice->Paused)
             continue;
 
-        MV_BufferEmpty[ MV_MixPage ] = FALSE;
+        if (!voice->Virtual)
+            MV_BufferEmpty[ MV_MixPage ] = FALSE;
+
+        if (voice->Binaural)
+            Bmemset(MV_HrtfBus, 0, sizeof(MV_HrtfBus));
+        else
+            voice->hrtf.angle = -1;
+
+        bool const playing = MV_Mix(voice, MV_MixPage);
+
+        // what the voice mixed before it ended still goes through the HRTF
+        if (voice->Binaural)
+            MV_MixHrtf(voice);
 
         // Is this voice done?
-        if (!MV_Mix(voice, MV_MixPage))
+        if (!playing)
         {
             MV_CleanupVoice(voice);
 
@@ -329,9 +729,39 @@ static void MV_ServiceVoc(void)
     }
     while ((voice = next) != &VoiceList);
 
+    if (MV_ReverbLevel)
+        MV_ApplyReverb(MV_BusActive);
+
+    if (MV_BusActive)
+        MV_BusToInt16(MV_Bus, (int16_t *)MV_MixBuffer[MV_MixPage], MV_BufferSize >> 1);
+
     //RestoreInterrupts();
 }
 
+static void MV_ServiceVoc(void)
+{
+    MV_Profiling = (MV_Profile != 0);
+
+    if (!MV_Profiling)
+    {
+        MV_ServiceBuffer();
+        return;
+    }
+
+    uint64_t const start = timerGetTicksU64();
+
+    MV_ServiceBuffer();
+
+    uint64_t const ticks = timerGetTicksU64() - start;
+    uint64_t const period = MV_ProfilePeriod(MV_MIXBUFFERSIZE);
+
+    MV_Prof.service += ticks;
+    MV_Prof.serviceworst = max(MV_Prof.serviceworst, ticks);
+    MV_Prof.buffers++;
+    MV_Prof.misses += (ticks > period);
+    MV_Prof.histogram[min<uint64_t>(ticks * 10 / max<uint64_t>(period, 1), MV_PROFILEBUCKETS - 1)]++;
+}
+
 static VoiceNode *MV_GetVoice(int32_t handle)
 {
     if (handle < MV_MINVOICEHANDLE || handle > MV_MaxVoices)
@@ -343,18 +773,139 @@ static VoiceNode *MV_GetVoice(int32_t handle)
 
     DisableInterrupts();
 
-    for (VoiceNode *voice = VoiceList.next; voice != &VoiceList; voice = voice->next)
+    VoiceNode *voice = MV_HandleVoice[handle].load(std::memory_order_relaxed);
+
+    RestoreInterrupts();
+
+    if (voice == NULL)
+        MV_SetErrorCode(MV_VoiceNotFound);
+
+    return voice;
+}
+
+/*---------------------------------------------------------------------
+   Voice command queue
+
+   The per-tic voice updates (pan, pitch, pause, loop end) are posted to
+   a single producer, single consumer ring instead of taking the driver
+   lock. The mixer applies them at the start of each buffer, and any
+   locked call applies them before doing anything else. Only the game
+   thread may post, and the ring is only drained with the driver locked
+   or from the mixer, which the driver already serializes.
+---------------------------------------------------------------------*/
+
+#define MV_MAXCOMMANDS 512
+
+enum
+{
+    MV_CMD_PAN,
+    MV_CMD_PAN3D,
+    MV_CMD_PITCH,
+    MV_CMD_FREQUENCY,
+    MV_CMD_PAUSE,
+    MV_CMD_ENDLOOPING,
+};
+
+typedef struct
+{
+    int16_t type;
+    int16_t handle;
+    int32_t arg[3];
+} voicecommand_t;
+
+static voicecommand_t MV_Commands[MV_MAXCOMMANDS];
+static std::atomic<uint32_t> MV_CommandHead, MV_CommandTail;
+
+static void MV_SetVoicePan3D(VoiceNode *voice, int32_t angle, int32_t distance)
+{
+    if (distance < 0)
     {
-        if (handle == voice->handle)
-        {
-            RestoreInterrupts();
-            return voice;
-        }
+        distance = -distance;
+        angle += MV_NUMPANPOSITIONS / 2;
     }
 
-    RestoreInterrupts();
-    MV_SetErrorCode(MV_VoiceNotFound);
-    return NULL;
+    int const volume = MIX_VOLUME(distance);
+
+    angle &= MV_MAXPANPOSITION;
+
+    MV_SetVoiceVolume(voice, max(0, 255 - distance), MV_PanTable[angle][volume].left, MV_PanTable[angle][volume].right,
+                      voice->volume);
+
+    voice->Angle = angle;
+}
+
+static void MV_RunCommand(voicecommand_t const *cmd)
+{
+    VoiceNode *voice = MV_HandleVoice[cmd->handle].load(std::memory_order_relaxed);
+
+    // the voice may have finished since the command was posted
+    if (voice == NULL)
+        return;
+
+    switch (cmd->type)
+    {
+        case MV_CMD_PAN:
+            MV_SetVoiceVolume(voice, cmd->arg[0], cmd->arg[1], cmd->arg[2], voice->volume);
+            voice->Angle = -1;
+            break;
+        case MV_CMD_PAN3D: MV_SetVoicePan3D(voice, cmd->arg[0], cmd->arg[1]); break;
+        case MV_CMD_PITCH: MV_SetVoicePitch(voice, voice->SamplingRate, cmd->arg[0]); break;
+        case MV_CMD_FREQUENCY: MV_SetVoicePitch(voice, cmd->arg[0], 0); break;
+        case MV_CMD_PAUSE: voice->Paused = cmd->arg[0]; break;
+        case MV_CMD_ENDLOOPING:
+            voice->LoopCount = 0;
+            voice->LoopStart = NULL;
+            voice->LoopEnd = NULL;
+            if (voice->wavetype == FMT_STREAM)
+                MV_EndStreamLooping(voice);
+            break;
+    }
+}
+
+static void MV_ProcessCommands(void)
+{
+    uint32_t const head = MV_CommandHead.load(std::memory_order_acquire);
+    uint32_t tail = MV_CommandTail.load(std::memory_order_relaxed);
+
+    if (head == tail || !MV_HandleVoice)
+        return;
+
+    for (; tail != head; tail++)
+        MV_RunCommand(&MV_Commands[tail % MV_MAXCOMMANDS]);
+
+    MV_CommandTail.store(tail, std::memory_order_release);
+}
+
+static int32_t MV_PostCommand(int32_t type, int32_t handle, int32_t arg0, int32_t arg1 = 0, int32_t arg2 = 0)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    if (handle < MV_MINVOICEHANDLE || handle > MV_MaxVoices)
+    {
+        if (MV_Printf)
+            MV_Printf("MV_PostCommand(): bad handle (%d)!\n", handle);
+        MV_SetErrorCode(MV_VoiceNotFound);
+        return MV_Error;
+    }
+
+    voicecommand_t const cmd = { (int16_t)type, (int16_t)handle, { arg0, arg1, arg2 } };
+
+    uint32_t const head = MV_CommandHead.load(std::memory_order_relaxed);
+
+    if (head - MV_CommandTail.load(std::memory_order_acquire) >= MV_MAXCOMMANDS)
+    {
+        // the mixer has fallen behind (or the driver never mixes): apply it under the lock
+        DisableInterrupts();
+        MV_RunCommand(&cmd);
+        RestoreInterrupts();
+        return MV_Ok;
+    }
+
+    MV_Commands[head % MV_MAXCOMMANDS] = cmd;
+    MV_CommandHead.store(head + 1, std::memory_order_release);
+
+    return MV_Ok;
 }
 
 VoiceNode *MV_BeginService(int32_t handle)
@@ -379,7 +930,10 @@ static inline void MV_EndService(void) { RestoreInterrupts(); }
 
 int32_t MV_VoicePlaying(int32_t handle)
 {
-    return (MV_Installed && MV_GetVoice(handle)) ? TRUE : FALSE;
+    if (!MV_Installed || handle < MV_MINVOICEHANDLE || handle > MV_MaxVoices)
+        return FALSE;
+
+    return MV_HandleVoice[handle].load(std::memory_order_acquire) ? TRUE : FALSE;
 }
 
 int32_t MV_KillAllVoices(void)
@@ -486,6 +1040,9 @@ VoiceNode *MV_AllocVoice(int32_t priority)
     } while (MV_VoicePlaying(vhan));
 
     voice->handle = vhan;
+    voice->decodeticks = voice->mixticks = 0;
+    voice->Angle = voice->hrtf.angle = -1;
+    voice->Binaural = FALSE;
 
     return voice;
 }
@@ -528,31 +1085,9 @@ void MV_SetVoicePitch(VoiceNode *voice, uint32_t rate, int32_t pitchoffset)
                                   voice->RateScale;
 }
 
-int32_t MV_SetPitch(int32_t handle, int32_t pitchoffset)
-{
-    VoiceNode *voice = MV_BeginService(handle);
-
-    if (voice == NULL)
-        return MV_Error;
-
-    MV_SetVoicePitch(voice, voice->SamplingRate, pitchoffset);
-    MV_EndService();
+int32_t MV_SetPitch(int32_t handle, int32_t pitchoffset) { return MV_PostCommand(MV_CMD_PITCH, handle, pitchoffset); }
 
-    return MV_Ok;
-}
-
-int32_t MV_SetFrequency(int32_t handle, int32_t frequency)
-{
-    VoiceNode *voice = MV_BeginService(handle);
-
-    if (voice == NULL)
-        return MV_Error;
-
-    MV_SetVoicePitch(voice, frequency, 0);
-    MV_EndService();
-
-    return MV_Ok;
-}
+int32_t MV_SetFrequency(int32_t handle, int32_t frequency) { return MV_PostCommand(MV_CMD_FREQUENCY, handle, frequency); }
 
 static inline const int16_t *MV_GetVolumeTable(int32_t vol) { return MV_VolumeTable[MIX_VOLUME(vol)]; }
 
@@ -605,27 +1140,27 @@ void MV_SetVoiceMixMode(VoiceNode *voice)
             MV_LeftVolume = MV_RightVolume;
             fallthrough__;
         case T_16BITSOURCE | T_MONO:
-        case T_16BITSOURCE | T_RIGHTQUIET: voice->mix = MV_Mix16BitMono16; break;
+        case T_16BITSOURCE | T_RIGHTQUIET: voice->mix = MV_Mix16BitMono16; voice->busmix = MV_MixBusMono16; break;
 
         case T_LEFTQUIET:
             MV_LeftVolume = MV_RightVolume;
             fallthrough__;
         case T_MONO:
-        case T_RIGHTQUIET: voice->mix = MV_Mix16BitMono; break;
+        case T_RIGHTQUIET: voice->mix = MV_Mix16BitMono; voice->busmix = MV_MixBusMono; break;
 
-        case T_16BITSOURCE: voice->mix = MV_Mix16BitStereo16; break;
+        case T_16BITSOURCE: voice->mix = MV_Mix16BitStereo16; voice->busmix = MV_MixBusStereo16; break;
 
-        case T_SIXTEENBIT_STEREO: voice->mix = MV_Mix16BitStereo; break;
+        case T_SIXTEENBIT_STEREO: voice->mix = MV_Mix16BitStereo; voice->busmix = MV_MixBusStereo; break;
 
-        case T_16BITSOURCE | T_STEREOSOURCE: voice->mix = MV_Mix16BitStereo16Stereo; break;
+        case T_16BITSOURCE | T_STEREOSOURCE: voice->mix = MV_Mix16BitStereo16Stereo; voice->busmix = MV_MixBusStereo16Stereo; break;
 
-        case T_16BITSOURCE | T_STEREOSOURCE | T_MONO: voice->mix = MV_Mix16BitMono16Stereo; break;
+        case T_16BITSOURCE | T_STEREOSOURCE | T_MONO: voice->mix = MV_Mix16BitMono16Stereo; voice->busmix = MV_MixBusMono16Stereo; break;
 
-        case T_STEREOSOURCE: voice->mix = MV_Mix16BitStereo8Stereo; break;
+        case T_STEREOSOURCE: voice->mix = MV_Mix16BitStereo8Stereo; voice->busmix = MV_MixBusStereo8Stereo; break;
 
-        case T_STEREOSOURCE | T_MONO: voice->mix = MV_Mix16BitMono8Stereo; break;
+        case T_STEREOSOURCE | T_MONO: voice->mix = MV_Mix16BitMono8Stereo; voice->busmix = MV_MixBusMono8Stereo; break;
 
-        default: voice->mix = NULL; break;
+        default: voice->mix = voice->busmix = NULL; break;
     }
 }
 
@@ -651,122 +1186,632 @@ void MV_SetVoiceVolume(VoiceNode *voice, int32_t vol, int32_t left, int32_t righ
     MV_SetVoiceMixMode(voice);
 }
 
-int32_t MV_PauseVoice(int32_t handle, int32_t pause)
+int32_t MV_PauseVoice(int32_t handle, int32_t pause) { return MV_PostCommand(MV_CMD_PAUSE, handle, pause); }
+
+static void MV_GetVoicePosition(VoiceNode *voice, int32_t *position)
+{
+    switch (voice->wavetype)
+    {
+#ifdef HAVE_VORBIS
+        case FMT_VORBIS: *position = MV_GetVorbisPosition(voice); break;
+#endif
+#ifdef HAVE_FLAC
+        case FMT_FLAC: *position = MV_GetFLACPosition(voice); break;
+#endif
+        case FMT_XA: *position = MV_GetXAPosition(voice); break;
+#ifdef HAVE_XMP
+        case FMT_XMP: *position = MV_GetXMPPosition(voice); break;
+#endif
+        case FMT_STREAM: *position = MV_GetStreamPosition(voice); break;
+        default: break;
+    }
+}
+
+static void MV_SetVoicePosition(VoiceNode *voice, int32_t position)
+{
+    switch (voice->wavetype)
+    {
+#ifdef HAVE_VORBIS
+        case FMT_VORBIS: MV_SetVorbisPosition(voice, position); break;
+#endif
+#ifdef HAVE_FLAC
+        case FMT_FLAC: MV_SetFLACPosition(voice, position); break;
+#endif
+        case FMT_XA: MV_SetXAPosition(voice, position); break;
+#ifdef HAVE_XMP
+        case FMT_XMP: MV_SetXMPPosition(voice, position); break;
+#endif
+        case FMT_STREAM: MV_SetStreamPosition(voice, position); break;
+        default: break;
+    }
+}
+
+int32_t MV_GetPosition(int32_t handle, int32_t *position)
+{
+    VoiceNode *voice = MV_BeginService(handle);
+
+    if (voice == NULL)
+        return MV_Error;
+
+    MV_GetVoicePosition(voice, position);
+    MV_EndService();
+
+    return MV_Ok;
+}
+
+int32_t MV_SetPosition(int32_t handle, int32_t position)
+{
+    VoiceNode *voice = MV_BeginService(handle);
+
+    if (voice == NULL)
+        return MV_Error;
+
+    MV_SetVoicePosition(voice, position);
+    MV_EndService();
+
+    return MV_Ok;
+}
+
+/*---------------------------------------------------------------------
+   Streamed music
+
+   When MV_StreamLead is above zero, music voices do not decode inside
+   MV_ServiceVoc. MV_StartStream moves the decoder to a copy of the voice
+   that only the stream thread touches. The thread copies each block it
+   decodes into a single producer, single consumer ring of slots, and
+   stays up to MV_StreamLead milliseconds ahead of the mixer. The voice
+   becomes FMT_STREAM, and its GetSound only takes the next slot. If the
+   ring is empty, the mixer plays silence and counts an underrun instead
+   of waiting for the decoder.
+
+   MV_SetPosition bumps the stream's generation. The decoder then seeks,
+   and the mixer skips the slots decoded before the seek. Stopping a
+   stream waits until the thread is done with its decoder, so the
+   sound data may be freed as soon as the voice is stopped.
+---------------------------------------------------------------------*/
+
+#define MV_STREAMSLOTSIZE (MV_MIXBUFFERSIZE * 16)  // bytes: 1024 frames of 16-bit stereo
+
+int32_t MV_StreamLead = 250;
+
+typedef struct
+{
+    uint32_t generation;
+    uint32_t numframes;
+    int32_t  position;  // decoder position after the block the slot starts in
+    uint32_t rate;
+    char     bits;
+    char     channels;
+    char     data[MV_STREAMSLOTSIZE];
+} streamslot_t;
+
+typedef struct streamdata
+{
+    struct streamdata *next;  // in MV_Streams
+
+    VoiceNode decoder;  // the voice as the format's MV_Play function set it up
+    streamslot_t *slots;
+    uint32_t numslots;
+
+    // decoder side
+    char const *pending;  // what is left of the decoder's last block
+    uint32_t pendingframes;
+    int32_t  pendingposition;
+    uint32_t decodegeneration;
+
+    // mixer side
+    uint32_t playgeneration;
+    bool holding;  // the voice is playing slots[tail]
+
+    std::atomic<uint32_t> head, tail;
+    std::atomic<uint32_t> generation;
+    std::atomic<uint32_t> finished;  // generation + 1 once the decoder ran out
+    std::atomic<int32_t>  seekposition;
+    std::atomic<int32_t>  position;
+    std::atomic<bool>     endlooping;
+    std::atomic<bool>     stopped;
+} streamdata;
+
+static streamdata *MV_Streams;
+static thread_t MV_StreamThread;
+static semaphore_t MV_StreamSignal;  // posted whenever a stream needs the thread
+static semaphore_t MV_StreamLock;    // guards MV_Streams
+static bool MV_StreamThreadRunning;
+static std::atomic<bool> MV_StreamQuit;
+
+static std::atomic<uint32_t> MV_StreamUnderruns, MV_StreamBlocks;
+
+static int16_t MV_StreamSilence[MV_MIXBUFFERSIZE * 2];
+static uint8_t MV_StreamSilence8[MV_MIXBUFFERSIZE * 2];
+
+static void MV_SetStreamFormat(VoiceNode *voice, streamslot_t const *slot)
+{
+    voice->bits         = slot->bits;
+    voice->channels     = slot->channels;
+    voice->SamplingRate = slot->rate;
+
+    // CODEDUP multivoc.c MV_SetVoicePitch
+    voice->RateScale = (voice->SamplingRate * voice->PitchScale) / MV_MixRate;
+    voice->FixedPointBufferSize = (voice->RateScale * MV_MIXBUFFERSIZE) - voice->RateScale;
+    MV_SetVoiceMixMode(voice);
+}
+
+// Decodes until the ring is full or the decoder runs out. Runs on the
+// stream thread, or on the caller's thread before the stream is listed.
+static void MV_FillStream(streamdata *sd)
+{
+    VoiceNode *const decoder = &sd->decoder;
+    uint32_t const generation = sd->generation.load(std::memory_order_acquire);
+
+    if (generation != sd->decodegeneration)
+    {
+        sd->decodegeneration = generation;
+        sd->pendingframes = 0;
+        MV_SetVoicePosition(decoder, sd->seekposition.load(std::memory_order_relaxed));
+    }
+    else if (sd->finished.load(std::memory_order_relaxed) == generation + 1)
+        return;
+
+    if (sd->endlooping.exchange(false, std::memory_order_acquire))
+    {
+        decoder->LoopCount = 0;
+        decoder->LoopStart = NULL;
+        decoder->LoopEnd   = NULL;
+    }
+
+    uint32_t head = sd->head.load(std::memory_order_relaxed);
+
+    while (head - sd->tail.load(std::memory_order_acquire) < sd->numslots)
+    {
+        // MV_ReleaseStreamVoice() is waiting for the lock
+        if (sd->stopped.load(std::memory_order_acquire))
+            return;
+
+        streamslot_t *const slot = &sd->slots[head % sd->numslots];
+        bool ended = false;
+
+        slot->numframes = 0;
+
+        for (;;)
+        {
+            if (sd->pendingframes == 0)
+            {
+                // a full slot does not need the next block yet
+                if (slot->numframes * slot->channels * (slot->bits >> 3) == MV_STREAMSLOTSIZE)
+                    break;
+
+                uint64_t const start = MV_ProfileStart();
+                playbackstatus const status = decoder->GetSound(decoder);
+
+                if (start)
+                    MV_StreamDecodeTime[decoder->wavetype] += (uint32_t)((timerGetTicksU64() - start) * 1000000 / timerGetFreqU64());
+
+                if (status != KeepPlaying)
+                {
+                    ended = true;
+                    break;
+                }
+
+                sd->pending       = decoder->sound;
+                sd->pendingframes = decoder->length >> 16;
+                MV_GetVoicePosition(decoder, &sd->pendingposition);
+                continue;
+            }
+
+            if (slot->numframes == 0)
+            {
+                slot->bits     = decoder->bits;
+                slot->channels = decoder->channels;
+                slot->rate     = decoder->SamplingRate;
+                slot->position = sd->pendingposition;
+            }
+            else if (slot->bits != decoder->bits || slot->channels != decoder->channels || slot->rate != decoder->SamplingRate)
+                break;  // the block starts the next slot
+
+            uint32_t const framesize = slot->channels * (slot->bits >> 3);
+            uint32_t const count = min(sd->pendingframes, MV_STREAMSLOTSIZE / framesize - slot->numframes);
+
+            if (count == 0)
+                break;
+
+            Bmemcpy(slot->data + slot->numframes * framesize, sd->pending, count * framesize);
+
+            slot->numframes   += count;
+            sd->pending       += count * framesize;
+            sd->pendingframes -= count;
+        }
+
+        if (slot->numframes)
+        {
+            slot->generation = generation;
+            sd->head.store(++head, std::memory_order_release);
+        }
+
+        if (ended)
+        {
+            sd->finished.store(generation + 1, std::memory_order_release);
+            return;
+        }
+
+        // seeked meanwhile, the next pass starts over
+        if (sd->generation.load(std::memory_order_relaxed) != generation)
+            return;
+    }
+}
+
+static void MV_FreeStream(streamdata *sd)
+{
+    MV_ReleaseVoiceData(&sd->decoder);
+
+    Bfree(sd->slots);
+    Bfree(sd);
+}
+
+static int32_t MV_StreamThreadFunc(void *arg)
+{
+    UNREFERENCED_PARAMETER(arg);
+
+    while (semaphore_wait(&MV_StreamSignal) == 0 && !MV_StreamQuit.load(std::memory_order_acquire))
+    {
+        semaphore_wait(&MV_StreamLock);
+
+        for (streamdata *sd = MV_Streams; sd != NULL; sd = sd->next)
+            MV_FillStream(sd);
+
+        semaphore_post(&MV_StreamLock);
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextStreamBlock
+
+   Hands the mixer the next slot decoded by the stream thread.
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextStreamBlock(VoiceNode *voice)
+{
+    auto sd = (streamdata *)voice->rawdataptr;
+    uint32_t tail = sd->tail.load(std::memory_order_relaxed);
+
+    if (sd->holding)
+    {
+        sd->holding = false;
+        sd->tail.store(++tail, std::memory_order_release);
+        semaphore_post(&MV_StreamSignal);
+    }
+
+    // finished before head: the decoder publishes them the other way around
+    uint32_t const generation = sd->generation.load(std::memory_order_acquire);
+    uint32_t const finished = sd->finished.load(std::memory_order_acquire);
+    uint32_t const head = sd->head.load(std::memory_order_acquire);
+
+    if (tail != head && sd->slots[tail % sd->numslots].generation != generation)
+    {
+        do
+            tail++;
+        while (tail != head && sd->slots[tail % sd->numslots].generation != generation);
+
+        sd->tail.store(tail, std::memory_order_release);
+        semaphore_post(&MV_StreamSignal);
+    }
+
+    voice->position    = 0;
+    voice->BlockLength = 0;
+
+    if (tail == head)
+    {
+        if (finished == generation + 1)
+            return NoMoreData;
+
+        // waiting for the decoder to catch up with a seek is not an underrun
+        if (sd->playgeneration == generation)
+            MV_StreamUnderruns.fetch_add(1, std::memory_order_relaxed);
+
+        voice->sound  = (voice->bits == 16) ? (char const *)MV_StreamSilence : (char const *)MV_StreamSilence8;
+        voice->length = MV_MIXBUFFERSIZE << 16;
+
+        return KeepPlaying;
+    }
+
+    streamslot_t const *const slot = &sd->slots[tail % sd->numslots];
+
+    if (slot->bits != voice->bits || slot->channels != voice->channels || slot->rate != voice->SamplingRate)
+        MV_SetStreamFormat(voice, slot);
+
+    sd->holding = true;
+    sd->playgeneration = generation;
+    sd->position.store(slot->position, std::memory_order_relaxed);
+
+    voice->sound  = slot->data;
+    voice->length = slot->numframes << 16;
+
+    MV_StreamBlocks.fetch_add(1, std::memory_order_relaxed);
+
+    return KeepPlaying;
+}
+
+// Called from MV_PlayVoice before <voice> is listed. If the stream thread
+// can not be started, the voice simply keeps decoding in the mixer.
+static void MV_StartStream(VoiceNode *voice)
+{
+    switch (voice->wavetype)
+    {
+        case FMT_VORBIS:
+        case FMT_FLAC:
+        case FMT_XA:
+        case FMT_XMP: break;
+        default: return;
+    }
+
+    if (!MV_StreamThreadRunning)
+    {
+        if (semaphore_init(&MV_StreamLock, 1))
+            return;
+
+        if (semaphore_init(&MV_StreamSignal, 0))
+        {
+            semaphore_destroy(&MV_StreamLock);
+            return;
+        }
+
+        MV_StreamQuit.store(false, std::memory_order_relaxed);
+
+        if (thread_create(&MV_StreamThread, MV_StreamThreadFunc, NULL, "mv_stream"))
+        {
+            if (MV_Printf)
+                MV_Printf("MV_StartStream(): failed creating the stream thread, music will decode in the mixer.\n");
+
+            semaphore_destroy(&MV_StreamSignal);
+            semaphore_destroy(&MV_StreamLock);
+            MV_StreamLead = 0;
+            return;
+        }
+
+        Bmemset(MV_StreamSilence8, 0x80, sizeof(MV_StreamSilence8));
+        MV_StreamThreadRunning = true;
+    }
+
+    auto sd = (streamdata *)Xcalloc(1, sizeof(streamdata));
+
+    // sized for 16-bit stereo at the mixing rate
+    uint32_t const slotframes = MV_STREAMSLOTSIZE / (2 * sizeof(int16_t));
+    uint32_t const leadframes = (uint32_t)MV_StreamLead * MV_MixRate / 1000;
+
+    sd->numslots = max<uint32_t>((leadframes + slotframes - 1) / slotframes, 2) + 1;
+    sd->slots    = (streamslot_t *)Xmalloc(sd->numslots * sizeof(streamslot_t));
+
+    sd->decoder      = *voice;
+    sd->decoder.next = NULL;
+    sd->decoder.prev = NULL;
+
+    // not IS_QUIET, so that MV_SetVoiceMixMode() on the copy leaves MV_LeftVolume alone
+    sd->decoder.LeftVolume  = NULL;
+    sd->decoder.RightVolume = NULL;
+
+#ifdef HAVE_FLAC
+    if (voice->wavetype == FMT_FLAC)
+        MV_SetFLACOwner(&sd->decoder);
+#endif
+
+    voice->wavetype   = FMT_STREAM;
+    voice->rawdataptr = (void *)sd;
+    voice->GetSound   = MV_GetNextStreamBlock;
+    voice->sound      = NULL;
+    voice->length     = 0;
+    voice->position   = 0;
+
+    // start out with a full ring, and with the voice in the format of the first slot
+    MV_FillStream(sd);
+
+    if (sd->head.load(std::memory_order_relaxed))
+        MV_SetStreamFormat(voice, &sd->slots[0]);
+
+    semaphore_wait(&MV_StreamLock);
+    sd->next   = MV_Streams;
+    MV_Streams = sd;
+    semaphore_post(&MV_StreamLock);
+}
+
+// The stream thread takes no other lock, so waiting for it here is safe even
+// with the mixer locked. It gives up on the stream after the block it is on.
+static void MV_ReleaseStreamVoice(VoiceNode *voice)
+{
+    auto sd = (streamdata *)voice->rawdataptr;
+
+    voice->rawdataptr = NULL;
+
+    sd->stopped.store(true, std::memory_order_release);
+
+    semaphore_wait(&MV_StreamLock);
+
+    for (streamdata **link = &MV_Streams; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == sd)
+        {
+            *link = sd->next;
+            break;
+        }
+    }
+
+    semaphore_post(&MV_StreamLock);
+
+    MV_FreeStream(sd);
+}
+
+static void MV_EndStreamLooping(VoiceNode *voice)
+{
+    auto sd = (streamdata *)voice->rawdataptr;
+
+    sd->endlooping.store(true, std::memory_order_release);
+    semaphore_post(&MV_StreamSignal);
+}
+
+static int32_t MV_GetStreamPosition(VoiceNode *voice)
 {
-    VoiceNode *voice = MV_BeginService(handle);
+    auto sd = (streamdata *)voice->rawdataptr;
 
-    if (voice == NULL)
-        return MV_Error;
+    return sd->position.load(std::memory_order_relaxed);
+}
 
-    voice->Paused = pause;
-    MV_EndService();
+static void MV_SetStreamPosition(VoiceNode *voice, int32_t position)
+{
+    auto sd = (streamdata *)voice->rawdataptr;
 
-    return MV_Ok;
+    sd->seekposition.store(position, std::memory_order_relaxed);
+    sd->position.store(position, std::memory_order_relaxed);
+    sd->generation.fetch_add(1, std::memory_order_release);
+    semaphore_post(&MV_StreamSignal);
 }
 
-int32_t MV_GetPosition(int32_t handle, int32_t *position)
+static void MV_StopStreams(void)
 {
-    VoiceNode *voice = MV_BeginService(handle);
+    if (!MV_StreamThreadRunning)
+        return;
 
-    if (voice == NULL)
-        return MV_Error;
+    MV_StreamQuit.store(true, std::memory_order_release);
+    semaphore_post(&MV_StreamSignal);
+    thread_join(&MV_StreamThread);
 
-    switch (voice->wavetype)
+    while (MV_Streams)
     {
-#ifdef HAVE_VORBIS
-        case FMT_VORBIS: *position = MV_GetVorbisPosition(voice); break;
-#endif
-#ifdef HAVE_FLAC
-        case FMT_FLAC: *position = MV_GetFLACPosition(voice); break;
-#endif
-        case FMT_XA: *position = MV_GetXAPosition(voice); break;
-#ifdef HAVE_XMP
-        case FMT_XMP: *position = MV_GetXMPPosition(voice); break;
-#endif
-        default: break;
+        streamdata *sd = MV_Streams;
+        MV_Streams = sd->next;
+        MV_FreeStream(sd);
     }
 
-    MV_EndService();
+    semaphore_destroy(&MV_StreamSignal);
+    semaphore_destroy(&MV_StreamLock);
 
-    return MV_Ok;
+    MV_StreamThreadRunning = false;
 }
 
-int32_t MV_SetPosition(int32_t handle, int32_t position)
+void MV_GetStreamStats(streamstats_t *stats)
 {
-    VoiceNode *voice = MV_BeginService(handle);
+    stats->underruns = MV_StreamUnderruns.load(std::memory_order_relaxed);
+    stats->blocks    = MV_StreamBlocks.load(std::memory_order_relaxed);
+    stats->streams   = 0;
+    stats->buffered  = 0;
 
-    if (voice == NULL)
-        return MV_Error;
+    if (!MV_StreamThreadRunning)
+        return;
 
-    switch (voice->wavetype)
+    uint32_t slots = 0;
+
+    semaphore_wait(&MV_StreamLock);
+
+    for (streamdata const *sd = MV_Streams; sd; sd = sd->next)
     {
-#ifdef HAVE_VORBIS
-        case FMT_VORBIS: MV_SetVorbisPosition(voice, position); break;
-#endif
-#ifdef HAVE_FLAC
-        case FMT_FLAC: MV_SetFLACPosition(voice, position); break;
-#endif
-        case FMT_XA: MV_SetXAPosition(voice, position); break;
-#ifdef HAVE_XMP
-        case FMT_XMP: MV_SetXMPPosition(voice, position); break;
-#endif
-        default: break;
+        stats->streams++;
+        slots += sd->head.load(std::memory_order_relaxed) - sd->tail.load(std::memory_order_relaxed);
     }
 
-    MV_EndService();
+    semaphore_post(&MV_StreamLock);
 
-    return MV_Ok;
+    if (stats->streams && MV_MixRate)
+        stats->buffered = (int32_t)((uint64_t)slots * (MV_STREAMSLOTSIZE / (2 * sizeof(int16_t))) * 1000 / MV_MixRate / stats->streams);
+}
+
+int32_t MV_EndLooping(int32_t handle) { return MV_PostCommand(MV_CMD_ENDLOOPING, handle, 0); }
+
+int32_t MV_SetPan(int32_t handle, int32_t vol, int32_t left, int32_t right)
+{
+    return MV_PostCommand(MV_CMD_PAN, handle, vol, left, right);
 }
 
-int32_t MV_EndLooping(int32_t handle)
+int32_t MV_Pan3D(int32_t handle, int32_t angle, int32_t distance)
 {
-    VoiceNode *voice = MV_BeginService(handle);
+    return MV_PostCommand(MV_CMD_PAN3D, handle, angle, distance);
+}
 
-    if (voice == NULL)
+// Posts MV_Pan3D() for <count> voices at once, publishing them to the
+// mixer together. Whatever does not fit in the queue is applied under
+// one lock.
+int32_t MV_Pan3DBatch(voicepan3d_t const *pans, int32_t count)
+{
+    if (!MV_Installed)
         return MV_Error;
 
-    voice->LoopCount = 0;
-    voice->LoopStart = NULL;
-    voice->LoopEnd = NULL;
+    uint32_t const tail = MV_CommandTail.load(std::memory_order_acquire);
+    uint32_t head = MV_CommandHead.load(std::memory_order_relaxed);
+    int32_t status = MV_Ok;
+    bool locked = false;
 
-    MV_EndService();
+    for (int i = 0; i < count; i++)
+    {
+        voicepan3d_t const &pan = pans[i];
 
-    return MV_Ok;
-}
+        if (pan.handle < MV_MINVOICEHANDLE || pan.handle > MV_MaxVoices)
+        {
+            MV_SetErrorCode(MV_VoiceNotFound);
+            status = MV_Error;
+            continue;
+        }
 
-int32_t MV_SetPan(int32_t handle, int32_t vol, int32_t left, int32_t right)
-{
-    VoiceNode *voice = MV_BeginService(handle);
+        voicecommand_t const cmd = { MV_CMD_PAN3D, (int16_t)pan.handle, { pan.angle, pan.distance, 0 } };
 
-    if (voice == NULL)
-        return MV_Error;
+        if (!locked && head - tail < MV_MAXCOMMANDS)
+        {
+            MV_Commands[head++ % MV_MAXCOMMANDS] = cmd;
+            continue;
+        }
 
-    MV_SetVoiceVolume(voice, vol, left, right, voice->volume);
-    MV_EndService();
-    return MV_Ok;
-}
+        if (!locked)
+        {
+            // the queued ones go first
+            MV_CommandHead.store(head, std::memory_order_release);
+            DisableInterrupts();
+            locked = true;
+        }
 
-int32_t MV_Pan3D(int32_t handle, int32_t angle, int32_t distance)
-{
-    if (distance < 0)
-    {
-        distance = -distance;
-        angle += MV_NUMPANPOSITIONS / 2;
+        MV_RunCommand(&cmd);
     }
 
-    int const volume = MIX_VOLUME(distance);
+    if (locked)
+        RestoreInterrupts();
+    else
+        MV_CommandHead.store(head, std::memory_order_release);
 
-    angle &= MV_MAXPANPOSITION;
+    return status;
+}
+
+/*---------------------------------------------------------------------
+   The old reverb mixed the output back in after MV_ReverbDelay, scaled
+   by MV_ReverbLevel, so an echo fell by 60 dB after 3 / -log10(level)
+   delays. The network decays over the same time, and its output is
+   scaled like the first echo.
+---------------------------------------------------------------------*/
+
+#define MV_REVERBMAXDECAY 8.f  // seconds
+
+static void MV_UpdateReverb(void)
+{
+    if (MV_ReverbLevel == 0)
+        return;
+
+    float const feedback = (float)MV_ReverbLevel / MV_MAXVOLUME;
+    float const delay = (float)(MV_ReverbDelay / MV_SampleSize) / (float)MV_MixRate;
+    float const decay = (feedback < 1.f) ? min(-3.f * delay / log10f(feedback), MV_REVERBMAXDECAY) : MV_REVERBMAXDECAY;
 
-    return MV_SetPan(handle, max(0, 255 - distance),
-        MV_PanTable[ angle ][ volume ].left,
-        MV_PanTable[ angle ][ volume ].right);
+    MV_SetReverbDecay(&MV_Reverb, MV_MixRate, decay, feedback);
 }
 
 void MV_SetReverb(int32_t reverb)
 {
+    if (!MV_Installed)
+        return;
+
+    DisableInterrupts();
+
+    // start from silence, not from what was left when it was turned off
+    if (MV_ReverbLevel == 0)
+        MV_ClearReverb(&MV_Reverb);
+
     MV_ReverbLevel = MIX_VOLUME(reverb);
-    MV_ReverbTable = &MV_VolumeTable[MV_ReverbLevel][0];
+    MV_UpdateReverb();
+
+    RestoreInterrupts();
 }
 
 int32_t MV_GetMaxReverbDelay(void) { return MV_MIXBUFFERSIZE * MV_NumberOfBuffers; }
@@ -775,7 +1820,13 @@ int32_t MV_GetReverbDelay(void) { return MV_ReverbDelay / MV_SampleSize; }
 
 void MV_SetReverbDelay(int32_t delay)
 {
+    if (!MV_Installed)
+        return;
+
+    DisableInterrupts();
     MV_ReverbDelay = max(MV_MIXBUFFERSIZE, min(delay, MV_GetMaxReverbDelay())) * MV_SampleSize;
+    MV_UpdateReverb();
+    RestoreInterrupts();
 }
 
 static int32_t MV_SetMixMode(int32_t numchannels)
@@ -844,6 +1895,48 @@ static void MV_CalcVolume(int32_t MaxVolume)
     }
 }
 
+/*---------------------------------------------------------------------
+   Function: MV_CalcResampleTables
+
+   Fills the filter rows used by the bus mixers. Row p holds the taps
+   for a read position p/MV_RESAMPLEPHASES past a source frame. Cubic
+   is Catmull-Rom. Sinc is Blackman-windowed, with its cutoff at 0.9,
+   0.6 and 0.45 of the source Nyquist frequency so that pitched-up
+   voices (up to 1.5x and 2x the output rate) are band-limited too.
+---------------------------------------------------------------------*/
+void MV_CalcResampleTables(void)
+{
+    static float const cutoffs[MV_SINCCUTOFFS] = { 0.9f, 0.6f, 0.45f };
+
+    for (int p = 0; p < MV_RESAMPLEPHASES; p++)
+    {
+        double const f = (p + 0.5) / MV_RESAMPLEPHASES;
+
+        MV_CubicTable[p][0] = (float)(0.5 * (-f*f*f + 2*f*f - f));
+        MV_CubicTable[p][1] = (float)(0.5 * (3*f*f*f - 5*f*f + 2));
+        MV_CubicTable[p][2] = (float)(0.5 * (-3*f*f*f + 4*f*f + f));
+        MV_CubicTable[p][3] = (float)(0.5 * (f*f*f - f*f));
+
+        for (int c = 0; c < MV_SINCCUTOFFS; c++)
+        {
+            double taps[MV_SINCTAPS], sum = 0;
+
+            for (int t = 0; t < MV_SINCTAPS; t++)
+            {
+                double const x = t - (MV_SINCTAPS/2 - 1) - f;
+                double const w = 0.42 + 0.5 * cos(M_PI * x / (MV_SINCTAPS/2)) + 0.08 * cos(2 * M_PI * x / (MV_SINCTAPS/2));
+                double const arg = M_PI * cutoffs[c] * x;
+
+                taps[t] = w * ((fabs(arg) < 1e-9) ? 1.0 : sin(arg) / arg);
+                sum += taps[t];
+            }
+
+            for (int t = 0; t < MV_SINCTAPS; t++)
+                MV_SincTable[c][p][t] = (float)(taps[t] / sum);
+        }
+    }
+}
+
 static void MV_CalcPanTable(void)
 {
     const int32_t HalfAngle = MV_NUMPANPOSITIONS / 2;
@@ -912,6 +2005,12 @@ int32_t MV_Init(int32_t soundcard, int32_t MixRate, int32_t Voices, int32_t numc
 
     MV_MaxVoices = Voices;
 
+    MV_HandleVoice = (std::atomic<VoiceNode *> *)Xcalloc(Voices + 1, sizeof(std::atomic<VoiceNode *>));
+    MV_VoiceOrder = (voiceorder_t *)Xcalloc(Voices, sizeof(voiceorder_t));
+    Bmemset(&MV_VoiceStats, 0, sizeof(MV_VoiceStats));
+    MV_CommandHead.store(0, std::memory_order_relaxed);
+    MV_CommandTail.store(0, std::memory_order_relaxed);
+
     LL_Reset((VoiceNode*) &VoiceList, next, prev);
     LL_Reset((VoiceNode*) &VoicePool, next, prev);
 
@@ -930,6 +2029,8 @@ int32_t MV_Init(int32_t soundcard, int32_t MixRate, int32_t Voices, int32_t numc
     if (MV_ErrorCode != MV_Ok)
     {
         ALIGNED_FREE_AND_NULL(MV_Voices);
+        DO_FREE_AND_NULL(MV_HandleVoice);
+        DO_FREE_AND_NULL(MV_VoiceOrder);
 
         return MV_Error;
     }
@@ -937,7 +2038,6 @@ int32_t MV_Init(int32_t soundcard, int32_t MixRate, int32_t Voices, int32_t numc
     MV_Installed    = TRUE;
     MV_CallBackFunc = NULL;
     MV_ReverbLevel  = 0;
-    MV_ReverbTable  = NULL;
 
     // Set the sampling rate
     MV_MixRate = MixRate;
@@ -945,6 +2045,8 @@ int32_t MV_Init(int32_t soundcard, int32_t MixRate, int32_t Voices, int32_t numc
     // Set Mixer to play stereo digitized sound
     MV_SetMixMode(numchannels);
     MV_ReverbDelay = MV_BufferSize * 3;
+    MV_InitReverb(&MV_Reverb, MV_MixRate);
+    MV_InitHrtf(MV_MixRate);
 
     // Make sure we don't cross a physical page
     MV_MixBuffer[ MV_NumberOfBuffers ] = ptr;
@@ -957,6 +2059,7 @@ int32_t MV_Init(int32_t soundcard, int32_t MixRate, int32_t Voices, int32_t numc
     // Calculate pan table
     MV_CalcPanTable();
     MV_CalcVolume(MV_MAXTOTALVOLUME);
+    MV_CalcResampleTables();
 
     // Start the playback engine
     if (MV_StartPlayback() != MV_Ok)
@@ -977,6 +2080,7 @@ int32_t MV_Shutdown(void)
         return MV_Ok;
 
     MV_KillAllVoices();
+    MV_ClearDecodeCache();
 
     MV_Installed = FALSE;
 
@@ -986,8 +2090,15 @@ int32_t MV_Shutdown(void)
     // Shutdown the sound card
     SoundDriver_Shutdown();
 
+    // the music voices are still around, and their streams with them
+    MV_StopStreams();
+
     // Free any voices we allocated
     ALIGNED_FREE_AND_NULL(MV_Voices);
+    DO_FREE_AND_NULL(MV_HandleVoice);
+    DO_FREE_AND_NULL(MV_VoiceOrder);
+
+    MV_FreeReverb(&MV_Reverb);
 
     LL_Reset((VoiceNode*) &VoiceList, next, prev);
     LL_Reset((VoiceNode*) &VoicePool, next, prev);
@@ -1005,6 +2116,282 @@ int32_t MV_Shutdown(void)
 
 void MV_SetPrintf(void (*function)(const char *, ...)) { MV_Printf = function; }
 
+/*---------------------------------------------------------------------
+   Function: MV_BenchmarkMix
+
+   Mixes <numbuffers> buffers of <numvoices> synthetic 16-bit mono
+   voices panned across the stereo field, either through the legacy
+   per-voice clamping mixers or through the 32-bit bus. Nothing is
+   played; the caller times the call. Returns MV_Error if the mixer
+   is not running.
+---------------------------------------------------------------------*/
+#define MV_BENCHMARKSAMPLES 22050
+
+// <numvoices> voices of noise for the benchmarks, panned across the stereo field
+static VoiceNode *MV_CreateBenchmarkVoices(int32_t numvoices, int16_t *data)
+{
+    auto voices = (VoiceNode *)Xcalloc(numvoices, sizeof(VoiceNode));
+
+    uint32_t seed = 1;
+
+    for (int i = 0; i < MV_BENCHMARKSAMPLES; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (int16_t)(seed >> 16);
+    }
+
+    for (int i = 0; i < numvoices; i++)
+    {
+        VoiceNode *const voice = &voices[i];
+        int const pan = (i * 37) & MV_MAXPANPOSITION;
+
+        voice->sound = (char const *)data;
+        voice->bits = 16;
+        voice->channels = 1;
+        voice->length = (uint32_t)MV_BENCHMARKSAMPLES << 16;
+        voice->position = (uint32_t)((i * 977) % MV_BENCHMARKSAMPLES) << 16;
+        voice->Angle = pan;
+        voice->hrtf.angle = -1;
+
+        MV_SetVoicePitch(voice, 22050 + (i & 7) * 1000, 0);
+        MV_SetVoiceVolume(voice, 255, MV_PanTable[pan][0].left, MV_PanTable[pan][0].right, 1.f);
+    }
+
+    return voices;
+}
+
+int32_t MV_BenchmarkMix(int32_t numvoices, int32_t numbuffers, int32_t bus)
+{
+    if (!MV_Installed || numvoices <= 0)
+        return MV_Error;
+
+    auto data = (int16_t *)Xmalloc(MV_BENCHMARKSAMPLES * sizeof(int16_t));
+    auto voices = MV_CreateBenchmarkVoices(numvoices, data);
+    auto scratch = (int16_t *)Xmalloc(MV_BufferSize);
+
+    DisableInterrupts();
+
+    for (int b = 0; b < numbuffers; b++)
+    {
+        if (bus)
+            Bmemset(MV_Bus, 0, sizeof(MV_Bus));
+        else
+            Bmemset(scratch, 0, MV_BufferSize);
+
+        for (int i = 0; i < numvoices; i++)
+        {
+            VoiceNode *const voice = &voices[i];
+
+            if (voice->position + voice->FixedPointBufferSize >= voice->length)
+                voice->position = 0;
+
+            MV_MixDestination = bus ? (char *)MV_Bus : (char *)scratch;
+            MV_LeftVolume = voice->LeftVolume;
+            MV_RightVolume = voice->RightVolume;
+
+            if ((MV_Channels == 2) && (IS_QUIET(MV_LeftVolume)))
+            {
+                MV_LeftVolume = MV_RightVolume;
+                MV_MixDestination += bus ? (int32_t)sizeof(int32_t) : MV_RightChannelOffset;
+            }
+
+            if (bus)
+            {
+                MV_SetBusGains(voice);
+                voice->position = voice->busmix(voice, MV_MIXBUFFERSIZE);
+            }
+            else
+                voice->position = voice->mix(voice, MV_MIXBUFFERSIZE);
+        }
+
+        if (bus)
+            MV_BusToInt16(MV_Bus, scratch, MV_BufferSize >> 1);
+    }
+
+    RestoreInterrupts();
+
+    Bfree(scratch);
+    Bfree(voices);
+    Bfree(data);
+
+    return MV_Ok;
+}
+
+/*---------------------------------------------------------------------
+   Function: MV_BenchmarkHrtf
+
+   Mixes <numbuffers> buffers of <numvoices> synthetic voices through
+   the HRTF, like binaural voices on the bus. With <moving>, every voice
+   turns to the next angle each buffer, so that every buffer crossfades.
+   Nothing is played; the caller times the call. Returns MV_Error if the
+   mixer is not running in stereo.
+---------------------------------------------------------------------*/
+int32_t MV_BenchmarkHrtf(int32_t numvoices, int32_t numbuffers, int32_t moving)
+{
+    if (!MV_Installed || numvoices <= 0 || MV_Channels != 2)
+        return MV_Error;
+
+    auto data = (int16_t *)Xmalloc(MV_BENCHMARKSAMPLES * sizeof(int16_t));
+    auto voices = MV_CreateBenchmarkVoices(numvoices, data);
+    auto scratch = (int16_t *)Xmalloc(MV_BufferSize);
+
+    DisableInterrupts();
+
+    for (int b = 0; b < numbuffers; b++)
+    {
+        Bmemset(MV_Bus, 0, sizeof(MV_Bus));
+
+        for (int i = 0; i < numvoices; i++)
+        {
+            VoiceNode *const voice = &voices[i];
+
+            if (voice->position + voice->FixedPointBufferSize >= voice->length)
+                voice->position = 0;
+
+            if (moving)
+                voice->Angle = (voice->Angle + MV_NUMPANPOSITIONS / MV_HRTFANGLES) & MV_MAXPANPOSITION;
+
+            Bmemset(MV_HrtfBus, 0, sizeof(MV_HrtfBus));
+
+            MV_MixDestination = (char *)MV_HrtfBus;
+            MV_LeftVolume = MV_RightVolume = max(voice->LeftVolume, voice->RightVolume);
+            MV_SetBusGains(voice);
+
+            voice->position = voice->busmix(voice, MV_MIXBUFFERSIZE);
+
+            MV_ProcessHrtf(&voice->hrtf, MV_HrtfBus, MV_MixesLeftOnly(voice), MV_Bus, MV_MIXBUFFERSIZE, MV_HrtfAngle(voice));
+        }
+
+        MV_BusToInt16(MV_Bus, scratch, MV_BufferSize >> 1);
+    }
+
+    RestoreInterrupts();
+
+    Bfree(scratch);
+    Bfree(voices);
+    Bfree(data);
+
+    return MV_Ok;
+}
+
+/*---------------------------------------------------------------------
+   Function: MV_BenchmarkReverb
+
+   Runs <numbuffers> buffers of noise through a reverb of its own at
+   the current mix rate and channel count. Nothing is played; the
+   caller times the call. Returns MV_Error if the mixer is not running.
+---------------------------------------------------------------------*/
+int32_t MV_BenchmarkReverb(int32_t numbuffers)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    static float block[MV_MIXBUFFERSIZE * 2];
+    reverb_t reverb;
+
+    MV_InitReverb(&reverb, MV_MixRate);
+    MV_SetReverbDecay(&reverb, MV_MixRate, 2.f, 0.5f);
+
+    uint32_t seed = 1;
+
+    for (int b = 0; b < numbuffers; b++)
+    {
+        for (int i = 0; i < MV_MIXBUFFERSIZE * MV_Channels; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            block[i] = (float)(int16_t)(seed >> 16);
+        }
+
+        MV_ProcessReverb(&reverb, block, MV_MIXBUFFERSIZE, MV_Channels);
+    }
+
+    MV_FreeReverb(&reverb);
+
+    return MV_Ok;
+}
+
+/*---------------------------------------------------------------------
+   Function: MV_MeasureResampler
+
+   Plays a full scale sine at <frequency> (cycles per source frame)
+   through the mono bus mixer with resampling mode <interp>, stepping
+   <rate> source frames per output sample, and stores the energy that
+   is not the expected output tone in <alias>, in dB relative to the
+   tone. When the tone lands above the output Nyquist frequency all of
+   the output counts as aliasing. Returns MV_Error if the mixer is not
+   running.
+---------------------------------------------------------------------*/
+int32_t MV_MeasureResampler(int32_t interp, float frequency, float rate, float *alias)
+{
+    if (!MV_Installed)
+        return MV_Error;
+
+    int const numframes = 16384, numout = 4096, skip = 64;
+    auto data = (int16_t *)Xmalloc(numframes * sizeof(int16_t));
+    auto out = (int32_t *)Xcalloc(numout * 2, sizeof(int32_t));
+
+    for (int i = 0; i < numframes; i++)
+        data[i] = (int16_t)Blrintf(32000.f * sinf(2.f * (float)M_PI * frequency * i));
+
+    VoiceNode voice;
+    Bmemset(&voice, 0, sizeof(voice));
+
+    voice.sound = (char const *)data;
+    voice.bits = 16;
+    voice.channels = 1;
+    voice.volume = 1.f;
+    voice.length = (uint32_t)numframes << 16;
+    voice.RateScale = (uint32_t)Blrintf(rate * 65536.f);
+
+    MV_SetVoiceVolume(&voice, 255, 255, 255, 1.f);
+
+    DisableInterrupts();
+
+    int32_t const saveInterpolation = MV_Interpolation;
+    int const stride = MV_SampleSize >> 1;
+
+    MV_Interpolation = interp;
+    MV_LeftVolume = MV_RightVolume = voice.LeftVolume;
+    MV_LeftGain = MV_RightGain = 1.f;
+    MV_MixDestination = (char *)out;
+    voice.busmix(&voice, numout / stride);
+
+    MV_Interpolation = saveInterpolation;
+
+    RestoreInterrupts();
+
+    // least squares fit of the expected tone, the rest is error
+    double const w = 2.0 * M_PI * frequency * rate;
+    double const aliased = frequency * rate >= 0.5;
+    double fitsin = 0, fitcos = 0, total = 0, error = 0;
+    int const n = numout / stride - skip;
+
+    for (int i = skip; i < numout / stride; i++)
+    {
+        fitsin += out[i * stride] * sin(w * i);
+        fitcos += out[i * stride] * cos(w * i);
+    }
+
+    fitsin *= 2.0 / n;
+    fitcos *= 2.0 / n;
+
+    for (int i = skip; i < numout / stride; i++)
+    {
+        double const tone = aliased ? 0.0 : fitsin * sin(w * i) + fitcos * cos(w * i);
+        double const residual = out[i * stride] - tone;
+
+        error += residual * residual;
+        total += 32000.0 * 32000.0 * 0.5;
+    }
+
+    Bfree(out);
+    Bfree(data);
+
+    *alias = (float)(10.0 * log10(max(error, 1e-3) / total));
+
+    return MV_Ok;
+}
+
 const char *loopStartTags[loopStartTagCount] = { "LOOP_START", "LOOPSTART", "LOOP" };
 const char *loopEndTags[loopEndTagCount] = { "LOOP_END", "LOOPEND" };
 const char *loopLengthTags[loopLengthTagCount] = { "LOOP_LENGTH", "LOOPLENGTH" };
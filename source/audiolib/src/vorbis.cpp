@@ -453,6 +453,78 @@ int32_t MV_PlayVorbis(char *ptr, uint32_t length, int32_t loopstart, int32_t loo
     return voice->handle;
 }
 
+/*---------------------------------------------------------------------
+Function: MV_DecodeVorbis
+
+Decodes a whole OggVorbis sound for the decoded sound cache. Sounds
+with loop tags, chained streams or more than maxbytes of PCM are
+left to MV_PlayVorbis.
+---------------------------------------------------------------------*/
+
+int32_t MV_DecodeVorbis(char const *ptr, uint32_t length, uint32_t maxbytes, decoded_sound *snd)
+{
+    auto vd = (vorbis_data *)calloc(1, sizeof(vorbis_data));
+
+    if (!vd)
+        return MV_Error;
+
+    vd->ptr    = const_cast<char *>(ptr);
+    vd->pos    = 0;
+    vd->length = length;
+
+    if (ov_open_callbacks((void *)vd, &vd->vf, 0, 0, vorbis_callbacks) < 0)
+    {
+        free(vd);
+        return MV_Error;
+    }
+
+    vorbis_info *vi = ov_info(&vd->vf, 0);
+    ogg_int64_t const numframes = ov_pcm_total(&vd->vf, -1);
+
+    VoiceNode voice;
+    Bmemset(&voice, 0, sizeof(voice));
+    MV_GetVorbisCommentLoops(&voice, ov_comment(&vd->vf, 0));
+
+    int32_t status = MV_Error;
+
+    if (vi && (vi->channels == 1 || vi->channels == 2) && ov_streams(&vd->vf) == 1 && voice.LoopSize == 0 && numframes > 0 &&
+        numframes * vi->channels * 2 <= (ogg_int64_t)maxbytes)
+    {
+        snd->channels = vi->channels;
+        snd->rate     = vi->rate;
+        status        = MV_Ok;
+
+        for (;;)
+        {
+            int bitstream;
+#ifdef USING_TREMOR
+            int32_t bytes = ov_read(&vd->vf, vd->block, BLOCKSIZE, &bitstream);
+#else
+            int32_t bytes = ov_read(&vd->vf, vd->block, BLOCKSIZE, 0, 2, 1, &bitstream);
+#endif
+            if (bytes == OV_HOLE)
+                continue;
+            else if (bytes < 0)
+                status = MV_Error;
+
+            if (bytes <= 0)
+                break;
+
+#ifdef GEKKO
+            auto data = (int16_t *)vd->block;
+            for (int32_t i = 0; i < bytes / 2; ++i)
+                data[i] = (data[i] & 0xff) << 8 | ((data[i] & 0xff00) >> 8);
+#endif
+            MV_AppendDecoded(snd, vd->block, bytes / (2 * snd->channels));
+        }
+    }
+
+    ov_clear(&vd->vf);
+    free(vd);
+
+    return status;
+}
+
 void MV_ReleaseVorbisVoice( VoiceNode * voice )
 {
     if (voice->wavetype != FMT_VORBIS)
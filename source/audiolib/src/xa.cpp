@@ -475,6 +475,69 @@ int32_t MV_PlayXA(char *ptr, uint32_t length, int32_t loopstart, int32_t loopend
 }
 
 
+/*---------------------------------------------------------------------
+Function: MV_DecodeXA
+
+Decodes a whole XA sound for the decoded sound cache. Sounds with
+more than maxbytes of PCM are left to MV_PlayXA.
+---------------------------------------------------------------------*/
+
+int32_t MV_DecodeXA(char const *ptr, uint32_t length, uint32_t maxbytes, decoded_sound *snd)
+{
+    xa_data xad;
+    Bmemset(&xad, 0, sizeof(xad));
+
+    xad.ptr = const_cast<char *>(ptr);
+    xad.pos = XA_DATA_START;
+    xad.length = length;
+
+    int32_t status = MV_Ok;
+
+    while (status == MV_Ok && xad.pos + sizeof(XASector) <= xad.length)
+    {
+        XASector ssct;
+
+        memcpy(&ssct, (int8_t *)xad.ptr + xad.pos, sizeof(XASector));
+        xad.pos += sizeof(XASector);
+
+        if (ssct.sectorFiller[46] != (SUBMODE_REAL_TIME_SECTOR | SUBMODE_FORM | SUBMODE_AUDIO_DATA))
+            continue;
+
+        int const coding = ssct.sectorFiller[47];
+        int const channels = (coding & 3) + 1;
+        int const rate = (((coding >> 2) & 3) == 1) ? 18900 : 37800;
+
+        if (snd->numframes == 0)
+        {
+            snd->channels = channels;
+            snd->rate = rate;
+        }
+
+        if (channels > 2 || channels != snd->channels || rate != snd->rate)
+        {
+            status = MV_Error;
+            break;
+        }
+
+        if (channels == 2)
+            decodeSoundSectStereo(&ssct, &xad);
+        else
+            decodeSoundSectMono(&ssct, &xad);
+
+        uint32_t const numframes = xad.blocksize / (2 * channels);
+
+        if ((snd->numframes + numframes) * channels * 2 > maxbytes)
+            status = MV_Error;
+        else
+            MV_AppendDecoded(snd, xad.block, numframes);
+    }
+
+    free(xad.block);
+
+    return status;
+}
+
+
 void MV_ReleaseXAVoice( VoiceNode * voice )
 {
     auto xad = (xa_data *) voice->rawdataptr;
@@ -10,7 +10,7 @@ $(engine_obj)/compat.$o: $(engine_src)/compat.cpp $(engine_inc)/compat.h $(engin
 $(engine_obj)/config.$o: $(engine_src)/config.cpp $(engine_inc)/compat.h $(engine_inc)/osd.h $(engine_inc)/editor.h
 $(engine_obj)/crc32.$o: $(engine_src)/crc32.cpp $(engine_inc)/crc32.h
 $(engine_obj)/defs.$o: $(engine_src)/defs.cpp $(engine_inc)/build.h $(engine_inc)/buildtypes.h $(engine_inc)/baselayer.h $(engine_inc)/scriptfile.h $(engine_inc)/compat.h
-$(engine_obj)/engine.$o: $(engine_src)/engine.cpp $(engine_inc)/compat.h $(engine_inc)/build.h $(engine_inc)/buildtypes.h $(engine_inc)/pragmas.h $(engine_inc)/cache1d.h $(engine_inc)/a.h $(engine_inc)/osd.h $(engine_inc)/baselayer.h $(engine_src)/engine_priv.h $(engine_src)/engine_oldmap.h $(engine_inc)/polymost.h $(engine_inc)/hightile.h $(engine_inc)/mdsprite.h $(engine_inc)/polymer.h
+$(engine_obj)/engine.$o: $(engine_src)/engine.cpp $(engine_inc)/compat.h $(engine_inc)/build.h $(engine_inc)/buildtypes.h $(engine_inc)/pragmas.h $(engine_inc)/cache1d.h $(engine_inc)/a.h $(engine_inc)/osd.h $(engine_inc)/baselayer.h $(engine_src)/engine_priv.h $(engine_src)/engine_oldmap.h $(engine_inc)/thread.h $(engine_inc)/polymost.h $(engine_inc)/hightile.h $(engine_inc)/mdsprite.h $(engine_inc)/polymer.h
 $(engine_obj)/2d.$o: $(engine_src)/2d.cpp $(engine_inc)/build.h
 $(engine_obj)/tiles.$o: $(engine_src)/tiles.cpp $(engine_inc)/build.h
 $(engine_obj)/clip.$o: $(engine_src)/clip.cpp $(engine_inc)/build.h $(engine_inc)/clip.h
@@ -18,6 +18,7 @@ $(engine_obj)/screenshot.$o: $(engine_src)/screenshot.cpp
 $(engine_obj)/hash.$o: $(engine_src)/hash.cpp $(engine_inc)/hash.h
 $(engine_obj)/colmatch.$o: $(engine_src)/colmatch.cpp
 $(engine_obj)/mhk.$o: $(engine_src)/mhk.cpp
+$(engine_obj)/pvs.$o: $(engine_src)/pvs.cpp $(engine_inc)/compat.h $(engine_inc)/build.h $(engine_src)/engine_priv.h $(engine_inc)/cache1d.h $(engine_inc)/md4.h $(engine_inc)/lz4.h
 $(engine_obj)/palette.$o: $(engine_src)/palette.cpp $(engine_inc)/palette.h
 $(engine_obj)/polymost.$o: $(engine_src)/polymost.cpp $(engine_inc)/lz4.h $(engine_inc)/compat.h $(engine_inc)/build.h $(engine_inc)/buildtypes.h $(engine_src)/engine_priv.h $(engine_inc)/polymost.h $(engine_inc)/hightile.h $(engine_inc)/mdsprite.h $(engine_inc)/texcache.h
 $(engine_obj)/texcache.$o: $(engine_src)/texcache.cpp $(engine_inc)/texcache.h $(engine_inc)/polymost.h $(engine_inc)/dxtfilter.h $(engine_inc)/kplib.h
@@ -42,6 +43,7 @@ $(engine_obj)/gtkbits.$o: $(engine_src)/gtkbits.cpp $(engine_inc)/baselayer.h $(
 $(engine_obj)/dynamicgtk.$o: $(engine_src)/dynamicgtk.cpp $(engine_inc)/dynamicgtk.h
 $(engine_obj)/polymer.$o: $(engine_src)/polymer.cpp $(engine_inc)/polymer.h $(engine_inc)/compat.h $(engine_inc)/build.h $(engine_inc)/buildtypes.h $(glad_inc)/glad/glad.h $(engine_inc)/glbuild.h $(engine_inc)/osd.h $(engine_inc)/pragmas.h $(engine_inc)/mdsprite.h $(engine_inc)/polymost.h
 $(engine_obj)/mutex.$o: $(engine_src)/mutex.cpp $(engine_inc)/mutex.h
+$(engine_obj)/thread.$o: $(engine_src)/thread.cpp $(engine_inc)/thread.h
 $(engine_obj)/rawinput.$o: $(engine_src)/rawinput.cpp $(engine_inc)/rawinput.h
 $(engine_obj)/wiibits.$o: $(engine_src)/wiibits.cpp $(engine_inc)/wiibits.h
 $(engine_obj)/winbits.$o: $(engine_src)/winbits.cpp $(engine_inc)/winbits.h
@@ -143,6 +143,21 @@ void stretchhline (intptr_t p0, int32_t u, bssize_t cnt, int32_t uinc, intptr_t
 
 void mmxoverlay();
 
+#if defined __x86_64__ || defined _M_X64
+# define CLASSIC_SIMD
+# if defined _MSC_VER || ((EDUKE32_GCC_PREREQ(4,9) || EDUKE32_CLANG_PREREQ(3,8)) && !defined __MINGW32__)
+#  define CLASSIC_AVX2
+# endif
+
+enum { CLASSIC_SIMD_NONE, CLASSIC_SIMD_SSE2, CLASSIC_SIMD_AVX2 };
+
+extern int32_t r_classicsimd;
+
+int32_t getsimdsupport(void);
+int32_t setsimdlevel(int32_t level);
+int32_t simdselftest(int32_t level, int32_t numtests);
+#endif
+
 #endif	// else
 
 #endif // a_h_
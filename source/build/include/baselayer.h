@@ -28,6 +28,9 @@ extern char modechange;
 
 extern int32_t vsync;
 
+// run without presenting frames or opening a window; only honored by the SDL2 layer
+extern char headless;
+
 extern void app_crashhandler(void);
 
 // NOTE: these are implemented in game-land so they may be overridden in game specific ways
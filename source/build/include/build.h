@@ -665,8 +665,8 @@ static FORCE_INLINE void sprite_tracker_hook(uintptr_t const address)
 #endif
 
 
-EXTERN int16_t maskwall[MAXWALLSB], maskwallcnt;
-EXTERN int16_t thewall[MAXWALLSB];
+EXTERN CLASSIC_TLS int16_t maskwall[MAXWALLSB], maskwallcnt;
+EXTERN CLASSIC_TLS int16_t thewall[MAXWALLSB];
 EXTERN uspritetype *tspriteptr[MAXSPRITESONSCREEN + 1];
 
 EXTERN int32_t wx1, wy1, wx2, wy2;
@@ -797,6 +797,13 @@ EXTERN int16_t headspritesect[MAXSECTORS+1], headspritestat[MAXSTATUS+1];
 EXTERN int16_t prevspritesect[MAXSPRITES], prevspritestat[MAXSPRITES];
 EXTERN int16_t nextspritesect[MAXSPRITES], nextspritestat[MAXSPRITES];
 
+// each status list is in order of decreasing spritestatorder[], which is
+// numbered from spritestatordercnt up as sprites are inserted
+EXTERN uint32_t spritestatorder[MAXSPRITES], spritestatordercnt;
+// bumped whenever a sprite enters or leaves a status list or goes through
+// spriteGridUpdate(), so callers can tell whether sprites changed under them
+EXTERN uint32_t spritechangecnt;
+
 EXTERN vec2s_t tilesiz[MAXTILES];
 
 EXTERN char picsiz[MAXTILES];
@@ -906,7 +913,7 @@ extern uint8_t globalr, globalg, globalb;
 EXTERN uint16_t h_xsize[MAXTILES], h_ysize[MAXTILES];
 EXTERN int8_t h_xoffs[MAXTILES], h_yoffs[MAXTILES];
 
-EXTERN char *globalpalwritten;
+EXTERN CLASSIC_TLS char *globalpalwritten;
 
 enum {
     GLOBAL_NO_GL_TILESHADES = 1<<0,
@@ -1051,6 +1058,12 @@ int32_t engineFatalError(char const * msg);
 int32_t   engineLoadBoard(const char *filename, char flags, vec3_t *dapos, int16_t *daang, int16_t *dacursectnum);
 int32_t   engineLoadMHK(const char *filename);
 void engineClearLightsFromMHK();
+int32_t   engineLoadPVS(const char *filename);
+void    pvsMarkDynamicSector(int16_t sectnum);
+void    pvsCheckWall(int16_t wallnum);
+void    pvsInvalidate(void);
+void    pvsReportStats(void);
+extern int32_t r_pvs;
 #ifdef HAVE_CLIPSHAPE_FEATURE
 int32_t engineLoadClipMaps(void);
 #endif
@@ -1071,6 +1084,13 @@ void    artClearMapArt(void);
 void    artSetupMapArt(const char *filename);
 bool    tileLoad(int16_t tilenume);
 void    tileLoadData(int16_t tilenume, int32_t dasiz, char *buffer);
+bool    tileLoadNoWait(int16_t tilenume, bool placeholder);
+bool    tilePrefetch(int16_t tilenume);
+void    tileStreamUpdate(void);
+void    tileStreamClearPlaceholders(void);
+void    tileStreamFlush(void);
+void    tileStreamReportStats(void);
+extern int32_t r_tilestream;
 int32_t tileCRC(int16_t tileNum);
 void    artConvertRGB(palette_t *pic, uint8_t const *buf, int32_t bufsizx, int32_t sizx, int32_t sizy);
 
@@ -1104,6 +1124,18 @@ static FORCE_INLINE int32_t drawrooms(int32_t daposx, int32_t daposy, int32_t da
 }
 
 void   renderDrawMasks(void);
+
+typedef struct
+{
+    double drawrooms, drawmasks;  // ms
+} renderstats_t;
+
+extern renderstats_t renderstats;
+
+#ifdef CLASSIC_THREADS
+extern int32_t r_classicthreads;
+void   renderPrintClassicThreadStats(void);
+#endif
 void   videoClearViewableArea(int32_t dacol);
 void   videoClearScreen(int32_t dacol);
 void   renderDrawMapView(int32_t dax, int32_t day, int32_t zoome, int16_t ang);
@@ -1263,6 +1295,17 @@ int32_t   changespritestat(int16_t spritenum, int16_t newstatnum);
 int32_t   setsprite(int16_t spritenum, const vec3_t *) ATTRIBUTE((nonnull(2)));
 int32_t   setspritez(int16_t spritenum, const vec3_t *) ATTRIBUTE((nonnull(2)));
 
+extern int32_t spritegrid;
+
+// Fills spritelist (room for MAXSPRITES) with the sprites inside the box, in no
+// particular order. Sprites moved without setsprite() since the last
+// spriteGridRefresh() are found as long as they have not gone far.
+int32_t spriteGridQuery(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int16_t *spritelist);
+void spriteGridUpdate(int16_t spritenum);
+void spriteGridRefresh(void);
+void spriteGridRebuild(void);
+void spriteGridBenchmark(int32_t radius);
+
 int32_t spriteheightofsptr(const uspritetype *spr, int32_t *height, int32_t alsotileyofs);
 static FORCE_INLINE int32_t spriteheightofs(int16_t i, int32_t *height, int32_t alsotileyofs)
 {
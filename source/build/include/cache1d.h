@@ -24,6 +24,20 @@ extern int32_t kpzbufload(const char *);
 void	cacheInitBuffer(intptr_t dacachestart, int32_t dacachesize);
 void	cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr);
 void	cacheAgeEntries(void);
+void	cacheReportStats(void);
+
+typedef struct
+{
+    uint32_t allocs, indexedallocs, evictions;
+    uint64_t evictedbytes;
+    double time, maxtime;  // ms spent in cacheAllocateBlock()
+    int32_t numobjects, size;
+    int32_t numfree, freebytes, largestfree;  // runs of free blocks
+} cachestats_t;
+
+void	cacheGetStats(cachestats_t *stats);
+
+extern int32_t cache_indexed;
 
 #ifdef USE_PHYSFS
 using buildvfs_kfd = PHYSFS_File *;
@@ -110,6 +124,18 @@ void	kclose(buildvfs_kfd handle);
 
 void krename(int32_t crcval, int32_t filenum, const char *newname);
 char const * kfileparent(int32_t handle);
+// Returns the file on disk holding the data of an open file and sets *offset
+// to where the data starts in it, or NULL if the data can't be read directly.
+char const * kfilesource(buildvfs_kfd handle, int32_t *offset);
+// Returns leng bytes at offset in an open file if they are in a group or
+// stored ZIP entry mapped into memory, NULL otherwise. The mapping is
+// copy-on-write and valid until uninitgroupfile().
+char *  kfileptr(buildvfs_kfd handle, int32_t offset, int32_t leng);
+extern int32_t cache_mmap;
+// Called with each mapping before it is unmapped, to drop pointers into it.
+extern void (*kunmapcallback)(char const *base, int32_t size);
+void kgroupstats(void);
+void kgroupbenchmark(void);
 #endif
 
 extern int32_t kpzbufloadfil(buildvfs_kfd);
@@ -123,6 +149,7 @@ typedef struct
     intptr_t *hand;
     int32_t   leng;
     char *    lock;
+    int32_t   ofs;  // from the start of the cache
 } cactype;
 
 enum {
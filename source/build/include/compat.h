@@ -1299,6 +1299,18 @@ static inline void maybe_grow_buffer(char ** const buffer, int32_t * const buffe
 # define EDUKE32_GLES
 #endif
 
+// The classic renderer can split the screen into column strips drawn by
+// several threads, each with its own copy of the per-pass state. This needs
+// the C replacements of a.asm (see a.h) and cheap native TLS.
+#if defined __cplusplus && !(!defined NOASM && (defined _MSC_VER || (defined __GNUC__ && defined __i386__))) \
+    && !defined __PSP__ && !defined GEKKO && !defined __OPENDINGUX__ && !defined __MINGW32__ \
+    && !defined EDUKE32_TOUCH_DEVICES
+# define CLASSIC_THREADS
+# define CLASSIC_TLS thread_local
+#else
+# define CLASSIC_TLS
+#endif
+
 #if DEBUGGINGAIDS>=2
 # define DEBUG_MAIN_ARRAYS
 #endif
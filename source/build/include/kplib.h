@@ -39,6 +39,7 @@ extern void kzuninit ();
 extern intptr_t kzopen (const char *);
 extern int32_t kzread (void *, int32_t);
 extern int32_t kzseek (int32_t, int32_t);
+extern char const *kzipname (void); //ZIP/GRP the open file is read from, NULL if stand-alone
 
 static inline int32_t kztell(void) { return kzfs.fil ? kzfs.pos : -1; }
 static inline int32_t kzeof(void) { return kzfs.fil ? kzfs.pos >= kzfs.leng : -1; }
@@ -91,7 +91,7 @@ extern uint8_t alphahackarray[MAXTILES];
 extern int32_t r_usenewshading;
 extern int32_t r_npotwallmode;
 
-extern int16_t globalpicnum;
+extern CLASSIC_TLS int16_t globalpicnum;
 
 // Compare with polymer_eligible_for_artmap()
 static FORCE_INLINE int32_t eligible_for_tileshades(int32_t const picnum, int32_t const pal)
@@ -0,0 +1,46 @@
+#ifndef thread_h_
+#define thread_h_
+
+/* Thread and semaphore wrappers for the different platforms */
+
+#if defined(RENDERTYPEWIN)
+# include "windows_inc.h"
+#elif defined(RENDERTYPEPSP)
+# include "psp_inc.h"
+#else
+# define SDL_MAIN_HANDLED
+# include "sdl_inc.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(RENDERTYPEWIN)
+typedef HANDLE thread_t;
+typedef HANDLE semaphore_t;
+#elif defined(RENDERTYPEPSP)
+typedef SceUID thread_t;
+typedef SceUID semaphore_t;
+#else
+typedef SDL_Thread* thread_t;
+typedef SDL_sem* semaphore_t;
+#endif
+
+typedef int32_t (*threadfunc_t)(void *);
+
+extern int32_t thread_create(thread_t *thread, threadfunc_t func, void *arg, const char *name);
+extern int32_t thread_join(thread_t *thread);
+extern int32_t thread_getcpucount(void);
+
+extern int32_t semaphore_init(semaphore_t *sem, int32_t value);
+extern int32_t semaphore_wait(semaphore_t *sem);
+extern int32_t semaphore_post(semaphore_t *sem);
+extern void semaphore_destroy(semaphore_t *sem);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
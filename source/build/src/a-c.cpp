@@ -15,6 +15,13 @@
 
 #ifdef ENGINE_USING_A_C
 
+#ifdef CLASSIC_SIMD
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>
+# endif
+#endif
+
 #define BITSOFPRECISION 3
 #define BITSOFPRECISIONPOW 8
 
@@ -24,8 +31,8 @@
 // Also for translucent masks?
 //#define USE_SATURATE_VPLC_TRANS
 
-extern intptr_t asm1, asm2, asm3, asm4;
-extern int32_t globalx3, globaly3;
+extern CLASSIC_TLS intptr_t asm1, asm2, asm3, asm4;
+extern CLASSIC_TLS int32_t globalx3, globaly3;
 
 #ifdef USE_ASM64
 # define A64_ASSIGN(var, val) var=val
@@ -40,13 +47,26 @@ intptr_t a64_paloffs;
 char *a64_gtrans;
 #endif
 
-static int32_t bpl, transmode = 0;
-static char *gbuf;
-static int32_t glogx, glogy;
-int32_t gpinc;
-static int32_t gbxinc, gbyinc;
-static char *gpal, *ghlinepal, *gtrans;
-static char *gpal2;
+static int32_t bpl;
+static CLASSIC_TLS int32_t transmode = 0;
+static CLASSIC_TLS char *gbuf;
+static CLASSIC_TLS int32_t glogx, glogy;
+CLASSIC_TLS int32_t gpinc;
+static CLASSIC_TLS int32_t gbxinc, gbyinc;
+static CLASSIC_TLS char *gpal, *ghlinepal, *gtrans;
+static CLASSIC_TLS char *gpal2;
+
+#ifdef CLASSIC_SIMD
+// SIMD versions of the functions below, NULL if the C version is used
+static struct
+{
+    void (*hlineasm4)(bssize_t cnt, const char *palptr, uint32_t by, uint32_t bx, char *pp);
+    void (*slopevlin)(intptr_t p, intptr_t slopaloffs, bssize_t cnt, int32_t bx, int32_t by);
+    void (*vlineasm4)(bssize_t cnt, char *p);
+    void (*mvlineasm4)(bssize_t cnt, char *p);
+    void (*tvlineasm2)(uint32_t vplc2, int32_t vinc1, intptr_t bufplc1, intptr_t bufplc2, uint32_t vplc1, intptr_t p);
+} simdfuncs;
+#endif
 
 //Global variable functions
 void setvlinebpl(int32_t dabpl) { A64_ASSIGN(a64_bpl, dabpl); bpl = dabpl;}
@@ -71,6 +91,14 @@ void hlineasm4(bssize_t cnt, int32_t skiploadincs, int32_t paloffs, uint32_t by,
 
     if (!skiploadincs) { gbxinc = asm1; gbyinc = asm2; }
 
+#ifdef CLASSIC_SIMD
+    if (simdfuncs.hlineasm4 && glogx && glogy)
+    {
+        simdfuncs.hlineasm4(cnt, &ghlinepal[paloffs], by, bx, (char *)p);
+        return;
+    }
+#endif
+
     const char *const A_C_RESTRICT palptr = &ghlinepal[paloffs];
     const char *const A_C_RESTRICT buf = gbuf;
     const vec2_t inc = { gbxinc, gbyinc };
@@ -115,6 +143,14 @@ void slopevlin(intptr_t p, int32_t i, intptr_t slopaloffs, bssize_t cnt, int32_t
     int32_t bz, bzinc;
     uint32_t u, v;
 
+#ifdef CLASSIC_SIMD
+    if (simdfuncs.slopevlin && glogx && glogy)
+    {
+        simdfuncs.slopevlin(p, slopaloffs, cnt, bx, by);
+        return;
+    }
+#endif
+
     bz = asm3; bzinc = (asm1>>3);
     slopalptr = (intptr_t *)slopaloffs;
     for (; cnt>0; cnt--)
@@ -132,7 +168,7 @@ void slopevlin(intptr_t p, int32_t i, intptr_t slopaloffs, bssize_t cnt, int32_t
 ///// Wall,face sprite/wall sprite vertical line functions /////
 
 
-extern int32_t globaltilesizy;
+extern CLASSIC_TLS int32_t globaltilesizy;
 
 static inline uint32_t ourmulscale32(uint32_t a, uint32_t b)
 {
@@ -198,10 +234,10 @@ int32_t vlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc, i
 }
 
 
-extern intptr_t palookupoffse[4];
-extern uint32_t vplce[4];
-extern int32_t vince[4];
-extern intptr_t bufplce[4];
+extern CLASSIC_TLS intptr_t palookupoffse[4];
+extern CLASSIC_TLS uint32_t vplce[4];
+extern CLASSIC_TLS int32_t vince[4];
+extern CLASSIC_TLS intptr_t bufplce[4];
 
 #if (EDUKE32_GCC_PREREQ(4,7) || __has_extension(attribute_ext_vector_type)) && defined BITNESS64
 // XXX: The "Ubuntu clang version 3.5-1ubuntu1 (trunk) (based on LLVM 3.5)"
@@ -266,6 +302,14 @@ static void vlineasm4nlogy(bssize_t cnt, char *p, char *const A_C_RESTRICT * pal
 // cnt >= 1
 void vlineasm4(bssize_t cnt, char *p)
 {
+#ifdef CLASSIC_SIMD
+    if (simdfuncs.vlineasm4 && glogy)
+    {
+        simdfuncs.vlineasm4(cnt, p);
+        return;
+    }
+#endif
+
     char * const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
     char * const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
 #ifdef USE_VECTOR_EXT
@@ -399,6 +443,14 @@ int32_t mvlineasm1(int32_t vinc, intptr_t paloffs, bssize_t cnt, uint32_t vplc,
 // cnt >= 1
 void mvlineasm4(bssize_t cnt, char *p)
 {
+#ifdef CLASSIC_SIMD
+    if (simdfuncs.mvlineasm4 && glogy)
+    {
+        simdfuncs.mvlineasm4(cnt, p);
+        return;
+    }
+#endif
+
     char *const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
     char *const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
 #ifdef USE_VECTOR_EXT
@@ -530,6 +582,14 @@ void setuptvlineasm2(int32_t neglogy, intptr_t paloffs1, intptr_t paloffs2)
 // Return: asm1=vplc1, asm2=vplc2
 void tvlineasm2(uint32_t vplc2, int32_t vinc1, intptr_t bufplc1, intptr_t bufplc2, uint32_t vplc1, intptr_t p)
 {
+#ifdef CLASSIC_SIMD
+    if (simdfuncs.tvlineasm2 && glogy)
+    {
+        simdfuncs.tvlineasm2(vplc2, vinc1, bufplc1, bufplc2, vplc1, p);
+        return;
+    }
+#endif
+
     char ch;
 
     bssize_t cnt = tabledivide32(asm2-p-1, bpl);  // >= 1
@@ -709,6 +769,624 @@ void drawslab(int32_t dx, int32_t v, int32_t dy, int32_t vi, intptr_t vptr, intp
     }
 }
 
+///// SIMD versions of the wall, sprite and ceiling/floor functions /////
+
+// The C functions above stay the reference: the versions here must write
+// exactly the same bytes, which simdselftest() checks on random input.
+
+#ifdef CLASSIC_SIMD
+int32_t r_classicsimd = CLASSIC_SIMD_AVX2;
+static int32_t simdsupported = -1;
+
+#define cvtlane(v, lane) ((uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi32(v, _MM_SHUFFLE(lane, lane, lane, lane))))
+
+// unsigned a < b, through a signed compare of the biased values
+static FORCE_INLINE __m128i cmplt_epu32(__m128i const a, __m128i const b)
+{
+    __m128i const bias = _mm_set1_epi32(INT32_MIN);
+    return _mm_cmpgt_epi32(_mm_xor_si128(b, bias), _mm_xor_si128(a, bias));
+}
+
+// SSE2 has no _mm_mullo_epi32
+static FORCE_INLINE __m128i mullo_epi32_sse2(__m128i const a, __m128i const b)
+{
+    __m128i const even = _mm_mul_epu32(a, b);
+    __m128i const odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i uint32_setr4(uint32_t const a, uint32_t const b, uint32_t const c, uint32_t const d)
+{
+    return _mm_setr_epi32((int32_t)a, (int32_t)b, (int32_t)c, (int32_t)d);
+}
+
+// cnt+1 pixels, right to left
+static void hlineasm4_sse2(bssize_t cnt, const char *palptr, uint32_t by, uint32_t bx, char *pp)
+{
+    const char *const A_C_RESTRICT buf = gbuf;
+    const vec2_t log = { glogx, glogy };
+    const uint32_t incx = gbxinc, incy = gbyinc;
+    __m128i const log32x = _mm_cvtsi32_si128(32-log.x), logy = _mm_cvtsi32_si128(log.y), log32y = _mm_cvtsi32_si128(32-log.y);
+    __m128i const stepx = _mm_set1_epi32(incx<<2), stepy = _mm_set1_epi32(incy<<2);
+    __m128i bxv = uint32_setr4(bx, bx-incx, bx-(incx<<1), bx-incx*3);
+    __m128i byv = uint32_setr4(by, by-incy, by-(incy<<1), by-incy*3);
+
+    for (cnt++; cnt>=4; cnt-=4, pp-=4)
+    {
+        __m128i const idx = _mm_add_epi32(_mm_sll_epi32(_mm_srl_epi32(bxv, log32x), logy), _mm_srl_epi32(byv, log32y));
+        uint32_t const pix = (uint8_t)palptr[buf[cvtlane(idx, 3)]] | ((uint8_t)palptr[buf[cvtlane(idx, 2)]]<<8) |
+                             ((uint8_t)palptr[buf[cvtlane(idx, 1)]]<<16) | ((uint32_t)(uint8_t)palptr[buf[cvtlane(idx, 0)]]<<24);
+        Bmemcpy(pp-3, &pix, sizeof(uint32_t));
+        bxv = _mm_sub_epi32(bxv, stepx);
+        byv = _mm_sub_epi32(byv, stepy);
+    }
+
+    bx = cvtlane(bxv, 0);
+    by = cvtlane(byv, 0);
+
+    for (; cnt>0; cnt--, pp--)
+    {
+        *pp = palptr[buf[((bx>>(32-log.x))<<log.y)+(by>>(32-log.y))]];
+        bx -= incx;
+        by -= incy;
+    }
+}
+
+static void slopevlin_sse2(intptr_t p, intptr_t slopaloffs, bssize_t cnt, int32_t bx, int32_t by)
+{
+    const intptr_t *A_C_RESTRICT slopalptr = (intptr_t *)slopaloffs;
+    const char *const A_C_RESTRICT buf = gbuf;
+    const vec2_t log = { glogx, glogy };
+    const uint32_t bzinc = (asm1>>3);
+    uint32_t bz = asm3;
+    __m128i const log32x = _mm_cvtsi32_si128(32-log.x), logy = _mm_cvtsi32_si128(log.y), log32y = _mm_cvtsi32_si128(32-log.y);
+    __m128i const xtou = _mm_set1_epi32(globalx3), ytov = _mm_set1_epi32(globaly3);
+    __m128i const bxv = _mm_set1_epi32(bx), byv = _mm_set1_epi32(by);
+    __m128i const bzstep = _mm_set1_epi32(bzinc<<2);
+    __m128i bzv = uint32_setr4(bz, bz+bzinc, bz+(bzinc<<1), bz+bzinc*3);
+
+    for (; cnt>=4; cnt-=4)
+    {
+        __m128i const slopidx = _mm_add_epi32(_mm_srai_epi32(bzv, 6), _mm_set1_epi32(8192));
+        __m128i const i = _mm_setr_epi32(sloptable[cvtlane(slopidx, 0)], sloptable[cvtlane(slopidx, 1)],
+                                         sloptable[cvtlane(slopidx, 2)], sloptable[cvtlane(slopidx, 3)]);
+        __m128i const u = _mm_add_epi32(bxv, mullo_epi32_sse2(xtou, i));
+        __m128i const v = _mm_add_epi32(byv, mullo_epi32_sse2(ytov, i));
+        __m128i const idx = _mm_add_epi32(_mm_sll_epi32(_mm_srl_epi32(u, log32x), logy), _mm_srl_epi32(v, log32y));
+
+        *(char *)p = *(char *)(slopalptr[0]+buf[cvtlane(idx, 0)]), p += gpinc;
+        *(char *)p = *(char *)(slopalptr[-1]+buf[cvtlane(idx, 1)]), p += gpinc;
+        *(char *)p = *(char *)(slopalptr[-2]+buf[cvtlane(idx, 2)]), p += gpinc;
+        *(char *)p = *(char *)(slopalptr[-3]+buf[cvtlane(idx, 3)]), p += gpinc;
+
+        slopalptr -= 4;
+        bzv = _mm_add_epi32(bzv, bzstep);
+    }
+
+    bz = cvtlane(bzv, 0);
+
+    for (; cnt>0; cnt--)
+    {
+        int32_t const i = (sloptable[((int32_t)bz>>6)+8192]); bz += bzinc;
+        uint32_t const u = bx+(inthi_t)globalx3*i;
+        uint32_t const v = by+(inthi_t)globaly3*i;
+        (*(char *)p) = *(char *)(((intptr_t)slopalptr[0])+buf[((u>>(32-log.x))<<log.y)+(v>>(32-log.y))]);
+        slopalptr--;
+        p += gpinc;
+    }
+}
+
+static void vlineasm4_sse2(bssize_t cnt, char *p)
+{
+    char *const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
+    char *const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
+    __m128i const vinc = _mm_loadu_si128((__m128i const *)vince);
+    __m128i const logy = _mm_cvtsi32_si128(glogy);
+    __m128i vplc = _mm_loadu_si128((__m128i const *)vplce);
+    const int32_t ourbpl = bpl;
+
+    do
+    {
+        __m128i const idx = _mm_srl_epi32(vplc, logy);
+        uint32_t const pix = (uint8_t)pal[0][buf[0][cvtlane(idx, 0)]] | ((uint8_t)pal[1][buf[1][cvtlane(idx, 1)]]<<8) |
+                             ((uint8_t)pal[2][buf[2][cvtlane(idx, 2)]]<<16) | ((uint32_t)(uint8_t)pal[3][buf[3][cvtlane(idx, 3)]]<<24);
+        Bmemcpy(p, &pix, sizeof(uint32_t));
+        vplc = _mm_add_epi32(vplc, vinc);
+        p += ourbpl;
+    }
+    while (--cnt);
+
+    _mm_storeu_si128((__m128i *)vplce, vplc);
+}
+
+static void mvlineasm4_sse2(bssize_t cnt, char *p)
+{
+    char *const A_C_RESTRICT pal[4] = {(char *)palookupoffse[0], (char *)palookupoffse[1], (char *)palookupoffse[2], (char *)palookupoffse[3]};
+    char *const A_C_RESTRICT buf[4] = {(char *)bufplce[0], (char *)bufplce[1], (char *)bufplce[2], (char *)bufplce[3]};
+    __m128i const vinc = _mm_loadu_si128((__m128i const *)vince);
+    __m128i const logy = _mm_cvtsi32_si128(glogy);
+#ifdef USE_SATURATE_VPLC
+    __m128i const saturate = _mm_set1_epi32(g_saturate);
+#endif
+    __m128i vplc = _mm_loadu_si128((__m128i const *)vplce);
+    const int32_t ourbpl = bpl;
+    char ch;
+
+    do
+    {
+        __m128i const idx = _mm_srl_epi32(vplc, logy);
+
+        ch = buf[0][cvtlane(idx, 0)];
+        if (ch != 255) p[0] = pal[0][ch];
+        ch = buf[1][cvtlane(idx, 1)];
+        if (ch != 255) p[1] = pal[1][ch];
+        ch = buf[2][cvtlane(idx, 2)];
+        if (ch != 255) p[2] = pal[2][ch];
+        ch = buf[3][cvtlane(idx, 3)];
+        if (ch != 255) p[3] = pal[3][ch];
+
+        vplc = _mm_add_epi32(vplc, vinc);
+#ifdef USE_SATURATE_VPLC
+        vplc = _mm_or_si128(vplc, _mm_and_si128(saturate, cmplt_epu32(vplc, vinc)));
+#endif
+        p += ourbpl;
+    }
+    while (--cnt);
+
+    _mm_storeu_si128((__m128i *)vplce, vplc);
+}
+
+#ifdef CLASSIC_AVX2
+# ifdef _MSC_VER
+#  define SIMD_AVX2
+# else
+#  define SIMD_AVX2 __attribute__((target("avx2")))
+# endif
+
+// Zero-extended bytes at four addresses. Each byte is read through the
+// aligned dword containing it, so no load can cross into the next page.
+static SIMD_AVX2 inline __m128i gatherbytes4(__m256i const addr)
+{
+    __m128i const lo = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(addr, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+    __m128i const shift = _mm_slli_epi32(_mm_and_si128(lo, _mm_set1_epi32(3)), 3);
+    __m128i const dw = _mm256_i64gather_epi32((int const *)0, _mm256_andnot_si256(_mm256_set1_epi64x(3), addr), 1);
+
+    return _mm_and_si128(_mm_srlv_epi32(dw, shift), _mm_set1_epi32(255));
+}
+
+// Same as above for eight byte offsets from one base.
+static SIMD_AVX2 inline __m256i gatherbytes8(const char *base, __m256i const idx)
+{
+    __m256i const mis = _mm256_and_si256(_mm256_add_epi32(_mm256_set1_epi32((int32_t)(intptr_t)base), idx), _mm256_set1_epi32(3));
+    __m256i const dw = _mm256_i32gather_epi32((int const *)base, _mm256_sub_epi32(idx, mis), 1);
+
+    return _mm256_and_si256(_mm256_srlv_epi32(dw, _mm256_slli_epi32(mis, 3)), _mm256_set1_epi32(255));
+}
+
+static SIMD_AVX2 inline __m256i addoffsets4(__m256i const base, __m128i const ofs)
+{
+    return _mm256_add_epi64(base, _mm256_cvtepu32_epi64(ofs));
+}
+
+static SIMD_AVX2 inline uint32_t packbytes4(__m128i const v)
+{
+    return _mm_cvtsi128_si32(_mm_shuffle_epi8(v, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)));
+}
+
+// cnt+1 pixels, right to left
+static SIMD_AVX2 void hlineasm4_avx2(bssize_t cnt, const char *palptr, uint32_t by, uint32_t bx, char *pp)
+{
+    const char *const A_C_RESTRICT buf = gbuf;
+    const vec2_t log = { glogx, glogy };
+    const uint32_t incx = gbxinc, incy = gbyinc;
+    __m128i const log32x = _mm_cvtsi32_si128(32-log.x), logy = _mm_cvtsi32_si128(log.y), log32y = _mm_cvtsi32_si128(32-log.y);
+    __m256i const lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i const stepx = _mm256_set1_epi32(incx<<3), stepy = _mm256_set1_epi32(incy<<3);
+    __m256i const reverse = _mm256_setr_epi8(12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                             12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i bxv = _mm256_sub_epi32(_mm256_set1_epi32(bx), _mm256_mullo_epi32(lane, _mm256_set1_epi32(incx)));
+    __m256i byv = _mm256_sub_epi32(_mm256_set1_epi32(by), _mm256_mullo_epi32(lane, _mm256_set1_epi32(incy)));
+
+    for (cnt++; cnt>=8; cnt-=8, pp-=8)
+    {
+        __m256i const idx = _mm256_add_epi32(_mm256_sll_epi32(_mm256_srl_epi32(bxv, log32x), logy), _mm256_srl_epi32(byv, log32y));
+        __m256i const pix = _mm256_shuffle_epi8(gatherbytes8(palptr, gatherbytes8(buf, idx)), reverse);
+        uint64_t const pix8 = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(pix, 1)) |
+                              ((uint64_t)(uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(pix))<<32);
+        Bmemcpy(pp-7, &pix8, sizeof(uint64_t));
+        bxv = _mm256_sub_epi32(bxv, stepx);
+        byv = _mm256_sub_epi32(byv, stepy);
+    }
+
+    bx = _mm_cvtsi128_si32(_mm256_castsi256_si128(bxv));
+    by = _mm_cvtsi128_si32(_mm256_castsi256_si128(byv));
+
+    for (; cnt>0; cnt--, pp--)
+    {
+        *pp = palptr[buf[((bx>>(32-log.x))<<log.y)+(by>>(32-log.y))]];
+        bx -= incx;
+        by -= incy;
+    }
+}
+
+static SIMD_AVX2 void slopevlin_avx2(intptr_t p, intptr_t slopaloffs, bssize_t cnt, int32_t bx, int32_t by)
+{
+    const intptr_t *A_C_RESTRICT slopalptr = (intptr_t *)slopaloffs;
+    const char *const A_C_RESTRICT buf = gbuf;
+    const vec2_t log = { glogx, glogy };
+    const uint32_t bzinc = (asm1>>3);
+    uint32_t bz = asm3;
+    __m128i const log32x = _mm_cvtsi32_si128(32-log.x), logy = _mm_cvtsi32_si128(log.y), log32y = _mm_cvtsi32_si128(32-log.y);
+    __m128i const xtou = _mm_set1_epi32(globalx3), ytov = _mm_set1_epi32(globaly3);
+    __m128i const bxv = _mm_set1_epi32(bx), byv = _mm_set1_epi32(by);
+    __m128i const bzstep = _mm_set1_epi32(bzinc<<2);
+    __m256i const bufv = _mm256_set1_epi64x((intptr_t)buf);
+    __m128i bzv = uint32_setr4(bz, bz+bzinc, bz+(bzinc<<1), bz+bzinc*3);
+
+    for (; cnt>=4; cnt-=4)
+    {
+        __m128i const slopidx = _mm_add_epi32(_mm_srai_epi32(bzv, 6), _mm_set1_epi32(8192));
+        __m128i const i = _mm_i32gather_epi32((int const *)sloptable, slopidx, 4);
+        __m128i const u = _mm_add_epi32(bxv, _mm_mullo_epi32(xtou, i));
+        __m128i const v = _mm_add_epi32(byv, _mm_mullo_epi32(ytov, i));
+        __m128i const idx = _mm_add_epi32(_mm_sll_epi32(_mm_srl_epi32(u, log32x), logy), _mm_srl_epi32(v, log32y));
+        __m256i const pals = _mm256_permute4x64_epi64(_mm256_loadu_si256((__m256i const *)(slopalptr-3)), _MM_SHUFFLE(0, 1, 2, 3));
+        uint32_t const pix = packbytes4(gatherbytes4(addoffsets4(pals, gatherbytes4(addoffsets4(bufv, idx)))));
+
+        *(char *)p = pix, p += gpinc;
+        *(char *)p = pix>>8, p += gpinc;
+        *(char *)p = pix>>16, p += gpinc;
+        *(char *)p = pix>>24, p += gpinc;
+
+        slopalptr -= 4;
+        bzv = _mm_add_epi32(bzv, bzstep);
+    }
+
+    bz = cvtlane(bzv, 0);
+
+    for (; cnt>0; cnt--)
+    {
+        int32_t const i = (sloptable[((int32_t)bz>>6)+8192]); bz += bzinc;
+        uint32_t const u = bx+(inthi_t)globalx3*i;
+        uint32_t const v = by+(inthi_t)globaly3*i;
+        (*(char *)p) = *(char *)(((intptr_t)slopalptr[0])+buf[((u>>(32-log.x))<<log.y)+(v>>(32-log.y))]);
+        slopalptr--;
+        p += gpinc;
+    }
+}
+
+static SIMD_AVX2 void vlineasm4_avx2(bssize_t cnt, char *p)
+{
+    __m256i const pals = _mm256_loadu_si256((__m256i const *)palookupoffse);
+    __m256i const bufs = _mm256_loadu_si256((__m256i const *)bufplce);
+    __m128i const vinc = _mm_loadu_si128((__m128i const *)vince);
+    __m128i const logy = _mm_cvtsi32_si128(glogy);
+    __m128i vplc = _mm_loadu_si128((__m128i const *)vplce);
+    const int32_t ourbpl = bpl;
+
+    do
+    {
+        __m128i const texel = gatherbytes4(addoffsets4(bufs, _mm_srl_epi32(vplc, logy)));
+        uint32_t const pix = packbytes4(gatherbytes4(addoffsets4(pals, texel)));
+        Bmemcpy(p, &pix, sizeof(uint32_t));
+        vplc = _mm_add_epi32(vplc, vinc);
+        p += ourbpl;
+    }
+    while (--cnt);
+
+    _mm_storeu_si128((__m128i *)vplce, vplc);
+}
+
+static SIMD_AVX2 void mvlineasm4_avx2(bssize_t cnt, char *p)
+{
+    __m256i const pals = _mm256_loadu_si256((__m256i const *)palookupoffse);
+    __m256i const bufs = _mm256_loadu_si256((__m256i const *)bufplce);
+    __m128i const vinc = _mm_loadu_si128((__m128i const *)vince);
+    __m128i const logy = _mm_cvtsi32_si128(glogy);
+    __m128i const transparent = _mm_set1_epi32(255);
+#ifdef USE_SATURATE_VPLC
+    __m128i const saturate = _mm_set1_epi32(g_saturate);
+#endif
+    __m128i vplc = _mm_loadu_si128((__m128i const *)vplce);
+    const int32_t ourbpl = bpl;
+
+    do
+    {
+        __m128i const texel = gatherbytes4(addoffsets4(bufs, _mm_srl_epi32(vplc, logy)));
+        __m128i const skip = _mm_cmpeq_epi32(texel, transparent);
+
+        if (_mm_movemask_epi8(skip) != 0xffff)
+        {
+            uint32_t pix;
+            Bmemcpy(&pix, p, sizeof(uint32_t));
+            __m128i const dst = _mm_and_si128(skip, _mm_cvtepu8_epi32(_mm_cvtsi32_si128(pix)));
+            pix = packbytes4(_mm_or_si128(dst, _mm_andnot_si128(skip, gatherbytes4(addoffsets4(pals, texel)))));
+            Bmemcpy(p, &pix, sizeof(uint32_t));
+        }
+
+        vplc = _mm_add_epi32(vplc, vinc);
+#ifdef USE_SATURATE_VPLC
+        vplc = _mm_or_si128(vplc, _mm_and_si128(saturate, cmplt_epu32(vplc, vinc)));
+#endif
+        p += ourbpl;
+    }
+    while (--cnt);
+
+    _mm_storeu_si128((__m128i *)vplce, vplc);
+}
+
+// Two rows of both columns at a time.
+static SIMD_AVX2 void tvlineasm2_avx2(uint32_t vplc2, int32_t vinc1, intptr_t bufplc1, intptr_t bufplc2, uint32_t vplc1, intptr_t p)
+{
+    char ch;
+
+    bssize_t cnt = max<bssize_t>(tabledivide32(asm2-p-1, bpl)+1, 1);
+    const uint32_t vinc2 = asm1;
+
+    const char *const A_C_RESTRICT buf1 = (char *)bufplc1;
+    const char *const A_C_RESTRICT buf2 = (char *)bufplc2;
+    const int32_t logy = glogy, ourbpl = bpl;
+
+    char *pp = (char *)p;
+
+    uint8_t const shift = transmode<<3;
+
+    __m256i const bufs = _mm256_setr_epi64x(bufplc1, bufplc2, bufplc1, bufplc2);
+    __m256i const pals = _mm256_setr_epi64x((intptr_t)gpal, (intptr_t)gpal2, (intptr_t)gpal, (intptr_t)gpal2);
+    __m256i const trans = _mm256_set1_epi64x((intptr_t)gtrans);
+    __m128i const logyv = _mm_cvtsi32_si128(logy), dstshift = _mm_cvtsi32_si128(8-shift), palshift = _mm_cvtsi32_si128(shift);
+    __m128i const transparent = _mm_set1_epi32(255);
+    __m128i const vinc = uint32_setr4(vinc1<<1, vinc2<<1, vinc1<<1, vinc2<<1);
+    __m128i vplc = uint32_setr4(vplc1, vplc2, vplc1+vinc1, vplc2+vinc2);
+
+    for (; cnt>=2; cnt-=2, pp+=ourbpl<<1)
+    {
+        __m128i const texel = gatherbytes4(addoffsets4(bufs, _mm_srl_epi32(vplc, logyv)));
+        int32_t const skip = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(texel, transparent)));
+
+        vplc = _mm_add_epi32(vplc, vinc);
+
+        if (skip == 15)
+            continue;
+
+        __m128i const dst = _mm_setr_epi32((uint8_t)pp[0], (uint8_t)pp[1], (uint8_t)pp[ourbpl], (uint8_t)pp[ourbpl+1]);
+        __m128i const pix = gatherbytes4(addoffsets4(pals, texel));
+        __m128i const idx = _mm_or_si128(_mm_sll_epi32(dst, dstshift), _mm_sll_epi32(pix, palshift));
+        uint32_t const blend = packbytes4(gatherbytes4(addoffsets4(trans, idx)));
+
+        if (!(skip&1)) pp[0] = blend;
+        if (!(skip&2)) pp[1] = blend>>8;
+        if (!(skip&4)) pp[ourbpl] = blend>>16;
+        if (!(skip&8)) pp[ourbpl+1] = blend>>24;
+    }
+
+    vplc1 = cvtlane(vplc, 0);
+    vplc2 = cvtlane(vplc, 1);
+
+    if (cnt > 0)
+    {
+        ch = buf1[vplc1>>logy];
+        if (ch != 255) pp[0] = gtrans[(pp[0]<<(8-shift))|(gpal[ch]<<shift)];
+        vplc1 += vinc1;
+
+        ch = buf2[vplc2>>logy];
+        if (ch != 255) pp[1] = gtrans[(pp[1]<<(8-shift))|(gpal2[ch]<<shift)];
+        vplc2 += vinc2;
+    }
+
+    asm1 = vplc1;
+    asm2 = vplc2;
+}
+#endif
+
+int32_t getsimdsupport(void)
+{
+    if (simdsupported >= 0)
+        return simdsupported;
+
+    simdsupported = CLASSIC_SIMD_SSE2;
+
+#ifdef CLASSIC_AVX2
+# ifdef _MSC_VER
+    int regs[4];
+
+    __cpuid(regs, 0);
+
+    if (regs[0] >= 7)
+    {
+        __cpuid(regs, 1);
+
+        // AVX and OSXSAVE, with the YMM state enabled by the OS
+        if ((regs[2] & (3<<27)) == (3<<27) && (_xgetbv(0) & 6) == 6)
+        {
+            __cpuidex(regs, 7, 0);
+
+            if (regs[1] & (1<<5))
+                simdsupported = CLASSIC_SIMD_AVX2;
+        }
+    }
+# else
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        simdsupported = CLASSIC_SIMD_AVX2;
+# endif
+#endif
+
+    return simdsupported;
+}
+
+int32_t setsimdlevel(int32_t level)
+{
+    level = clamp(level, CLASSIC_SIMD_NONE, getsimdsupport());
+
+    Bmemset(&simdfuncs, 0, sizeof(simdfuncs));
+
+    switch (level)
+    {
+    case CLASSIC_SIMD_SSE2:
+        simdfuncs.hlineasm4 = hlineasm4_sse2;
+        simdfuncs.slopevlin = slopevlin_sse2;
+        simdfuncs.vlineasm4 = vlineasm4_sse2;
+        simdfuncs.mvlineasm4 = mvlineasm4_sse2;
+        break;
+#ifdef CLASSIC_AVX2
+    case CLASSIC_SIMD_AVX2:
+        simdfuncs.hlineasm4 = hlineasm4_avx2;
+        simdfuncs.slopevlin = slopevlin_avx2;
+        simdfuncs.vlineasm4 = vlineasm4_avx2;
+        simdfuncs.mvlineasm4 = mvlineasm4_avx2;
+# ifndef USE_SATURATE_VPLC_TRANS
+        simdfuncs.tvlineasm2 = tvlineasm2_avx2;
+# endif
+        break;
+#endif
+    }
+
+    return level;
+}
+
+//
+// simdselftest
+//
+// Runs the C and SIMD versions of each function on the same random input
+// and returns the number of runs where their output differs.
+//
+
+static uint32_t simdtestseed = 0x2545f491;
+
+static uint32_t simdtestrand(void)
+{
+    simdtestseed ^= simdtestseed<<13;
+    simdtestseed ^= simdtestseed>>17;
+    simdtestseed ^= simdtestseed<<5;
+    return simdtestseed;
+}
+
+#define SIMDTEST_BPL 640
+#define SIMDTEST_ROWS 300
+
+int32_t simdselftest(int32_t level, int32_t numtests)
+{
+    const int32_t oldbpl = bpl, oldtransmode = transmode;
+    char *const oldgtrans = gtrans;
+#ifdef USE_SATURATE_VPLC
+    const int32_t oldsaturate = g_saturate;
+#endif
+    decltype(simdfuncs) const oldfuncs = simdfuncs;
+
+    char *const tile = (char *)Xmalloc(65536);
+    char *const pals = (char *)Xmalloc(4*256);
+    char *const trans = (char *)Xmalloc(65536);
+    char *const dst[2] = { (char *)Xmalloc(SIMDTEST_BPL*SIMDTEST_ROWS), (char *)Xmalloc(SIMDTEST_BPL*SIMDTEST_ROWS) };
+    intptr_t slopal[SIMDTEST_ROWS];
+    intptr_t out[2][4];
+    int32_t failed = 0;
+
+    for (int i=0; i<65536; i++)
+    {
+        // make about one texel in eight transparent
+        tile[i] = (simdtestrand() & 7) ? simdtestrand() % 255 : 255;
+        trans[i] = simdtestrand();
+    }
+
+    for (int i=0; i<4*256; i++)
+        pals[i] = simdtestrand();
+
+    for (int i=0; i<SIMDTEST_ROWS; i++)
+        slopal[i] = (intptr_t)&pals[(simdtestrand()&3)<<8];
+
+    bpl = SIMDTEST_BPL;
+    gtrans = trans;
+
+    for (int t=0; t<numtests; t++)
+    {
+        int32_t const func = t % 5;
+        int32_t const log2x = 1 + simdtestrand() % 8, log2y = 1 + simdtestrand() % 8;
+        int32_t const cnt = 1 + simdtestrand() % (SIMDTEST_ROWS-2);
+        int32_t const x = simdtestrand() % (SIMDTEST_BPL-8);
+        uint32_t const seed = simdtestrand();
+
+        for (int i=0; i<SIMDTEST_BPL*SIMDTEST_ROWS; i++)
+            dst[0][i] = dst[1][i] = simdtestrand();
+
+        // pass 0: C, pass 1: SIMD
+        for (int pass=0; pass<2; pass++)
+        {
+            setsimdlevel(pass ? level : CLASSIC_SIMD_NONE);
+            simdtestseed = seed;
+
+            transmode = simdtestrand() & 1;
+
+            for (int i=0; i<4; i++)
+            {
+                palookupoffse[i] = (intptr_t)&pals[i<<8];
+                bufplce[i] = (intptr_t)&tile[(simdtestrand() % 255)<<8];
+                vplce[i] = simdtestrand();
+                vince[i] = simdtestrand() >> (simdtestrand() & 31);
+            }
+
+            char *const p = &dst[pass][x];
+
+            switch (func)
+            {
+            case 0:
+                sethlinesizes(log2x, log2y, (intptr_t)tile);
+                setpalookupaddress(pals);
+                asm1 = simdtestrand(), asm2 = simdtestrand();
+                hlineasm4(cnt, 0, 256, simdtestrand(), simdtestrand(), (intptr_t)(p + cnt));
+                break;
+            case 1:
+                sethlinesizes(log2x, log2y, (intptr_t)tile);
+                gpinc = SIMDTEST_BPL;
+                // keep the sloptable[] index in range over the whole column
+                asm1 = (int32_t)(simdtestrand() % 801 - 400) << 3;
+                asm3 = (int32_t)(simdtestrand() % 262144) - 131072;
+                globalx3 = simdtestrand(), globaly3 = simdtestrand();
+                slopevlin((intptr_t)p, 0, (intptr_t)&slopal[cnt-1], cnt, simdtestrand(), simdtestrand());
+                break;
+            case 2:
+                setupvlineasm(32-log2y);
+                vlineasm4(cnt, p);
+                break;
+            case 3:
+                setupmvlineasm(32-log2y, simdtestrand() & 1);
+                mvlineasm4(cnt, p);
+                break;
+            case 4:
+                setuptvlineasm2(32-log2y, palookupoffse[0], palookupoffse[1]);
+                asm1 = vince[1], asm2 = (intptr_t)p + cnt*SIMDTEST_BPL;
+                tvlineasm2(vplce[1], vince[0], bufplce[0], bufplce[1], vplce[0], (intptr_t)p);
+                vplce[0] = asm1, vplce[1] = asm2;
+                break;
+            }
+
+            for (int i=0; i<4; i++)
+                out[pass][i] = vplce[i];
+        }
+
+        if (Bmemcmp(dst[0], dst[1], SIMDTEST_BPL*SIMDTEST_ROWS) || Bmemcmp(out[0], out[1], sizeof(out[0])))
+            failed++;
+    }
+
+    Bfree(tile);
+    Bfree(pals);
+    Bfree(trans);
+    Bfree(dst[0]);
+    Bfree(dst[1]);
+
+    bpl = oldbpl;
+    transmode = oldtransmode;
+    gtrans = oldgtrans;
+#ifdef USE_SATURATE_VPLC
+    g_saturate = oldsaturate;
+#endif
+    simdfuncs = oldfuncs;
+
+    return failed;
+}
+#endif
+
 #if 0
 void stretchhline(intptr_t p0, int32_t u, bssize_t cnt, int32_t uinc, intptr_t rptr, intptr_t p)
 {
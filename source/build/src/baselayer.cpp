@@ -235,6 +235,7 @@ void makeasmwriteable(void)
 }
 
 int32_t vsync=0;
+char headless=0;
 int32_t g_logFlushWindow = 1;
 
 #ifdef USE_OPENGL
@@ -408,6 +409,89 @@ int osdcmd_glinfo(osdcmdptr_t UNUSED(parm))
 }
 #endif
 
+#ifdef CLASSIC_THREADS
+static int osdcmd_classicthreadstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    renderPrintClassicThreadStats();
+
+    return OSDCMD_OK;
+}
+#endif
+
+#ifdef CLASSIC_SIMD
+static int osdcmd_classicsimdtest(osdcmdptr_t parm)
+{
+    int32_t const numtests = parm->numparms > 0 ? max(Batol(parm->parms[0]), 1L) : 10000;
+
+    for (int32_t level = CLASSIC_SIMD_SSE2; level <= getsimdsupport(); level++)
+    {
+        int32_t const failed = simdselftest(level, numtests);
+
+        OSD_Printf("%s: %d of %d runs differ from the C functions\n", level == CLASSIC_SIMD_AVX2 ? "AVX2" : "SSE2", failed, numtests);
+    }
+
+    return OSDCMD_OK;
+}
+#endif
+
+static int osdcmd_cachestats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    cacheReportStats();
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_tilestreamstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    tileStreamReportStats();
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_pvsstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    pvsReportStats();
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_spritegridbench(osdcmdptr_t parm)
+{
+    int32_t const radius = parm->numparms > 0 ? max(Batol(parm->parms[0]), 1L) : 2048;
+
+    spriteGridBenchmark(radius);
+
+    return OSDCMD_OK;
+}
+
+#ifndef USE_PHYSFS
+static int osdcmd_groupstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    kgroupstats();
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_groupbench(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    kgroupbenchmark();
+
+    return OSDCMD_OK;
+}
+#endif
+
 static int osdcmd_cvar_set_baselayer(osdcmdptr_t parm)
 {
     int32_t r = osdcmd_cvar_set(parm);
@@ -420,6 +504,14 @@ static int osdcmd_cvar_set_baselayer(osdcmdptr_t parm)
 
         return r;
     }
+#ifdef CLASSIC_SIMD
+    else if (!Bstrcasecmp(parm->name, "r_classicsimd"))
+    {
+        setsimdlevel(r_classicsimd);
+
+        return r;
+    }
+#endif
 
     return r;
 }
@@ -435,6 +527,10 @@ int32_t baselayer_init(void)
 #endif
     static osdcvardata_t cvars_engine[] =
     {
+        { "cache_indexed","enable/disable the free block index of the cache allocator",(void *) &cache_indexed, CVAR_BOOL, 0, 1 },
+#ifndef USE_PHYSFS
+        { "cache_mmap","enable/disable reading group files through memory mappings where supported",(void *) &cache_mmap, CVAR_BOOL, 0, 1 },
+#endif
         { "lz4compressionlevel","adjust LZ4 compression level used for savegames",(void *) &lz4CompressionLevel, CVAR_INT, 1, 32 },
         { "r_usenewaspect","enable/disable new screen aspect ratio determination code",(void *) &r_usenewaspect, CVAR_BOOL, 0, 1 },
         { "r_screenaspect","if using r_usenewaspect and in fullscreen, screen aspect ratio in the form XXYY, e.g. 1609 for 16:9",
@@ -444,7 +540,16 @@ int32_t baselayer_init(void)
 #ifdef YAX_ENABLE
         { "r_tror_nomaskpass", "enable/disable additional pass in TROR software rendering", (void *)&r_tror_nomaskpass, CVAR_BOOL, 0, 1 },
 #endif
+#ifdef CLASSIC_SIMD
+        { "r_classicsimd", "SIMD functions used by the classic renderer: 0: none  1: SSE2  2: AVX2 (if supported)", (void *)&r_classicsimd, CVAR_INT|CVAR_FUNCPTR, 0, 2 },
+#endif
+#ifdef CLASSIC_THREADS
+        { "r_classicthreads", "number of threads drawing the classic renderer's scene (0: one per CPU)", (void *)&r_classicthreads, CVAR_INT, 0, 16 },
+#endif
+        { "r_pvs", "enable/disable rejecting sectors with the precomputed sector visibility built when a map is loaded", (void *)&r_pvs, CVAR_BOOL, 0, 1 },
+        { "r_tilestream", "background tile loading: 0: off  1: load prefetched tiles in a thread  2: also draw placeholders for missing tiles (classic)", (void *)&r_tilestream, CVAR_INT, 0, 2 },
         { "r_windowpositioning", "enable/disable window position memory", (void *) &windowpos, CVAR_BOOL, 0, 1 },
+        { "spritegrid", "enable/disable looking up sprites near a point through the sprite position grid instead of the status lists", (void *)&spritegrid, CVAR_BOOL, 0, 1 },
         { "vid_gamma","adjusts gamma component of gamma ramp",(void *) &g_videoGamma, CVAR_FLOAT|CVAR_FUNCPTR, 0, 10 },
         { "vid_contrast","adjusts contrast component of gamma ramp",(void *) &g_videoContrast, CVAR_FLOAT|CVAR_FUNCPTR, 0, 10 },
         { "vid_brightness","adjusts brightness component of gamma ramp",(void *) &g_videoBrightness, CVAR_FLOAT|CVAR_FUNCPTR, 0, 10 },
@@ -460,6 +565,21 @@ int32_t baselayer_init(void)
     for (auto & i : cvars_engine)
         OSD_RegisterCvar(&i, (i.flags & CVAR_FUNCPTR) ? osdcmd_cvar_set_baselayer : osdcmd_cvar_set);
 
+    OSD_RegisterFunction("cachestats","cachestats: shows cache allocation times, evictions and fragmentation",osdcmd_cachestats);
+#ifndef USE_PHYSFS
+    OSD_RegisterFunction("groupstats","groupstats: shows the loaded group files and how many name lookups were made in them",osdcmd_groupstats);
+    OSD_RegisterFunction("groupbench","groupbench: times reading all group files with and without memory mappings",osdcmd_groupbench);
+#endif
+    OSD_RegisterFunction("pvsstats","pvsstats: shows the precomputed sector visibility of the current map and how much it rejected",osdcmd_pvsstats);
+    OSD_RegisterFunction("spritegridbench","spritegridbench [radius]: times sprite lookups around every sprite through the sprite position grid and through the status lists",osdcmd_spritegridbench);
+    OSD_RegisterFunction("tilestreamstats","tilestreamstats: shows the background tile loading queue, stalls and placeholders",osdcmd_tilestreamstats);
+#ifdef CLASSIC_SIMD
+    OSD_RegisterFunction("r_classicsimdtest","r_classicsimdtest [runs]: compares the classic renderer's SIMD functions with the C ones on random input",osdcmd_classicsimdtest);
+#endif
+#ifdef CLASSIC_THREADS
+    OSD_RegisterFunction("r_classicthreadstats","r_classicthreadstats: shows the column strips and timings of the classic renderer threads",osdcmd_classicthreadstats);
+#endif
+
 #ifdef USE_OPENGL
     OSD_RegisterFunction("setrendermode","setrendermode <number>: sets the engine's rendering mode.\n"
                          "Mode numbers are:\n"
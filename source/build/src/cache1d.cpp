@@ -21,6 +21,15 @@
 
 #include "vfs.h"
 
+// Group files can be mapped into memory instead of being read through a file
+// handle: reads from them become copies, and the data of uncompressed members
+// can be used in place (see kfileptr()).
+#if !defined USE_PHYSFS && (defined __linux__ || defined __APPLE__ || defined __FreeBSD__) && !defined EDUKE32_TOUCH_DEVICES
+# define CACHE1D_MMAP
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
 #ifdef WITHKPLIB
 #include "kplib.h"
 
@@ -102,6 +111,8 @@ int32_t kpzbufload(char const * const filnam)
 
 #define MAXCACHEOBJECTS 9216
 
+int32_t cache_indexed = 1;
+
 #if !defined DEBUG_ALLOCACHE_AS_MALLOC
 static int32_t cachesize = 0;
 static char zerochar = 0;
@@ -110,6 +121,26 @@ static int32_t lockrecip[200];
 
 int32_t cacnum = 0;
 cactype cac[MAXCACHEOBJECTS];
+
+// cac[] is kept dense: a block's slot can change when another one is
+// removed. The blocks are chained in offset order through caclink[], and each
+// one is also on a second list: free blocks of ours (lock == &zerochar) on the
+// bin for log2 of their size, all others on an LRU list in allocation order.
+#define CACHEFREEBINS 32
+#define CACHENONE -1
+
+typedef struct
+{
+    int32_t prev, next;    // in offset order
+    int32_t lprev, lnext;  // on the free bin or the LRU list
+} caclink_t;
+
+static caclink_t caclink[MAXCACHEOBJECTS];
+static int32_t cachehead;
+static int32_t freebin[CACHEFREEBINS];
+static int32_t cachelru, cachemru;
+
+static cachestats_t cachestats;
 #endif
 
 char toupperlookup[256] =
@@ -134,76 +165,254 @@ char toupperlookup[256] =
 
 static void reportandexit(const char *errormessage);
 
+#ifndef DEBUG_ALLOCACHE_AS_MALLOC
+static int32_t cacheFreeBin(int32_t leng)
+{
+    int32_t bin = 0;
 
-void cacheInitBuffer(intptr_t dacachestart, int32_t dacachesize)
+    while (leng >>= 1)
+        bin++;
+
+    return bin;
+}
+
+static FORCE_INLINE int32_t *cacheListHead(int32_t z)
 {
-#ifndef DEBUG_ALLOCACHE_AS_MALLOC
-    int32_t i;
+    return (cac[z].lock == &zerochar) ? &freebin[cacheFreeBin(cac[z].leng)] : &cachelru;
+}
 
-    for (i=1; i<200; i++)
-        lockrecip[i] = tabledivide32_noinline(1<<28, 200-i);
+static void cacheListLink(int32_t z)
+{
+    auto &link = caclink[z];
 
-    // we allocate this block with aligned_alloc, but I'm leaving this here in
-    // case we run on any platforms that just implement it as regular malloc
+    if (cac[z].lock == &zerochar)
+    {
+        int32_t &head = freebin[cacheFreeBin(cac[z].leng)];
 
-    cachestart = ((uintptr_t)dacachestart+15)&~(uintptr_t)0xf;
-    cachesize = (dacachesize-(((uintptr_t)(dacachestart))&0xf))&~(uintptr_t)0xf;
+        link.lprev = CACHENONE;
+        link.lnext = head;
 
-    cac[0].leng = cachesize;
-    cac[0].lock = &zerochar;
-    cacnum = 1;
+        if (head != CACHENONE)
+            caclink[head].lprev = z;
 
-    initprintf("Initialized %.1fM cache\n", (float)(dacachesize/1024.f/1024.f));
-#else
-    UNREFERENCED_PARAMETER(dacachestart);
-    UNREFERENCED_PARAMETER(dacachesize);
-#endif
+        head = z;
+        return;
+    }
+
+    link.lprev = cachemru;
+    link.lnext = CACHENONE;
+
+    if (cachemru != CACHENONE)
+        caclink[cachemru].lnext = z;
+    else
+        cachelru = z;
+
+    cachemru = z;
 }
 
-#ifdef DEBUG_ALLOCACHE_AS_MALLOC
-void cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
+static void cacheListUnlink(int32_t z)
 {
-    UNREFERENCED_PARAMETER(newlockptr);
+    auto const &link = caclink[z];
 
-    *newhandle = (intptr_t)Xmalloc(newbytes);
+    if (link.lprev != CACHENONE)
+        caclink[link.lprev].lnext = link.lnext;
+    else
+        *cacheListHead(z) = link.lnext;
+
+    if (link.lnext != CACHENONE)
+        caclink[link.lnext].lprev = link.lprev;
+    else if (cac[z].lock != &zerochar)
+        cachemru = link.lprev;
 }
-#else
+
 static inline void inc_and_check_cacnum(void)
 {
     if (EDUKE32_PREDICT_FALSE(++cacnum > MAXCACHEOBJECTS))
         reportandexit("Too many objects in cache! (cacnum > MAXCACHEOBJECTS)");
 }
 
-void cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
+// Takes block z out of the offset chain and gives its slot to the last block.
+// z must not be on a list anymore. Returns the old slot of the moved block.
+static int32_t cacheRemoveBlock(int32_t z)
 {
-    if (EDUKE32_PREDICT_FALSE(*newlockptr == 0))
-        reportandexit("ALLOCACHE CALLED WITH LOCK OF 0!");
+    auto const &link = caclink[z];
 
-    // Make all requests a multiple of 16 bytes
-    newbytes = (newbytes + 15) & ~0xf;
+    if (link.prev != CACHENONE)
+        caclink[link.prev].next = link.next;
+    else
+        cachehead = link.next;
 
-    if (EDUKE32_PREDICT_FALSE((unsigned)newbytes > (unsigned)cachesize))
+    if (link.next != CACHENONE)
+        caclink[link.next].prev = link.prev;
+
+    int32_t const last = --cacnum;
+
+    if (last == z)
+        return last;
+
+    cac[z] = cac[last];
+    caclink[z] = caclink[last];
+
+    auto const &moved = caclink[z];
+
+    if (moved.prev != CACHENONE)
+        caclink[moved.prev].next = z;
+    else
+        cachehead = z;
+
+    if (moved.next != CACHENONE)
+        caclink[moved.next].prev = z;
+
+    if (moved.lprev != CACHENONE)
+        caclink[moved.lprev].lnext = z;
+    else
+        *cacheListHead(z) = z;
+
+    if (moved.lnext != CACHENONE)
+        caclink[moved.lnext].lprev = z;
+    else if (cac[z].lock != &zerochar)
+        cachemru = z;
+
+    return last;
+}
+
+// Inserts a free block after block z and returns it.
+static int32_t cacheInsertFreeBlock(int32_t z, int32_t ofs, int32_t leng)
+{
+    int32_t const nz = cacnum;
+
+    inc_and_check_cacnum();
+
+    cac[nz].hand = NULL;
+    cac[nz].leng = leng;
+    cac[nz].lock = &zerochar;
+    cac[nz].ofs  = ofs;
+
+    caclink[nz].prev = z;
+    caclink[nz].next = caclink[z].next;
+
+    if (caclink[z].next != CACHENONE)
+        caclink[caclink[z].next].prev = nz;
+
+    caclink[z].next = nz;
+    cacheListLink(nz);
+
+    return nz;
+}
+
+// Best fit among the free blocks of the smallest bin that can hold newbytes,
+// or any block of a larger bin. -1 if there is none.
+static int32_t cacheFindFreeBlock(int32_t newbytes)
+{
+    int32_t const firstbin = cacheFreeBin(newbytes);
+    int32_t bestz = CACHENONE;
+
+    for (int32_t z = freebin[firstbin]; z != CACHENONE; z = caclink[z].lnext)
+        if (cac[z].leng >= newbytes && (bestz == CACHENONE || cac[z].leng < cac[bestz].leng))
+            bestz = z;
+
+    for (int32_t bin = firstbin+1; bestz == CACHENONE && bin < CACHEFREEBINS; bin++)
+        bestz = freebin[bin];
+
+    return bestz;
+}
+
+static FORCE_INLINE int32_t cacheEvictionCost(int32_t z)
+{
+    char const lock = *cac[z].lock;
+
+    // Potential for eviction increases with
+    //  - smaller item size
+    //  - smaller lock byte value (but in [1 .. 199])
+    return lock ? mulscale32(cac[z].leng + 65536, lockrecip[(uint8_t)lock]) : 0;
+}
+
+#define CACHELRUCANDIDATES 16
+#define CACHELRUVISITS 256
+#define CACHEMAXWINDOW 64
+
+// Grows a window of evictable blocks around z until it holds newbytes and
+// returns its cost, or 0x7fffffff if the blocks around z are locked.
+static int32_t cacheScoreWindow(int32_t z, int32_t newbytes, int32_t *start)
+{
+    int32_t leng = cac[z].leng, cost = cacheEvictionCost(z), first = z, last = z;
+
+    for (int32_t num = 1; leng < newbytes; num++)
     {
-        initprintf("Cachesize: %d\n",cachesize);
-        initprintf("*Newhandle: 0x%" PRIxPTR ", Newbytes: %d, *Newlock: %d\n",(intptr_t)newhandle,newbytes,*newlockptr);
-        reportandexit("BUFFER TOO BIG TO FIT IN CACHE!");
+        int32_t const next = caclink[last].next, prev = caclink[first].prev;
+        int32_t nz;
+
+        if (next != CACHENONE && *cac[next].lock < 200)
+            nz = last = next;
+        else if (prev != CACHENONE && *cac[prev].lock < 200)
+            nz = first = prev;
+        else
+            return 0x7fffffff;
+
+        if (num >= CACHEMAXWINDOW)
+            return 0x7fffffff;
+
+        leng += cac[nz].leng;
+        cost += cacheEvictionCost(nz);
     }
 
-    int32_t bestz   = 0;
-    int32_t besto   = 0;
-    int32_t bestval = 0x7fffffff;
+    *start = first;
+    return cost;
+}
+
+// Looks at the least recently allocated blocks for the cheapest window to
+// evict. Pinned blocks met on the way go to the back of the list.
+static int32_t cacheFindLRUWindow(int32_t newbytes)
+{
+    int32_t bestz = CACHENONE, bestval = 0x7fffffff;
+    int32_t candidates = CACHELRUCANDIDATES;
 
-    for (native_t z=cacnum-1, o1=cachesize; z>=0; z--)
+    for (int32_t z = cachelru, visits = CACHELRUVISITS, next; z != CACHENONE && candidates > 0 && visits > 0; z = next, visits--)
     {
-        o1 -= cac[z].leng;
-        int32_t o2 = o1 + newbytes;
+        next = caclink[z].lnext;
 
-        if (o2 > cachesize)
+        if (*cac[z].lock >= 200)
+        {
+            if (z != cachemru)
+            {
+                cacheListUnlink(z);
+                cacheListLink(z);
+            }
             continue;
+        }
+
+        candidates--;
+
+        int32_t start;
+        int32_t const val = cacheScoreWindow(z, newbytes, &start);
+
+        if (val < bestval)
+        {
+            bestval = val;
+            bestz   = start;
+
+            if (bestval == 0)
+                break;
+        }
+    }
+
+    return bestz;
+}
+
+// Scores every window of blocks the new one could replace, in offset order.
+static int32_t cacheFindEvictionWindow(int32_t newbytes)
+{
+    int32_t bestz   = 0;
+    int32_t bestval = 0x7fffffff;
+
+    for (int32_t z = cachehead; z != CACHENONE; z = caclink[z].next)
+    {
+        if (cac[z].ofs + newbytes > cachesize)
+            break;
 
         int32_t daval = 0;
 
-        for (native_t i=o1, zz=z; i<o2; i+=cac[zz++].leng)
+        for (int32_t i = 0, zz = z; i < newbytes; i += cac[zz].leng, zz = caclink[zz].next)
         {
             if (*cac[zz].lock == 0)
                 continue;
@@ -214,10 +423,7 @@ void cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
                 break;
             }
 
-            // Potential for eviction increases with
-            //  - smaller item size
-            //  - smaller lock byte value (but in [1 .. 199])
-            daval += mulscale32(cac[zz].leng + 65536, lockrecip[*cac[zz].lock]);
+            daval += cacheEvictionCost(zz);
 
             if (daval >= bestval)
                 break;
@@ -226,7 +432,6 @@ void cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
         if (daval < bestval)
         {
             bestval = daval;
-            besto   = o1;
             bestz   = z;
 
             if (bestval == 0)
@@ -234,55 +439,196 @@ void cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
         }
     }
 
-    //printf("%d %d %d\n",besto,newbytes,*newlockptr);
-
     if (EDUKE32_PREDICT_FALSE(bestval == 0x7fffffff))
         reportandexit("CACHE SPACE ALL LOCKED UP!");
 
+    return bestz;
+}
+#endif
+
+
+void cacheInitBuffer(intptr_t dacachestart, int32_t dacachesize)
+{
+#ifndef DEBUG_ALLOCACHE_AS_MALLOC
+    int32_t i;
+
+    for (i=1; i<200; i++)
+        lockrecip[i] = tabledivide32_noinline(1<<28, 200-i);
+
+    // we allocate this block with aligned_alloc, but I'm leaving this here in
+    // case we run on any platforms that just implement it as regular malloc
+
+    cachestart = ((uintptr_t)dacachestart+15)&~(uintptr_t)0xf;
+    cachesize = (dacachesize-(((uintptr_t)(dacachestart))&0xf))&~(uintptr_t)0xf;
+
+    cac[0].hand = NULL;
+    cac[0].leng = cachesize;
+    cac[0].lock = &zerochar;
+    cac[0].ofs = 0;
+    cacnum = 1;
+
+    caclink[0].prev = caclink[0].next = CACHENONE;
+    cachehead = 0;
+    cachelru = cachemru = CACHENONE;
+
+    for (i=0; i<CACHEFREEBINS; i++)
+        freebin[i] = CACHENONE;
+    Bmemset(&cachestats, 0, sizeof(cachestats));
+    cacheListLink(0);
+
+    initprintf("Initialized %.1fM cache\n", (float)(dacachesize/1024.f/1024.f));
+#else
+    UNREFERENCED_PARAMETER(dacachestart);
+    UNREFERENCED_PARAMETER(dacachesize);
+#endif
+}
+
+#ifdef DEBUG_ALLOCACHE_AS_MALLOC
+void cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
+{
+    UNREFERENCED_PARAMETER(newlockptr);
+
+    *newhandle = (intptr_t)Xmalloc(newbytes);
+}
+
+void cacheGetStats(cachestats_t *stats)
+{
+    Bmemset(stats, 0, sizeof(cachestats_t));
+}
+
+void cacheReportStats(void)
+{
+    initprintf("Cache allocations go through malloc.\n");
+}
+#else
+void cacheAllocateBlock(intptr_t *newhandle, int32_t newbytes, char *newlockptr)
+{
+    if (EDUKE32_PREDICT_FALSE(*newlockptr == 0))
+        reportandexit("ALLOCACHE CALLED WITH LOCK OF 0!");
+
+    // Make all requests a multiple of 16 bytes
+    newbytes = (newbytes + 15) & ~0xf;
+
+    if (EDUKE32_PREDICT_FALSE((unsigned)newbytes > (unsigned)cachesize))
+    {
+        initprintf("Cachesize: %d\n",cachesize);
+        initprintf("*Newhandle: 0x%" PRIxPTR ", Newbytes: %d, *Newlock: %d\n",(intptr_t)newhandle,newbytes,*newlockptr);
+        reportandexit("BUFFER TOO BIG TO FIT IN CACHE!");
+    }
+
+    double const starttime = timerGetHiTicks();
+
+    int32_t bestz = CACHENONE;
+
+    if (cache_indexed)
+    {
+        if ((bestz = cacheFindFreeBlock(newbytes)) != CACHENONE)
+            cachestats.indexedallocs++;
+        else
+            bestz = cacheFindLRUWindow(newbytes);
+    }
+
+    if (bestz == CACHENONE)
+        bestz = cacheFindEvictionWindow(newbytes);
+
+    int32_t const besto = cac[bestz].ofs;
+
     //Suck things out
     int32_t sucklen = -newbytes;
-    int32_t suckz = bestz;
 
-    for (;sucklen<0; sucklen+=cac[suckz++].leng)
-        if (*cac[suckz].lock)
-            *cac[suckz].hand = 0;
+    for (int32_t z = bestz; sucklen < 0; z = caclink[z].next)
+    {
+        if (*cac[z].lock)
+        {
+            *cac[z].hand = 0;
+            cachestats.evictions++;
+            cachestats.evictedbytes += cac[z].leng;
+        }
+
+        sucklen += cac[z].leng;
+    }
 
     //Remove all blocks except 1
-    suckz -= bestz+1;
-    cacnum -= suckz;
+    for (int32_t leng = cac[bestz].leng; leng < newbytes;)
+    {
+        int32_t const z = caclink[bestz].next;
+
+        leng += cac[z].leng;
+        cacheListUnlink(z);
+
+        if (cacheRemoveBlock(z) == bestz)
+            bestz = z;
+    }
 
-    Bmemmove(&cac[bestz], &cac[bestz + suckz], (cacnum - bestz) * sizeof(cactype));
+    cacheListUnlink(bestz);
 
     cac[bestz].hand = newhandle;
     *newhandle      = cachestart + besto;
     cac[bestz].leng = newbytes;
     cac[bestz].lock = newlockptr;
+    cac[bestz].ofs  = besto;
+    cacheListLink(bestz);
 
     //Add new empty block if necessary
-    if (sucklen <= 0)
-        return;
-
-    if (++bestz == cacnum)
+    if (sucklen > 0)
     {
-        inc_and_check_cacnum();
-        cac[bestz].leng = sucklen;
-        cac[bestz].lock = &zerochar;
-        return;
+        int32_t const z = caclink[bestz].next;
+
+        if (z != CACHENONE && cac[z].lock == &zerochar)
+        {
+            cacheListUnlink(z);
+            cac[z].leng += sucklen;
+            cac[z].ofs = besto + newbytes;
+            cacheListLink(z);
+        }
+        else
+            cacheInsertFreeBlock(bestz, besto + newbytes, sucklen);
     }
 
-    if (*cac[bestz].lock == 0)
+    double const time = timerGetHiTicks() - starttime;
+
+    cachestats.allocs++;
+    cachestats.time += time;
+    cachestats.maxtime = max(cachestats.maxtime, time);
+}
+
+void cacheGetStats(cachestats_t *stats)
+{
+    *stats = cachestats;
+
+    stats->numobjects = cacnum;
+    stats->size = cachesize;
+    stats->numfree = stats->freebytes = stats->largestfree = 0;
+
+    for (int32_t z = cachehead; z != CACHENONE; z = caclink[z].next)
     {
-        cac[bestz].leng += sucklen;
-        return;
+        if (*cac[z].lock != 0)
+            continue;
+
+        // count runs of free blocks as one
+        int32_t leng = cac[z].leng;
+
+        while (caclink[z].next != CACHENONE && *cac[caclink[z].next].lock == 0)
+            leng += cac[z = caclink[z].next].leng;
+
+        stats->numfree++;
+        stats->freebytes += leng;
+        stats->largestfree = max(stats->largestfree, leng);
     }
+}
 
-    inc_and_check_cacnum();
+void cacheReportStats(void)
+{
+    cachestats_t stats;
 
-    for (native_t z=cacnum-1; z>bestz; z--)
-        cac[z] = cac[z-1];
+    cacheGetStats(&stats);
 
-    cac[bestz].leng = sucklen;
-    cac[bestz].lock = &zerochar;
+    initprintf("%d objects in a %.1fM cache, allocator: %s\n", stats.numobjects, stats.size/1048576.f, cache_indexed ? "indexed" : "linear");
+    initprintf("%u allocations (%u from the free block index), %.3f ms average, %.3f ms max\n", stats.allocs,
+               stats.indexedallocs, stats.allocs ? stats.time / stats.allocs : 0.0, stats.maxtime);
+    initprintf("%u evictions, %.1fM evicted\n", stats.evictions, stats.evictedbytes/1048576.f);
+    initprintf("%.1fM free in %d runs, largest %.1fM, fragmentation %.1f%%\n", stats.freebytes/1048576.f, stats.numfree,
+               stats.largestfree/1048576.f, stats.freebytes ? 100.f - 100.f * stats.largestfree / stats.freebytes : 0.f);
 }
 #endif
 
@@ -680,8 +1026,58 @@ static int32_t groupfilpos[MAXGROUPFILES];
 static uint8_t groupfilgrp[MAXGROUPFILES];
 static char *gfilelist[MAXGROUPFILES];
 static char *groupname[MAXGROUPFILES];
+static char *grouppath[MAXGROUPFILES];  // where the group was found on disk, NULL if inside another group
+static char *groupmap[MAXGROUPFILES];
+static int32_t groupmapsiz[MAXGROUPFILES];
+
+int32_t cache_mmap = 1;
+void (*kunmapcallback)(char const *base, int32_t size);
+
+#ifdef CACHE1D_MMAP
+// ZIPs are mapped the first time a stored entry is read from them.
+#define MAXZIPMAPS 16
+static struct
+{
+    char *  name;
+    char *  base;
+    int32_t size;
+} zipmap[MAXZIPMAPS];
+static int32_t numzipmaps;
+
+static void kunmapfile(char *base, int32_t size)
+{
+    // pointers handed out by kfileptr() must not outlive the mapping
+    if (kunmapcallback)
+        kunmapcallback(base, size);
+
+    munmap(base, size);
+}
+
+// The mapping is private and writable, so writes to it stay in memory.
+static char *kmapfile(int32_t fil, int32_t *size)
+{
+    struct stat st;
+
+    if (fstat(fil, &st) || st.st_size <= 0 || st.st_size > INT32_MAX)
+        return NULL;
+
+    void *const map = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fil, 0);
+
+    if (map == MAP_FAILED)
+        return NULL;
+
+    *size = (int32_t)st.st_size;
+    return (char *)map;
+}
+#endif
 static int32_t *gfileoffs[MAXGROUPFILES];
 
+// Open addressing hash of each group's file names: entry index + 1, 0 = empty
+static int32_t *gfilehash[MAXGROUPFILES];
+static uint32_t gfilehashmask[MAXGROUPFILES];
+
+static uint32_t grouplookups, groupprobes, grouphits;
+
 static uint8_t filegrp[MAXOPENFILES];
 static int32_t filepos[MAXOPENFILES];
 static intptr_t filehan[MAXOPENFILES] =
@@ -703,6 +1099,8 @@ int32_t cache1d_file_fromzip(buildvfs_kfd fil)
 #endif
 
 static int32_t kopen_internal(const char *filename, char **lastpfn, char searchfirst, char checkcase, char tryzip, int32_t newhandle, uint8_t *arraygrp, intptr_t *arrayhan, int32_t *arraypos);
+static void kgrouphash_build(int32_t group);
+static void kgroupmap(int32_t group);
 static int32_t kread_grp(int32_t handle, void *buffer, int32_t leng);
 static int32_t klseek_grp(int32_t handle, int32_t offset, int32_t whence);
 static void kclose_grp(int32_t handle);
@@ -741,11 +1139,7 @@ int initgroupfile(const char *filename)
             return MAXGROUPFILES;
         }
         klseek_grp(numgroupfiles,0,BSEEK_SET);
-
-        Bfree(zfn);
     }
-#else
-    Bfree(zfn);
 #endif
 
     // check if GRP
@@ -769,6 +1163,9 @@ int initgroupfile(const char *filename)
         }
         gfileoffs[numgroupfiles][gnumfiles[numgroupfiles]] = j;
         groupname[numgroupfiles] = Xstrdup(filename);
+        grouppath[numgroupfiles] = zfn;
+        kgrouphash_build(numgroupfiles);
+        kgroupmap(numgroupfiles);
         return numgroupfiles++;
     }
     klseek_grp(numgroupfiles, 0, BSEEK_SET);
@@ -872,23 +1269,222 @@ int initgroupfile(const char *filename)
         }
         gfileoffs[numgroupfiles][gnumfiles[numgroupfiles]] = j;
         groupname[numgroupfiles] = Xstrdup(filename);
+        grouppath[numgroupfiles] = zfn;
+        kgrouphash_build(numgroupfiles);
+        kgroupmap(numgroupfiles);
         return numgroupfiles++;
     }
 
     kclose_grp(numgroupfiles);
+    Bfree(zfn);
     return -1;
 }
 
+// Entry names are compared through toupperlookup[] and are at most 12
+// characters long, so "e1l1.map" is neither "e1l1" nor a longer name.
+static int32_t kgroupname_equal(char const *filename, char const *gfileptr)
+{
+    unsigned int j;
+    for (j = 0; j < 13; ++j)
+    {
+        if (!filename[j]) break;
+        if (toupperlookup[filename[j]] != toupperlookup[gfileptr[j]])
+            return 0;
+    }
+    if (j<13 && gfileptr[j]) return 0;   // JBF: because e1l1.map might exist before e1l1
+    if (j==13 && filename[j]) return 0;   // JBF: long file name
+
+    return 1;
+}
+
+static uint32_t kgroupname_hash(char const *name)
+{
+    uint32_t h = 5381;
+
+    for (unsigned int j = 0; j < 13 && name[j]; ++j)
+        h = ((h << 5) + h) ^ (uint8_t)toupperlookup[name[j]];
+
+    return h;
+}
+
+static void kgrouphash_build(int32_t group)
+{
+    uint32_t size = 16;
+
+    while (size < (uint32_t)gnumfiles[group]<<1)
+        size <<= 1;
+
+    Bfree(gfilehash[group]);
+    gfilehash[group] = (int32_t *)Xcalloc(size, sizeof(int32_t));
+    gfilehashmask[group] = size-1;
+
+    // a later entry with the same name replaces the earlier one, like the
+    // linear search from the end of the directory did
+    for (bssize_t i = 0; i < gnumfiles[group]; i++)
+    {
+        char const * const name = &gfilelist[group][i<<4];
+        uint32_t slot = kgroupname_hash(name) & gfilehashmask[group];
+
+        for (int32_t e; (e = gfilehash[group][slot]) != 0; slot = (slot+1) & gfilehashmask[group])
+            if (kgroupname_equal(name, &gfilelist[group][(e-1)<<4]))
+                break;
+
+        gfilehash[group][slot] = i+1;
+    }
+}
+
+static int32_t kgrouphash_find(int32_t group, char const *filename)
+{
+    uint32_t slot = kgroupname_hash(filename) & gfilehashmask[group];
+
+    grouplookups++;
+
+    for (int32_t e; (e = gfilehash[group][slot]) != 0; slot = (slot+1) & gfilehashmask[group])
+    {
+        groupprobes++;
+
+        if (kgroupname_equal(filename, &gfilelist[group][(e-1)<<4]))
+        {
+            grouphits++;
+            return e-1;
+        }
+    }
+
+    return -1;
+}
+
+void kgroupstats(void)
+{
+    for (bssize_t k = 0; k < numgroupfiles; k++)
+        if (groupfil[k] != -1)
+            initprintf("%d: %s, %d files, %u hash slots\n", (int32_t)k, groupname[k], gnumfiles[k], gfilehashmask[k]+1);
+
+    initprintf("%u lookups, %u found, %.2f probes per lookup\n", grouplookups, grouphits,
+               grouplookups ? (double)groupprobes / grouplookups : 0.0);
+}
+
+// Reads every member of the loaded groups with the read() and the mmap()
+// backends, and once more using the mapped data in place. A first pass fills
+// the OS file cache so that the timings compare the backends, not the disk.
+void kgroupbenchmark(void)
+{
+    int32_t handle = MAXOPENFILES-1;
+
+    while (handle >= 0 && filehan[handle] != -1)
+        handle--;
+
+    if (handle < 0)
+        return;
+
+    int32_t maxleng = 0;
+
+    for (bssize_t k = 0; k < numgroupfiles; k++)
+        if (groupfil[k] != -1)
+            for (bssize_t i = 0; i < gnumfiles[k]; i++)
+                maxleng = max(maxleng, gfileoffs[k][i+1]-gfileoffs[k][i]);
+
+    char *const buf = (char *)Xmalloc(max(maxleng, 1));
+    int32_t const oldmmap = cache_mmap;
+    static char const *const passname[] = { "warm-up", "read()", "mmap() copy", "mmap() in place" };
+
+    for (bssize_t pass = 0; pass < 4; pass++)
+    {
+        cache_mmap = (pass >= 2);
+
+        double const starttime = timerGetHiTicks();
+        int64_t bytes = 0;
+        int32_t files = 0, inplace = 0;
+        uint8_t sum = 0;
+
+        for (bssize_t k = 0; k < numgroupfiles; k++)
+        {
+            if (groupfil[k] == -1)
+                continue;
+
+            for (bssize_t i = 0; i < gnumfiles[k]; i++)
+            {
+                int32_t const leng = gfileoffs[k][i+1]-gfileoffs[k][i];
+
+                filegrp[handle] = k;
+                filehan[handle] = i;
+                filepos[handle] = 0;
+
+                char const *const ptr = (pass == 3) ? kfileptr(handle, 0, leng) : NULL;
+
+                if (ptr)
+                {
+                    // touch every page like the users of the data would
+                    for (bssize_t j = 0; j < leng; j += 4096)
+                        sum += ptr[j];
+                    inplace++;
+                }
+                else
+                    kread(handle, buf, leng);
+
+                bytes += leng;
+                files++;
+            }
+        }
+
+        double const ms = timerGetHiTicks() - starttime;
+
+        if (pass > 0)
+            initprintf("%s: %d files, %.1fM in %.2f ms, %.1f MB/s%s\n", passname[pass], files, bytes/1048576.0, ms,
+                       ms > 0.0 ? bytes/1048576.0/(ms/1000.0) : 0.0,
+                       (pass == 3 && inplace < files) ? " (some files not mapped)" : "");
+
+        buf[0] += sum;
+    }
+
+    filehan[handle] = -1;
+    cache_mmap = oldmmap;
+
+    Bfree(buf);
+
+#ifndef CACHE1D_MMAP
+    initprintf("Group files can't be mapped into memory on this platform.\n");
+#endif
+}
+
+static void kgroupmap(int32_t group)
+{
+#ifdef CACHE1D_MMAP
+    // groups inside other groups use the mapping of the outermost one
+    if (groupfilgrp[group] == GRP_FILESYSTEM)
+        groupmap[group] = kmapfile(groupfil[group], &groupmapsiz[group]);
+#else
+    UNREFERENCED_PARAMETER(group);
+#endif
+}
+
 void uninitgroupfile(void)
 {
     int32_t i;
 
+#ifdef CACHE1D_MMAP
+    for (i=0; i<numzipmaps; i++)
+    {
+        if (zipmap[i].base)
+            kunmapfile(zipmap[i].base, zipmap[i].size);
+        DO_FREE_AND_NULL(zipmap[i].name);
+    }
+    numzipmaps = 0;
+#endif
+
     for (i=numgroupfiles-1; i>=0; i--)
         if (groupfil[i] != -1)
         {
+#ifdef CACHE1D_MMAP
+            if (groupmap[i])
+                kunmapfile(groupmap[i], groupmapsiz[i]);
+#endif
+            groupmap[i] = NULL;
+
             DO_FREE_AND_NULL(gfilelist[i]);
             DO_FREE_AND_NULL(gfileoffs[i]);
             DO_FREE_AND_NULL(groupname[i]);
+            DO_FREE_AND_NULL(grouppath[i]);
+            DO_FREE_AND_NULL(gfilehash[i]);
 
             Bclose(groupfil[i]);
             groupfil[i] = -1;
@@ -1025,27 +1621,15 @@ static int32_t kopen_internal(const char *filename, char **lastpfn, char searchf
         if (groupfil[k] < 0)
             continue;
 
-        for (bssize_t i = gnumfiles[k]-1; i >= 0; --i)
-        {
-            char const * const gfileptr = (char *)&gfilelist[k][i<<4];
+        int32_t const i = kgrouphash_find(k, filename);
 
-            unsigned int j;
-            for (j = 0; j < 13; ++j)
-            {
-                if (!filename[j]) break;
-                if (toupperlookup[filename[j]] != toupperlookup[gfileptr[j]])
-                    goto gnumfiles_continue;
-            }
-            if (j<13 && gfileptr[j]) continue;   // JBF: because e1l1.map might exist before e1l1
-            if (j==13 && filename[j]) continue;   // JBF: long file name
-
-            arraygrp[newhandle] = k;
-            arrayhan[newhandle] = i;
-            arraypos[newhandle] = 0;
-            return newhandle;
+        if (i < 0)
+            continue;
 
-gnumfiles_continue: ;
-        }
+        arraygrp[newhandle] = k;
+        arrayhan[newhandle] = i;
+        arraypos[newhandle] = 0;
+        return newhandle;
     }
 
     return -1;
@@ -1054,6 +1638,7 @@ gnumfiles_continue: ;
 void krename(int32_t crcval, int32_t filenum, const char *newname)
 {
     Bstrncpy((char *)&gfilelist[crcval][filenum<<4], newname, 12);
+    kgrouphash_build(crcval);
 }
 
 char const * kfileparent(int32_t const handle)
@@ -1087,11 +1672,141 @@ int32_t kopen4load(const char *filename, char searchfirst)
 
     int32_t h = kopen_internal(filename, &lastpfn, searchfirst, 1, 1, newhandle, filegrp, filehan, filepos);
 
+    // remember where loose files were found for kfilesource()
+    if (h >= 0 && filegrp[h] == GRP_FILESYSTEM)
+    {
+        if (lastpfn && Bstrlen(lastpfn) < sizeof(filenamsav[0]))
+            Bstrcpy(filenamsav[h], lastpfn);
+        else
+            filenamsav[h][0] = 0;
+    }
+
     Bfree(lastpfn);
 
     return h;
 }
 
+// Returns the group on disk an open group member is in and sets *offset to
+// where its data starts in that group, or -1.
+static int32_t kgrouproot(buildvfs_kfd handle, int32_t *offset)
+{
+    int32_t groupnum = filegrp[handle];
+
+    if ((unsigned)groupnum >= MAXGROUPFILES || groupfil[groupnum] == -1)
+        return -1;
+
+    int32_t ofs = gfileoffs[groupnum][filehan[handle]];
+
+    while (groupfilgrp[groupnum] != GRP_FILESYSTEM)
+    {
+        if ((unsigned)groupfilgrp[groupnum] >= MAXGROUPFILES)
+            return -1;
+
+        ofs += gfileoffs[groupfilgrp[groupnum]][groupfil[groupnum]];
+        groupnum = groupfilgrp[groupnum];
+    }
+
+    *offset = ofs;
+    return groupnum;
+}
+
+char const *kfilesource(buildvfs_kfd handle, int32_t *offset)
+{
+    if (filegrp[handle] == GRP_FILESYSTEM)
+    {
+        *offset = 0;
+        return filenamsav[handle][0] ? filenamsav[handle] : NULL;
+    }
+
+    int32_t const rootgroupnum = kgrouproot(handle, offset);
+
+    return rootgroupnum >= 0 ? grouppath[rootgroupnum] : NULL;
+}
+
+#ifdef WITHKPLIB
+static void kzipselect(int32_t handle, int32_t *arraypos)
+{
+    if (kzcurhand != handle)
+    {
+        if (kztell() >= 0) { arraypos[kzcurhand] = kztell(); kzclose(); }
+        kzcurhand = handle;
+        kzipopen(filenamsav[handle]);
+        kzseek(arraypos[handle],SEEK_SET);
+    }
+}
+
+// Returns the data of the open ZIP entry if it is stored uncompressed and its
+// ZIP could be mapped, and sets *avail to the length of the entry.
+static char *kzipdata(int32_t *avail)
+{
+#ifdef CACHE1D_MMAP
+    char const *const name = kzipname();
+
+    if (name == NULL || kzfs.comptyp != 0)
+        return NULL;
+
+    int32_t i = 0;
+
+    while (i < numzipmaps && Bstrcmp(zipmap[i].name, name))
+        i++;
+
+    if (i == numzipmaps)
+    {
+        if (numzipmaps == MAXZIPMAPS)
+            return NULL;
+
+        zipmap[i].name = Xstrdup(name);
+        zipmap[i].base = NULL;
+        numzipmaps++;
+
+        int32_t const fil = Bopen(name, BO_BINARY|BO_RDONLY, BS_IREAD);
+
+        if (fil >= 0)
+        {
+            zipmap[i].base = kmapfile(fil, &zipmap[i].size);
+            Bclose(fil);
+        }
+    }
+
+    if (zipmap[i].base == NULL || kzfs.seek0 + kzfs.leng > zipmap[i].size)
+        return NULL;
+
+    *avail = kzfs.leng;
+    return zipmap[i].base + kzfs.seek0;
+#else
+    UNREFERENCED_PARAMETER(avail);
+    return NULL;
+#endif
+}
+#endif
+
+char *kfileptr(buildvfs_kfd handle, int32_t offset, int32_t leng)
+{
+    if (!cache_mmap || offset < 0 || leng < 0)
+        return NULL;
+
+#ifdef WITHKPLIB
+    if (filegrp[handle] == GRP_ZIP)
+    {
+        int32_t avail;
+
+        kzipselect(handle, filepos);
+
+        char *const data = kzipdata(&avail);
+
+        return (data && offset + leng <= avail) ? data + offset : NULL;
+    }
+#endif
+
+    int32_t ofs;
+    int32_t const rootgroupnum = kgrouproot(handle, &ofs);
+
+    if (rootgroupnum < 0 || !groupmap[rootgroupnum] || ofs + offset + leng > groupmapsiz[rootgroupnum])
+        return NULL;
+
+    return groupmap[rootgroupnum] + ofs + offset;
+}
+
 int32_t kread_internal(int32_t handle, void *buffer, int32_t leng, const uint8_t *arraygrp, const intptr_t *arrayhan, int32_t *arraypos)
 {
     int32_t filenum = arrayhan[handle];
@@ -1101,13 +1816,22 @@ int32_t kread_internal(int32_t handle, void *buffer, int32_t leng, const uint8_t
 #ifdef WITHKPLIB
     else if (groupnum == GRP_ZIP)
     {
-        if (kzcurhand != handle)
+        kzipselect(handle, arraypos);
+
+        int32_t avail;
+        char const *const data = cache_mmap ? kzipdata(&avail) : NULL;
+
+        if (data)
         {
-            if (kztell() >= 0) { arraypos[kzcurhand] = kztell(); kzclose(); }
-            kzcurhand = handle;
-            kzipopen(filenamsav[handle]);
-            kzseek(arraypos[handle],SEEK_SET);
+            leng = min(leng, kzfs.leng-kzfs.pos);
+            if (leng <= 0)
+                return 0;
+
+            Bmemcpy(buffer, data+kzfs.pos, leng);
+            kzfs.pos += leng;
+            return leng;
         }
+
         return kzread(buffer,leng);
     }
 #endif
@@ -1122,6 +1846,18 @@ int32_t kread_internal(int32_t handle, void *buffer, int32_t leng, const uint8_t
         i += gfileoffs[groupfilgrp[rootgroupnum]][groupfil[rootgroupnum]];
         rootgroupnum = groupfilgrp[rootgroupnum];
     }
+    if (groupmap[rootgroupnum] && cache_mmap)
+    {
+        i += gfileoffs[groupnum][filenum]+arraypos[handle];
+        leng = min(leng,(gfileoffs[groupnum][filenum+1]-gfileoffs[groupnum][filenum])-arraypos[handle]);
+        leng = min(leng,groupmapsiz[rootgroupnum]-i);
+        if (leng <= 0)
+            return 0;
+
+        Bmemcpy(buffer,groupmap[rootgroupnum]+i,leng);
+        arraypos[handle] += leng;
+        return leng;
+    }
     if (EDUKE32_PREDICT_TRUE(groupfil[rootgroupnum] != -1))
     {
         i += gfileoffs[groupnum][filenum]+arraypos[handle];
@@ -42,6 +42,11 @@ L_State g_engState;
 
 #include "vfs.h"
 
+#ifdef CLASSIC_THREADS
+# include "thread.h"
+# include <atomic>
+#endif
+
 //////////
 // Compilation switches for optional/extended engine features
 
@@ -145,7 +150,7 @@ float g_videoBrightness = DEFAULT_BRIGHTNESS;
 static char globalpolytype;
 static int16_t **dotp1, **dotp2;
 
-static int8_t tempbuf[MAXWALLS];
+static CLASSIC_TLS int8_t tempbuf[MAXWALLS];
 
 // referenced from asm
 #if !defined(NOASM) && defined __cplusplus
@@ -153,18 +158,18 @@ extern "C" {
 #endif
 int32_t ebpbak, espbak;
 int32_t reciptable[2048], fpuasm;
-intptr_t asm1, asm2, asm3, asm4, palookupoffse[4];
-uint32_t vplce[4];
-int32_t vince[4];
-intptr_t bufplce[4];
-int32_t globaltilesizy;
-int32_t globalx1, globaly2, globalx3, globaly3;
+CLASSIC_TLS intptr_t asm1, asm2, asm3, asm4, palookupoffse[4];
+CLASSIC_TLS uint32_t vplce[4];
+CLASSIC_TLS int32_t vince[4];
+CLASSIC_TLS intptr_t bufplce[4];
+CLASSIC_TLS int32_t globaltilesizy;
+CLASSIC_TLS int32_t globalx1, globaly2, globalx3, globaly3;
 #if !defined(NOASM) && defined __cplusplus
 }
 #endif
 
 int32_t sloptable[16384];
-static intptr_t slopalookup[16384];    // was 2048
+static CLASSIC_TLS intptr_t slopalookup[16384];    // was 2048
 
 static int32_t no_radarang2 = 0;
 static int16_t radarang[1280], *radarang2;
@@ -1336,26 +1341,27 @@ int32_t checksectorpointer(int16_t i, int16_t sectnum)
 
 #undef WALLS_ARE_CONSISTENT
 
-int32_t xb1[MAXWALLSB];  // Polymost uses this as a temp array
-static int32_t yb1[MAXWALLSB], xb2[MAXWALLSB], yb2[MAXWALLSB];
-int32_t rx1[MAXWALLSB], ry1[MAXWALLSB];
-static int32_t rx2[MAXWALLSB], ry2[MAXWALLSB];
-int16_t bunchp2[MAXWALLSB], thesector[MAXWALLSB];
+CLASSIC_TLS int32_t xb1[MAXWALLSB];  // Polymost uses this as a temp array
+static CLASSIC_TLS int32_t yb1[MAXWALLSB], xb2[MAXWALLSB], yb2[MAXWALLSB];
+CLASSIC_TLS int32_t rx1[MAXWALLSB], ry1[MAXWALLSB];
+static CLASSIC_TLS int32_t rx2[MAXWALLSB], ry2[MAXWALLSB];
+CLASSIC_TLS int16_t bunchp2[MAXWALLSB], thesector[MAXWALLSB];
 
-int16_t bunchfirst[MAXWALLSB], bunchlast[MAXWALLSB];
+CLASSIC_TLS int16_t bunchfirst[MAXWALLSB], bunchlast[MAXWALLSB];
 
 static int32_t nodesperline, ysavecnt;
-static int16_t *smost, *umost, *dmost, *bakumost, *bakdmost;
-static int16_t *uplc, *dplc, *uwall, *dwall;
-static int32_t *swplc, *lplc, *swall, *lwall;
+static CLASSIC_TLS int16_t *smost, *umost, *dmost;
+static int16_t *bakumost, *bakdmost;
+static CLASSIC_TLS int16_t *uplc, *dplc, *uwall, *dwall;
+static CLASSIC_TLS int32_t *swplc, *lplc, *swall, *lwall;
 #ifdef HIGH_PRECISION_SPRITE
 static float *swallf;
 #endif
 
-static int32_t smostcnt;
-static int32_t smoststart[MAXWALLSB];
-static char smostwalltype[MAXWALLSB];
-static int32_t smostwall[MAXWALLSB], smostwallcnt = -1;
+static CLASSIC_TLS int32_t smostcnt;
+static CLASSIC_TLS int32_t smoststart[MAXWALLSB];
+static CLASSIC_TLS char smostwalltype[MAXWALLSB];
+static CLASSIC_TLS int32_t smostwall[MAXWALLSB], smostwallcnt = -1;
 
 static vec3_t spritesxyz[MAXSPRITESONSCREEN+1];
 
@@ -1371,15 +1377,18 @@ static int32_t rzi[8], rxi2[8], ryi2[8], rzi2[8];
 static int32_t xsi[8], ysi[8], horizycent;
 static int32_t *horizlookup=0, *horizlookup2=0;
 
-int32_t globalposx, globalposy, globalposz, globalhoriz;
+int32_t globalposx, globalposy, globalposz;
+CLASSIC_TLS int32_t globalhoriz;
 fix16_t qglobalhoriz;
 float fglobalposx, fglobalposy, fglobalposz;
 int16_t globalang, globalcursectnum;
 fix16_t qglobalang;
-int32_t globalpal, cosglobalang, singlobalang;
+CLASSIC_TLS int32_t globalpal;
+int32_t cosglobalang, singlobalang;
 int32_t cosviewingrangeglobalang, sinviewingrangeglobalang;
 static int32_t globaluclip, globaldclip;
-int32_t globvis, globalvisibility;
+CLASSIC_TLS int32_t globvis;
+int32_t globalvisibility;
 int32_t globalhisibility, globalpisibility, globalcisibility;
 #ifdef USE_OPENGL
 int32_t globvis2, globalvisibility2, globalhisibility2, globalpisibility2, globalcisibility2;
@@ -1389,26 +1398,26 @@ int32_t globvis2, globalvisibility2, globalhisibility2, globalpisibility2, globa
 int32_t xyaspect;
 static int32_t viewingrangerecip;
 
-static char globalxshift, globalyshift;
-static int32_t globalxpanning, globalypanning;
-int32_t globalshade, globalorientation;
-int16_t globalpicnum;
-static int16_t globalshiftval;
+static CLASSIC_TLS char globalxshift, globalyshift;
+static CLASSIC_TLS int32_t globalxpanning, globalypanning;
+CLASSIC_TLS int32_t globalshade, globalorientation;
+CLASSIC_TLS int16_t globalpicnum;
+static CLASSIC_TLS int16_t globalshiftval;
 #ifdef HIGH_PRECISION_SPRITE
-static int64_t globalzd;
+static CLASSIC_TLS int64_t globalzd;
 #else
-static int32_t globalzd;
+static CLASSIC_TLS int32_t globalzd;
 #endif
-static int32_t globalyscale;
+static CLASSIC_TLS int32_t globalyscale;
 static int32_t globalxspan, globalyspan, globalispow2=1;  // true if texture has power-of-two x and y size
-static intptr_t globalbufplc;
+static CLASSIC_TLS intptr_t globalbufplc;
 
-static int32_t globaly1, globalx2;
+static CLASSIC_TLS int32_t globaly1, globalx2;
 
-int16_t sectorborder[256];
+CLASSIC_TLS int16_t sectorborder[256];
 int32_t ydim16, qsetmode = 0;
 int16_t pointhighlight=-1, linehighlight=-1, highlightcnt=0;
-static int32_t *lastx;
+static CLASSIC_TLS int32_t *lastx;
 
 int32_t halfxdim16, midydim16;
 
@@ -1427,8 +1436,35 @@ static permfifotype permfifo[MAXPERMS];
 static int32_t permhead = 0, permtail = 0;
 
 EDUKE32_STATIC_ASSERT(MAXWALLSB < INT16_MAX);
-int16_t numscans, numbunches;
-static int16_t numhits;
+CLASSIC_TLS int16_t numscans, numbunches;
+static CLASSIC_TLS int16_t numhits;
+
+// Column strip the current thread draws to and its private gotsector[] (see
+// the multithreaded classic renderer above renderDrawRoomsQ16()).
+static CLASSIC_TLS int32_t classicclipx1 = 0, classicclipx2 = INT32_MAX;
+static CLASSIC_TLS char *classicgotsector = gotsector;
+static CLASSIC_TLS char classicworker;
+
+// PVS row of the sector the view starts in, set once per drawrooms and only
+// when the camera is inside that sector.
+static uint8_t const *classicpvsrow;
+
+static FORCE_INLINE int32_t classicPVSTest(int32_t sectnum)
+{
+    if (!classicpvsrow || (classicpvsrow[sectnum>>3] & pow2char[sectnum&7]))
+        return 1;
+
+    if (!classicworker)
+        pvsrejected[1]++;
+
+    return 0;
+}
+
+#ifdef CLASSIC_THREADS
+static int32_t classicthreading;
+static std::atomic<int32_t> classicmissedtile;
+static void classicStopThreads(void);
+#endif
 
 uint8_t vgapal16[4*256] =
 {
@@ -1656,6 +1692,7 @@ static void classicScanSector(int16_t startsectnum)
 #ifdef YAX_ENABLE
         if (scansector_collectsprites)
 #endif
+        if (!classicworker)
         for (bssize_t i=headspritesect[sectnum]; i>=0; i=nextspritesect[i])
         {
             const uspritetype *const spr = (uspritetype *)&sprite[i];
@@ -1671,7 +1708,7 @@ static void classicScanSector(int16_t startsectnum)
                         break;
         }
 
-        gotsector[sectnum>>3] |= pow2char[sectnum&7];
+        classicgotsector[sectnum>>3] |= pow2char[sectnum&7];
 
         const int32_t onumbunches = numbunches;
         const int32_t onumscans = numscans;
@@ -1702,7 +1739,7 @@ static void classicScanSector(int16_t startsectnum)
 #ifdef YAX_ENABLE
                 if (yax_nomaskpass==0 || !yax_isislandwall(w, !yax_globalcf) || (yax_nomaskdidit=1, 0))
 #endif
-                if ((gotsector[nextsectnum>>3]&pow2char[nextsectnum&7]) == 0)
+                if ((classicgotsector[nextsectnum>>3]&pow2char[nextsectnum&7]) == 0)
                 {
                     // OV: E2L10
                     coord_t temp = (coord_t)x1*y2-(coord_t)x2*y1;
@@ -1711,7 +1748,7 @@ static void classicScanSector(int16_t startsectnum)
                         if (mulscale5(tempint,tempint) <= (x2-x1)*(x2-x1)+(y2-y1)*(y2-y1))
                         {
                             sectorborder[sectorbordercnt++] = nextsectnum;
-                            gotsector[nextsectnum>>3] |= pow2char[nextsectnum&7];
+                            classicgotsector[nextsectnum>>3] |= pow2char[nextsectnum&7];
                         }
                 }
 #endif
@@ -1727,7 +1764,8 @@ static void classicScanSector(int16_t startsectnum)
 
             if (numscans >= MAXWALLSB-1)
             {
-                OSD_Printf("!!numscans\n");
+                if (!classicworker)
+                    OSD_Printf("!!numscans\n");
                 return;
             }
 
@@ -1819,6 +1857,65 @@ void printbunches(void)
 }
 #endif
 
+////////// MULTITHREADED CLASSIC HELPERS //////////
+
+// Workers leave gotpic[], tile loading and the timer to the main thread.
+static FORCE_INLINE void classicSetGotPic(int32_t tilenume)
+{
+    if (!classicworker)
+        setgotpic(tilenume);
+}
+
+static FORCE_INLINE void classicFakeTimerHandler(void)
+{
+    if (!classicworker)
+        faketimerhandler();
+}
+
+// Returns nonzero if the tile isn't cached and can't be loaded right now: the
+// cache must not change under the workers' feet, so a multithreaded frame
+// that misses a tile gets redrawn single-threaded afterwards. With
+// r_tilestream 2, a tile that is still being loaded is drawn as a placeholder.
+static FORCE_INLINE int32_t classicLoadTile(int32_t tilenume)
+{
+    if (waloff[tilenume])
+        return 0;
+#ifdef CLASSIC_THREADS
+    if (classicthreading)
+    {
+        classicmissedtile = 1;
+        return 1;
+    }
+#endif
+    tileLoadNoWait(tilenume, true);
+    return 0;
+}
+
+// Clips the span [*xl, *xr] to the strip of the current thread. The texture
+// coordinates of the end the span is drawn from (stepped by asm1/asm2 per
+// pixel) are moved along with it.
+static FORCE_INLINE int32_t classicClipSpan(int32_t *xl, int32_t *xr, uint32_t *bx, uint32_t *by, int32_t fromright)
+{
+    int32_t const nxl = max(*xl, classicclipx1), nxr = min(*xr, classicclipx2);
+
+    if (nxl > nxr)
+        return 0;
+
+    if (fromright)
+    {
+        uint32_t const d = *xr-nxr;
+        *bx -= d*(uint32_t)asm1; *by -= d*(uint32_t)asm2;
+    }
+    else
+    {
+        uint32_t const d = nxl-*xl;
+        *bx += d*(uint32_t)asm1; *by += d*(uint32_t)asm2;
+    }
+
+    *xl = nxl; *xr = nxr;
+    return 1;
+}
+
 ////////// *WALLSCAN HELPERS //////////
 
 #define WSHELPER_DECL inline //ATTRIBUTE((always_inline))
@@ -1914,7 +2011,8 @@ static void maskwallscan(int32_t x1, int32_t x2, int32_t saturatevplc)
 
     setgotpic(globalpicnum);
 
-    if (waloff[globalpicnum] == 0) tileLoad(globalpicnum);
+    // masked walls and sprites still being loaded are left out
+    if (!tileLoadNoWait(globalpicnum, false)) return;
 
     tweak_tsizes(&tsiz);
 
@@ -2168,15 +2266,17 @@ static inline int32_t bunchfront(int32_t b1, int32_t b2)
 //
 static inline void hline(int32_t xr, int32_t yp)
 {
-    int32_t const xl = lastx[yp];
+    int32_t xl = lastx[yp];
     if (xl > xr) return;
     int32_t const r = horizlookup2[yp-globalhoriz+horizycent];
     asm1 = (inthi_t)globalx1*r;
     asm2 = (inthi_t)globaly2*r;
     int32_t const s = getpalookupsh(mulscale16(r,globvis));
 
-    hlineasm4(xr-xl,0,s,(uint32_t)globalx2*r+globalypanning,(uint32_t)globaly1*r+globalxpanning,
-              ylookup[yp]+xr+frameoffset);
+    uint32_t bx = (uint32_t)globaly1*r+globalxpanning, by = (uint32_t)globalx2*r+globalypanning;
+    if (!classicClipSpan(&xl, &xr, &bx, &by, 1)) return;
+
+    hlineasm4(xr-xl,0,s,by,bx,ylookup[yp]+xr+frameoffset);
 }
 
 
@@ -2185,20 +2285,23 @@ static inline void hline(int32_t xr, int32_t yp)
 //
 static inline void slowhline(int32_t xr, int32_t yp)
 {
-    int32_t const xl = lastx[yp]; if (xl > xr) return;
+    int32_t xl = lastx[yp]; if (xl > xr) return;
     int32_t const r = horizlookup2[yp-globalhoriz+horizycent];
     asm1 = (inthi_t)globalx1*r;
     asm2 = (inthi_t)globaly2*r;
 
     asm3 = (intptr_t)globalpalwritten + getpalookupsh(mulscale16(r,globvis));
+
+    uint32_t bx = (uint32_t)globaly1*r+globalxpanning-asm1*(xr-xl);
+    uint32_t by = (uint32_t)globalx2*r+globalypanning-asm2*(xr-xl);
+    if (!classicClipSpan(&xl, &xr, &bx, &by, 0)) return;
+
     if (!(globalorientation&256))
     {
-        mhline(globalbufplc,(uint32_t)globaly1*r+globalxpanning-asm1*(xr-xl),(xr-xl)<<16,0L,
-               (uint32_t)globalx2*r+globalypanning-asm2*(xr-xl),ylookup[yp]+xl+frameoffset);
+        mhline(globalbufplc,bx,(xr-xl)<<16,0L,by,ylookup[yp]+xl+frameoffset);
         return;
     }
-    thline(globalbufplc,(uint32_t)globaly1*r+globalxpanning-asm1*(xr-xl),(xr-xl)<<16,0L,
-           (uint32_t)globalx2*r+globalypanning-asm2*(xr-xl),ylookup[yp]+xl+frameoffset);
+    thline(globalbufplc,bx,(xr-xl)<<16,0L,by,ylookup[yp]+xl+frameoffset);
 }
 
 
@@ -2628,9 +2731,9 @@ static int32_t setup_globals_cf1(const usectortype *sec, int32_t pal, int32_t zd
     globalpicnum = picnum;
     if ((unsigned)globalpicnum >= MAXTILES) globalpicnum = 0;
     DO_TILE_ANIM(globalpicnum, 0);
-    setgotpic(globalpicnum);
+    classicSetGotPic(globalpicnum);
     if ((tilesiz[globalpicnum].x <= 0) || (tilesiz[globalpicnum].y <= 0)) return 1;
-    if (waloff[globalpicnum] == 0) tileLoad(globalpicnum);
+    if (classicLoadTile(globalpicnum)) return 1;
 
     globalbufplc = waloff[globalpicnum];
 
@@ -2743,7 +2846,7 @@ static void ceilscan(int32_t x1, int32_t x2, int32_t sectnum)
             globalx2 += globaly2; globaly1 += globalx1;
         }
         while (y1 < y2-1) hline(x2,++y1);
-        faketimerhandler();
+        classicFakeTimerHandler();
         return;
     }
 
@@ -2792,7 +2895,7 @@ static void ceilscan(int32_t x1, int32_t x2, int32_t sectnum)
         globalx2 += globaly2; globaly1 += globalx1;
     }
     while (y1 < y2-1) slowhline(x2,++y1);
-    faketimerhandler();
+    classicFakeTimerHandler();
 }
 
 
@@ -2841,7 +2944,7 @@ static void florscan(int32_t x1, int32_t x2, int32_t sectnum)
             globalx2 += globaly2; globaly1 += globalx1;
         }
         while (y1 < y2-1) hline(x2,++y1);
-        faketimerhandler();
+        classicFakeTimerHandler();
         return;
     }
 
@@ -2890,7 +2993,7 @@ static void florscan(int32_t x1, int32_t x2, int32_t sectnum)
         globalx2 += globaly2; globaly1 += globalx1;
     }
     while (y1 < y2-1) slowhline(x2,++y1);
-    faketimerhandler();
+    classicFakeTimerHandler();
 }
 
 
@@ -2915,7 +3018,7 @@ static void wallscan(int32_t x1, int32_t x2,
     if (g_nodraw)
         return;
 #endif
-    setgotpic(globalpicnum);
+    classicSetGotPic(globalpicnum);
     if (globalshiftval < 0)
         return;
 
@@ -2929,7 +3032,7 @@ static void wallscan(int32_t x1, int32_t x2,
     if ((uwal[x1] > ydimen) && (uwal[x2] > ydimen)) return;
     if ((dwal[x1] < 0) && (dwal[x2] < 0)) return;
 
-    if (waloff[globalpicnum] == 0) tileLoad(globalpicnum);
+    if (classicLoadTile(globalpicnum)) return;
 
     tweak_tsizes(&tsiz);
 
@@ -2937,6 +3040,8 @@ static void wallscan(int32_t x1, int32_t x2,
 
     setupvlineasm(globalshiftval);
 
+    x1 = max(x1, classicclipx1);
+    x2 = min(x2, classicclipx2);
 
     x = x1;
     while ((x <= x2) && (umost[x] > dmost[x]))
@@ -3038,7 +3143,7 @@ do_vlineasm1:
         vlineasm1(vince[0],palookupoffse[0],y2ve[0]-y1ve[0]-1,vplce[0],bufplce[0],x+frameoffset+ylookup[y1ve[0]]);
     }
 
-    faketimerhandler();
+    classicFakeTimerHandler();
 }
 
 //
@@ -3150,7 +3255,7 @@ static void transmaskwallscan(int32_t x1, int32_t x2, int32_t saturatevplc)
     if ((tilesiz[globalpicnum].x <= 0) || (tilesiz[globalpicnum].y <= 0))
         return;
 
-    if (waloff[globalpicnum] == 0) tileLoad(globalpicnum);
+    if (!tileLoadNoWait(globalpicnum, false)) return;
 
     setuptvlineasm(globalshiftval, saturatevplc);
 
@@ -3331,11 +3436,11 @@ static void ceilspritescan(int32_t x1, int32_t x2)
 }
 
 ////////// translucent slope vline, based on a-c.c's slopevlin //////////
-static int32_t gglogx, gglogy, ggpinc;
-static char *ggbuf, *ggpal;
+static CLASSIC_TLS int32_t gglogx, gglogy, ggpinc;
+static CLASSIC_TLS char *ggbuf, *ggpal;
 
 #ifdef ENGINE_USING_A_C
-extern int32_t gpinc;
+extern CLASSIC_TLS int32_t gpinc;
 #endif
 
 static inline void setupslopevlin_alsotrans(int32_t logylogx, intptr_t bufplc, int32_t pinc)
@@ -3449,9 +3554,9 @@ static void grouscan(int32_t dax1, int32_t dax2, int32_t sectnum, char dastat)
     }
 
     DO_TILE_ANIM(globalpicnum, sectnum);
-    setgotpic(globalpicnum);
+    classicSetGotPic(globalpicnum);
     if ((tilesiz[globalpicnum].x <= 0) || (tilesiz[globalpicnum].y <= 0)) return;
-    if (waloff[globalpicnum] == 0) tileLoad(globalpicnum);
+    if (classicLoadTile(globalpicnum)) return;
 
     wal = (uwalltype *)&wall[sec->wallptr];
     wx = wall[wal->point2].x - wal->x;
@@ -3572,6 +3677,7 @@ static void grouscan(int32_t dax1, int32_t dax2, int32_t sectnum, char dastat)
             globalx3 = (globalx2>>10);
             globaly3 = (globaly2>>10);
             asm3 = mulscale16(y2,globalzd) + (globalzx>>6);
+            if (x >= classicclipx1 && x <= classicclipx2)
             switch (globalorientation&0x180)
             {
             case 0:
@@ -3586,7 +3692,7 @@ static void grouscan(int32_t dax1, int32_t dax2, int32_t sectnum, char dastat)
                 break;
             }
 
-            if ((x&15) == 0) faketimerhandler();
+            if ((x&15) == 0) classicFakeTimerHandler();
         }
         globalx2 += globalx;
         globaly2 += globaly;
@@ -3638,7 +3744,7 @@ static void parascan(char dastat, int32_t bunch)
 
     if ((unsigned)globalpicnum >= MAXTILES) globalpicnum = 0;
     DO_TILE_ANIM(globalpicnum, sectnum);
-    setgotpic(globalpicnum);
+    classicSetGotPic(globalpicnum);
 
     logtilesizy = (picsiz[globalpicnum]>>4);
     tsizy = tilesiz[globalpicnum].y;
@@ -4263,7 +4369,7 @@ static void classicDrawBunches(int32_t bunch)
             if (numhits < 0)
                 return;
 
-            if (!(wal->cstat&32) && (gotsector[nextsectnum>>3]&pow2char[nextsectnum&7]) == 0)
+            if (!(wal->cstat&32) && (classicgotsector[nextsectnum>>3]&pow2char[nextsectnum&7]) == 0 && classicPVSTest(nextsectnum))
             {
                 if (umost[x2] < dmost[x2])
                     classicScanSector(nextsectnum);
@@ -5614,7 +5720,7 @@ draw_as_face_sprite:
         globalpicnum = tilenum;
         if ((unsigned)globalpicnum >= (unsigned)MAXTILES) globalpicnum = 0;
 
-        if (waloff[globalpicnum] == 0) tileLoad(globalpicnum);
+        if (!tileLoadNoWait(globalpicnum, false)) return;
         setgotpic(globalpicnum);
         globalbufplc = waloff[globalpicnum];
 
@@ -7254,6 +7360,220 @@ static int32_t engineLoadTables(void)
 # define LISTFN_STATIC
 #endif
 
+///// sprite position grid /////
+
+// Sprites that are in a sector list are also linked into one of
+// SPRITEGRID_BUCKETS lists, hashed from the SPRITEGRID_CELLSHIFT cell of their
+// position when they were last inserted, moved by setsprite() or refreshed.
+// Queries look SPRITEGRID_SLACK further than asked so that sprites whose
+// position was written directly since then are still found.
+#define SPRITEGRID_CELLSHIFT 11
+#define SPRITEGRID_BUCKETS 4096
+#define SPRITEGRID_SLACK 1024
+
+int32_t spritegrid = 1;
+
+static int16_t headspritecell[SPRITEGRID_BUCKETS];
+static int16_t prevspritecell[MAXSPRITES], nextspritecell[MAXSPRITES];
+static int16_t spritecell[MAXSPRITES];
+static uint32_t spritecellstamp[SPRITEGRID_BUCKETS], spritegridstamp;
+
+static FORCE_INLINE int32_t spriteGridBucket(int32_t cx, int32_t cy)
+{
+    return ((uint32_t)cx * 73856093u ^ (uint32_t)cy * 19349663u) & (SPRITEGRID_BUCKETS-1);
+}
+
+static FORCE_INLINE int32_t spriteGridBucketOf(int16_t spritenum)
+{
+    return spriteGridBucket(sprite[spritenum].x >> SPRITEGRID_CELLSHIFT, sprite[spritenum].y >> SPRITEGRID_CELLSHIFT);
+}
+
+static void spriteGridLink(int16_t spritenum, int32_t bucket)
+{
+    int16_t const ohead = headspritecell[bucket];
+
+    prevspritecell[spritenum] = -1;
+    nextspritecell[spritenum] = ohead;
+    if (ohead >= 0)
+        prevspritecell[ohead] = spritenum;
+    headspritecell[bucket] = spritenum;
+
+    spritecell[spritenum] = bucket;
+}
+
+static void spriteGridUnlink(int16_t spritenum)
+{
+    int32_t const bucket = spritecell[spritenum];
+
+    if (bucket < 0)
+        return;
+
+    int32_t const prev = prevspritecell[spritenum];
+    int32_t const next = nextspritecell[spritenum];
+
+    if (headspritecell[bucket] == spritenum)
+        headspritecell[bucket] = next;
+    if (prev >= 0)
+        nextspritecell[prev] = next;
+    if (next >= 0)
+        prevspritecell[next] = prev;
+
+    spritecell[spritenum] = -1;
+}
+
+static void spriteGridClear(void)
+{
+    Bmemset(headspritecell, -1, sizeof(headspritecell));
+    Bmemset(spritecell, -1, sizeof(spritecell));
+    Bmemset(spritecellstamp, 0, sizeof(spritecellstamp));
+    spritegridstamp = 0;
+}
+
+void spriteGridUpdate(int16_t spritenum)
+{
+    spritechangecnt++;
+
+    if (spritecell[spritenum] < 0)
+        return;
+
+    int32_t const bucket = spriteGridBucketOf(spritenum);
+
+    if (bucket != spritecell[spritenum])
+    {
+        spriteGridUnlink(spritenum);
+        spriteGridLink(spritenum, bucket);
+    }
+}
+
+void spriteGridRefresh(void)
+{
+    for (bssize_t stat=0; stat<MAXSTATUS; stat++)
+        for (bssize_t SPRITES_OF(stat, i))
+            spriteGridUpdate(i);
+}
+
+void spriteGridRebuild(void)
+{
+    spriteGridClear();
+    spritestatordercnt = 0;
+
+    for (bssize_t stat=0; stat<MAXSTATUS; stat++)
+    {
+        int32_t cnt = 0;
+
+        for (bssize_t SPRITES_OF(stat, i))
+            cnt++;
+
+        // List heads are the most recently inserted sprites.
+        uint32_t order = spritestatordercnt + cnt;
+        spritestatordercnt = order;
+
+        for (bssize_t SPRITES_OF(stat, i))
+        {
+            spritestatorder[i] = order--;
+            spriteGridLink(i, spriteGridBucketOf(i));
+        }
+    }
+}
+
+int32_t spriteGridQuery(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int16_t *spritelist)
+{
+    if (x1 > x2 || y1 > y2)
+        return 0;
+
+    int64_t const cx1 = ((int64_t)x1 - SPRITEGRID_SLACK) >> SPRITEGRID_CELLSHIFT;
+    int64_t const cy1 = ((int64_t)y1 - SPRITEGRID_SLACK) >> SPRITEGRID_CELLSHIFT;
+    int64_t const cx2 = ((int64_t)x2 + SPRITEGRID_SLACK) >> SPRITEGRID_CELLSHIFT;
+    int64_t const cy2 = ((int64_t)y2 + SPRITEGRID_SLACK) >> SPRITEGRID_CELLSHIFT;
+
+    int32_t cnt = 0;
+
+    if ((cx2-cx1+1) * (cy2-cy1+1) >= SPRITEGRID_BUCKETS)
+    {
+        for (bssize_t b=0; b<SPRITEGRID_BUCKETS; b++)
+            for (bssize_t i=headspritecell[b]; i>=0; i=nextspritecell[i])
+                if (sprite[i].x >= x1 && sprite[i].x <= x2 && sprite[i].y >= y1 && sprite[i].y <= y2)
+                    spritelist[cnt++] = i;
+
+        return cnt;
+    }
+
+    // Different cells can share a bucket; each bucket is walked once.
+    if (++spritegridstamp == 0)
+    {
+        Bmemset(spritecellstamp, 0, sizeof(spritecellstamp));
+        spritegridstamp = 1;
+    }
+
+    for (int64_t cy=cy1; cy<=cy2; cy++)
+        for (int64_t cx=cx1; cx<=cx2; cx++)
+        {
+            int32_t const b = spriteGridBucket((int32_t)cx, (int32_t)cy);
+
+            if (spritecellstamp[b] == spritegridstamp)
+                continue;
+
+            spritecellstamp[b] = spritegridstamp;
+
+            for (bssize_t i=headspritecell[b]; i>=0; i=nextspritecell[i])
+                if (sprite[i].x >= x1 && sprite[i].x <= x2 && sprite[i].y >= y1 && sprite[i].y <= y2)
+                    spritelist[cnt++] = i;
+        }
+
+    return cnt;
+}
+
+// Times spriteGridQuery() against walking every status list, with a query of
+// the given radius around each sprite in the world.
+void spriteGridBenchmark(int32_t radius)
+{
+    static int16_t spritelist[MAXSPRITES];
+    int64_t const r2 = (int64_t)radius * radius;
+    int32_t numqueries = 0, scanfound = 0, gridfound = 0;
+
+    spriteGridRefresh();
+
+    double const t0 = timerGetHiTicks();
+
+    for (bssize_t stat=0; stat<MAXSTATUS; stat++)
+        for (bssize_t SPRITES_OF(stat, s))
+        {
+            for (bssize_t stat2=0; stat2<MAXSTATUS; stat2++)
+                for (bssize_t SPRITES_OF(stat2, i))
+                {
+                    int64_t const dx = sprite[i].x - sprite[s].x, dy = sprite[i].y - sprite[s].y;
+                    scanfound += (dx*dx + dy*dy < r2);
+                }
+
+            numqueries++;
+        }
+
+    double const t1 = timerGetHiTicks();
+
+    for (bssize_t stat=0; stat<MAXSTATUS; stat++)
+        for (bssize_t SPRITES_OF(stat, s))
+        {
+            int32_t const cnt = spriteGridQuery(sprite[s].x - radius, sprite[s].y - radius,
+                                                sprite[s].x + radius, sprite[s].y + radius, spritelist);
+
+            for (bssize_t j=0; j<cnt; j++)
+            {
+                int64_t const dx = sprite[spritelist[j]].x - sprite[s].x, dy = sprite[spritelist[j]].y - sprite[s].y;
+                gridfound += (dx*dx + dy*dy < r2);
+            }
+        }
+
+    double const t2 = timerGetHiTicks();
+
+    OSD_Printf("%d queries of radius %d over %d sprites: status lists %.2f ms, grid %.2f ms\n",
+               numqueries, radius, Numsprites, t1-t0, t2-t1);
+
+    if (scanfound != gridfound)
+        OSD_Printf("Grid found %d sprites, status lists found %d!\n", gridfound, scanfound);
+    else
+        OSD_Printf("Both found %d sprites.\n", gridfound);
+}
+
 ///// sector lists of sprites /////
 
 // insert sprite at the head of sector list, change .sectnum
@@ -7268,6 +7588,9 @@ LISTFN_STATIC void do_insertsprite_at_headofsect(int16_t spritenum, int16_t sect
     headspritesect[sectnum] = spritenum;
 
     sprite[spritenum].sectnum = sectnum;
+
+    spriteGridUnlink(spritenum);
+    spriteGridLink(spritenum, spriteGridBucketOf(spritenum));
 }
 
 // remove sprite 'deleteme' from its sector list
@@ -7283,6 +7606,8 @@ LISTFN_STATIC void do_deletespritesect(int16_t deleteme)
         nextspritesect[prev] = next;
     if (next >= 0)
         prevspritesect[next] = prev;
+
+    spriteGridUnlink(deleteme);
 }
 
 ///// now, status lists /////
@@ -7299,6 +7624,8 @@ LISTFN_STATIC void do_insertsprite_at_headofstat(int16_t spritenum, int16_t stat
     headspritestat[statnum] = spritenum;
 
     sprite[spritenum].statnum = statnum;
+    spritestatorder[spritenum] = ++spritestatordercnt;
+    spritechangecnt++;
 }
 
 // insertspritestat (internal)
@@ -7335,6 +7662,8 @@ LISTFN_STATIC void do_deletespritestat(int16_t deleteme)
         nextspritestat[prev] = next;
     if (next >= 0)
         prevspritestat[next] = prev;
+
+    spritechangecnt++;
 }
 
 
@@ -7400,6 +7729,9 @@ int32_t changespritesect(int16_t spritenum, int16_t newsectnum)
     if ((newsectnum < 0 || newsectnum > MAXSECTORS) || (sprite[spritenum].sectnum == MAXSECTORS))
         return -1;
 
+    // callers such as the transporters write x/y directly before moving the sprite here
+    spriteGridUpdate(spritenum);
+
     if (sprite[spritenum].sectnum == newsectnum)
         return 0;
 
@@ -7638,6 +7970,10 @@ int32_t enginePreInit(void)
     initdivtables();
     if (initsystem()) Bexit(9);
     makeasmwriteable();
+    spriteGridClear();
+#ifdef CLASSIC_SIMD
+    setsimdlevel(r_classicsimd);
+#endif
 
 #ifdef DYNALLOC_ARRAYS
     {
@@ -7825,6 +8161,10 @@ int32_t enginePostInit(void)
 //
 void engineUnInit(void)
 {
+#ifdef CLASSIC_THREADS
+    classicStopThreads();
+#endif
+
 #ifdef USE_OPENGL
     polymost_glreset();
     hicinit();
@@ -7928,6 +8268,9 @@ void initspritelists(void)
 
     tailspritefree = MAXSPRITES-1;
     Numsprites = 0;
+
+    spriteGridClear();
+    spritestatordercnt = 0;
 }
 
 
@@ -7951,19 +8294,361 @@ void set_globalang(fix16_t ang)
     sinviewingrangeglobalang = mulscale16(singlobalang,viewingrange);
 }
 
+#define YSAVES ((xdim*MAXSPRITES)>>7)
+
+// (Re)allocates the per-pass buffers of the calling thread for the current
+// video mode, or just frees them.
+static void classicAllocatePassBuffers(int32_t dofree)
+{
+    // Needed for the game's TILT_SETVIEWTOTILE_320.
+    const int32_t clamped_ydim = max(ydim, 320);
+
+    struct
+    {
+        void **ptr;
+        size_t size;
+    } dynarray[] = {
+          { (void **)&smost, YSAVES * sizeof(int16_t) },
+          { (void **)&umost, xdim * sizeof(int16_t) },
+          { (void **)&dmost, xdim * sizeof(int16_t) },
+          { (void **)&uplc, xdim * sizeof(int16_t) },
+          { (void **)&dplc, xdim * sizeof(int16_t) },
+          { (void **)&uwall, xdim * sizeof(int16_t) },
+          { (void **)&dwall, xdim * sizeof(int16_t) },
+          { (void **)&swplc, xdim * sizeof(int32_t) },
+          { (void **)&lplc, xdim * sizeof(int32_t) },
+          { (void **)&swall, xdim * sizeof(int32_t) },
+          { (void **)&lwall, (xdim + 4) * sizeof(int32_t) },
+          { (void **)&lastx, clamped_ydim * sizeof(int32_t) },
+      };
+
+    for (auto &i : dynarray)
+    {
+        Baligned_free(*i.ptr);
+
+        *i.ptr = dofree ? NULL : Xaligned_alloc(16, i.size);
+    }
+}
+
+static void classicResetMost(void)
+{
+    int16_t const *const shortptr1 = (int16_t *)&startumost[windowxy1.x];
+    int16_t const *const shortptr2 = (int16_t *)&startdmost[windowxy1.x];
+    int32_t i = xdimen-1;
+
+    do
+    {
+        umost[i] = shortptr1[i]-windowxy1.y;
+        dmost[i] = shortptr2[i]-windowxy1.y;
+    }
+    while (i--);  // xdimen == 1 is OK!
+    umost[0] = shortptr1[0]-windowxy1.y;
+    dmost[0] = shortptr2[0]-windowxy1.y;
+}
+
+// Draws the collected bunches front to back until the screen is covered.
+static void classicDrawAllBunches(void)
+{
+    int32_t i, j, closest;
+
+    while ((numbunches > 0) && (numhits > 0))
+    {
+        Bmemset(tempbuf, 0, numbunches);
+        tempbuf[0] = 1;
+
+        closest = 0;              //Almost works, but not quite :(
+        for (i=1; i<numbunches; i++)
+        {
+            if ((j = bunchfront(i,closest)) < 0) continue;
+            tempbuf[i] = 1;
+            if (j == 0) tempbuf[closest] = 1, closest = i;
+        }
+        for (i=0; i<numbunches; i++) //Double-check
+        {
+            if (tempbuf[i]) continue;
+            if ((j = bunchfront(i,closest)) < 0) continue;
+            tempbuf[i] = 1;
+            if (j == 0) tempbuf[closest] = 1, closest = i, i = 0;
+        }
+
+        classicDrawBunches(closest);
+
+        numbunches--;
+        bunchfirst[closest] = bunchfirst[numbunches];
+        bunchlast[closest] = bunchlast[numbunches];
+    }
+}
+
+#ifdef CLASSIC_THREADS
+//
+// Multithreaded classic renderer
+//
+// Every thread replays the whole scan/bunch pass of the frame with its own
+// copy of the per-pass state (see CLASSIC_TLS) but only writes the pixels of
+// its own strip of columns. Since the state evolves the same way everywhere,
+// the image is identical to the single-threaded one and the main thread's
+// state is still valid for drawmasks afterwards.
+//
+int32_t r_classicthreads = 1;  // cvar: 0 for one per CPU
+
+#define MAXCLASSICTHREADS 16
+
+typedef struct
+{
+    thread_t thread;
+    semaphore_t start;
+    int32_t x1, x2;
+    double ms;
+    char quit;
+} classicthread_t;
+
+static classicthread_t classicthread[MAXCLASSICTHREADS];
+static int32_t classicnumthreads = 1, classicwantthreads = 1;
+static semaphore_t classicdone;
+static double classicstarttime;
+static int32_t classicframecnt, classicredrawcnt;
+
+// State of the main thread the workers start their pass with.
+static struct
+{
+    char *palwritten;
+    int32_t horiz, pal, blend, orientation, shade, vis;
+    int16_t picnum;
+} classicframe;
+
+static CLASSIC_TLS int32_t classicbufxdim, classicbufydim;
+
+//
+// Replays the scan and bunch pass of the current frame.
+//
+static void classicDrawRoomsPass(void)
+{
+    Bmemset(classicgotsector, 0, ((numsectors+7)>>3));
+    classicResetMost();
+
+    numhits = xdimen; numscans = 0; numbunches = 0;
+    maskwallcnt = 0; smostwallcnt = 0; smostcnt = 0;
+    if (!classicworker)
+        spritesortcnt = 0;
+
+    classicScanSector(globalcursectnum);
+    classicDrawAllBunches();
+}
+
+static int32_t classicWorkerThread(void *arg)
+{
+    classicthread_t *const t = (classicthread_t *)arg;
+
+    classicworker = 1;
+    classicgotsector = (char *)Xmalloc(sizeof(gotsector));
+
+    while (!semaphore_wait(&t->start) && !t->quit)
+    {
+        double const starttime = timerGetHiTicks();
+
+        if (classicbufxdim != xdim || classicbufydim != ydim)
+        {
+            classicAllocatePassBuffers(0);
+            classicbufxdim = xdim;
+            classicbufydim = ydim;
+        }
+
+        globalpalwritten = classicframe.palwritten;
+        setpalookupaddress(globalpalwritten);
+        globalblend = classicframe.blend;
+        fixtransluscence(FP_OFF(paletteGetBlendTable(globalblend)));
+
+        globalhoriz = classicframe.horiz;
+        globalpal = classicframe.pal;
+        globalorientation = classicframe.orientation;
+        globalshade = classicframe.shade;
+        globalpicnum = classicframe.picnum;
+        globvis = classicframe.vis;
+
+        classicclipx1 = t->x1;
+        classicclipx2 = t->x2;
+
+        classicDrawRoomsPass();
+
+        t->ms = timerGetHiTicks() - starttime;
+        semaphore_post(&classicdone);
+    }
+
+    classicAllocatePassBuffers(1);
+    DO_FREE_AND_NULL(classicgotsector);
+
+    return 0;
+}
+
+static void classicStopThreads(void)
+{
+    if (classicnumthreads <= 1)
+        return;
+
+    for (bssize_t i=1; i<classicnumthreads; i++)
+    {
+        classicthread[i].quit = 1;
+        semaphore_post(&classicthread[i].start);
+        thread_join(&classicthread[i].thread);
+        semaphore_destroy(&classicthread[i].start);
+    }
+
+    semaphore_destroy(&classicdone);
+    classicnumthreads = 1;
+}
+
+static void classicStartThreads(int32_t numthreads)
+{
+    classicStopThreads();
+    classicwantthreads = numthreads;
+
+    if (numthreads <= 1 || semaphore_init(&classicdone, 0))
+        return;
+
+    for (bssize_t i=1; i<numthreads; i++)
+    {
+        classicthread_t *const t = &classicthread[i];
+
+        t->quit = 0;
+        t->ms = 0.0;
+
+        if (semaphore_init(&t->start, 0))
+            break;
+
+        if (thread_create(&t->thread, classicWorkerThread, t, "classic renderer"))
+        {
+            semaphore_destroy(&t->start);
+            break;
+        }
+
+        classicnumthreads++;
+    }
+
+    if (classicnumthreads <= 1)
+    {
+        semaphore_destroy(&classicdone);
+        OSD_Printf("Failed creating classic renderer threads!\n");
+    }
+}
+
+//
+// Splits the frame between the threads and starts the workers. Returns
+// nonzero if the frame is drawn multithreaded: the main thread then draws
+// the first strip itself and calls classicJoinThreads() afterwards.
+//
+static int32_t classicDispatchThreads(void)
+{
+    int32_t numthreads = r_classicthreads ? r_classicthreads : thread_getcpucount();
+
+    numthreads = clamp(numthreads, 1, MAXCLASSICTHREADS);
+
+    if (numthreads != classicwantthreads)
+        classicStartThreads(numthreads);
+
+    // mirrors, TROR and editor picking need the single-threaded pass
+    if (classicnumthreads <= 1 || xdimen < (classicnumthreads<<5) || inpreparemirror || searchit == 2
+#ifdef YAX_ENABLE
+        || numyaxbunches > 0 || yax_globallev != YAX_MAXDRAWS
+#endif
+        )
+        return 0;
+
+    classicstarttime = timerGetHiTicks();
+
+    for (bssize_t i=0, x1=0; i<classicnumthreads; i++)
+    {
+        int32_t x2 = xdimen-1;
+
+        if (i < classicnumthreads-1)
+        {
+            // keep the 4-column groups of wallscan() inside one strip
+            x2 = scale(i+1, xdimen, classicnumthreads);
+            x2 -= (int32_t)((x2+frameoffset)&3) + 1;
+        }
+
+        classicthread[i].x1 = x1;
+        classicthread[i].x2 = x2;
+        x1 = x2+1;
+    }
+
+    classicframe.palwritten = globalpalwritten;
+    classicframe.horiz = globalhoriz;
+    classicframe.pal = globalpal;
+    classicframe.blend = globalblend;
+    classicframe.orientation = globalorientation;
+    classicframe.shade = globalshade;
+    classicframe.picnum = globalpicnum;
+    classicframe.vis = globvis;
+
+    classicmissedtile = 0;
+    classicthreading = 1;
+
+    for (bssize_t i=1; i<classicnumthreads; i++)
+        semaphore_post(&classicthread[i].start);
+
+    classicclipx1 = classicthread[0].x1;
+    classicclipx2 = classicthread[0].x2;
+
+    return 1;
+}
+
+static void classicJoinThreads(void)
+{
+    classicthread[0].ms = timerGetHiTicks() - classicstarttime;
+
+    for (bssize_t i=1; i<classicnumthreads; i++)
+        semaphore_wait(&classicdone);
+
+    classicthreading = 0;
+    classicclipx1 = 0;
+    classicclipx2 = INT32_MAX;
+    classicframecnt++;
+
+    if (classicmissedtile)
+    {
+        // Some thread hit an uncached tile: draw the frame again with
+        // loading allowed.
+        classicredrawcnt++;
+        classicDrawRoomsPass();
+    }
+}
+
+void renderPrintClassicThreadStats(void)
+{
+    if (classicnumthreads <= 1)
+    {
+        OSD_Printf("Classic renderer is single-threaded (r_classicthreads %d).\n", r_classicthreads);
+        return;
+    }
+
+    OSD_Printf("Classic renderer: %d threads, %d of %d frames redrawn single-threaded\n",
+               classicnumthreads, classicredrawcnt, classicframecnt);
+
+    for (bssize_t i=0; i<classicnumthreads; i++)
+        OSD_Printf("  thread %d: columns %d-%d, %.3f ms\n", (int)i,
+                   classicthread[i].x1, classicthread[i].x2, classicthread[i].ms);
+}
+#endif
+
+// Cumulative time spent in renderDrawRoomsQ16() and renderDrawMasks(), in ms.
+// Callers sample the counters around a frame to split its cost by phase.
+renderstats_t renderstats;
+
 //
 // drawrooms
 //
-int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
-                           fix16_t daang, fix16_t dahoriz, int16_t dacursectnum)
+static int32_t renderDrawRoomsInternal(int32_t daposx, int32_t daposy, int32_t daposz,
+                                       fix16_t daang, fix16_t dahoriz, int16_t dacursectnum)
 {
-    int32_t i, j, /*cz, fz,*/ closest;
-    int16_t *shortptr1, *shortptr2;
+    int32_t i, j /*, cz, fz*/;
 
     int32_t didmirror = 0;
 
     beforedrawrooms = 0;
 
+    // hand over the tiles the loader thread has read since the last frame
+    tileStreamUpdate();
+
     set_globalpos(daposx, daposy, daposz);
     set_globalang(daang);
 
@@ -8033,19 +8718,7 @@ int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
         || yax_globallev==YAX_MAXDRAWS
 #endif
         )
-    {
-        shortptr1 = (int16_t *)&startumost[windowxy1.x];
-        shortptr2 = (int16_t *)&startdmost[windowxy1.x];
-        i = xdimen-1;
-        do
-        {
-            umost[i] = shortptr1[i]-windowxy1.y;
-            dmost[i] = shortptr2[i]-windowxy1.y;
-        }
-        while (i--);  // xdimen == 1 is OK!
-        umost[0] = shortptr1[0]-windowxy1.y;
-        dmost[0] = shortptr2[0]-windowxy1.y;
-    }
+        classicResetMost();
 
     for (int i = 0; i < numwalls; ++i)
     {
@@ -8131,6 +8804,14 @@ int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
 
     frameoffset = frameplace + windowxy1.y*bytesperline + windowxy1.x;
 
+    classicpvsrow = pvsGetRow(globalcursectnum);
+    if (classicpvsrow && (editstatus || inside(globalposx, globalposy, globalcursectnum) != 1))
+        classicpvsrow = NULL;
+
+#ifdef CLASSIC_THREADS
+    int32_t const threaded = classicDispatchThreads();
+#endif
+
     //if (smostwallcnt < 0)
     //  if (getkensmessagecrc(FP_OFF(kensmessage)) != 0x56c764d4)
     //      { /* setvmode(0x3);*/ OSD_Printf("Nice try.\n"); Bexit(0); }
@@ -8204,34 +8885,27 @@ int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
         mirrorsy2 = max(dmost[mirrorsx1],dmost[mirrorsx2]);
     }
 
-    while ((numbunches > 0) && (numhits > 0))
-    {
-        Bmemset(tempbuf, 0, numbunches);
-        tempbuf[0] = 1;
+    classicDrawAllBunches();
 
-        closest = 0;              //Almost works, but not quite :(
-        for (i=1; i<numbunches; i++)
-        {
-            if ((j = bunchfront(i,closest)) < 0) continue;
-            tempbuf[i] = 1;
-            if (j == 0) tempbuf[closest] = 1, closest = i;
-        }
-        for (i=0; i<numbunches; i++) //Double-check
-        {
-            if (tempbuf[i]) continue;
-            if ((j = bunchfront(i,closest)) < 0) continue;
-            tempbuf[i] = 1;
-            if (j == 0) tempbuf[closest] = 1, closest = i, i = 0;
-        }
+#ifdef CLASSIC_THREADS
+    if (threaded)
+        classicJoinThreads();
+#endif
 
-        classicDrawBunches(closest);
+    videoEndDrawing();   //}}}
 
-        numbunches--;
-        bunchfirst[closest] = bunchfirst[numbunches];
-        bunchlast[closest] = bunchlast[numbunches];
-    }
+    return didmirror;
+}
 
-    videoEndDrawing();   //}}}
+int32_t renderDrawRoomsQ16(int32_t daposx, int32_t daposy, int32_t daposz,
+                           fix16_t daang, fix16_t dahoriz, int16_t dacursectnum)
+{
+    double const starttime = timerGetHiTicks();
+    int32_t const didmirror = renderDrawRoomsInternal(daposx, daposy, daposz, daang, dahoriz, dacursectnum);
+
+    tileStreamClearPlaceholders();
+
+    renderstats.drawrooms += timerGetHiTicks() - starttime;
 
     return didmirror;
 }
@@ -8375,6 +9049,8 @@ int32_t g_maskDrawMode = 0;
 //
 void renderDrawMasks(void)
 {
+    double const starttime = timerGetHiTicks();
+
 #ifdef DEBUG_MASK_DRAWING
         static struct {
             int16_t di;  // &32768: &32767 is tspriteptr[], else thewall[] index
@@ -8717,6 +9393,8 @@ killsprite:
 #endif
 
     videoEndDrawing();   //}}}
+
+    renderstats.drawmasks += timerGetHiTicks() - starttime;
 }
 
 //
@@ -9035,6 +9713,7 @@ static FORCE_INLINE int32_t have_maptext(void)
 static void enginePrepareLoadBoard(buildvfs_kfd fil, vec3_t *dapos, int16_t *daang, int16_t *dacursectnum)
 {
     initspritelists();
+    pvsInvalidate();
 
     Bmemset(show2dsector, 0, sizeof(show2dsector));
     Bmemset(show2dsprite, 0, sizeof(show2dsprite));
@@ -9835,8 +10514,6 @@ int32_t saveboard(const char *filename, const vec3_t *dapos, int16_t daang, int1
     return -1;
 }
 
-#define YSAVES ((xdim*MAXSPRITES)>>7)
-
 static void videoAllocateBuffers(void)
 {
     int32_t i;
@@ -9848,25 +10525,13 @@ static void videoAllocateBuffers(void)
         void **ptr;
         size_t size;
     } dynarray[] = {
-          { (void **)&smost, YSAVES * sizeof(int16_t) },
-          { (void **)&umost, xdim * sizeof(int16_t) },
-          { (void **)&dmost, xdim * sizeof(int16_t) },
           { (void **)&startumost, xdim * sizeof(int16_t) },
           { (void **)&startdmost, xdim * sizeof(int16_t) },
           { (void **)&bakumost, xdim * sizeof(int16_t) },
           { (void **)&bakdmost, xdim * sizeof(int16_t) },
-          { (void **)&uplc, xdim * sizeof(int16_t) },
-          { (void **)&dplc, xdim * sizeof(int16_t) },
-          { (void **)&uwall, xdim * sizeof(int16_t) },
-          { (void **)&dwall, xdim * sizeof(int16_t) },
-          { (void **)&swplc, xdim * sizeof(int32_t) },
-          { (void **)&lplc, xdim * sizeof(int32_t) },
-          { (void **)&swall, xdim * sizeof(int32_t) },
-          { (void **)&lwall, (xdim + 4) * sizeof(int32_t) },
           { (void **)&radarang2, xdim * sizeof(int16_t) },
           { (void **)&dotp1, clamped_ydim * sizeof(intptr_t) },
           { (void **)&dotp2, clamped_ydim * sizeof(intptr_t) },
-          { (void **)&lastx, clamped_ydim * sizeof(int32_t) },
       };
 
     for (i = 0; i < (signed)ARRAY_SIZE(dynarray); i++)
@@ -9876,6 +10541,8 @@ static void videoAllocateBuffers(void)
         *dynarray[i].ptr = Xaligned_alloc(16, dynarray[i].size);
     }
 
+    classicAllocatePassBuffers(0);
+
     ysavecnt = YSAVES;
     nodesperline = tabledivide32_noinline(YSAVES, ydim);
 
@@ -10300,6 +10967,8 @@ int32_t setsprite(int16_t spritenum, const vec3_t *newpos)
     if ((void const *) newpos != (void *) &sprite[spritenum])
         *(vec3_t *) &sprite[spritenum] = *newpos;
 
+    spriteGridUpdate(spritenum);
+
     updatesector(newpos->x,newpos->y,&tempsectnum);
 
     if (tempsectnum < 0)
@@ -10317,6 +10986,8 @@ int32_t setspritez(int16_t spritenum, const vec3_t *newpos)
     if ((void const *)newpos != (void *)&sprite[spritenum])
         *(vec3_t *) &sprite[spritenum] = *newpos;
 
+    spriteGridUpdate(spritenum);
+
     updatesectorz(newpos->x,newpos->y,newpos->z,&tempsectnum);
 
     if (tempsectnum < 0)
@@ -10391,6 +11062,15 @@ int32_t cansee(int32_t x1, int32_t y1, int32_t z1, int16_t sect1, int32_t x2, in
 
     Bmemset(&pendingvec, 0, sizeof(vec3_t));  // compiler-happy
 #endif
+
+    // The PVS only holds for lines that really start inside sect1.
+    uint8_t const * const pvsrow = pvsGetRow(sect1);
+    if (pvsrow && (unsigned)sect2 < (unsigned)numsectors && !(pvsrow[sect2>>3] & pow2char[sect2&7]) && inside(x1, y1, sect1) == 1)
+    {
+        pvsrejected[0]++;
+        return 0;
+    }
+
     Bmemset(sectbitmap, 0, (numsectors+7)>>3);
 #ifdef YAX_ENABLE
 restart_grand:
@@ -10734,6 +11414,8 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
 
     uint8_t *const walbitmap = (uint8_t *)tempbuf;
 
+    pvsCheckWall(pointhighlight);
+
     if ((flags&1)==0)
         Bmemset(walbitmap, 0, (numwalls+7)>>3);
     yaxwalls[numyaxwalls++] = pointhighlight;
@@ -10824,6 +11506,8 @@ void dragpoint(int16_t pointhighlight, int32_t dax, int32_t day, uint8_t flags)
     tempshort = pointhighlight;    //search points CCW
     cnt = MAXWALLS;
 
+    pvsCheckWall(pointhighlight);
+
     wall[tempshort].x = dax;
     wall[tempshort].y = day;
 
@@ -11825,6 +12509,8 @@ void setfirstwall(int16_t sectnum, int16_t newfirstwall)
     if (newfirstwall < startwall || newfirstwall >= startwall+danumwalls)
         return;
 
+    pvsInvalidate();
+
     tmpwall = (uwalltype *)Xmalloc(danumwalls * sizeof(walltype));
 
     Bmemcpy(tmpwall, &wall[startwall], danumwalls*sizeof(walltype));
@@ -27,8 +27,8 @@
 #if !defined(NOASM) && defined __cplusplus
 extern "C" {
 #endif
-    extern intptr_t asm1, asm2, asm3, asm4;
-    extern int32_t globalx1, globaly2;
+    extern CLASSIC_TLS intptr_t asm1, asm2, asm3, asm4;
+    extern CLASSIC_TLS int32_t globalx1, globaly2;
 #if !defined(NOASM) && defined __cplusplus
 }
 #endif
@@ -205,29 +205,32 @@ extern uint16_t ATTRIBUTE((used)) sqrtable[4096], ATTRIBUTE((used)) shlookup[409
 
 #endif
 
-extern int16_t thesector[MAXWALLSB], thewall[MAXWALLSB];
-extern int16_t bunchfirst[MAXWALLSB], bunchlast[MAXWALLSB];
-extern int16_t maskwall[MAXWALLSB], maskwallcnt;
+extern CLASSIC_TLS int16_t thesector[MAXWALLSB], thewall[MAXWALLSB];
+extern CLASSIC_TLS int16_t bunchfirst[MAXWALLSB], bunchlast[MAXWALLSB];
+extern CLASSIC_TLS int16_t maskwall[MAXWALLSB], maskwallcnt;
 extern uspritetype *tspriteptr[MAXSPRITESONSCREEN + 1];
 extern int32_t xdimen, xdimenrecip, halfxdimen, xdimenscale, xdimscale, ydimen;
 extern float fxdimen;
 extern intptr_t frameoffset;
-extern int32_t globalposx, globalposy, globalposz, globalhoriz;
+extern int32_t globalposx, globalposy, globalposz;
+extern CLASSIC_TLS int32_t globalhoriz;
 extern fix16_t qglobalhoriz, qglobalang;
 extern float fglobalposx, fglobalposy, fglobalposz;
 extern int16_t globalang, globalcursectnum;
-extern int32_t globalpal, cosglobalang, singlobalang;
+extern CLASSIC_TLS int32_t globalpal;
+extern int32_t cosglobalang, singlobalang;
 extern int32_t cosviewingrangeglobalang, sinviewingrangeglobalang;
 extern int32_t globalhisibility, globalpisibility, globalcisibility;
 #ifdef USE_OPENGL
 extern int32_t globvis2, globalvisibility2, globalhisibility2, globalpisibility2, globalcisibility2;
 #endif
-extern int32_t globvis, globalvisibility;
+extern CLASSIC_TLS int32_t globvis;
+extern int32_t globalvisibility;
 extern int32_t xyaspect;
-extern int32_t globalshade;
-extern int16_t globalpicnum;
+extern CLASSIC_TLS int32_t globalshade;
+extern CLASSIC_TLS int16_t globalpicnum;
 
-extern int32_t globalorientation;
+extern CLASSIC_TLS int32_t globalorientation;
 
 extern int16_t editstatus;
 
@@ -239,14 +242,14 @@ extern int16_t searchbottomwall, searchisbottom;
 extern char inpreparemirror;
 
 extern char picsiz[MAXTILES];
-extern int16_t sectorborder[256];
+extern CLASSIC_TLS int16_t sectorborder[256];
 extern int32_t qsetmode;
 extern int32_t hitallsprites;
 
-extern int32_t xb1[MAXWALLSB];
-extern int32_t rx1[MAXWALLSB], ry1[MAXWALLSB];
-extern int16_t bunchp2[MAXWALLSB];
-extern int16_t numscans, numbunches;
+extern CLASSIC_TLS int32_t xb1[MAXWALLSB];
+extern CLASSIC_TLS int32_t rx1[MAXWALLSB], ry1[MAXWALLSB];
+extern CLASSIC_TLS int16_t bunchp2[MAXWALLSB];
+extern CLASSIC_TLS int16_t numscans, numbunches;
 extern int32_t rxi[8], ryi[8];
 
 #ifdef USE_OPENGL
@@ -276,6 +279,16 @@ int32_t animateoffs(int tilenum);
         if ((((Fakevar) & 16384) == 16384) && (globalorientation & CSTAT_WALL_ROTATE_90) && rottile[Picnum].newtile != -1) Picnum = rottile[Picnum].newtile; \
     } while (0)
 
+extern uint8_t *pvsmatrix;
+extern int32_t pvsrowbytes;
+extern uint32_t pvsrejected[2];
+
+// PVS row of a sector, or NULL when there is no PVS to consult.
+static FORCE_INLINE uint8_t const *pvsGetRow(int32_t sectnum)
+{
+    return (pvsmatrix && r_pvs && (unsigned)sectnum < (unsigned)numsectors) ? &pvsmatrix[sectnum * pvsrowbytes] : NULL;
+}
+
 static FORCE_INLINE int32_t bad_tspr(const uspritetype *tspr)
 {
     // NOTE: tspr->owner >= MAXSPRITES (could be model) has to be handled by
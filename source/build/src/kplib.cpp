@@ -2416,6 +2416,13 @@ static int32_t kzcalchash(const char *st)
     return hashind%ARRAY_SIZE(kzhashead);
 }
 
+static int32_t kzipnamoffs = -1; //Offset of the open file's ZIP/GRP name in kzhashbuf, -1:stand-alone
+
+char const *kzipname(void)
+{
+    return (kzfs.fil && kzipnamoffs >= 0) ? &kzhashbuf[kzipnamoffs] : NULL;
+}
+
 static int32_t kzcheckhash(const char *filnam, char **zipnam, int32_t *fileoffs, int32_t *fileleng, char *iscomp)
 {
     int32_t i;
@@ -2564,6 +2571,7 @@ intptr_t kzopen(const char *filnam)
     char tempbuf[46+260], *zipnam, iscomp;
 
     //kzfs.fil = 0;
+    kzipnamoffs = -1;
     if (filnam[0] != '|') //Search standalone file first
     {
         kzfs.fil = buildvfs_fopen_read(filnam);
@@ -2581,6 +2589,7 @@ intptr_t kzopen(const char *filnam)
     {
         fil = buildvfs_fopen_read(zipnam); if (!fil) return 0;
         buildvfs_fseek_abs(fil,fileoffs);
+        kzipnamoffs = zipnam-kzhashbuf;
         if (!iscomp) //Must be from GRP file
         {
             kzfs.fil = fil;
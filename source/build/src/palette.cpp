@@ -21,7 +21,7 @@
 uint8_t *basepaltable[MAXBASEPALS] = { palette };
 uint8_t basepalreset=1;
 uint8_t curbasepal;
-int32_t globalblend;
+CLASSIC_TLS int32_t globalblend;
 
 uint32_t g_lastpalettesum = 0;
 palette_t curpalette[256];			// the current palette, unadjusted for brightness or tint
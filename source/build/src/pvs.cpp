@@ -0,0 +1,682 @@
+// Precomputed sector visibility (PVS)
+//
+// For every sector, the set of sectors that a straight line starting inside
+// it can pass through, found by clipping sequences of red walls against each
+// other in 2D. Heights, slopes and wall cstat are ignored, so the set is a
+// superset of what cansee() and the classic renderer's sector flood can reach
+// and it is only ever used to reject.
+//
+// Walls touching sectors marked with pvsMarkDynamicSector() may move at
+// runtime, and the engine cannot order lines through overlapping sectors, so
+// lines through either kind of wall are not clipped. Moving any other wall or
+// changing the wall topology drops the PVS until it is loaded again.
+
+#include "compat.h"
+#include "build.h"
+#include "baselayer.h"
+#include "engine_priv.h"
+#include "cache1d.h"
+#include "md4.h"
+#include "lz4.h"
+#include "vfs.h"
+
+int32_t r_pvs = 1;
+
+uint8_t *pvsmatrix;
+int32_t pvsrowbytes;
+uint32_t pvsrejected[2];
+
+static int32_t pvsnumsectors, pvsnumwalls;
+static uint8_t pvsdynsect[(MAXSECTORS+7)>>3];
+static uint8_t pvsdynwall[(MAXWALLS+7)>>3];
+static uint8_t pvsopenwall[(MAXWALLS+7)>>3];
+
+static struct
+{
+    double buildms;
+    int32_t fromcache;
+    int32_t openwalls;
+    int32_t fallbackrows;
+    int32_t invalidated;
+} pvsstats;
+
+#define PVS_MAGIC "BPVS"
+#define PVS_VERSION 1
+
+// Slack for rounding in the renderer's screen projection: separating lines are
+// opened by this angle (as a tangent) around the pass portal, and by a fixed
+// distance everywhere.
+#define PVS_SLOPE (1.0/32.0)
+#define PVS_EPSILON 2.0
+
+// Upper bounds on the portal sequences walked per source sector. A sector that
+// runs into either gets every sector it is connected to, as does every sector
+// after the whole map has used up PVS_MAXMAPSTEPS.
+#define PVS_MAXSTEPS (1<<14)
+#define PVS_MAXDEPTH 256
+#define PVS_MAXMAPSTEPS (1<<22)
+
+#define PVS_TEST(bitmap, i) ((bitmap)[(i)>>3] & pow2char[(i)&7])
+#define PVS_SET(bitmap, i) ((bitmap)[(i)>>3] |= pow2char[(i)&7])
+
+typedef struct { double x1, y1, x2, y2; } pvsseg_t;
+
+static uint8_t *pvsrow;
+static uint8_t *pvsflooded, *pvsfresh, *pvschain;
+static int16_t *pvssectqueue, *pvswallqueue;
+static int32_t pvssectqueuecnt, pvswallqueuecnt;
+static int32_t pvssteps, pvsmapsteps;
+
+static FORCE_INLINE double pvsSide(double ax, double ay, double bx, double by, double px, double py)
+{
+    return (bx-ax)*(py-ay) - (by-ay)*(px-ax);
+}
+
+static FORCE_INLINE pvsseg_t pvsWallSeg(int32_t w)
+{
+    pvsseg_t const s = { (double)wall[w].x, (double)wall[w].y, (double)wall[wall[w].point2].x, (double)wall[wall[w].point2].y };
+    return s;
+}
+
+// Keeps the part of seg where nx*x + ny*y + c >= 0.
+static int32_t pvsClip(pvsseg_t *seg, double nx, double ny, double c)
+{
+    double const d1 = nx*seg->x1 + ny*seg->y1 + c;
+    double const d2 = nx*seg->x2 + ny*seg->y2 + c;
+
+    if (d1 >= 0 && d2 >= 0)
+        return 1;
+
+    if (d1 < 0 && d2 < 0)
+        return 0;
+
+    double const t = d1 / (d1 - d2);
+    double const x = seg->x1 + (seg->x2 - seg->x1) * t;
+    double const y = seg->y1 + (seg->y2 - seg->y1) * t;
+
+    if (d1 < 0)
+        seg->x1 = x, seg->y1 = y;
+    else
+        seg->x2 = x, seg->y2 = y;
+
+    return 1;
+}
+
+// Keeps the part of seg that is on the far side of wall w, i.e. away from the
+// sector that owns w.
+static int32_t pvsClipBeyond(pvsseg_t *seg, int32_t w)
+{
+    pvsseg_t const l = pvsWallSeg(w);
+    double const dx = l.x2 - l.x1, dy = l.y2 - l.y1;
+    double const len = Bsqrt(dx*dx + dy*dy);
+
+    if (len < 1.0)
+        return 1;
+
+    double const nx = dy/len, ny = -dx/len;
+
+    return pvsClip(seg, nx, ny, PVS_EPSILON - nx*l.x1 - ny*l.y1);
+}
+
+// Keeps the part of target that lies on lines through source and pass, on the
+// far side of pass.
+static int32_t pvsClipSeparators(pvsseg_t const *source, pvsseg_t const *pass, pvsseg_t *target)
+{
+    double const sx[2] = { source->x1, source->x2 }, sy[2] = { source->y1, source->y2 };
+    double const px[2] = { pass->x1, pass->x2 }, py[2] = { pass->y1, pass->y2 };
+
+    for (int i=0; i<2; i++)
+        for (int j=0; j<2; j++)
+        {
+            double const dx = px[j]-sx[i], dy = py[j]-sy[i];
+            double const len = Bsqrt(dx*dx + dy*dy);
+
+            if (len < 1.0)
+                continue;
+
+            double const ux = dx/len, uy = dy/len;
+            double const ds = -uy*(sx[i^1]-sx[i]) + ux*(sy[i^1]-sy[i]);
+            double const dp = -uy*(px[j^1]-sx[i]) + ux*(py[j^1]-sy[i]);
+
+            if (fabs(dp) < 1.0/256.0 || (dp > 0 ? ds : -ds) > 1.0/256.0)
+                continue;
+
+            // normal towards the pass side, tilted forward about the pass point
+            double const mx = (dp > 0) ? -uy : uy, my = (dp > 0) ? ux : -ux;
+            double const nx = mx + ux*PVS_SLOPE, ny = my + uy*PVS_SLOPE;
+
+            if (!pvsClip(target, nx, ny, PVS_EPSILON - nx*px[j] - ny*py[j]))
+                return 0;
+        }
+
+    return 1;
+}
+
+static FORCE_INLINE int32_t pvsIsOpenWall(int32_t w)
+{
+    return PVS_TEST(pvsopenwall, w);
+}
+
+static FORCE_INLINE void pvsQueueSector(int32_t sectnum)
+{
+    if (!PVS_TEST(pvsflooded, sectnum))
+    {
+        PVS_SET(pvsflooded, sectnum);
+        pvssectqueue[pvssectqueuecnt++] = sectnum;
+    }
+}
+
+static FORCE_INLINE void pvsQueueWall(int32_t w)
+{
+    if (!PVS_TEST(pvsfresh, w))
+    {
+        PVS_SET(pvsfresh, w);
+        pvswallqueue[pvswallqueuecnt++] = w;
+    }
+}
+
+// Walks the portals of sectnum for lines that have crossed the source portal
+// and, if there is one, the pass portal.
+static int32_t pvsRecurse(int32_t sectnum, pvsseg_t const *source, int32_t sourcewall,
+                          pvsseg_t const *pass, int32_t passwall, int32_t depth)
+{
+    if (++pvssteps > PVS_MAXSTEPS || depth > PVS_MAXDEPTH)
+        return 0;
+
+    int32_t const startwall = sector[sectnum].wallptr;
+    int32_t const endwall = startwall + sector[sectnum].wallnum;
+
+    for (bssize_t w=startwall; w<endwall; w++)
+    {
+        int32_t const nextsect = wall[w].nextsector;
+        int32_t const nextwall = wall[w].nextwall;
+
+        if (nextsect < 0 || nextwall < 0 || PVS_TEST(pvschain, w))
+            continue;
+
+        if (pvsIsOpenWall(w))
+        {
+            PVS_SET(pvsrow, nextsect);
+            pvsQueueSector(nextsect);
+            continue;
+        }
+
+        pvsseg_t target = pvsWallSeg(w);
+
+        if (!pvsClipBeyond(&target, pass ? passwall : sourcewall))
+            continue;
+
+        if (pass && !pvsClipSeparators(source, pass, &target))
+            continue;
+
+        PVS_SET(pvsrow, nextsect);
+
+        PVS_SET(pvschain, w);
+        PVS_SET(pvschain, nextwall);
+
+        int32_t const ok = pvsRecurse(nextsect, source, sourcewall, &target, w, depth+1);
+
+        pvschain[w>>3] &= ~pow2char[w&7];
+        pvschain[nextwall>>3] &= ~pow2char[nextwall&7];
+
+        if (!ok)
+            return 0;
+    }
+
+    return 1;
+}
+
+// Every sector reachable from sectnum through red walls.
+static void pvsFloodAll(int32_t sectnum)
+{
+    Bmemset(pvsflooded, 0, (numsectors+7)>>3);
+    pvssectqueuecnt = 0;
+    pvsQueueSector(sectnum);
+
+    for (bssize_t i=0; i<pvssectqueuecnt; i++)
+    {
+        int32_t const s = pvssectqueue[i];
+
+        PVS_SET(pvsrow, s);
+
+        for (bssize_t w=sector[s].wallptr, endwall=w+sector[s].wallnum; w<endwall; w++)
+            if (wall[w].nextsector >= 0)
+                pvsQueueSector(wall[w].nextsector);
+    }
+}
+
+static void pvsBuildRow(int32_t sectnum)
+{
+    if (pvsmapsteps > PVS_MAXMAPSTEPS)
+    {
+        pvsstats.fallbackrows++;
+        pvsFloodAll(sectnum);
+        return;
+    }
+
+    Bmemset(pvsflooded, 0, (numsectors+7)>>3);
+    Bmemset(pvsfresh, 0, (numwalls+7)>>3);
+    pvssectqueuecnt = pvswallqueuecnt = 0;
+    pvssteps = 0;
+
+    PVS_SET(pvsrow, sectnum);
+    pvsQueueSector(sectnum);
+
+    // Sectors entered through a wall that is not clipped can be left through
+    // any of their walls. Lines through a clipped one start over from it.
+    int32_t sq = 0, wq = 0;
+
+    while (sq < pvssectqueuecnt || wq < pvswallqueuecnt)
+    {
+        while (sq < pvssectqueuecnt)
+        {
+            int32_t const s = pvssectqueue[sq++];
+
+            for (bssize_t w=sector[s].wallptr, endwall=w+sector[s].wallnum; w<endwall; w++)
+            {
+                int32_t const nextsect = wall[w].nextsector;
+
+                if (nextsect < 0 || wall[w].nextwall < 0)
+                    continue;
+
+                PVS_SET(pvsrow, nextsect);
+
+                if (pvsIsOpenWall(w))
+                    pvsQueueSector(nextsect);
+                else
+                    pvsQueueWall(w);
+            }
+        }
+
+        while (wq < pvswallqueuecnt)
+        {
+            int32_t const w = pvswallqueue[wq++];
+            int32_t const nextwall = wall[w].nextwall;
+            pvsseg_t const source = pvsWallSeg(w);
+
+            PVS_SET(pvschain, w);
+            PVS_SET(pvschain, nextwall);
+
+            int32_t const ok = pvsRecurse(wall[w].nextsector, &source, w, NULL, -1, 1);
+
+            pvschain[w>>3] &= ~pow2char[w&7];
+            pvschain[nextwall>>3] &= ~pow2char[nextwall&7];
+
+            if (!ok)
+            {
+                pvsmapsteps += pvssteps;
+                pvsstats.fallbackrows++;
+                pvsFloodAll(sectnum);
+                return;
+            }
+        }
+    }
+
+    pvsmapsteps += pvssteps;
+}
+
+static int32_t pvsPointInSector(double x, double y, int32_t sectnum)
+{
+    int32_t c = 0;
+
+    for (bssize_t w=sector[sectnum].wallptr, endwall=w+sector[sectnum].wallnum; w<endwall; w++)
+    {
+        double const x1 = wall[w].x, y1 = wall[w].y;
+        double const x2 = wall[wall[w].point2].x, y2 = wall[wall[w].point2].y;
+
+        if ((y1 > y) != (y2 > y) && x < x1 + (x2-x1) * (y-y1) / (y2-y1))
+            c ^= 1;
+    }
+
+    return c;
+}
+
+// Flags the walls of sectors that cross or contain other sectors.
+static void pvsFindOverlaps(void)
+{
+    int32_t *const bbox = (int32_t *)Xmalloc(numsectors * 4 * sizeof(int32_t));
+    uint8_t *const overlap = (uint8_t *)Xcalloc((numsectors+7)>>3, 1);
+
+    for (bssize_t s=0; s<numsectors; s++)
+    {
+        int32_t *const b = &bbox[s<<2];
+        b[0] = b[1] = INT32_MAX; b[2] = b[3] = INT32_MIN;
+
+        for (bssize_t w=sector[s].wallptr, endwall=w+sector[s].wallnum; w<endwall; w++)
+        {
+            int32_t const x = wall[w].x, y = wall[w].y;
+            b[0] = min(b[0], x); b[1] = min(b[1], y);
+            b[2] = max(b[2], x); b[3] = max(b[3], y);
+        }
+    }
+
+    for (bssize_t s1=0; s1<numsectors; s1++)
+        for (bssize_t s2=s1+1; s2<numsectors; s2++)
+        {
+            int32_t const *const b1 = &bbox[s1<<2], *const b2 = &bbox[s2<<2];
+
+            if (b1[2] <= b2[0] || b2[2] <= b1[0] || b1[3] <= b2[1] || b2[3] <= b1[1])
+                continue;
+
+            int32_t found = 0;
+
+            for (bssize_t w1=sector[s1].wallptr, end1=w1+sector[s1].wallnum; w1<end1 && !found; w1++)
+            {
+                pvsseg_t const a = pvsWallSeg(w1);
+
+                for (bssize_t w2=sector[s2].wallptr, end2=w2+sector[s2].wallnum; w2<end2; w2++)
+                {
+                    pvsseg_t const b = pvsWallSeg(w2);
+                    double const d1 = pvsSide(a.x1, a.y1, a.x2, a.y2, b.x1, b.y1);
+                    double const d2 = pvsSide(a.x1, a.y1, a.x2, a.y2, b.x2, b.y2);
+                    double const d3 = pvsSide(b.x1, b.y1, b.x2, b.y2, a.x1, a.y1);
+                    double const d4 = pvsSide(b.x1, b.y1, b.x2, b.y2, a.x2, a.y2);
+
+                    if (((d1 < 0 && d2 > 0) || (d1 > 0 && d2 < 0)) && ((d3 < 0 && d4 > 0) || (d3 > 0 && d4 < 0)))
+                    {
+                        found = 1;
+                        break;
+                    }
+                }
+            }
+
+            // containment: a point just inside one sector lying inside the other
+            for (int k=0; k<2 && !found; k++)
+            {
+                int32_t const inner = k ? s2 : s1, outer = k ? s1 : s2;
+
+                for (bssize_t w=sector[inner].wallptr, endwall=w+sector[inner].wallnum; w<endwall; w++)
+                {
+                    pvsseg_t const a = pvsWallSeg(w);
+                    double const dx = a.x2-a.x1, dy = a.y2-a.y1;
+                    double const len = Bsqrt(dx*dx + dy*dy);
+
+                    if (len < 1.0)
+                        continue;
+
+                    double const x = (a.x1+a.x2)*0.5 - dy/len*(1.0/16.0);
+                    double const y = (a.y1+a.y2)*0.5 + dx/len*(1.0/16.0);
+
+                    found = pvsPointInSector(x, y, outer);
+                    break;
+                }
+            }
+
+            if (found)
+            {
+                PVS_SET(overlap, s1);
+                PVS_SET(overlap, s2);
+            }
+        }
+
+    for (bssize_t s=0; s<numsectors; s++)
+        if (PVS_TEST(overlap, s))
+            for (bssize_t w=sector[s].wallptr, endwall=w+sector[s].wallnum; w<endwall; w++)
+            {
+                PVS_SET(pvsopenwall, w);
+                if (wall[w].nextwall >= 0)
+                    PVS_SET(pvsopenwall, wall[w].nextwall);
+            }
+
+    Bfree(overlap);
+    Bfree(bbox);
+}
+
+static int pvsCompareVertices(const void *a, const void *b)
+{
+    vec2_t const *const va = (vec2_t const *)a, *const vb = (vec2_t const *)b;
+    return (va->x != vb->x) ? (va->x < vb->x ? -1 : 1) : (va->y < vb->y ? -1 : va->y > vb->y);
+}
+
+// Flags every wall that starts on a vertex of a dynamic sector, and every wall
+// with either end on one as not clipped.
+static void pvsFindDynamicWalls(void)
+{
+    vec2_t *const verts = (vec2_t *)Xmalloc(numwalls * sizeof(vec2_t));
+    int32_t numverts = 0;
+
+    for (bssize_t s=0; s<numsectors; s++)
+        if (PVS_TEST(pvsdynsect, s))
+            for (bssize_t w=sector[s].wallptr, endwall=w+sector[s].wallnum; w<endwall; w++)
+                verts[numverts++] = { (int32_t)wall[w].x, (int32_t)wall[w].y };
+
+    qsort(verts, numverts, sizeof(vec2_t), pvsCompareVertices);
+
+    for (bssize_t w=0; w<numwalls; w++)
+    {
+        vec2_t const v = { (int32_t)wall[w].x, (int32_t)wall[w].y };
+
+        if (numverts && bsearch(&v, verts, numverts, sizeof(vec2_t), pvsCompareVertices))
+            PVS_SET(pvsdynwall, w);
+    }
+
+    for (bssize_t w=0; w<numwalls; w++)
+        if (PVS_TEST(pvsdynwall, w) || PVS_TEST(pvsdynwall, wall[w].point2))
+        {
+            PVS_SET(pvsopenwall, w);
+            if (wall[w].nextwall >= 0)
+                PVS_SET(pvsopenwall, wall[w].nextwall);
+        }
+
+    Bfree(verts);
+}
+
+// The key covers everything the matrix depends on: the wall topology, the
+// flags set above and the positions of the walls that are not expected to move.
+static void pvsComputeKey(uint8_t key[16])
+{
+    MD4_CTX ctx;
+    md4init(&ctx);
+
+    uint32_t const head[3] = { B_LITTLE32(PVS_VERSION), B_LITTLE32(numsectors), B_LITTLE32(numwalls) };
+    md4block(&ctx, (const unsigned char *)head, sizeof(head));
+
+    for (bssize_t s=0; s<numsectors; s++)
+    {
+        uint32_t const v[2] = { B_LITTLE32(sector[s].wallptr), B_LITTLE32(sector[s].wallnum) };
+        md4block(&ctx, (const unsigned char *)v, sizeof(v));
+    }
+
+    for (bssize_t w=0; w<numwalls; w++)
+    {
+        int32_t const dyn = !!PVS_TEST(pvsdynwall, w);
+        uint32_t const v[7] = { B_LITTLE32(wall[w].point2), B_LITTLE32(wall[w].nextwall), B_LITTLE32(wall[w].nextsector),
+                               B_LITTLE32(dyn), B_LITTLE32(!!PVS_TEST(pvsopenwall, w)),
+                               B_LITTLE32(dyn ? 0 : (int32_t)wall[w].x), B_LITTLE32(dyn ? 0 : (int32_t)wall[w].y) };
+        md4block(&ctx, (const unsigned char *)v, sizeof(v));
+    }
+
+    md4finish(key, &ctx);
+}
+
+static int32_t pvsReadCache(const char *fn, uint8_t const key[16])
+{
+    buildvfs_kfd fil = kopen4load(fn, 0);
+
+    if (fil == buildvfs_kfd_invalid)
+        return -1;
+
+    char magic[4];
+    uint8_t filekey[16];
+    int32_t head[3];
+    int32_t ret = -1;
+
+    if (kread(fil, magic, 4) != 4 || Bmemcmp(magic, PVS_MAGIC, 4) ||
+        kread(fil, head, sizeof(head)) != sizeof(head) || kread(fil, filekey, 16) != 16)
+        goto done;
+
+    if (B_LITTLE32(head[0]) != PVS_VERSION || (int32_t)B_LITTLE32(head[1]) != numsectors || Bmemcmp(filekey, key, 16))
+        goto done;
+
+    {
+        int32_t const packedsize = B_LITTLE32(head[2]);
+        int32_t const size = numsectors * pvsrowbytes;
+
+        if (packedsize <= 0 || packedsize > LZ4_compressBound(size))
+            goto done;
+
+        char *const packed = (char *)Xmalloc(packedsize);
+
+        if (kread(fil, packed, packedsize) == packedsize &&
+            LZ4_decompress_safe(packed, (char *)pvsmatrix, packedsize, size) == size)
+            ret = 0;
+
+        Bfree(packed);
+    }
+
+done:
+    kclose(fil);
+    return ret;
+}
+
+static void pvsWriteCache(const char *fn, uint8_t const key[16])
+{
+    int32_t const size = numsectors * pvsrowbytes;
+    char *const packed = (char *)Xmalloc(LZ4_compressBound(size));
+    int32_t const packedsize = LZ4_compress_default((const char *)pvsmatrix, packed, size, LZ4_compressBound(size));
+
+    buildvfs_FILE fp;
+
+    if (packedsize <= 0 || (fp = buildvfs_fopen_write(fn)) == NULL)
+    {
+        Bfree(packed);
+        return;
+    }
+
+    uint32_t const head[3] = { B_LITTLE32(PVS_VERSION), B_LITTLE32(numsectors), B_LITTLE32(packedsize) };
+
+    buildvfs_fwrite(PVS_MAGIC, 4, 1, fp);
+    buildvfs_fwrite(head, sizeof(head), 1, fp);
+    buildvfs_fwrite(key, 16, 1, fp);
+    buildvfs_fwrite(packed, packedsize, 1, fp);
+    buildvfs_fclose(fp);
+
+    Bfree(packed);
+}
+
+void pvsInvalidate(void)
+{
+    DO_FREE_AND_NULL(pvsmatrix);
+    pvsnumsectors = pvsnumwalls = 0;
+    Bmemset(pvsdynsect, 0, sizeof(pvsdynsect));
+}
+
+void pvsMarkDynamicSector(int16_t sectnum)
+{
+    if ((unsigned)sectnum < (unsigned)numsectors)
+        PVS_SET(pvsdynsect, sectnum);
+}
+
+void pvsCheckWall(int16_t wallnum)
+{
+    if (pvsmatrix && ((unsigned)wallnum >= (unsigned)pvsnumwalls || !PVS_TEST(pvsdynwall, wallnum)))
+    {
+        pvsstats.invalidated++;
+        DO_FREE_AND_NULL(pvsmatrix);
+    }
+}
+
+//
+// engineLoadPVS
+//
+// Loads the PVS for the current board from the cache file fn or builds it and
+// writes the cache. The sectors that can move must have been marked first.
+//
+int32_t engineLoadPVS(const char *filename)
+{
+    DO_FREE_AND_NULL(pvsmatrix);
+
+    if (!r_pvs || numsectors <= 0 || editstatus)
+        return -1;
+#ifdef YAX_ENABLE
+    if (numyaxbunches > 0)
+        return -1;
+#endif
+
+    double const t0 = timerGetHiTicks();
+
+    pvsnumsectors = numsectors;
+    pvsnumwalls = numwalls;
+    pvsrowbytes = (numsectors+7)>>3;
+
+    Bmemset(pvsdynwall, 0, sizeof(pvsdynwall));
+    Bmemset(pvsopenwall, 0, sizeof(pvsopenwall));
+    pvsFindDynamicWalls();
+    pvsFindOverlaps();
+
+    pvsstats.openwalls = 0;
+    for (bssize_t w=0; w<numwalls; w++)
+        if (wall[w].nextsector >= 0 && PVS_TEST(pvsopenwall, w))
+            pvsstats.openwalls++;
+
+    uint8_t key[16];
+    pvsComputeKey(key);
+
+    pvsmatrix = (uint8_t *)Xcalloc(numsectors, pvsrowbytes);
+
+    char fn[BMAX_PATH];
+    fn[0] = 0;
+
+    if (filename)
+    {
+        Bstrncpyz(fn, filename, BMAX_PATH - 4);
+        append_ext_UNSAFE(fn, ".pvs");
+    }
+
+    pvsstats.fromcache = (fn[0] && !pvsReadCache(fn, key));
+
+    if (!pvsstats.fromcache)
+    {
+        Bmemset(pvsmatrix, 0, numsectors * pvsrowbytes);
+
+        pvsflooded = (uint8_t *)Xcalloc(pvsrowbytes, 1);
+        pvsfresh = (uint8_t *)Xcalloc((numwalls+7)>>3, 1);
+        pvschain = (uint8_t *)Xcalloc((numwalls+7)>>3, 1);
+        pvssectqueue = (int16_t *)Xmalloc(numsectors * sizeof(int16_t));
+        pvswallqueue = (int16_t *)Xmalloc(numwalls * sizeof(int16_t));
+        pvsstats.fallbackrows = 0;
+        pvsmapsteps = 0;
+
+        for (bssize_t s=0; s<numsectors; s++)
+        {
+            pvsrow = &pvsmatrix[s * pvsrowbytes];
+            pvsBuildRow(s);
+        }
+
+        DO_FREE_AND_NULL(pvsflooded);
+        DO_FREE_AND_NULL(pvsfresh);
+        DO_FREE_AND_NULL(pvschain);
+        DO_FREE_AND_NULL(pvssectqueue);
+        DO_FREE_AND_NULL(pvswallqueue);
+        pvsrow = NULL;
+
+        if (fn[0])
+            pvsWriteCache(fn, key);
+    }
+
+    pvsstats.buildms = timerGetHiTicks() - t0;
+    Bmemset(pvsrejected, 0, sizeof(pvsrejected));
+
+    return 0;
+}
+
+void pvsReportStats(void)
+{
+    if (!pvsmatrix)
+    {
+        initprintf("No PVS loaded%s.\n", pvsstats.invalidated ? " (dropped after a wall moved)" : "");
+        return;
+    }
+
+    uint64_t visible = 0;
+
+    for (bssize_t i=0; i<pvsnumsectors * pvsrowbytes; i++)
+        for (uint32_t bits = pvsmatrix[i]; bits; bits &= bits-1)
+            visible++;
+
+    initprintf("PVS: %d sectors, %.1f%% of sector pairs potentially visible\n", pvsnumsectors,
+               100.0 * (double)visible / ((double)pvsnumsectors * pvsnumsectors));
+    initprintf("%s in %.1f ms, %d unclipped portal walls, %d rows flooded\n",
+               pvsstats.fromcache ? "Loaded from cache" : "Built", pvsstats.buildms, pvsstats.openwalls, pvsstats.fallbackrows);
+    initprintf("Rejected %u cansee() calls and %u renderer portals\n", pvsrejected[0], pvsrejected[1]);
+}
@@ -604,6 +604,17 @@ int32_t initsystem(void)
     if (sdlayer_checkversion())
         return -1;
 
+#if SDL_MAJOR_VERSION > 1
+    if (headless)
+    {
+        // the dummy driver keeps its window surfaces in memory, so the classic renderer runs unchanged
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+#ifdef USE_OPENGL
+        nogl = 1;
+#endif
+    }
+#endif
+
     int32_t err = 0;
     uint32_t inited = SDL_WasInit(sdlinitflags);
     if (inited == 0)
@@ -1786,6 +1797,9 @@ void videoShowFrame(int32_t w)
         while (lockcount) videoEndDrawing();
     }
 
+    if (headless)
+        return;
+
     if (SDL_MUSTLOCK(sdl_surface)) SDL_LockSurface(sdl_surface);
 #ifdef __PSP__
     softsurface_blitBuffer((uint32_t*) sdl_surface->pixels, sdl_surface->format->BitsPerPixel, /*sdl_surface->pitch*/512);
@@ -0,0 +1,145 @@
+#include "compat.h"
+
+#ifdef _WIN32
+# define NEED_PROCESS_H
+# include "windows_inc.h"
+#endif
+
+#include "thread.h"
+
+typedef struct
+{
+    threadfunc_t func;
+    void *arg;
+} threadstart_t;
+
+#if defined(RENDERTYPEWIN)
+static DWORD WINAPI thread_entry(LPVOID param)
+#elif defined(RENDERTYPEPSP)
+static int thread_entry(SceSize args, void *argp)
+#else
+static int SDLCALL thread_entry(void *param)
+#endif
+{
+#if defined(RENDERTYPEPSP)
+    UNREFERENCED_PARAMETER(args);
+    threadstart_t *const start = *(threadstart_t **)argp;
+#else
+    threadstart_t *const start = (threadstart_t *)param;
+#endif
+    threadfunc_t const func = start->func;
+    void *const arg = start->arg;
+
+    Bfree(start);
+
+    return func(arg);
+}
+
+int32_t thread_create(thread_t *thread, threadfunc_t func, void *arg, const char *name)
+{
+    threadstart_t *start = (threadstart_t *)Xmalloc(sizeof(threadstart_t));
+
+    start->func = func;
+    start->arg = arg;
+
+#if defined(RENDERTYPEWIN)
+    UNREFERENCED_PARAMETER(name);
+    *thread = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+    if (*thread != NULL)
+        return 0;
+#elif defined(RENDERTYPEPSP)
+    *thread = sceKernelCreateThread(name, thread_entry, 0x12, 0x10000, PSP_THREAD_ATTR_USER, NULL);
+    if (*thread >= 0 && sceKernelStartThread(*thread, sizeof(start), &start) >= 0)
+        return 0;
+#else
+# if SDL_MAJOR_VERSION == 1
+    UNREFERENCED_PARAMETER(name);
+    *thread = SDL_CreateThread(thread_entry, start);
+# else
+    *thread = SDL_CreateThread(thread_entry, name, start);
+# endif
+    if (*thread != NULL)
+        return 0;
+#endif
+
+    Bfree(start);
+    return -1;
+}
+
+int32_t thread_join(thread_t *thread)
+{
+#if defined(RENDERTYPEWIN)
+    DWORD ret = WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+    return (ret == WAIT_FAILED);
+#elif defined(RENDERTYPEPSP)
+    int ret = sceKernelWaitThreadEnd(*thread, NULL);
+    sceKernelDeleteThread(*thread);
+    return (ret < 0);
+#else
+    SDL_WaitThread(*thread, NULL);
+    return 0;
+#endif
+}
+
+int32_t thread_getcpucount(void)
+{
+#if defined(RENDERTYPEWIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return max<int32_t>(info.dwNumberOfProcessors, 1);
+#elif defined(RENDERTYPEPSP)
+    return 1;
+#elif SDL_MAJOR_VERSION == 1
+    return 1;
+#else
+    return max(SDL_GetCPUCount(), 1);
+#endif
+}
+
+int32_t semaphore_init(semaphore_t *sem, int32_t value)
+{
+#if defined(RENDERTYPEWIN)
+    *sem = CreateSemaphore(NULL, value, INT32_MAX, NULL);
+    return (*sem == NULL);
+#elif defined(RENDERTYPEPSP)
+    *sem = sceKernelCreateSema("semaphore", 0, value, INT32_MAX, NULL);
+    return (*sem < 0);
+#else
+    *sem = SDL_CreateSemaphore(value);
+    return (*sem == NULL);
+#endif
+}
+
+int32_t semaphore_wait(semaphore_t *sem)
+{
+#if defined(RENDERTYPEWIN)
+    return (WaitForSingleObject(*sem, INFINITE) == WAIT_FAILED);
+#elif defined(RENDERTYPEPSP)
+    return (sceKernelWaitSema(*sem, 1, NULL) < 0);
+#else
+    return SDL_SemWait(*sem);
+#endif
+}
+
+int32_t semaphore_post(semaphore_t *sem)
+{
+#if defined(RENDERTYPEWIN)
+    return (ReleaseSemaphore(*sem, 1, NULL) == 0);
+#elif defined(RENDERTYPEPSP)
+    return (sceKernelSignalSema(*sem, 1) < 0);
+#else
+    return SDL_SemPost(*sem);
+#endif
+}
+
+void semaphore_destroy(semaphore_t *sem)
+{
+#if defined(RENDERTYPEWIN)
+    CloseHandle(*sem);
+#elif defined(RENDERTYPEPSP)
+    sceKernelDeleteSema(*sem);
+#else
+    SDL_DestroySemaphore(*sem);
+#endif
+}
@@ -15,6 +15,9 @@
 #include "crc32.h"
 
 #include "vfs.h"
+#include "thread.h"
+
+#include <atomic>
 
 void *pic = NULL;
 
@@ -45,12 +48,73 @@ static int32_t mapartfnXXofs;  // byte offset to 'XX' (the number part) in the a
 static int32_t artfilnum, artfilplc;
 static buildvfs_kfd artfil;
 
+////////// Background tile loading //////////
+
+// r_tilestream 1: tiles queued with tilePrefetch() are read by a loader
+// thread into cache blocks that stay locked until the main thread hands them
+// over in tileStreamUpdate(). tileLoad() on a queued tile waits for it.
+// r_tilestream 2: the classic renderer also queues the tiles it misses and
+// draws placeholders instead of waiting for them.
+int32_t r_tilestream = 1;
+
+#define MAXTILESTREAMREQS 64  // power of two
+#define TILESTREAM_LOCK 200  // pins the block while the loader writes to it
+
+typedef struct
+{
+    intptr_t ptr;
+    int32_t  ofs, leng;  // in the source file of the ART file
+    int16_t  tile;
+    uint8_t  tilefilenum;
+    uint8_t  failed;
+} tilestreamreq_t;
+
+// Where the loader thread reads each ART file from. state: 0 = not looked
+// up yet, 1 = path and ofs valid, -1 = can't be read directly (ZIP, PhysFS).
+typedef struct
+{
+    char *  path;
+    int32_t ofs;
+    int8_t  state;
+} tilestreamsrc_t;
+
+static tilestreamreq_t tilestreamreq[MAXTILESTREAMREQS];
+static tilestreamsrc_t tilestreamsrc[MAXARTFILES_TOTAL];
+
+// head: queued by the main thread, tail: read by the loader thread,
+// retired: handed over to waloff[] by the main thread
+static std::atomic<uint32_t> tilestreamhead, tilestreamtail;
+static uint32_t tilestreamretired;
+
+static uint8_t tilestreampending[(MAXTILES+7)>>3];
+static int32_t tilestreambytes;
+
+static thread_t tilestreamthread;
+static semaphore_t tilestreamwake, tilestreamdone;
+static std::atomic<int32_t> tilestreamquit;
+static int32_t tilestreamrunning;
+
+// Tiles drawn as placeholders in the current frame. Only pending tiles get
+// one, so there are never more of them than requests in the queue.
+static char *tilestreamplaceholder;
+static int32_t tilestreamplaceholdersiz, tilestreamplaceholdernum;
+static int16_t tilestreamplaceholdertile[MAXTILESTREAMREQS];
+
+static struct
+{
+    uint32_t requests, loaded, dropped, syncloads, mapped;
+    uint32_t stalls, placeholders, maxdepth;
+    double stalltime;
+} tilestreamstats;
+
 ////////// Per-map ART file loading //////////
 
 // Some forward declarations.
 static void tileUpdatePicSiz(int32_t picnum);
 static const char *artGetIndexedFileName(int32_t tilefilei);
 static int32_t artReadIndexedFile(int32_t tilefilei);
+static void tileStreamResetSources(void);
+static void tileStreamWait(int16_t tilenume);
 
 static inline void artClearMapArtFilename(void)
 {
@@ -81,6 +145,10 @@ static inline void ALLOC_MAPART_ARRAY(origar_t & origar, bakar_t & bakar)
 
 void artClearMapArt(void)
 {
+    // the queued tiles may come from the files being replaced
+    tileStreamFlush();
+    tileStreamResetSources();
+
     if (g_bakTileFileNum == NULL)
         return;  // per-map ART N/A
 
@@ -237,6 +305,8 @@ void tileSetData(int32_t const tile, int32_t tsiz, char const * const buffer)
 
 static void tileSoftDelete(int32_t const tile)
 {
+    tileStreamWait(tile);
+
     tilesiz[tile].x = 0;
     tilesiz[tile].y = 0;
     picsiz[tile] = 0;
@@ -516,7 +586,8 @@ static int32_t artReadIndexedFile(int32_t tilefilei)
         artReadManifest(fil, &local);
 
 #ifndef USE_PHYSFS
-        if (cache1d_file_fromzip(fil))
+        // stored ZIP entries mapped into memory are read from like other files
+        if (cache1d_file_fromzip(fil) && !kfileptr(fil, 0, kfilelength(fil)))
 #else
         if (1)
 #endif
@@ -558,6 +629,9 @@ static int32_t artReadIndexedFile(int32_t tilefilei)
 //
 int32_t artLoadFiles(const char *filename, int32_t askedsize)
 {
+    tileStreamFlush();
+    tileStreamResetSources();
+
     Bstrncpyz(artfilename, filename, sizeof(artfilename));
 
     Bmemset(&tilesiz[0], 0, sizeof(vec2s_t) * MAXTILES);
@@ -593,21 +667,73 @@ int32_t artLoadFiles(const char *filename, int32_t askedsize)
 //
 static void tilePostLoad(int16_t tilenume);
 
-bool tileLoad(int16_t tileNum)
+// Potentially switch open ART file.
+static void artOpenIndexedFile(int32_t tfn)
 {
-    if ((unsigned) tileNum >= (unsigned) MAXTILES) return 0;
-    int const dasiz = tilesiz[tileNum].x*tilesiz[tileNum].y;
-    if (dasiz <= 0) return 0;
+    if (tfn == artfilnum)
+        return;
 
-    // Allocate storage if necessary.
-    if (waloff[tileNum] == 0)
+    if (artfil != buildvfs_kfd_invalid)
+        kclose(artfil);
+
+    char const *fn = artGetIndexedFileName(tfn);
+
+    artfil = kopen4load(fn, 0);
+
+    if (artfil == buildvfs_kfd_invalid)
     {
-        walock[tileNum] = 199;
-        cacheAllocateBlock(&waloff[tileNum], dasiz, &walock[tileNum]);
+        initprintf("Failed opening ART file \"%s\"!\n", fn);
+        engineUnInit();
+        Bexit(11);
     }
 
-    tileLoadData(tileNum, dasiz, (char *) waloff[tileNum]);
+    artfilnum = tfn;
+    artfilplc = 0L;
 
+    faketimerhandler();
+}
+
+// Unloads the tiles using data in place from a mapping that goes away.
+static void tileUnmapData(char const *base, int32_t size)
+{
+    for (bssize_t i=0; i<MAXTILES; i++)
+    {
+        if ((uintptr_t)waloff[i] - (uintptr_t)base < (uintptr_t)size)
+            waloff[i] = 0;
+    }
+}
+
+// Points the tile at its data in place if its ART file is in a group mapped
+// into memory, instead of copying the data into the cache. The mapping is
+// copy-on-write, so drawing into the tile still works.
+static bool tileMapData(int16_t tilenume, int32_t dasiz)
+{
+#ifndef USE_PHYSFS
+    kunmapcallback = tileUnmapData;
+
+    if (rottile[tilenume].owner != -1 || (faketile[tilenume>>3] & pow2char[tilenume&7]))
+        return false;
+
+    artOpenIndexedFile(tilefilenum[tilenume]);
+
+    // some bytes more, so that reading past the end of the tile stays inside the mapping
+    char *const ptr = kfileptr(artfil, tilefileoffs[tilenume], dasiz + 16);
+
+    if (ptr == NULL)
+        return false;
+
+    waloff[tilenume] = (intptr_t)ptr;
+    tilestreamstats.mapped++;
+    return true;
+#else
+    UNREFERENCED_PARAMETER(tilenume);
+    UNREFERENCED_PARAMETER(dasiz);
+    return false;
+#endif
+}
+
+static void tileLoadFinish(int16_t tileNum)
+{
 #ifdef USE_OPENGL
     if (videoGetRenderMode() >= REND_POLYMOST &&
         in3dmode())
@@ -622,6 +748,382 @@ bool tileLoad(int16_t tileNum)
 #endif
 
     tilePostLoad(tileNum);
+}
+
+static FORCE_INLINE int32_t tileStreamPending(int32_t tilenume)
+{
+    return tilestreampending[tilenume>>3] & pow2char[tilenume&7];
+}
+
+#ifndef USE_PHYSFS
+static int32_t tileStreamThread(void *arg)
+{
+    UNREFERENCED_PARAMETER(arg);
+
+    int32_t fil = -1;
+    char *filpath = NULL;
+
+    while (!semaphore_wait(&tilestreamwake) && !tilestreamquit)
+    {
+        uint32_t const tail = tilestreamtail.load(std::memory_order_relaxed);
+        tilestreamreq_t &req = tilestreamreq[tail & (MAXTILESTREAMREQS-1)];
+        char const *const path = tilestreamsrc[req.tilefilenum].path;
+
+        // The main thread's file handles can't be shared, so the loader keeps
+        // its own one open on the file it read from last.
+        if (filpath == NULL || Bstrcmp(filpath, path))
+        {
+            if (fil >= 0)
+                Bclose(fil);
+
+            Bfree(filpath);
+            filpath = Xstrdup(path);
+            fil = Bopen(filpath, BO_BINARY|BO_RDONLY, BS_IREAD);
+        }
+
+        req.failed = (fil < 0 || Blseek(fil, req.ofs, BSEEK_SET) != req.ofs ||
+                      Bread(fil, (char *)req.ptr, req.leng) != req.leng);
+
+        tilestreamtail.store(tail+1, std::memory_order_release);
+        semaphore_post(&tilestreamdone);
+    }
+
+    if (fil >= 0)
+        Bclose(fil);
+
+    Bfree(filpath);
+
+    return 0;
+}
+
+static int32_t tileStreamStart(void)
+{
+    if (tilestreamrunning)
+        return 1;
+
+    if (semaphore_init(&tilestreamwake, 0))
+        return 0;
+
+    if (semaphore_init(&tilestreamdone, 0))
+    {
+        semaphore_destroy(&tilestreamwake);
+        return 0;
+    }
+
+    tilestreamquit = 0;
+
+    if (thread_create(&tilestreamthread, tileStreamThread, NULL, "tile loader"))
+    {
+        initprintf("Failed starting the tile loader thread, loading tiles synchronously.\n");
+        semaphore_destroy(&tilestreamwake);
+        semaphore_destroy(&tilestreamdone);
+        r_tilestream = 0;
+        return 0;
+    }
+
+    tilestreamrunning = 1;
+    return 1;
+}
+
+static tilestreamsrc_t const *tileStreamSource(int32_t tilefilei)
+{
+    tilestreamsrc_t &src = tilestreamsrc[tilefilei];
+
+    if (src.state == 0)
+    {
+        src.state = -1;
+
+        buildvfs_kfd const fil = kopen4load(artGetIndexedFileName(tilefilei), 0);
+
+        if (fil != buildvfs_kfd_invalid)
+        {
+            char const *const path = kfilesource(fil, &src.ofs);
+
+            if (path)
+            {
+                src.path  = Xstrdup(path);
+                src.state = 1;
+            }
+
+            kclose(fil);
+        }
+    }
+
+    return src.state > 0 ? &src : NULL;
+}
+#endif
+
+static void tileStreamResetSources(void)
+{
+    for (auto &src : tilestreamsrc)
+    {
+        DO_FREE_AND_NULL(src.path);
+        src.state = 0;
+    }
+}
+
+static void tileStreamRetire(void)
+{
+    tilestreamreq_t const &req = tilestreamreq[tilestreamretired & (MAXTILESTREAMREQS-1)];
+    int16_t const tile = req.tile;
+
+    waloff[tile] = req.ptr;
+    walock[tile] = 199;
+
+    tilestreampending[tile>>3] &= ~pow2char[tile&7];
+    tilestreambytes -= req.leng;
+    tilestreamretired++;
+
+    // Go through the main thread's file handles for tiles the loader couldn't
+    // read, which also takes care of reporting errors.
+    if (req.failed)
+        tileLoadData(tile, req.leng, (char *)waloff[tile]);
+    else
+        tilestreamstats.loaded++;
+
+    tileLoadFinish(tile);
+}
+
+// Placeholders only live in waloff[] while the classic renderer draws a frame,
+// so nothing else mistakes them for tile data.
+void tileStreamClearPlaceholders(void)
+{
+    for (native_t i=0; i<tilestreamplaceholdernum; i++)
+    {
+        int16_t const tile = tilestreamplaceholdertile[i];
+
+        if (waloff[tile] == (intptr_t)tilestreamplaceholder)
+            waloff[tile] = 0;
+    }
+
+    tilestreamplaceholdernum = 0;
+}
+
+void tileStreamUpdate(void)
+{
+    uint32_t const tail = tilestreamtail.load(std::memory_order_acquire);
+
+    while (tilestreamretired != tail)
+        tileStreamRetire();
+}
+
+static void tileStreamWait(int16_t tilenume)
+{
+    if (!tileStreamPending(tilenume))
+        return;
+
+    double const starttime = timerGetHiTicks();
+
+    do
+    {
+        if (tilestreamretired == tilestreamtail.load(std::memory_order_acquire))
+            semaphore_wait(&tilestreamdone);
+
+        tileStreamUpdate();
+    }
+    while (tileStreamPending(tilenume));
+
+    tilestreamstats.stalls++;
+    tilestreamstats.stalltime += timerGetHiTicks() - starttime;
+}
+
+void tileStreamFlush(void)
+{
+    while (tilestreamretired != tilestreamhead.load(std::memory_order_relaxed))
+    {
+        if (tilestreamretired == tilestreamtail.load(std::memory_order_acquire))
+            semaphore_wait(&tilestreamdone);
+
+        tileStreamUpdate();
+    }
+}
+
+static void tileStreamShutdown(void)
+{
+    if (!tilestreamrunning)
+        return;
+
+    tileStreamFlush();
+
+    tilestreamquit = 1;
+    semaphore_post(&tilestreamwake);
+    thread_join(&tilestreamthread);
+
+    semaphore_destroy(&tilestreamwake);
+    semaphore_destroy(&tilestreamdone);
+    tilestreamrunning = 0;
+
+    tileStreamResetSources();
+    tileStreamClearPlaceholders();
+    DO_FREE_AND_NULL(tilestreamplaceholder);
+    tilestreamplaceholdersiz = 0;
+}
+
+bool tilePrefetch(int16_t tilenume)
+{
+    if ((unsigned)tilenume >= (unsigned)MAXTILES)
+        return false;
+
+    if (waloff[tilenume] || tileStreamPending(tilenume))
+        return true;
+
+#ifdef USE_PHYSFS
+    return false;
+#else
+    int const dasiz = tilesiz[tilenume].x*tilesiz[tilenume].y;
+
+    if (!r_tilestream || dasiz <= 0)
+        return false;
+
+    if (tileMapData(tilenume, dasiz))
+    {
+        tileLoadFinish(tilenume);
+        return true;
+    }
+
+    if (rottile[tilenume].owner != -1 || (faketile[tilenume>>3] & pow2char[tilenume&7]))
+        return false;
+
+    tilestreamsrc_t const *const src = tileStreamSource(tilefilenum[tilenume]);
+
+    if (src == NULL)
+        return false;
+
+    // Locked blocks can't be evicted, so keep the queue to a fraction of the cache.
+    uint32_t const head = tilestreamhead.load(std::memory_order_relaxed);
+
+    if (head - tilestreamretired >= MAXTILESTREAMREQS || tilestreambytes + dasiz > (cachesize>>2))
+    {
+        tileStreamUpdate();
+
+        if (head - tilestreamretired >= MAXTILESTREAMREQS || tilestreambytes + dasiz > (cachesize>>2))
+        {
+            tilestreamstats.dropped++;
+            return false;
+        }
+    }
+
+    if (!tileStreamStart())
+        return false;
+
+    walock[tilenume] = TILESTREAM_LOCK;
+    cacheAllocateBlock(&waloff[tilenume], dasiz, &walock[tilenume]);
+
+    tilestreamreq_t &req = tilestreamreq[head & (MAXTILESTREAMREQS-1)];
+
+    req.ptr  = waloff[tilenume];
+    req.ofs  = src->ofs + tilefileoffs[tilenume];
+    req.leng = dasiz;
+    req.tile = tilenume;
+    req.tilefilenum = tilefilenum[tilenume];
+
+    // The block belongs to the loader until the request is retired.
+    waloff[tilenume] = 0;
+
+    tilestreampending[tilenume>>3] |= pow2char[tilenume&7];
+    tilestreambytes += dasiz;
+
+    tilestreamstats.requests++;
+    tilestreamstats.maxdepth = max(tilestreamstats.maxdepth, head + 1 - tilestreamretired);
+
+    tilestreamhead.store(head+1, std::memory_order_release);
+    semaphore_post(&tilestreamwake);
+
+    return true;
+#endif
+}
+
+bool tileLoadNoWait(int16_t tilenume, bool placeholder)
+{
+    if ((unsigned)tilenume >= (unsigned)MAXTILES)
+        return false;
+
+    if (waloff[tilenume])
+        return true;
+
+    if (r_tilestream < 2 || !tilePrefetch(tilenume))
+    {
+        tileLoad(tilenume);
+        return waloff[tilenume] != 0;
+    }
+
+    tileStreamUpdate();
+
+    if (waloff[tilenume] || !placeholder)
+        return waloff[tilenume] != 0;
+
+    int const dasiz = tilesiz[tilenume].x*tilesiz[tilenume].y;
+
+    if (dasiz > tilestreamplaceholdersiz)
+    {
+        // other tiles may still point at the old one
+        if (tilestreamplaceholdernum)
+        {
+            tileLoad(tilenume);
+            return waloff[tilenume] != 0;
+        }
+
+        tilestreamplaceholder = (char *)Xrealloc(tilestreamplaceholder, dasiz);
+        Bmemset(tilestreamplaceholder, 0, dasiz);
+        tilestreamplaceholdersiz = dasiz;
+    }
+
+    if (EDUKE32_PREDICT_FALSE(tilestreamplaceholdernum >= MAXTILESTREAMREQS))
+    {
+        tileLoad(tilenume);
+        return waloff[tilenume] != 0;
+    }
+
+    waloff[tilenume] = (intptr_t)tilestreamplaceholder;
+    tilestreamplaceholdertile[tilestreamplaceholdernum++] = tilenume;
+    tilestreamstats.placeholders++;
+
+    return true;
+}
+
+void tileStreamReportStats(void)
+{
+    uint32_t const head = tilestreamhead.load(std::memory_order_relaxed);
+
+    initprintf("r_tilestream %d, loader thread %s, %u of %d requests queued (%.1fK), %u max\n", r_tilestream,
+               tilestreamrunning ? "running" : "not started", head - tilestreamretired, MAXTILESTREAMREQS,
+               tilestreambytes/1024.f, tilestreamstats.maxdepth);
+    initprintf("%u tiles requested, %u loaded in the background, %u dropped with the queue full, %u loaded synchronously\n",
+               tilestreamstats.requests, tilestreamstats.loaded, tilestreamstats.dropped, tilestreamstats.syncloads);
+    initprintf("%u tiles used in place from memory mapped group files\n", tilestreamstats.mapped);
+    initprintf("%u stalls waiting for queued tiles, %.3f ms total, %u placeholders drawn\n", tilestreamstats.stalls,
+               tilestreamstats.stalltime, tilestreamstats.placeholders);
+}
+
+bool tileLoad(int16_t tileNum)
+{
+    if ((unsigned) tileNum >= (unsigned) MAXTILES) return 0;
+    int const dasiz = tilesiz[tileNum].x*tilesiz[tileNum].y;
+    if (dasiz <= 0) return 0;
+
+    if (tileStreamPending(tileNum))
+    {
+        tileStreamWait(tileNum);
+        return (waloff[tileNum] != 0 && tilesiz[tileNum].x > 0 && tilesiz[tileNum].y > 0);
+    }
+
+    // Allocate storage if necessary.
+    if (waloff[tileNum] == 0)
+    {
+        if (tileMapData(tileNum, dasiz))
+        {
+            tileLoadFinish(tileNum);
+            return (waloff[tileNum] != 0 && tilesiz[tileNum].x > 0 && tilesiz[tileNum].y > 0);
+        }
+
+        walock[tileNum] = 199;
+        cacheAllocateBlock(&waloff[tileNum], dasiz, &walock[tileNum]);
+    }
+
+    tileLoadData(tileNum, dasiz, (char *) waloff[tileNum]);
+    tilestreamstats.syncloads++;
+
+    tileLoadFinish(tileNum);
 
     return (waloff[tileNum] != 0 && tilesiz[tileNum].x > 0 && tilesiz[tileNum].y > 0);
 }
@@ -674,28 +1176,7 @@ void tileLoadData(int16_t tilenume, int32_t dasiz, char *buffer)
         return;
     }
 
-    // Potentially switch open ART file.
-    if (tfn != artfilnum)
-    {
-        if (artfil != buildvfs_kfd_invalid)
-            kclose(artfil);
-
-        char const *fn = artGetIndexedFileName(tfn);
-
-        artfil = kopen4load(fn, 0);
-
-        if (artfil == buildvfs_kfd_invalid)
-        {
-            initprintf("Failed opening ART file \"%s\"!\n", fn);
-            engineUnInit();
-            Bexit(11);
-        }
-
-        artfilnum = tfn;
-        artfilplc = 0L;
-
-        faketimerhandler();
-    }
+    artOpenIndexedFile(tfn);
 
     // Seek to the right position.
     if (artfilplc != tilefileoffs[tilenume])
@@ -798,6 +1279,8 @@ intptr_t tileCreate(int16_t tilenume, int32_t xsiz, int32_t ysiz)
 
     int const dasiz = xsiz*ysiz;
 
+    tileStreamWait(tilenume);
+
     walock[tilenume] = 255;
     cacheAllocateBlock(&waloff[tilenume], dasiz, &walock[tilenume]);
 
@@ -849,6 +1332,8 @@ void tileCopySection(int32_t tilenume1, int32_t sx1, int32_t sy1, int32_t xsiz,
 
 void Buninitart(void)
 {
+    tileStreamShutdown();
+
     if (artfil != buildvfs_kfd_invalid)
         kclose(artfil);
 
@@ -99,6 +99,186 @@ static FORCE_INLINE int32_t G_WallSpriteDist(uwalltype const * const wal, usprit
     return klabs(wal->x - spr->x) + klabs(wal->y - spr->y);
 }
 
+static const uint8_t g_radiusDamageStatnums[] = {
+    STAT_DEFAULT, STAT_ACTOR, STAT_STANDABLE,
+    STAT_PLAYER, STAT_FALLER, STAT_ZOMBIEACTOR, STAT_MISC
+};
+
+static int16_t g_radiusSprites[MAXSPRITES];
+static int32_t g_radiusSpriteCnt;
+
+static int A_RadiusDamageStatRank(int statNum)
+{
+    for (bssize_t i = 0; i < ARRAY_SSIZE(g_radiusDamageStatnums); i++)
+        if (g_radiusDamageStatnums[i] == statNum)
+            return i;
+
+    return -1;
+}
+
+// The order A_RadiusDamage() walks the status lists in.
+static int A_CompareRadiusDamageOrder(const void *a, const void *b)
+{
+    int const spriteA = *(int16_t const *)a;
+    int const spriteB = *(int16_t const *)b;
+    int const rankA   = A_RadiusDamageStatRank(sprite[spriteA].statnum);
+    int const rankB   = A_RadiusDamageStatRank(sprite[spriteB].statnum);
+
+    if (rankA != rankB)
+        return rankA - rankB;
+
+    return (spritestatorder[spriteA] < spritestatorder[spriteB]) - (spritestatorder[spriteA] > spritestatorder[spriteB]);
+}
+
+static void A_RadiusDamageSprite(int spriteNum, int otherSprite, int statNum, int blastRadius, int32_t zRand,
+                                 int &dmg1, int &dmg2, int &dmg3, int &dmg4)
+{
+    uspritetype const *const pSprite = (uspritetype *)&sprite[spriteNum];
+    spritetype *const pOther    = &sprite[otherSprite];
+
+    // DEFAULT, ZOMBIEACTOR, MISC
+    if (statNum == STAT_DEFAULT || statNum == STAT_ZOMBIEACTOR || statNum == STAT_MISC || AFLAMABLE(pOther->picnum))
+    {
+#ifndef EDUKE32_STANDALONE
+        if (pSprite->picnum != SHRINKSPARK || (pOther->cstat&257))
+#endif
+        {
+            if (dist(pSprite, pOther) < blastRadius)
+            {
+                if (A_CheckEnemySprite(pOther) && !cansee(pOther->x, pOther->y, pOther->z+zRand, pOther->sectnum, pSprite->x, pSprite->y, pSprite->z+zRand, pSprite->sectnum))
+                    return;
+                A_DamageObject_Internal(otherSprite, spriteNum);
+            }
+        }
+    }
+    else if (pOther->extra >= 0 && (uspritetype *)pOther != pSprite && ((pOther->cstat & 257) ||
+#ifndef EDUKE32_STANDALONE
+        pOther->picnum == TRIPBOMB || pOther->picnum == QUEBALL || pOther->picnum == STRIPEBALL || pOther->picnum == DUKELYINGDEAD ||
+#endif
+        A_CheckEnemySprite(pOther)))
+    {
+#ifndef EDUKE32_STANDALONE
+        if ((pSprite->picnum == SHRINKSPARK && pOther->picnum != SHARK && (otherSprite == pSprite->owner || pOther->xrepeat < 24))
+            || (pSprite->picnum == MORTER && otherSprite == pSprite->owner))
+            return;
+#endif
+        int32_t const spriteDist = pOther->picnum == APLAYER
+                             ? FindDistance3D(pSprite->x - pOther->x, pSprite->y - pOther->y, pSprite->z - (pOther->z - PHEIGHT))
+                             : dist(pSprite, pOther);
+
+        if (spriteDist >= blastRadius || !cansee(pOther->x, pOther->y, pOther->z - ZOFFSET3, pOther->sectnum, pSprite->x,
+                                       pSprite->y, pSprite->z - ZOFFSET4, pSprite->sectnum))
+            return;
+
+        if (A_CheckSpriteFlags(otherSprite, SFLAG_DAMAGEEVENT))
+        {
+            if (VM_OnEventWithReturn(EVENT_DAMAGESPRITE, spriteNum, -1, otherSprite) < 0)
+                return;
+        }
+
+        actor_t & dmgActor = actor[otherSprite];
+
+        dmgActor.ang = getangle(pOther->x - pSprite->x, pOther->y - pSprite->y);
+
+        if ((pOther->extra > 0 && ((A_CheckSpriteFlags(spriteNum, SFLAG_PROJECTILE) && SpriteProjectile[spriteNum].workslike & PROJECTILE_RADIUS_PICNUM) || pSprite->picnum == RPG))
+            || (pSprite->picnum == SHRINKSPARK))
+            dmgActor.picnum = pSprite->picnum;
+        else dmgActor.picnum = RADIUSEXPLOSION;
+
+#ifndef EDUKE32_STANDALONE
+        if (pSprite->picnum != SHRINKSPARK)
+#endif
+        {
+            int32_t const k = blastRadius/3;
+
+            if (spriteDist < k)
+            {
+                if (dmg4 == dmg3) dmg4++;
+                dmgActor.extra = dmg3 + (krand()%(dmg4-dmg3));
+            }
+            else if (spriteDist < k*2)
+            {
+                if (dmg3 == dmg2) dmg3++;
+                dmgActor.extra = dmg2 + (krand()%(dmg3-dmg2));
+            }
+            else if (spriteDist < blastRadius)
+            {
+                if (dmg2 == dmg1) dmg2++;
+                dmgActor.extra = dmg1 + (krand()%(dmg2-dmg1));
+            }
+
+            if (!A_CheckSpriteFlags(otherSprite, SFLAG_NODAMAGEPUSH))
+            {
+                if (pOther->xvel < 0) pOther->xvel = 0;
+                pOther->xvel += (pSprite->extra<<2);
+            }
+
+            if (A_CheckSpriteFlags(otherSprite, SFLAG_DAMAGEEVENT))
+                VM_OnEventWithReturn(EVENT_POSTDAMAGESPRITE, spriteNum, -1, otherSprite);
+
+#ifndef EDUKE32_STANDALONE
+            switch (DYNAMICTILEMAP(pOther->picnum))
+            {
+                case PODFEM1__STATIC:
+                case FEM1__STATIC:
+                case FEM2__STATIC:
+                case FEM3__STATIC:
+                case FEM4__STATIC:
+                case FEM5__STATIC:
+                case FEM6__STATIC:
+                case FEM7__STATIC:
+                case FEM8__STATIC:
+                case FEM9__STATIC:
+                case FEM10__STATIC:
+                case STATUE__STATIC:
+                case STATUEFLASH__STATIC:
+                case SPACEMARINE__STATIC:
+                case QUEBALL__STATIC:
+                case STRIPEBALL__STATIC: A_DamageObject_Internal(otherSprite, spriteNum);
+                default: break;
+            }
+#endif
+        }
+#ifndef EDUKE32_STANDALONE
+        else if (pSprite->extra == 0) dmgActor.extra = 0;
+#endif
+
+        if (pOther->picnum != RADIUSEXPLOSION &&
+                pSprite->owner >= 0 && sprite[pSprite->owner].statnum < MAXSTATUS)
+        {
+            if (pOther->picnum == APLAYER)
+            {
+                DukePlayer_t *pPlayer = g_player[P_GetP((uspritetype *)pOther)].ps;
+
+                if (pPlayer->newowner >= 0)
+                    G_ClearCameraView(pPlayer);
+            }
+
+            dmgActor.owner = pSprite->owner;
+        }
+    }
+}
+
+// Walks the status lists from otherSprite in the list of rank statRank on.
+static void A_RadiusDamageStatLists(int spriteNum, int statRank, int otherSprite, int blastRadius, int32_t zRand,
+                                    int &dmg1, int &dmg2, int &dmg3, int &dmg4)
+{
+    for (; statRank < ARRAY_SSIZE(g_radiusDamageStatnums); statRank++)
+    {
+        int const statNum = g_radiusDamageStatnums[statRank];
+
+        while (otherSprite >= 0)
+        {
+            int const nextOther = nextspritestat[otherSprite];
+            A_RadiusDamageSprite(spriteNum, otherSprite, statNum, blastRadius, zRand, dmg1, dmg2, dmg3, dmg4);
+            otherSprite = nextOther;
+        }
+
+        if (statRank + 1 < ARRAY_SSIZE(g_radiusDamageStatnums))
+            otherSprite = headspritestat[g_radiusDamageStatnums[statRank + 1]];
+    }
+}
+
 void A_RadiusDamage(int spriteNum, int blastRadius, int dmg1, int dmg2, int dmg3, int dmg4)
 {
     ud.returnvar[0] = blastRadius; // Allow checking for radius damage in EVENT_DAMAGE(SPRITE/WALL/FLOOR/CEILING) events.
@@ -179,145 +359,49 @@ SKIPWALLCHECK:
     // this is really weird
     int32_t const zRand = -ZOFFSET2 + (krand()&(ZOFFSET5-1));
 
-    static const uint8_t statnumList [] = {
-        STAT_DEFAULT, STAT_ACTOR, STAT_STANDABLE,
-        STAT_PLAYER, STAT_FALLER, STAT_ZOMBIEACTOR, STAT_MISC
-    };
-
-    for (unsigned char stati : statnumList)
+    // Sprites near the blast come from the sprite grid and are visited in the
+    // order of the status list walk. Nested calls (from damage events) take the
+    // part of the list after ours. Once the damage spawns, deletes, moves or
+    // restats a sprite, the grid's list no longer holds what the walk would
+    // visit, so the walk takes over after the sprite it had got to.
+    if (spritegrid && g_radiusSpriteCnt + Numsprites <= MAXSPRITES)
     {
-        int32_t otherSprite = headspritestat[stati];
+        int16_t *const spriteList = &g_radiusSprites[g_radiusSpriteCnt];
+        int32_t const  reach      = A_SpriteDistReach(blastRadius);
+        uint32_t const changeCnt  = spritechangecnt;
+        int32_t        spriteCnt  = 0;
 
-        while (otherSprite >= 0)
-        {
-            int const         nextOther = nextspritestat[otherSprite];
-            spritetype *const pOther    = &sprite[otherSprite];
-
-            // DEFAULT, ZOMBIEACTOR, MISC
-            if (stati == STAT_DEFAULT || stati == STAT_ZOMBIEACTOR || stati == STAT_MISC || AFLAMABLE(pOther->picnum))
-            {
-#ifndef EDUKE32_STANDALONE
-                if (pSprite->picnum != SHRINKSPARK || (pOther->cstat&257))
-#endif
-                {
-                    if (dist(pSprite, pOther) < blastRadius)
-                    {
-                        if (A_CheckEnemySprite(pOther) && !cansee(pOther->x, pOther->y, pOther->z+zRand, pOther->sectnum, pSprite->x, pSprite->y, pSprite->z+zRand, pSprite->sectnum))
-                            goto next_sprite;
-                        A_DamageObject_Internal(otherSprite, spriteNum);
-                    }
-                }
-            }
-            else if (pOther->extra >= 0 && (uspritetype *)pOther != pSprite && ((pOther->cstat & 257) ||
-#ifndef EDUKE32_STANDALONE
-                pOther->picnum == TRIPBOMB || pOther->picnum == QUEBALL || pOther->picnum == STRIPEBALL || pOther->picnum == DUKELYINGDEAD ||
-#endif
-                A_CheckEnemySprite(pOther)))
-            {
-#ifndef EDUKE32_STANDALONE
-                if ((pSprite->picnum == SHRINKSPARK && pOther->picnum != SHARK && (otherSprite == pSprite->owner || pOther->xrepeat < 24))
-                    || (pSprite->picnum == MORTER && otherSprite == pSprite->owner))
-                    goto next_sprite;
-#endif
-                int32_t const spriteDist = pOther->picnum == APLAYER
-                                     ? FindDistance3D(pSprite->x - pOther->x, pSprite->y - pOther->y, pSprite->z - (pOther->z - PHEIGHT))
-                                     : dist(pSprite, pOther);
-
-                if (spriteDist >= blastRadius || !cansee(pOther->x, pOther->y, pOther->z - ZOFFSET3, pOther->sectnum, pSprite->x,
-                                               pSprite->y, pSprite->z - ZOFFSET4, pSprite->sectnum))
-                    goto next_sprite;
-
-                if (A_CheckSpriteFlags(otherSprite, SFLAG_DAMAGEEVENT))
-                {
-                    if (VM_OnEventWithReturn(EVENT_DAMAGESPRITE, spriteNum, -1, otherSprite) < 0)
-                        goto next_sprite;
-                }
+        int32_t const foundCnt = spriteGridQuery(pSprite->x - reach, pSprite->y - reach, pSprite->x + reach, pSprite->y + reach, spriteList);
 
-                actor_t & dmgActor = actor[otherSprite];
+        for (bssize_t i = 0; i < foundCnt; i++)
+            if (A_RadiusDamageStatRank(sprite[spriteList[i]].statnum) >= 0)
+                spriteList[spriteCnt++] = spriteList[i];
 
-                dmgActor.ang = getangle(pOther->x - pSprite->x, pOther->y - pSprite->y);
+        qsort(spriteList, spriteCnt, sizeof(int16_t), A_CompareRadiusDamageOrder);
 
-                if ((pOther->extra > 0 && ((A_CheckSpriteFlags(spriteNum, SFLAG_PROJECTILE) && SpriteProjectile[spriteNum].workslike & PROJECTILE_RADIUS_PICNUM) || pSprite->picnum == RPG))
-                    || (pSprite->picnum == SHRINKSPARK))
-                    dmgActor.picnum = pSprite->picnum;
-                else dmgActor.picnum = RADIUSEXPLOSION;
+        g_radiusSpriteCnt += spriteCnt;
 
-#ifndef EDUKE32_STANDALONE
-                if (pSprite->picnum != SHRINKSPARK)
-#endif
-                {
-                    int32_t const k = blastRadius/3;
-
-                    if (spriteDist < k)
-                    {
-                        if (dmg4 == dmg3) dmg4++;
-                        dmgActor.extra = dmg3 + (krand()%(dmg4-dmg3));
-                    }
-                    else if (spriteDist < k*2)
-                    {
-                        if (dmg3 == dmg2) dmg3++;
-                        dmgActor.extra = dmg2 + (krand()%(dmg3-dmg2));
-                    }
-                    else if (spriteDist < blastRadius)
-                    {
-                        if (dmg2 == dmg1) dmg2++;
-                        dmgActor.extra = dmg1 + (krand()%(dmg2-dmg1));
-                    }
-
-                    if (!A_CheckSpriteFlags(otherSprite, SFLAG_NODAMAGEPUSH))
-                    {
-                        if (pOther->xvel < 0) pOther->xvel = 0;
-                        pOther->xvel += (pSprite->extra<<2);
-                    }
-
-                    if (A_CheckSpriteFlags(otherSprite, SFLAG_DAMAGEEVENT))
-                        VM_OnEventWithReturn(EVENT_POSTDAMAGESPRITE, spriteNum, -1, otherSprite);
-
-#ifndef EDUKE32_STANDALONE
-                    switch (DYNAMICTILEMAP(pOther->picnum))
-                    {
-                        case PODFEM1__STATIC:
-                        case FEM1__STATIC:
-                        case FEM2__STATIC:
-                        case FEM3__STATIC:
-                        case FEM4__STATIC:
-                        case FEM5__STATIC:
-                        case FEM6__STATIC:
-                        case FEM7__STATIC:
-                        case FEM8__STATIC:
-                        case FEM9__STATIC:
-                        case FEM10__STATIC:
-                        case STATUE__STATIC:
-                        case STATUEFLASH__STATIC:
-                        case SPACEMARINE__STATIC:
-                        case QUEBALL__STATIC:
-                        case STRIPEBALL__STATIC: A_DamageObject_Internal(otherSprite, spriteNum);
-                        default: break;
-                    }
-#endif
-                }
-#ifndef EDUKE32_STANDALONE
-                else if (pSprite->extra == 0) dmgActor.extra = 0;
-#endif
-
-                if (pOther->picnum != RADIUSEXPLOSION &&
-                        pSprite->owner >= 0 && sprite[pSprite->owner].statnum < MAXSTATUS)
-                {
-                    if (pOther->picnum == APLAYER)
-                    {
-                        DukePlayer_t *pPlayer = g_player[P_GetP((uspritetype *)pOther)].ps;
+        for (bssize_t i = 0; i < spriteCnt; i++)
+        {
+            int const otherSprite = spriteList[i];
+            int const statNum     = sprite[otherSprite].statnum;
+            int const nextOther   = nextspritestat[otherSprite];
 
-                        if (pPlayer->newowner >= 0)
-                            G_ClearCameraView(pPlayer);
-                    }
+            A_RadiusDamageSprite(spriteNum, otherSprite, statNum, blastRadius, zRand, dmg1, dmg2, dmg3, dmg4);
 
-                    dmgActor.owner = pSprite->owner;
-                }
+            if (spritechangecnt != changeCnt)
+            {
+                g_radiusSpriteCnt -= spriteCnt;
+                A_RadiusDamageStatLists(spriteNum, A_RadiusDamageStatRank(statNum), nextOther, blastRadius, zRand, dmg1, dmg2, dmg3, dmg4);
+                return;
             }
-next_sprite:
-            otherSprite = nextOther;
         }
+
+        g_radiusSpriteCnt -= spriteCnt;
+        return;
     }
+
+    A_RadiusDamageStatLists(spriteNum, 0, headspritestat[g_radiusDamageStatnums[0]], blastRadius, zRand, dmg1, dmg2, dmg3, dmg4);
 }
 
 // Maybe do a projectile transport via an SE7.
@@ -8437,6 +8521,8 @@ void G_MoveWorld(void)
 
     G_DoEventGame(EVENT_PREGAME);
 
+    spriteGridRefresh();
+
     G_MoveZombieActors();     //ST 2
     G_MoveWeapons();          //ST 4
     G_MoveTransports();       //ST 9
@@ -8447,6 +8533,7 @@ void G_MoveWorld(void)
 
     const double actorsTime = timerGetHiTicks();
 
+    spriteGridRefresh();
     G_MoveActors();           //ST 1
 
     g_moveActorsTime = (1-0.033)*g_moveActorsTime + 0.033*(timerGetHiTicks()-actorsTime);
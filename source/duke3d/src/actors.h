@@ -463,6 +463,14 @@ void                Sect_ToggleInterpolation(int sectnum, int setInterpolation);
 static FORCE_INLINE void   Sect_ClearInterpolation(int sectnum) { Sect_ToggleInterpolation(sectnum, 0); }
 static FORCE_INLINE void   Sect_SetInterpolation(int sectnum) { Sect_ToggleInterpolation(sectnum, 1); }
 
+// Half the side of a box around a sprite holding every sprite whose dist() or
+// ldist() from it is below maxDist (both are at least 15/16 of the larger axis).
+static FORCE_INLINE int32_t A_SpriteDistReach(int32_t maxDist)
+{
+    maxDist = min<int32_t>(maxDist, 1<<28);
+    return maxDist + (maxDist >> 3) + 1;
+}
+
 #ifdef LUNATIC
 int32_t G_ToggleWallInterpolation(int32_t w, int32_t doset);
 #endif
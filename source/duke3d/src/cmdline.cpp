@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "screens.h"
 #include "renderlayer.h"
 #include "cmdline.h"
+#include "drivers.h"
 
 #ifdef LUNATIC
 char const * const * g_argv;
@@ -54,6 +55,7 @@ void G_ShowParameterHelp(void)
         "-connect [host]\tConnect to a multiplayer game\n"
         "-c#\t\tMultiplayer mode #, 1 = DM, 2 = Co-op, 3 = DM(no spawn)\n"
         "-d [file.edm or #]\tPlay a demo\n"
+        "-d [file.edm or #]:#[,#]\tProfile a demo at # frames per game tic\n"
         "-g [file.grp]\tLoad additional game data\n"
         "-h [file.def]\tLoad an alternate definitions file\n"
         "-j [dir]\t\tAdd a directory to " APPNAME "'s search list\n"
@@ -102,17 +104,27 @@ void G_ShowDebugHelp(void)
         "-a\t\tUse fake player AI (fake multiplayer only)\n"
 #endif
         "-cachesize #\tSet cache size in kB\n"
+        "-concachebench\tTime compiling the CON scripts against loading them from the cache\n"
+#ifdef CON_JIT
+        "-conjitdiff\tPlay the demo given with -d with and without the CON JIT and compare the game state\n"
+#endif
         "-game_dir [dir]\tSpecify game data directory\n"
         "-gamegrp   \tSelect main grp file\n"
         "-name [name]\tPlayer name in multiplayer\n"
         "-noautoload\tDisable loading from autoload directory\n"
+        "-noconcache\tAlways compile the CON scripts instead of loading the cached bytecode\n"
+        "-noconopt\tDon't rewrite the compiled CON bytecode with superinstructions\n"
 #if defined RENDERTYPEWIN
         "-nodinput\t\tDisable DirectInput (joystick) support\n"
 #endif
+        "-headless\tRun without a window or sound, e.g. for timedemos\n"
         "-nologo\t\tSkip intro anim\n"
         "-ns\t\tDisable sound\n"
         "-nm\t\tDisable music\n"
+        "-profilejson [file]\tWrite demo profiling results to a JSON file\n"
         "-q#\t\tFake multiplayer with # players\n"
+        "-wavout [file]\tWrite sound to a WAV file instead of playing it\n"
+        "-wavmode [mode]\tMix sound without a sound card: realtime, fast or stepped (by game tic, the default with -headless)\n"
         "-z#/-condebug\tEnable line-by-line CON compile debugging at level #\n"
         "-conversion YYYYMMDD\tSelects CON script version for compatibility with older mods\n"
         "-rotatesprite-no-widescreen\tStretch screen drawing from scripts to fullscreen\n"
@@ -337,6 +349,65 @@ void G_CheckCommandLine(int32_t argc, char const * const * argv)
                     continue;
                 }
 #endif
+                if (!Bstrcasecmp(c+1, "headless"))
+                {
+                    headless = 1;
+                    g_noSetup = 1;
+                    g_commandSetup = 0;
+                    i++;
+                    continue;
+                }
+#ifdef CON_JIT
+                if (!Bstrcasecmp(c+1, "conjitdiff"))
+                {
+                    Demo_SetJitDiff();
+                    i++;
+                    continue;
+                }
+#endif
+                if (!Bstrcasecmp(c+1, "profilejson"))
+                {
+                    if (argc > i+1)
+                    {
+                        Demo_SetProfileFile(argv[i+1]);
+                        i++;
+                    }
+                    i++;
+                    continue;
+                }
+                if (!Bstrcasecmp(c+1, "wavout"))
+                {
+                    if (argc > i+1)
+                    {
+                        Bfree(g_soundRenderFile);
+                        g_soundRenderFile = Xstrdup(argv[i+1]);
+                        i++;
+                    }
+                    i++;
+                    continue;
+                }
+                if (!Bstrcasecmp(c+1, "wavmode"))
+                {
+                    if (argc > i+1)
+                    {
+                        static char const *const modes[] = { "realtime", "fast", "stepped" };
+                        int m = 0;
+
+                        while (m < ARRAY_SSIZE(modes) && Bstrcasecmp(argv[i+1], modes[m]))
+                            m++;
+
+                        if (m < ARRAY_SSIZE(modes))
+                            g_soundRenderMode = ASS_RENDER_REALTIME + m;
+                        else
+                            initprintf("Warning: unknown -wavmode \"%s\", expected realtime, fast or stepped.\n", argv[i+1]);
+
+                        i++;
+                    }
+                    else
+                        initprintf("Warning: -wavmode expects realtime, fast or stepped.\n");
+                    i++;
+                    continue;
+                }
                 if (!Bstrcasecmp(c+1, "noautoload"))
                 {
                     initprintf("Autoload disabled\n");
@@ -518,6 +589,24 @@ void G_CheckCommandLine(int32_t argc, char const * const * argv)
                     i++;
                     continue;
                 }
+                if (!Bstrcasecmp(c+1, "noconcache"))
+                {
+                    g_scriptCacheMode = SCRIPTCACHE_OFF;
+                    i++;
+                    continue;
+                }
+                if (!Bstrcasecmp(c+1, "concachebench"))
+                {
+                    g_scriptCacheMode = SCRIPTCACHE_BENCHMARK;
+                    i++;
+                    continue;
+                }
+                if (!Bstrcasecmp(c+1, "noconopt"))
+                {
+                    g_scriptOptimize = 0;
+                    i++;
+                    continue;
+                }
                 if (!Bstrcasecmp(c+1, "nologo"))
                 {
                     g_noLogo = 1;
@@ -199,10 +199,10 @@ void CONFIG_SetDefaults(void)
 #endif
 
 #if defined GEKKO || defined __OPENDINGUX__ || defined __PSP__
-    ud.config.NumVoices = 32;
+    ud.config.NumVoices = 128;
     ud.camera_time = 11;
 #else
-    ud.config.NumVoices = 64;
+    ud.config.NumVoices = 256;
     ud.camera_time    = 4;
 #endif
 
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //-------------------------------------------------------------------------
 
 #include "demo.h"
+#include "crc32.h"
 #include "duke3d.h"
 #include "input.h"
 #include "menus.h"
@@ -333,6 +334,128 @@ void G_CloseDemoWrite(void)
 
 static int32_t g_whichDemo = 1;
 
+#ifdef CON_JIT
+// -conjitdiff: the demo is played with the interpreter, then again with every actor and event
+// running through the JIT, and the game state has to be the same after each tic
+static int32_t g_demo_jitDiff, g_demo_jitDiffTic, g_demo_jitDiffFailTic = -1;
+static int32_t g_demo_jitDiffSavedJit, g_demo_jitDiffSavedThreshold;  // con_jit and con_jitthreshold before the test
+static GrowArray<uint32_t, 4096> g_demo_jitDiffSums;
+
+void Demo_SetJitDiff(void)
+{
+    g_demo_jitDiff = 1;
+    demoplay_diffs = 0;  // the state has to come from the game code, not from the diffs in the demo
+}
+
+static uint32_t Demo_StateChecksum(void)
+{
+    uint32_t crc = Bcrc32(&sprite[0], sizeof(spritetype) * MAXSPRITES, 0);
+
+    crc = Bcrc32(&sector[0], sizeof(sectortype) * numsectors, crc);
+    crc = Bcrc32(&randomseed, sizeof(randomseed), crc);
+
+    for (int TRAVERSE_CONNECT(i))
+    {
+        auto const ps = g_player[i].ps;
+
+        crc = Bcrc32(&ps->pos, sizeof(ps->pos), crc);
+        crc = Bcrc32(&ps->q16ang, sizeof(ps->q16ang), crc);
+    }
+
+    // the gamevars, which most CON code writes to without touching a sprite
+    for (int varNum = 0; varNum < g_gameVarCount; varNum++)
+    {
+        auto const &var = aGameVars[varNum];
+        int32_t value;
+
+        if (var.flags & (GAMEVAR_PTR_MASK | GAMEVAR_SPECIAL))
+            continue;
+
+        if (var.flags & GAMEVAR_PERACTOR)
+        {
+            for (int spriteNum = 0; spriteNum < MAXSPRITES; spriteNum++)
+            {
+                if (sprite[spriteNum].statnum == MAXSTATUS)
+                    continue;
+
+                value = Gv_GetActorValue(var, spriteNum);
+                crc = Bcrc32(&value, sizeof(value), crc);
+            }
+        }
+        else if (var.flags & GAMEVAR_PERPLAYER)
+        {
+            for (int TRAVERSE_CONNECT(i))
+            {
+                value = var.pValues[i];
+                crc = Bcrc32(&value, sizeof(value), crc);
+            }
+        }
+        else
+        {
+            value = var.global;
+            crc = Bcrc32(&value, sizeof(value), crc);
+        }
+    }
+
+    return crc;
+}
+
+static void Demo_JitDiffStartPass(void)
+{
+    VM_JitReset();
+
+    if (g_demo_jitDiff == 1)
+    {
+        g_demo_jitDiffSavedJit       = g_vmJit;
+        g_demo_jitDiffSavedThreshold = g_vmJitThreshold;
+    }
+
+    g_vmJit            = (g_demo_jitDiff == 2);
+    g_vmJitThreshold   = 0;
+    g_demo_jitDiffTic  = 0;
+}
+
+static void Demo_JitDiffTic(void)
+{
+    uint32_t const crc = Demo_StateChecksum();
+
+    if (g_demo_jitDiff == 1)
+        g_demo_jitDiffSums.append(crc);
+    else if (g_demo_jitDiffFailTic < 0 && ((unsigned)g_demo_jitDiffTic >= g_demo_jitDiffSums.size() || g_demo_jitDiffSums[g_demo_jitDiffTic] != crc))
+        g_demo_jitDiffFailTic = g_demo_jitDiffTic;
+
+    g_demo_jitDiffTic++;
+}
+
+// returns whether the demo has to be played again
+static int32_t Demo_JitDiffFinishPass(void)
+{
+    if (g_demo_jitDiff == 1)
+    {
+        g_demo_jitDiff = 2;
+        return 1;
+    }
+
+    int const numTics = g_demo_jitDiffSums.size();
+
+    VM_JitPrintStats();
+
+    if (g_demo_jitDiffFailTic >= 0)
+        OSD_Printf(OSD_ERROR "CON JIT differential test FAILED: the game state differs from tic %d on.\n", g_demo_jitDiffFailTic + 1);
+    else if (g_demo_jitDiffTic != numTics)
+        OSD_Printf(OSD_ERROR "CON JIT differential test FAILED: %d tics with the interpreter, %d with the JIT.\n", numTics, g_demo_jitDiffTic);
+    else
+        OSD_Printf("CON JIT differential test passed: %d tics match.\n", numTics);
+
+    g_demo_jitDiff = 0;
+    g_demo_jitDiffSums.clear();
+
+    g_vmJit          = g_demo_jitDiffSavedJit;
+    g_vmJitThreshold = g_demo_jitDiffSavedThreshold;
+    return 0;
+}
+#endif
+
 static int32_t Demo_UpdateState(int32_t frominit)
 {
     int32_t j = g_player[myconnectindex].ps->gm&MODE_MENU;
@@ -385,8 +508,20 @@ static struct {
     double totalgamems;
     double totalroomsdrawms, totalrestdrawms;
     double starthiticks;
+
+    // per-sample times for the JSON report, in ms
+    int32_t ticsalloc, framesalloc;
+    float *gamems;
+    float *roomsms, *masksms, *hudms;
 } g_prof;
 
+static char g_demo_profileFile[BMAX_PATH];
+
+void Demo_SetProfileFile(const char *filename)
+{
+    Bstrncpyz(g_demo_profileFile, filename, sizeof(g_demo_profileFile));
+}
+
 int32_t Demo_IsProfiling(void)
 {
     return (g_demo_profile > 0);
@@ -399,15 +534,165 @@ static void Demo_StopProfiling(void)
 
 static void Demo_GToc(double t)
 {
+    double const ms = timerGetHiTicks()-t;
+
+    if (g_demo_profileFile[0])
+    {
+        if (g_prof.numtics >= g_prof.ticsalloc)
+        {
+            g_prof.ticsalloc = max(g_prof.ticsalloc*2, 1024);
+            g_prof.gamems = (float *)Xrealloc(g_prof.gamems, g_prof.ticsalloc * sizeof(float));
+        }
+
+        g_prof.gamems[g_prof.numtics] = ms;
+    }
+
     g_prof.numtics++;
-    g_prof.totalgamems += timerGetHiTicks()-t;
+    g_prof.totalgamems += ms;
 }
 
-static void Demo_RToc(double t1, double t2)
+// <rooms> and <masks> are the renderstats deltas over the G_DrawRooms() call
+static void Demo_RToc(double t1, double t2, double rooms, double masks)
 {
+    double const hud = timerGetHiTicks()-t2;
+
+    if (g_demo_profileFile[0])
+    {
+        if (g_prof.numframes >= g_prof.framesalloc)
+        {
+            g_prof.framesalloc = max(g_prof.framesalloc*2, 1024);
+            g_prof.roomsms = (float *)Xrealloc(g_prof.roomsms, g_prof.framesalloc * sizeof(float));
+            g_prof.masksms = (float *)Xrealloc(g_prof.masksms, g_prof.framesalloc * sizeof(float));
+            g_prof.hudms = (float *)Xrealloc(g_prof.hudms, g_prof.framesalloc * sizeof(float));
+        }
+
+        g_prof.roomsms[g_prof.numframes] = rooms;
+        g_prof.masksms[g_prof.numframes] = masks;
+        g_prof.hudms[g_prof.numframes] = hud;
+    }
+
     g_prof.numframes++;
     g_prof.totalroomsdrawms += t2-t1;
-    g_prof.totalrestdrawms += timerGetHiTicks()-t2;
+    g_prof.totalrestdrawms += hud;
+}
+
+static int Demo_CompareFloat(const void *a, const void *b)
+{
+    float const fa = *(float const *)a, fb = *(float const *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static void Demo_WriteProfileSeries(buildvfs_FILE fp, const char *name, const float *samples, int32_t num, bool last)
+{
+    static double const percentiles[] = { 50, 90, 95, 99 };
+    double sum = 0;
+
+    float *sorted = (float *)Xmalloc(max(num, 1) * sizeof(float));
+    Bmemcpy(sorted, samples, num * sizeof(float));
+    qsort(sorted, num, sizeof(float), Demo_CompareFloat);
+
+    for (int i=0; i<num; i++)
+        sum += samples[i];
+
+    Bsnprintf(tempbuf, sizeof(tempbuf), "    \"%s\": {\n      \"mean\": %.4f,\n", name, num ? sum/num : 0.0);
+    buildvfs_fputstrptr(fp, tempbuf);
+
+    for (double p : percentiles)
+    {
+        // nearest-rank percentile
+        int32_t const rank = num ? clamp((int32_t)ceil(p/100.0 * num) - 1, 0, num-1) : 0;
+        Bsnprintf(tempbuf, sizeof(tempbuf), "      \"p%d\": %.4f,\n", (int)p, num ? sorted[rank] : 0.f);
+        buildvfs_fputstrptr(fp, tempbuf);
+    }
+
+    Bsnprintf(tempbuf, sizeof(tempbuf), "      \"max\": %.4f,\n      \"samples\": [", num ? sorted[num-1] : 0.f);
+    buildvfs_fputstrptr(fp, tempbuf);
+
+    for (int i=0; i<num; i++)
+    {
+        Bsnprintf(tempbuf, sizeof(tempbuf), "%s%.4f", i ? (i&15) ? ", " : ",\n        " : "", samples[i]);
+        buildvfs_fputstrptr(fp, tempbuf);
+    }
+
+    buildvfs_fputstrptr(fp, last ? "]\n    }\n" : "]\n    },\n");
+
+    Bfree(sorted);
+}
+
+// Copies src into dst as the contents of a JSON string.
+static void Demo_EscapeJSON(char *dst, int32_t dstSize, char const *src)
+{
+    char *const end = dst + dstSize - 1;
+
+    for (; *src && dst < end; src++)
+    {
+        uint8_t const c = *src;
+
+        if (c == '"' || c == '\\')
+        {
+            if (end - dst < 2)
+                break;
+
+            *dst++ = '\\';
+            *dst++ = c;
+        }
+        else if (c < 0x20)
+        {
+            if (end - dst < 6)
+                break;
+
+            dst += Bsprintf(dst, "\\u%04x", c);
+        }
+        else
+            *dst++ = c;
+    }
+
+    *dst = 0;
+}
+
+// Writes the per-tic and per-frame samples of the finished run to <g_demo_profileFile>,
+// so that benchmark runs can be compared by scripts instead of by reading the log.
+static void Demo_WriteProfileJSON(int32_t dn, double totalms)
+{
+    buildvfs_FILE fp = buildvfs_fopen_write_text(g_demo_profileFile);
+
+    if (!fp)
+    {
+        OSD_Printf("Couldn't open \"%s\" for writing.\n", g_demo_profileFile);
+        return;
+    }
+
+    cachestats_t cs;
+    cacheGetStats(&cs);
+
+    char demoName[BMAX_PATH*2];
+    Demo_EscapeJSON(demoName, sizeof(demoName), g_firstDemoFile);
+
+    Bsnprintf(tempbuf, sizeof(tempbuf),
+              "{\n  \"demo\": \"%s\",\n  \"demonum\": %d,\n  \"frames_per_tic\": %d,\n"
+              "  \"tics\": %d,\n  \"frames\": %d,\n  \"total_ms\": %.3f,\n  \"renderer\": %d,\n"
+              "  \"resolution\": [%d, %d],\n  \"headless\": %s,\n  \"times\": {\n",
+              demoName, dn, g_demo_profile-1, g_prof.numtics, g_prof.numframes, totalms,
+              videoGetRenderMode(), xdim, ydim, headless ? "true" : "false");
+    buildvfs_fputstrptr(fp, tempbuf);
+
+    Demo_WriteProfileSeries(fp, "game", g_prof.gamems, g_prof.numtics, false);
+    Demo_WriteProfileSeries(fp, "drawrooms", g_prof.roomsms, g_prof.numframes, false);
+    Demo_WriteProfileSeries(fp, "drawmasks", g_prof.masksms, g_prof.numframes, false);
+    Demo_WriteProfileSeries(fp, "hud", g_prof.hudms, g_prof.numframes, true);
+
+    Bsnprintf(tempbuf, sizeof(tempbuf),
+              "  },\n  \"cache\": {\n    \"size\": %d,\n    \"objects\": %d,\n    \"allocs\": %u,\n"
+              "    \"indexed_allocs\": %u,\n    \"evictions\": %u,\n    \"evicted_bytes\": %" PRIu64 ",\n"
+              "    \"alloc_ms\": %.4f,\n    \"alloc_max_ms\": %.4f,\n    \"free_bytes\": %d,\n"
+              "    \"free_runs\": %d,\n    \"largest_free\": %d\n  }\n}\n",
+              cs.size, cs.numobjects, cs.allocs, cs.indexedallocs, cs.evictions, cs.evictedbytes,
+              cs.time, cs.maxtime, cs.freebytes, cs.numfree, cs.largestfree);
+    buildvfs_fputstrptr(fp, tempbuf);
+
+    buildvfs_fclose(fp);
+
+    OSD_Printf("== demo %d: wrote profile to \"%s\"\n", dn, g_demo_profileFile);
 }
 
 static void Demo_DisplayProfStatus(void)
@@ -435,6 +720,11 @@ static void Demo_SetupProfile(void)
     g_demo_soundToggle = ud.config.SoundToggle;
     ud.config.SoundToggle = 0;  // restored by Demo_FinishProfile()
 
+    DO_FREE_AND_NULL(g_prof.gamems);
+    DO_FREE_AND_NULL(g_prof.roomsms);
+    DO_FREE_AND_NULL(g_prof.masksms);
+    DO_FREE_AND_NULL(g_prof.hudms);
+
     Bmemset(&g_prof, 0, sizeof(g_prof));
 
     g_prof.starthiticks = timerGetHiTicks();
@@ -473,7 +763,16 @@ static void Demo_FinishProfile(void)
             if (totalprofms != 0)
                 OSD_Printf("== demo %d: non-profiled time overhead: %.02f %%\n",
                            dn, 100.0*totalms/totalprofms - 100.0);
+
+            if (g_demo_profileFile[0])
+                Demo_WriteProfileJSON(dn, totalms);
         }
+
+        DO_FREE_AND_NULL(g_prof.gamems);
+        DO_FREE_AND_NULL(g_prof.roomsms);
+        DO_FREE_AND_NULL(g_prof.masksms);
+        DO_FREE_AND_NULL(g_prof.hudms);
+        g_prof.ticsalloc = g_prof.framesalloc = 0;
     }
 
     g_demo_profile = 0;
@@ -555,6 +854,10 @@ RECHECK:
         outofsync = 0;
 #if KRANDDEBUG
         krd_enable(2);
+#endif
+#ifdef CON_JIT
+        if (g_demo_jitDiff)
+            Demo_JitDiffStartPass();
 #endif
         if (g_demo_profile < 0)
         {
@@ -719,8 +1022,21 @@ nextdemo_nomenu:
                             ud.config.SoundToggle = g_demo_soundToggle;
                         }
 
+#ifdef CON_JIT
+                        int32_t const profile = g_demo_profile;
+#endif
                         if (Demo_IsProfiling())  // don't reset g_demo_profile if it's < 0
                             Demo_FinishProfile();
+#ifdef CON_JIT
+                        if (g_demo_jitDiff && Demo_JitDiffFinishPass())
+                        {
+                            // the same demo again, without exiting after it
+                            if (profile > 0)
+                                g_demo_profile = -profile;
+                            g_demo_playFirstFlag = 1;
+                            g_whichDemo = 1;
+                        }
+#endif
                         goto RECHECK;
                     }
                 }
@@ -764,6 +1080,10 @@ nextdemo_nomenu:
                     ud.config.SoundToggle = k;
                 }
 
+#ifdef CON_JIT
+                if (g_demo_jitDiff)
+                    Demo_JitDiffTic();
+#endif
                 ototalclock += TICSPERFRAME;
 
                 if (g_demo_goalCnt > 0)
@@ -815,6 +1135,7 @@ nextdemo_nomenu:
                     for (i=0; i<num; i++)
                     {
                         double t1 = timerGetHiTicks(), t2;
+                        renderstats_t const rs = renderstats;
 
                         //                    initprintf("t=%d, o=%d, t-o = %d\n", totalclock,
                         //                               ototalclock, totalclock-ototalclock);
@@ -831,7 +1152,7 @@ nextdemo_nomenu:
 
                         G_DisplayRest(j);
 
-                        Demo_RToc(t1, t2);
+                        Demo_RToc(t1, t2, renderstats.drawrooms - rs.drawrooms, renderstats.drawmasks - rs.drawmasks);
                     }
 
                     totalclock = ototalclock+4;
@@ -57,6 +57,8 @@ void G_OpenDemoWrite(void);
 
 void Demo_PlayFirst(int32_t prof, int32_t exitafter);
 void Demo_SetFirst(const char *demostr);
+void Demo_SetProfileFile(const char *filename);
+void Demo_SetJitDiff(void);
 
 int32_t Demo_IsProfiling(void);
 
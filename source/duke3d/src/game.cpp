@@ -1048,6 +1048,9 @@ void G_DrawRooms(int32_t playerNum, int32_t smoothRatio)
             drawing_ror = 0;
 #endif
             renderDrawMasks();
+
+            // start reading what is likely to be drawn next while the game runs
+            G_PrefetchTiles(CAMERA(sect));
 #endif
         }
 
@@ -1201,9 +1204,9 @@ void G_DumpDebugInfo(void)
             {
                 if (aGameVars[i].flags & (GAMEVAR_PERACTOR))
                 {
-                    if (aGameVars[i].pValues[j] != aGameVars[i].defaultValue)
+                    if (Gv_GetActorValue(aGameVars[i], j) != aGameVars[i].defaultValue)
                     {
-                        buildprint("gamevar ", aGameVars[i].szLabel, " ", aGameVars[i].pValues[j], " GAMEVAR_PERACTOR");
+                        buildprint("gamevar ", aGameVars[i].szLabel, " ", Gv_GetActorValue(aGameVars[i], j), " GAMEVAR_PERACTOR");
                         if (aGameVars[i].flags != GAMEVAR_PERACTOR)
                         {
                             buildprint(" // ");
@@ -5623,6 +5626,9 @@ static void G_Cleanup(void)
 
 void G_Shutdown(void)
 {
+#ifdef CON_PROFILER
+    VM_ProfileStop();
+#endif
     CONFIG_WriteSetup(0);
     S_SoundShutdown();
     S_MusicShutdown();
@@ -6516,7 +6522,12 @@ int app_main(int argc, char const * const * argv)
 
     if (g_networkMode != NET_DEDICATED_SERVER)
     {
-        if (videoSetGameMode(ud.setup.fullscreen, ud.setup.xdim, ud.setup.ydim, ud.setup.bpp, ud.detail) < 0)
+        // headless runs always use the classic renderer in a window that is never shown;
+        // the configured mode is left alone so it is written back unchanged
+        int const setupFullscreen = headless ? 0 : ud.setup.fullscreen;
+        int const setupBpp = headless ? 8 : ud.setup.bpp;
+
+        if (videoSetGameMode(setupFullscreen, ud.setup.xdim, ud.setup.ydim, setupBpp, ud.detail) < 0)
         {
             initprintf("Failure setting video mode %dx%dx%d %s! Trying next mode...\n", ud.setup.xdim, ud.setup.ydim,
                        ud.setup.bpp, ud.setup.fullscreen ? "fullscreen" : "windowed");
@@ -6557,7 +6568,8 @@ int app_main(int argc, char const * const * argv)
 
         g_frameDelay = calcFrameDelay(r_maxfps + r_maxfpsoffset);
         videoSetPalette(ud.brightness>>2, myplayer.palette, 0);
-        S_MusicStartup();
+        if (!headless)
+            S_MusicStartup();
         S_SoundStartup();
     }
 
@@ -7021,6 +7033,8 @@ int G_DoMoveThings(void)
     if (g_netClient)   //Slave
         Net_SendClientUpdate();
 
+    S_RenderTic();
+
     return 0;
 }
 
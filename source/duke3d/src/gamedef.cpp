@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "debugbreak.h"
 #include "duke3d.h"
 #include "gameexec.h"
+#include "lz4.h"
 #include "namesdyn.h"
 #include "osd.h"
 #include "savegame.h"
@@ -77,6 +78,32 @@ static intptr_t *g_caseTablePtr;
 
 static bool C_ParseCommand(bool loop);
 static void C_SetScriptSize(int32_t newsize);
+
+int32_t g_scriptCacheMode = SCRIPTCACHE_ON;
+int32_t g_scriptOptimize = 1;
+
+// SCRIPTINS_* flags for each word of apScript, only kept after compiling for the JIT
+uint8_t *g_scriptInsFlags;
+
+typedef struct
+{
+    char *   fileName;
+    int32_t  length;
+    uint32_t crc;
+} scriptsource_t;
+
+// every file read while compiling, in order; the script cache is only valid while all of them match
+static GrowArray<scriptsource_t> g_scriptSources;
+
+// directives whose effects live outside of the compiled script, replayed when it is loaded from the cache
+static struct
+{
+    char *  gameName;
+    char *  defName;
+    char *  cfgName;
+    int32_t startupVersion;  // g_scriptVersion at `gamestartup', or 0 if there was none
+    int32_t startupParams[31];
+} g_scriptDirectives;
 #endif
 
 int32_t g_errorCnt;
@@ -818,6 +845,21 @@ const tokenmap_t iter_tokens [] =
     { "walofsec",         ITER_WALLSOFSECTOR },
 };
 
+// names of the superinstructions C_OptimizeCode() writes, for diagnostics
+static tokenmap_t const vm_superinstructions[] =
+{
+    { "addvar (folded)",     CON_ADDVAR_FOLDED },
+    { "getactor[THISACTOR]", CON_GETTHISSPRITE },
+    { "ifvare+setvar",       CON_IFVARE_SETVAR },
+    { "ifvarg+setvar",       CON_IFVARG_SETVAR },
+    { "ifvarl+setvar",       CON_IFVARL_SETVAR },
+    { "ifvarn+setvar",       CON_IFVARN_SETVAR },
+    { "setvar (folded)",     CON_SETVAR_FOLDED },
+    { "setvar+setvar",       CON_SETVAR_SETVAR },
+    { "setvarvar+addvar",    CON_SETVARVAR_ADDVAR },
+    { "setvarvar+addvarvar", CON_SETVARVAR_ADDVARVAR },
+};
+
 char const * VM_GetKeywordForID(int32_t id)
 {
     // could be better but this is only called for diagnostics, ayy lmao
@@ -825,6 +867,10 @@ char const * VM_GetKeywordForID(int32_t id)
         if (keyword.val == id)
             return keyword.token;
 
+    for (tokenmap_t const & keyword : vm_superinstructions)
+        if (keyword.val == id)
+            return keyword.token;
+
     return "<unknown>";
 }
 #endif
@@ -1024,9 +1070,13 @@ static void C_SetScriptSize(int32_t newsize)
 
     auto newscript = (intptr_t *)Xrealloc(apScript, newsize * sizeof(intptr_t));
     bitptr = (char *)Xrealloc(bitptr, (((newsize + 7) >> 3) + 1) * sizeof(uint8_t));
+    g_scriptInsFlags = (uint8_t *)Xrealloc(g_scriptInsFlags, newsize * sizeof(uint8_t));
 
     if (newsize > g_scriptSize)
+    {
         Bmemset(&newscript[g_scriptSize], 0, (newsize - g_scriptSize) * sizeof(intptr_t));
+        Bmemset(&g_scriptInsFlags[g_scriptSize], 0, (newsize - g_scriptSize) * sizeof(uint8_t));
+    }
 
     if (apScript != newscript)
     {
@@ -1195,6 +1245,7 @@ static void C_GetNextLabelName(void)
 static inline void scriptWriteValue(int32_t const value)
 {
     BITPTR_CLEAR(g_scriptPtr-apScript);
+    g_scriptInsFlags[g_scriptPtr-apScript] = 0;
     *g_scriptPtr++ = value;
 }
 
@@ -1202,15 +1253,23 @@ static inline void scriptWriteValue(int32_t const value)
 static inline void scriptWriteAtOffset(int32_t const value, intptr_t * const addr)
 {
     BITPTR_CLEAR(addr-apScript);
+    g_scriptInsFlags[addr-apScript] = 0;
     *(addr) = value;
 }
 
 static inline void scriptWritePointer(intptr_t const value, intptr_t * const addr)
 {
     BITPTR_SET(addr-apScript);
+    g_scriptInsFlags[addr-apScript] = 0;
     *(addr) = value;
 }
 
+// called once an instruction is complete; anything written over it later clears the mark again
+static inline void scriptMarkInstruction(intptr_t const * const ins, bool const loop)
+{
+    g_scriptInsFlags[ins-apScript] = SCRIPTINS_START | SCRIPTINS_OPCODE | (loop ? 0 : SCRIPTINS_BODY);
+}
+
 static int32_t C_GetNextGameArrayName(void)
 {
     C_GetNextLabelName();
@@ -1273,6 +1332,8 @@ static int C_GetNextKeyword(void) //Returns its code #
             scriptWriteValue(i | (IFELSE_MAGIC<<12));
         else scriptWriteValue(i | LINE_NUMBER);
 
+        g_scriptInsFlags[g_scriptPtr-apScript-1] = SCRIPTINS_OPCODE;
+
         textptr += l;
         if (!(g_errorCnt || g_warningCnt) && g_scriptDebug)
             initprintf("%s:%d: debug: keyword `%s'.\n", g_scriptFileName, g_lineNumber, tempbuf);
@@ -1907,6 +1968,7 @@ static void C_Include(const char *confile)
 
     mptr[len] = 0;
     g_scriptcrc = Bcrc32(mptr, len, g_scriptcrc);
+    g_scriptSources.append({ Xstrdup(confile), len, Bcrc32(mptr, len, 0) });
 
     if (*textptr == '"') // skip past the closing quote if it's there so we don't screw up the next line
         textptr++;
@@ -2472,6 +2534,155 @@ static void scriptUpdateOpcodeForVariableType(intptr_t *ins)
     }
 }
 
+// plain variables hold their value in the gamevar itself, rather than behind a pointer
+static inline bool C_IsPlainVar(intptr_t const id)
+{
+    return (unsigned)id < (unsigned)g_gameVarCount && (aGameVars[id].flags & GAMEVAR_PTR_MASK) == 0;
+}
+
+// global plain variables can be read and written through aGameVars[].global directly
+static inline bool C_IsGlobalVar(intptr_t const id)
+{
+    return C_IsPlainVar(id) && (aGameVars[id].flags & GAMEVAR_USER_MASK) == 0 && id != g_thisActorVarID;
+}
+
+static int C_NextOpcode(intptr_t const *code, uint8_t const *insFlags, int32_t codeSize, int32_t pos)
+{
+    return (pos < codeSize && (insFlags[pos] & SCRIPTINS_START)) ? (code[pos] & VM_INSTMASK) : -1;
+}
+
+// applies a constant operation to a constant the way the VM would apply it to a gamevar
+static bool C_FoldConstant(int const opcode, int32_t const lhs, int32_t const rhs, int32_t *result)
+{
+    int64_t value;
+
+    switch (opcode)
+    {
+        case CON_ADDVAR: value = (int64_t)lhs + rhs; break;
+        case CON_SUBVAR: value = (int64_t)lhs - rhs; break;
+        case CON_MULVAR: value = (int64_t)lhs * rhs; break;
+        case CON_ANDVAR: value = lhs & rhs; break;
+        case CON_ORVAR:  value = lhs | rhs; break;
+        case CON_XORVAR: value = lhs ^ rhs; break;
+        case CON_SHIFTVARL:
+            if ((unsigned)rhs > 31)
+                return false;
+            value = (int64_t)lhs * ((int64_t)1 << rhs);
+            break;
+        case CON_SHIFTVARR:
+            if ((unsigned)rhs > 31)
+                return false;
+            value = lhs >> rhs;
+            break;
+        default: return false;
+    }
+
+    // the VM does the arithmetic on intptr_t, so only results that don't wrap are the same everywhere
+    if (value != (int32_t)value)
+        return false;
+
+    *result = (int32_t)value;
+    return true;
+}
+
+// Rewrites instructions into superinstructions that fold constants, fuse pairs of instructions or
+// access global gamevars directly.  A pair keeps the opcode slot of its first instruction and the
+// second one is left in place for the superinstruction to step over, so branches that land on it
+// still find it.  The first instruction of a pair can't be the lone body of a branch or loop, since
+// the VM runs those on their own.
+int32_t C_OptimizeCode(intptr_t *code, uint8_t const *insFlags, int32_t codeSize)
+{
+    int32_t numOptimized = 0;
+
+    for (int32_t i = 0; i < codeSize; ++i)
+    {
+        if ((insFlags[i] & SCRIPTINS_START) == 0)
+            continue;
+
+        auto const ins = &code[i];
+        bool const alone = insFlags[i] & SCRIPTINS_BODY;
+        int const next = C_NextOpcode(code, insFlags, codeSize, i + 3);
+        int opcode = -1;
+
+        switch (*ins & VM_INSTMASK)
+        {
+            case CON_SETVAR:
+            {
+                if (alone || next == -1 || !C_IsPlainVar(ins[1]))
+                    break;
+
+                int32_t value;
+
+                if (ins[4] == ins[1] && C_FoldConstant(next, ins[2], ins[5], &value))
+                {
+                    ins[2] = value;
+                    opcode = CON_SETVAR_FOLDED;
+                }
+                else if (next == CON_SETVAR && C_IsGlobalVar(ins[1]) && C_IsGlobalVar(ins[4]))
+                    opcode = CON_SETVAR_SETVAR;
+                break;
+            }
+
+            case CON_ADDVAR:
+            {
+                if (alone || (next != CON_ADDVAR && next != CON_SUBVAR) || ins[4] != ins[1] || !C_IsPlainVar(ins[1]))
+                    break;
+
+                int32_t value;
+
+                if (C_FoldConstant(next, ins[2], ins[5], &value))
+                {
+                    ins[2] = value;
+                    opcode = CON_ADDVAR_FOLDED;
+                }
+                break;
+            }
+
+            case CON_SETVARVAR:
+                if (alone || (next != CON_ADDVAR && next != CON_ADDVARVAR) || !C_IsGlobalVar(ins[1]) || !C_IsGlobalVar(ins[2])
+                    || !C_IsGlobalVar(ins[4]))
+                    break;
+
+                if (next == CON_ADDVAR)
+                    opcode = CON_SETVARVAR_ADDVAR;
+                else if (next == CON_ADDVARVAR && C_IsGlobalVar(ins[5]))
+                    opcode = CON_SETVARVAR_ADDVARVAR;
+                break;
+
+            case CON_IFVARE:
+            case CON_IFVARG:
+            case CON_IFVARL:
+            case CON_IFVARN:
+                // the body has to be a lone setvar, right after the fail location
+                if (!C_IsGlobalVar(ins[1]) || C_NextOpcode(code, insFlags, codeSize, i + 4) != CON_SETVAR
+                    || (insFlags[i + 4] & SCRIPTINS_BODY) == 0 || !C_IsGlobalVar(ins[5]))
+                    break;
+
+                switch (*ins & VM_INSTMASK)
+                {
+                    case CON_IFVARE: opcode = CON_IFVARE_SETVAR; break;
+                    case CON_IFVARG: opcode = CON_IFVARG_SETVAR; break;
+                    case CON_IFVARL: opcode = CON_IFVARL_SETVAR; break;
+                    case CON_IFVARN: opcode = CON_IFVARN_SETVAR; break;
+                }
+                break;
+
+            case CON_GETSPRITESTRUCT:
+                if (ins[1] == g_thisActorVarID && C_IsGlobalVar(ins[3]))
+                    opcode = CON_GETTHISSPRITE;
+                break;
+        }
+
+        if (opcode != -1)
+        {
+            *ins = opcode | (*ins & ~VM_INSTMASK);
+            numOptimized++;
+        }
+    }
+
+    return numOptimized;
+}
+
 static bool C_ParseCommand(bool loop)
 {
     int32_t i, j=0, k=0, tw;
@@ -3540,6 +3751,7 @@ DO_DEFSTATE:
                     C_GetNextVar();
 
                 C_GetNextVarType(GAMEVAR_READONLY);
+                scriptMarkInstruction(ins, loop);
                 continue;
             }
 
@@ -3781,6 +3993,7 @@ setvar:
             }
             // replace instructions with special versions for specific var types
             scriptUpdateOpcodeForVariableType(ins);
+            scriptMarkInstruction(ins, loop);
             continue;
         }
 
@@ -3824,6 +4037,7 @@ setvarvar:
                     goto setvar;
                 }
 
+                scriptMarkInstruction(ins, loop);
                 continue;
             }
 
@@ -4428,6 +4642,7 @@ ifvar:
 
                 auto const tempscrptr = apScript + offset;
                 scriptWritePointer((intptr_t)g_scriptPtr, tempscrptr);
+                scriptMarkInstruction(ins, loop);
 
                 if (tw != CON_WHILEVARN && tw != CON_WHILEVARL)
                 {
@@ -5311,6 +5526,8 @@ repeatcase:
                 }
                 gamename[i] = '\0';
                 g_gameNamePtr = Xstrdup(gamename);
+                Bfree(g_scriptDirectives.gameName);
+                g_scriptDirectives.gameName = Xstrdup(gamename);
                 G_UpdateAppTitle();
             }
             continue;
@@ -5328,6 +5545,8 @@ repeatcase:
                 }
                 tempbuf[j] = '\0';
 
+                Bfree(g_scriptDirectives.defName);
+                g_scriptDirectives.defName = Xstrdup(tempbuf);
                 C_SetDefName(tempbuf);
             }
             continue;
@@ -5345,6 +5564,8 @@ repeatcase:
                 }
                 tempbuf[j] = '\0';
 
+                Bfree(g_scriptDirectives.cfgName);
+                g_scriptDirectives.cfgName = Xstrdup(tempbuf);
                 C_SetCfgName(tempbuf);
             }
             continue;
@@ -5904,6 +6125,10 @@ repeatcase:
                 TRIPBOMBLASERMODE
                 */
 
+                EDUKE32_STATIC_ASSERT(sizeof(params) == sizeof(g_scriptDirectives.startupParams));
+                Bmemcpy(g_scriptDirectives.startupParams, params, sizeof(params));
+                g_scriptDirectives.startupVersion = g_scriptVersion;
+
                 G_DoGameStartup(params);
             }
             continue;
@@ -5960,6 +6185,7 @@ static void C_AddDefaultDefinitions(void)
         { "GAMEVAR_NODEFAULT", GAMEVAR_NODEFAULT },
         { "GAMEVAR_NOMULTI",   GAMEVAR_NOMULTI },
         { "GAMEVAR_NORESET",   GAMEVAR_NORESET },
+        { "GAMEVAR_PACKED",    GAMEVAR_PACKED },
         { "GAMEVAR_PERACTOR",  GAMEVAR_PERACTOR },
         { "GAMEVAR_PERPLAYER", GAMEVAR_PERPLAYER },
 
@@ -6170,8 +6396,756 @@ void scriptInitTables()
 #endif
 }
 
+#define SCRIPTCACHE_MAGIC   "EDCONBIN"
+#define SCRIPTCACHE_VERSION 3
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t key;         // C_ScriptCacheKey() of the build and options the script was compiled with
+    int32_t  size;        // of the payload after decompression
+    int32_t  packedSize;
+    uint32_t crc;         // of the decompressed payload
+} scriptcacheheader_t;
+
+typedef struct
+{
+    int32_t  execOfs, loadOfs;
+    uint32_t flags;
+    int32_t  cacherange;
+} scriptcachetile_t;
+
+static uint32_t g_cacheKey;
+static char *   g_cacheData;
+static int32_t  g_cacheSize;
+static int32_t  g_cachePos;
+static bool     g_cacheOverrun;
+
+static void C_CacheWrite(void const *src, int32_t len)
+{
+    if (g_cachePos + len > g_cacheSize)
+    {
+        g_cacheSize = max(g_cacheSize << 1, g_cachePos + len);
+        g_cacheData = (char *)Xrealloc(g_cacheData, g_cacheSize);
+    }
+
+    Bmemcpy(g_cacheData + g_cachePos, src, len);
+    g_cachePos += len;
+}
+
+static void C_CacheRead(void *dst, int32_t len)
+{
+    if (EDUKE32_PREDICT_FALSE(len < 0 || g_cachePos + len > g_cacheSize))
+    {
+        g_cacheOverrun = true;
+        Bmemset(dst, 0, max(len, 0));
+        return;
+    }
+
+    Bmemcpy(dst, g_cacheData + g_cachePos, len);
+    g_cachePos += len;
+}
+
+template <typename T> static FORCE_INLINE void C_CacheWriteValue(T const value) { C_CacheWrite(&value, sizeof(T)); }
+template <typename T> static FORCE_INLINE T C_CacheReadValue(void)
+{
+    T value;
+    C_CacheRead(&value, sizeof(T));
+    return value;
+}
+
+static void C_CacheWriteString(char const *str)
+{
+    int32_t const len = str ? Bstrlen(str) : -1;
+
+    C_CacheWriteValue(len);
+
+    if (len > 0)
+        C_CacheWrite(str, len);
+}
+
+// returns NULL for a string that was written as NULL
+static char *C_CacheReadString(void)
+{
+    int32_t const len = C_CacheReadValue<int32_t>();
+
+    if (len < 0 || g_cacheOverrun || g_cachePos + len > g_cacheSize)
+    {
+        g_cacheOverrun |= (len >= 0);
+        return NULL;
+    }
+
+    auto str = (char *)Xmalloc(len + 1);
+    C_CacheRead(str, len);
+    str[len] = '\0';
+
+    return str;
+}
+
+static void C_FreeScriptCacheData(void)
+{
+    DO_FREE_AND_NULL(g_cacheData);
+    g_cacheSize = g_cachePos = 0;
+    g_cacheOverrun = false;
+}
+
+static int C_ScriptCacheName(char *buf, int bufsize, char const *fileName, bool withModDir)
+{
+    char const *baseName = Bstrrchr(fileName, '/');
+    baseName = baseName ? baseName + 1 : fileName;
+
+    if (withModDir)
+        return G_ModDirSnprintf(buf, bufsize, "%s.cache", baseName);
+
+    return Bsnprintf(buf, bufsize, "%s.cache", baseName) >= bufsize - 1;
+}
+
+// everything besides the sources that changes what C_Compile() produces
+static uint32_t C_ScriptCacheKey(char const *fileName)
+{
+    int32_t const limits[] = {
+        (int32_t)sizeof(intptr_t), BYTEVERSION_EDUKE32, CON_END,  MAXTILES,  MAXSOUNDS,    MAXQUOTES,
+        MAXQUOTELEN,               MAXGAMEVARS,         MAXEVENTS, MAXVOLUMES, MAXLEVELS,  MAXSKILLS,
+        MAXGAMETYPES,              NUMGAMEFUNCTIONS,    NUMCHEATS, (int32_t)sizeof(projectile_t),
+        g_scriptVersion,           g_loadFromGroupOnly, g_scriptOptimize,
+    };
+
+    uint32_t key = Bcrc32(limits, sizeof(limits), 0);
+
+    key = Bcrc32(s_buildRev, Bstrlen(s_buildRev), key);
+    key = Bcrc32(s_buildTimestamp, Bstrlen(s_buildTimestamp), key);
+    key = Bcrc32(fileName, Bstrlen(fileName), key);
+
+    for (char const *m : g_scriptModules)
+        key = Bcrc32(m, Bstrlen(m), key);
+
+    return key;
+}
+
+static void C_ClearScriptSources(void)
+{
+    for (auto &source : g_scriptSources)
+        Bfree(source.fileName);
+
+    g_scriptSources.clear();
+}
+
+static void C_WriteScriptCache(char const *fileName)
+{
+    char cacheName[BMAX_PATH];
+
+    if (C_ScriptCacheName(cacheName, sizeof(cacheName), fileName, true))
+        return;
+
+    C_FreeScriptCacheData();
+
+    C_CacheWriteValue((int32_t)g_scriptSources.size());
+
+    for (auto const &source : g_scriptSources)
+    {
+        C_CacheWriteString(source.fileName);
+        C_CacheWriteValue(source.length);
+        C_CacheWriteValue(source.crc);
+    }
+
+    C_CacheWriteValue(g_scriptcrc);
+    C_CacheWriteValue(g_scriptVersion);
+    C_CacheWriteValue(g_totalLines);
+    C_CacheWriteValue(g_scriptSize);
+    C_CacheWriteValue((int32_t)(g_scriptPtr - apScript));
+
+    // pointers in the bytecode are stored as offsets, the same way C_SetScriptSize() moves them
+    int32_t const scriptPos = g_cachePos;
+    C_CacheWrite(apScript, g_scriptSize * sizeof(intptr_t));
+
+    auto const script = (intptr_t *)(g_cacheData + scriptPos);
+
+    for (int i = 0; i < g_scriptSize - 1; ++i)
+        if (BITPTR_IS_POINTER(i))
+            script[i] -= (intptr_t)apScript;
+
+    C_CacheWrite(bitptr, ((g_scriptSize + 7) >> 3) + 1);
+
+    // only builds with the JIT keep the instruction flags around
+    C_CacheWriteValue((int32_t)(g_scriptInsFlags != NULL));
+
+    if (g_scriptInsFlags)
+        C_CacheWrite(g_scriptInsFlags, g_scriptSize * sizeof(uint8_t));
+
+    C_CacheWrite(apScriptEvents, sizeof(apScriptEvents));
+
+    C_CacheWriteValue(g_labelCnt);
+    C_CacheWrite(label, g_labelCnt << 6);
+    C_CacheWrite(labelcode, g_labelCnt * sizeof(int32_t));
+    C_CacheWrite(labeltype, g_labelCnt * sizeof(int32_t));
+
+    int32_t numProjectiles = 0;
+
+    for (auto const &tile : g_tile)
+    {
+        scriptcachetile_t const cacheTile = { tile.execPtr ? (int32_t)(tile.execPtr - apScript) : 0,
+                                              tile.loadPtr ? (int32_t)(tile.loadPtr - apScript) : 0, tile.flags,
+                                              tile.cacherange };
+        C_CacheWriteValue(cacheTile);
+        numProjectiles += (tile.proj != NULL);
+    }
+
+    C_CacheWriteValue(numProjectiles);
+
+    for (int i = 0; i < MAXTILES; i++)
+    {
+        if (g_tile[i].proj == NULL)
+            continue;
+
+        C_CacheWriteValue(i);
+        C_CacheWriteValue(*g_tile[i].proj);
+        C_CacheWriteValue(*g_tile[i].defproj);
+    }
+
+    C_CacheWriteValue(g_gameVarCount);
+
+    for (int i = 0; i < g_gameVarCount; i++)
+    {
+        gamevar_t const &var = aGameVars[i];
+
+        C_CacheWriteString(var.szLabel);
+        C_CacheWriteValue(var.flags);
+        C_CacheWriteValue(var.defaultValue);
+        C_CacheWriteValue((var.flags & (GAMEVAR_USER_MASK | GAMEVAR_PTR_MASK)) ? 0 : var.global);
+    }
+
+    C_CacheWriteValue(g_gameArrayCount);
+
+    for (int i = 0; i < g_gameArrayCount; i++)
+    {
+        C_CacheWriteString(aGameArrays[i].szLabel);
+        C_CacheWriteValue(aGameArrays[i].flags);
+        C_CacheWriteValue(aGameArrays[i].size);
+    }
+
+    for (int i = 0; i < MAXQUOTES; i++)
+    {
+        if (apStrings[i] == NULL)
+            continue;
+
+        C_CacheWriteValue(i);
+        C_CacheWriteString(apStrings[i]);
+    }
+
+    C_CacheWriteValue(-1);
+    C_CacheWriteValue(g_numXStrings);
+
+    for (int i = 0; i < g_numXStrings; i++)
+        C_CacheWriteString(apXStrings[i]);
+
+    C_CacheWriteValue(g_highestSoundIdx);
+
+    for (int i = 0; i <= g_highestSoundIdx; i++)
+    {
+        sound_t const &snd = g_sounds[i];
+
+        if (snd.filename == NULL)
+            continue;
+
+        C_CacheWriteValue(i);
+        C_CacheWriteString(snd.filename);
+        C_CacheWriteValue(snd.ps);
+        C_CacheWriteValue(snd.pe);
+        C_CacheWriteValue(snd.pr);
+        C_CacheWriteValue(snd.m);
+        C_CacheWriteValue(snd.vo);
+        C_CacheWriteValue(snd.volume);
+    }
+
+    C_CacheWriteValue(-1);
+
+    for (auto const &map : g_mapInfo)
+    {
+        C_CacheWriteValue(map.partime);
+        C_CacheWriteValue(map.designertime);
+        C_CacheWriteString(map.name);
+        C_CacheWriteString(map.filename);
+        C_CacheWriteString(map.musicfn);
+    }
+
+    C_CacheWrite(g_volumeNames, sizeof(g_volumeNames));
+    C_CacheWrite(g_volumeFlags, sizeof(g_volumeFlags));
+    C_CacheWriteValue(g_volumeCnt);
+    C_CacheWrite(g_skillNames, sizeof(g_skillNames));
+    C_CacheWriteValue(g_skillCnt);
+    C_CacheWrite(g_gametypeNames, sizeof(g_gametypeNames));
+    C_CacheWrite(g_gametypeFlags, sizeof(g_gametypeFlags));
+    C_CacheWriteValue(g_gametypeCnt);
+    C_CacheWrite(gamefunctions, sizeof(gamefunctions));
+    C_CacheWrite(CheatStrings, sizeof(CheatStrings));
+    C_CacheWrite(CheatKeys, sizeof(CheatKeys));
+
+    C_CacheWriteString(g_scriptDirectives.gameName);
+    C_CacheWriteString(g_scriptDirectives.defName);
+    C_CacheWriteString(g_scriptDirectives.cfgName);
+    C_CacheWriteValue(g_scriptDirectives.startupVersion);
+    C_CacheWrite(g_scriptDirectives.startupParams, sizeof(g_scriptDirectives.startupParams));
+
+    int32_t const numDynTiles = G_GetDynamicTileMapping(NULL);
+    C_CacheWriteValue(numDynTiles);
+
+    if (numDynTiles > 0)
+    {
+        auto values = (int32_t *)Xmalloc(numDynTiles * sizeof(int32_t));
+        G_GetDynamicTileMapping(values);
+        C_CacheWrite(values, numDynTiles * sizeof(int32_t));
+        Bfree(values);
+    }
+
+    int32_t const numDynSounds = G_GetDynamicSoundMapping(NULL);
+    C_CacheWriteValue(numDynSounds);
+
+    if (numDynSounds > 0)
+    {
+        auto values = (int32_t *)Xmalloc(numDynSounds * sizeof(int32_t));
+        G_GetDynamicSoundMapping(values);
+        C_CacheWrite(values, numDynSounds * sizeof(int32_t));
+        Bfree(values);
+    }
+
+    scriptcacheheader_t header;
+
+    Bmemcpy(header.magic, SCRIPTCACHE_MAGIC, sizeof(header.magic));
+    header.version = SCRIPTCACHE_VERSION;
+    header.key     = g_cacheKey;
+    header.size    = g_cachePos;
+    header.crc     = Bcrc32(g_cacheData, g_cachePos, 0);
+
+    auto packed = (char *)Xmalloc(LZ4_compressBound(g_cachePos));
+    header.packedSize = LZ4_compress_default(g_cacheData, packed, g_cachePos, LZ4_compressBound(g_cachePos));
+
+    buildvfs_FILE fil;
+
+    if (header.packedSize <= 0 || (fil = buildvfs_fopen_write(cacheName)) == NULL)
+    {
+        initprintf("Could not write compiled script cache \"%s\".\n", cacheName);
+        Bfree(packed);
+        C_FreeScriptCacheData();
+        return;
+    }
+
+    buildvfs_fwrite(&header, sizeof(header), 1, fil);
+    buildvfs_fwrite(packed, header.packedSize, 1, fil);
+    buildvfs_fclose(fil);
+
+    Bfree(packed);
+    C_FreeScriptCacheData();
+}
+
+// reads the cache and checks it against the build, the options and every source file before
+// touching anything, so that a miss leaves C_Compile() to start from the same state
+static bool C_ReadScriptCache(char const *fileName)
+{
+    char cacheName[BMAX_PATH];
+
+    if (C_ScriptCacheName(cacheName, sizeof(cacheName), fileName, false))
+        return false;
+
+    buildvfs_kfd const kFile = kopen4loadfrommod(cacheName, 0);
+
+    if (kFile == buildvfs_kfd_invalid)
+        return false;
+
+    scriptcacheheader_t header;
+
+    if (kread(kFile, &header, sizeof(header)) != sizeof(header) || Bmemcmp(header.magic, SCRIPTCACHE_MAGIC, sizeof(header.magic))
+        || header.version != SCRIPTCACHE_VERSION || header.key != g_cacheKey || header.size <= 0
+        || header.packedSize <= 0 || header.packedSize != kfilelength(kFile) - (int32_t)sizeof(header))
+    {
+        kclose(kFile);
+        return false;
+    }
+
+    auto packed = (char *)Xmalloc(header.packedSize);
+    bool const readOk = (kread(kFile, packed, header.packedSize) == header.packedSize);
+    kclose(kFile);
+
+    C_FreeScriptCacheData();
+    g_cacheData = (char *)Xmalloc(header.size);
+    g_cacheSize = header.size;
+
+    bool const unpacked = readOk && LZ4_decompress_safe(packed, g_cacheData, header.packedSize, header.size) == header.size;
+    Bfree(packed);
+
+    if (!unpacked || Bcrc32(g_cacheData, header.size, 0) != header.crc)
+    {
+        C_FreeScriptCacheData();
+        return false;
+    }
+
+    int32_t const numSources = C_CacheReadValue<int32_t>();
+    uint32_t scriptcrc = 0;
+
+    for (int i = 0; i < numSources && !g_cacheOverrun; i++)
+    {
+        char *const sourceName = C_CacheReadString();
+        int32_t const length = C_CacheReadValue<int32_t>();
+        uint32_t const crc = C_CacheReadValue<uint32_t>();
+
+        buildvfs_kfd const sourceFile = sourceName ? kopen4loadfrommod(sourceName, g_loadFromGroupOnly) : buildvfs_kfd_invalid;
+        Bfree(sourceName);
+
+        if (sourceFile == buildvfs_kfd_invalid)
+        {
+            g_cacheOverrun = true;
+            break;
+        }
+
+        bool match = (kfilelength(sourceFile) == length);
+
+        if (match)
+        {
+            auto const text = (char *)Xmalloc(length + 1);
+            match = (kread(sourceFile, text, length) == length && Bcrc32(text, length, 0) == crc);
+            scriptcrc = Bcrc32(text, length, scriptcrc);
+            Bfree(text);
+        }
+
+        kclose(sourceFile);
+
+        if (!match)
+            g_cacheOverrun = true;
+    }
+
+    if (g_cacheOverrun || numSources <= 0 || C_CacheReadValue<uint32_t>() != scriptcrc)
+    {
+        C_FreeScriptCacheData();
+        return false;
+    }
+
+    g_scriptcrc = scriptcrc;
+
+    return true;
+}
+
+// restores everything C_WriteScriptCache() saved from the data C_ReadScriptCache() accepted
+static bool C_RestoreScriptCache(void)
+{
+    g_scriptVersion = C_CacheReadValue<int32_t>();
+    g_totalLines    = C_CacheReadValue<int32_t>();
+    g_scriptSize    = C_CacheReadValue<int32_t>();
+
+    int32_t const scriptPtrOfs = C_CacheReadValue<int32_t>();
+
+    Bfree(apScript);
+    Bfree(bitptr);
+
+    apScript = (intptr_t *)Xmalloc(g_scriptSize * sizeof(intptr_t));
+    bitptr   = (char *)Xmalloc(((g_scriptSize + 7) >> 3) + 1);
+
+    C_CacheRead(apScript, g_scriptSize * sizeof(intptr_t));
+    C_CacheRead(bitptr, ((g_scriptSize + 7) >> 3) + 1);
+
+    for (int i = 0; i < g_scriptSize - 1; ++i)
+        if (BITPTR_IS_POINTER(i))
+            apScript[i] += (intptr_t)apScript;
+
+    g_scriptPtr = apScript + scriptPtrOfs;
+
+    DO_FREE_AND_NULL(g_scriptInsFlags);
+
+    if (C_CacheReadValue<int32_t>())
+    {
+        g_scriptInsFlags = (uint8_t *)Xmalloc(g_scriptSize * sizeof(uint8_t));
+        C_CacheRead(g_scriptInsFlags, g_scriptSize * sizeof(uint8_t));
+#ifndef CON_JIT
+        DO_FREE_AND_NULL(g_scriptInsFlags);
+#endif
+    }
+
+    C_CacheRead(apScriptEvents, sizeof(apScriptEvents));
+
+    g_labelCnt = C_CacheReadValue<int32_t>();
+
+    if ((uint32_t)g_labelCnt > MAXSPRITES*sizeof(spritetype)/64)
+    {
+        g_labelCnt = 0;
+        g_cacheOverrun = true;
+    }
+
+    C_CacheRead(label, g_labelCnt << 6);
+    C_CacheRead(labelcode, g_labelCnt * sizeof(int32_t));
+    C_CacheRead(labeltype, g_labelCnt * sizeof(int32_t));
+
+    for (int i = 0; i < MAXTILES; i++)
+    {
+        if (g_tile[i].proj)
+            C_FreeProjectile(i);
+
+        auto const cacheTile = C_CacheReadValue<scriptcachetile_t>();
+        tiledata_t &tile = g_tile[i];
+
+        tile.execPtr    = cacheTile.execOfs ? apScript + cacheTile.execOfs : NULL;
+        tile.loadPtr    = cacheTile.loadOfs ? apScript + cacheTile.loadOfs : NULL;
+        tile.flags      = cacheTile.flags;
+        tile.cacherange = cacheTile.cacherange;
+    }
+
+    for (int numProjectiles = C_CacheReadValue<int32_t>(); numProjectiles > 0 && !g_cacheOverrun; --numProjectiles)
+    {
+        int const tileNum = C_CacheReadValue<int32_t>();
+
+        if ((unsigned)tileNum >= MAXTILES)
+        {
+            g_cacheOverrun = true;
+            break;
+        }
+
+        C_AllocProjectile(tileNum);
+        C_CacheRead(g_tile[tileNum].proj, sizeof(projectile_t));
+        C_CacheRead(g_tile[tileNum].defproj, sizeof(projectile_t));
+    }
+
+    // the system variables already exist from Gv_Init(), and the rest come back in the order the script
+    // declared them, so the indices compiled into the bytecode stay valid
+    for (int i = 0, numVars = C_CacheReadValue<int32_t>(); i < numVars && !g_cacheOverrun; i++)
+    {
+        char *const     varLabel     = C_CacheReadString();
+        uintptr_t const varFlags     = C_CacheReadValue<uintptr_t>();
+        intptr_t const  defaultValue = C_CacheReadValue<intptr_t>();
+        intptr_t const  globalValue  = C_CacheReadValue<intptr_t>();
+
+        if (varLabel == NULL)
+        {
+            g_cacheOverrun = true;
+            break;
+        }
+
+        int const varNum = hash_find(&h_gamevars, varLabel);
+
+        if (!(varFlags & GAMEVAR_PTR_MASK)
+            && (varNum < 0 || (aGameVars[varNum].flags & GAMEVAR_RESET) || aGameVars[varNum].defaultValue != defaultValue))
+            Gv_NewVar(varLabel, defaultValue, varFlags);
+
+        if (!(varFlags & (GAMEVAR_USER_MASK | GAMEVAR_PTR_MASK)) && (unsigned)i < (unsigned)g_gameVarCount)
+            aGameVars[i].global = globalValue;
+
+        Bfree(varLabel);
+    }
+
+    for (int i = 0, numArrays = C_CacheReadValue<int32_t>(); i < numArrays && !g_cacheOverrun; i++)
+    {
+        char *const     arrayLabel = C_CacheReadString();
+        uintptr_t const arrayFlags = C_CacheReadValue<uintptr_t>();
+        intptr_t const  arraySize  = C_CacheReadValue<intptr_t>();
+
+        if (arrayLabel == NULL)
+        {
+            g_cacheOverrun = true;
+            break;
+        }
+
+        int const arrayNum = hash_find(&h_arrays, arrayLabel);
+
+        if (arrayNum < 0 || (aGameArrays[arrayNum].flags & GAMEARRAY_RESET))
+            Gv_NewArray(arrayLabel, NULL, arraySize, arrayFlags);
+
+        Bfree(arrayLabel);
+    }
+
+    for (int quoteNum; (quoteNum = C_CacheReadValue<int32_t>()) >= 0 && !g_cacheOverrun;)
+    {
+        char *const quote = C_CacheReadString();
+
+        if ((unsigned)quoteNum >= MAXQUOTES || quote == NULL)
+        {
+            Bfree(quote);
+            g_cacheOverrun = true;
+            break;
+        }
+
+        C_AllocQuote(quoteNum);
+        Bstrncpyz(apStrings[quoteNum], quote, MAXQUOTELEN);
+        Bfree(quote);
+    }
+
+    g_numXStrings = C_CacheReadValue<int32_t>();
+
+    if ((unsigned)g_numXStrings > MAXQUOTES)
+    {
+        g_numXStrings = 0;
+        g_cacheOverrun = true;
+    }
+
+    for (int i = 0; i < g_numXStrings && !g_cacheOverrun; i++)
+    {
+        char *const quote = C_CacheReadString();
+
+        if (apXStrings[i] == NULL)
+            apXStrings[i] = (char *)Xcalloc(MAXQUOTELEN, sizeof(uint8_t));
+
+        Bstrncpyz(apXStrings[i], quote ? quote : "", MAXQUOTELEN);
+        Bfree(quote);
+    }
+
+    g_highestSoundIdx = C_CacheReadValue<int32_t>();
+
+    for (int soundNum; (soundNum = C_CacheReadValue<int32_t>()) >= 0 && !g_cacheOverrun;)
+    {
+        char *const soundFile = C_CacheReadString();
+
+        if ((unsigned)soundNum >= MAXSOUNDS || soundFile == NULL)
+        {
+            Bfree(soundFile);
+            g_cacheOverrun = true;
+            break;
+        }
+
+        sound_t &snd = g_sounds[soundNum];
+
+        if (snd.filename == NULL)
+            snd.filename = (char *)Xcalloc(BMAX_PATH, sizeof(uint8_t));
+
+        Bstrncpyz(snd.filename, soundFile, BMAX_PATH);
+        Bfree(soundFile);
+
+        snd.ps     = C_CacheReadValue<int16_t>();
+        snd.pe     = C_CacheReadValue<int16_t>();
+        snd.pr     = C_CacheReadValue<char>();
+        snd.m      = C_CacheReadValue<char>();
+        snd.vo     = C_CacheReadValue<int16_t>();
+        snd.volume = C_CacheReadValue<float>();
+    }
+
+    for (auto &map : g_mapInfo)
+    {
+        map.partime      = C_CacheReadValue<int32_t>();
+        map.designertime = C_CacheReadValue<int32_t>();
+
+        Bfree(map.name);
+        Bfree(map.filename);
+        Bfree(map.musicfn);
+
+        map.name     = C_CacheReadString();
+        map.filename = C_CacheReadString();
+        map.musicfn  = C_CacheReadString();
+    }
+
+    C_CacheRead(g_volumeNames, sizeof(g_volumeNames));
+    C_CacheRead(g_volumeFlags, sizeof(g_volumeFlags));
+    g_volumeCnt = C_CacheReadValue<int32_t>();
+    C_CacheRead(g_skillNames, sizeof(g_skillNames));
+    g_skillCnt = C_CacheReadValue<char>();
+    C_CacheRead(g_gametypeNames, sizeof(g_gametypeNames));
+    C_CacheRead(g_gametypeFlags, sizeof(g_gametypeFlags));
+    g_gametypeCnt = C_CacheReadValue<int32_t>();
+
+    for (int i = 0; i < NUMGAMEFUNCTIONS; i++)
+    {
+        char funcName[MAXGAMEFUNCLEN];
+        C_CacheRead(funcName, sizeof(funcName));
+        funcName[MAXGAMEFUNCLEN-1] = '\0';
+
+        if (!Bstrcmp(funcName, gamefunctions[i]))
+            continue;
+
+        hash_delete(&h_gamefuncs, gamefunctions[i]);
+        Bstrcpy(gamefunctions[i], funcName);
+
+        if (funcName[0])
+            hash_add(&h_gamefuncs, gamefunctions[i], i, 0);
+    }
+
+    C_CacheRead(CheatStrings, sizeof(CheatStrings));
+    C_CacheRead(CheatKeys, sizeof(CheatKeys));
+
+    char *const gameName = C_CacheReadString();
+    char *const defName  = C_CacheReadString();
+    char *const cfgName  = C_CacheReadString();
+
+    int32_t const startupVersion = C_CacheReadValue<int32_t>();
+    int32_t startupParams[ARRAY_SIZE(g_scriptDirectives.startupParams)];
+    C_CacheRead(startupParams, sizeof(startupParams));
+
+    if (gameName)
+    {
+        g_gameNamePtr = gameName;
+        G_UpdateAppTitle();
+    }
+
+    if (defName)
+        C_SetDefName(defName);
+
+    if (cfgName)
+        C_SetCfgName(cfgName);
+
+    if (startupVersion)
+    {
+        int32_t const scriptVersion = g_scriptVersion;
+
+        g_scriptVersion = startupVersion;
+        G_DoGameStartup(startupParams);
+        g_scriptVersion = scriptVersion;
+    }
+
+    Bfree(defName);
+    Bfree(cfgName);
+
+    int32_t const numDynTiles = C_CacheReadValue<int32_t>();
+
+    if (numDynTiles == G_GetDynamicTileMapping(NULL) && numDynTiles > 0)
+    {
+        auto values = (int32_t *)Xmalloc(numDynTiles * sizeof(int32_t));
+        C_CacheRead(values, numDynTiles * sizeof(int32_t));
+        G_SetDynamicTileMapping(values);
+        Bfree(values);
+    }
+    else g_cacheOverrun |= (numDynTiles != G_GetDynamicTileMapping(NULL));
+
+    int32_t const numDynSounds = C_CacheReadValue<int32_t>();
+
+    if (numDynSounds == G_GetDynamicSoundMapping(NULL) && numDynSounds > 0)
+    {
+        auto values = (int32_t *)Xmalloc(numDynSounds * sizeof(int32_t));
+        C_CacheRead(values, numDynSounds * sizeof(int32_t));
+        G_SetDynamicSoundMapping(values);
+        Bfree(values);
+    }
+    else g_cacheOverrun |= (numDynSounds != G_GetDynamicSoundMapping(NULL));
+
+    bool const restored = !g_cacheOverrun && g_cachePos == g_cacheSize;
+
+    C_FreeScriptCacheData();
+
+    for (char *m : g_scriptModules)
+        free(m);
+    g_scriptModules.clear();
+
+    return restored;
+}
+
+static void C_FinishCompile(void)
+{
+    for (auto i : tables_free)
+        hash_free(i);
+
+    for (auto i : inttables)
+        inthash_free(i);
+
+    freehashnames();
+    freesoundhashnames();
+
+    if (g_scriptDebug)
+        C_PrintStats();
+
+    C_InitQuotes();
+}
+
 void C_Compile(const char *fileName)
 {
+#ifdef CON_JIT
+    VM_JitReset();
+#endif
+#ifdef CON_PROFILER
+    VM_ProfileReset();
+#endif
+
     Bmemset(apScriptEvents, 0, sizeof(apScriptEvents));
     Bmemset(apScriptGameEventEnd, 0, sizeof(apScriptGameEventEnd));
 
@@ -6187,6 +7161,39 @@ void C_Compile(const char *fileName)
     Gv_Init();
     C_InitProjectiles();
 
+    C_ClearScriptSources();
+
+    Bfree(g_scriptDirectives.gameName);
+    Bfree(g_scriptDirectives.defName);
+    Bfree(g_scriptDirectives.cfgName);
+    Bmemset(&g_scriptDirectives, 0, sizeof(g_scriptDirectives));
+
+    g_cacheKey = C_ScriptCacheKey(fileName);
+
+    if (g_scriptCacheMode == SCRIPTCACHE_ON && !g_scriptDebug)
+    {
+        uint32_t const startloadtime = timerGetTicks();
+
+        if (C_ReadScriptCache(fileName))
+        {
+            if (!C_RestoreScriptCache())
+            {
+                char cacheName[BMAX_PATH];
+
+                if (!C_ScriptCacheName(cacheName, sizeof(cacheName), fileName, true))
+                    buildvfs_unlink(cacheName);
+
+                G_GameExit("The compiled script cache was damaged and has been deleted.  Please restart.");
+            }
+
+            initprintf("Loaded %s from the compiled script cache in %ums%s\n", fileName, timerGetTicks() - startloadtime,
+                       C_ScriptVersionString(g_scriptVersion));
+
+            C_FinishCompile();
+            return;
+        }
+    }
+
     buildvfs_kfd kFile = kopen4loadfrommod(fileName, g_loadFromGroupOnly);
 
     if (kFile == buildvfs_kfd_invalid) // JBF: was 0
@@ -6219,6 +7226,7 @@ void C_Compile(const char *fileName)
     g_logFlushWindow = 0;
 
     uint32_t const startcompiletime = timerGetTicks();
+    double const   compileStartTime = timerGetHiTicks();
 
     char * mptr = (char *)Xmalloc(kFileLen+1);
     mptr[kFileLen] = 0;
@@ -6229,12 +7237,16 @@ void C_Compile(const char *fileName)
 
     g_scriptcrc = Bcrc32(NULL, 0, 0L);
     g_scriptcrc = Bcrc32(textptr, kFileLen, g_scriptcrc);
+    g_scriptSources.append({ Xstrdup(fileName), kFileLen, g_scriptcrc });
 
     Bfree(apScript);
 
     apScript = (intptr_t *)Xcalloc(1, g_scriptSize * sizeof(intptr_t));
     bitptr   = (char *)Xcalloc(1, (((g_scriptSize + 7) >> 3) + 1) * sizeof(uint8_t));
 
+    Bfree(g_scriptInsFlags);
+    g_scriptInsFlags = (uint8_t *)Xcalloc(g_scriptSize, sizeof(uint8_t));
+
     g_errorCnt   = 0;
     g_labelCnt   = 0;
     g_lineNumber = 1;
@@ -6294,22 +7306,47 @@ void C_Compile(const char *fileName)
 
     C_SetScriptSize(g_scriptPtr-apScript+8);
 
+    if (g_scriptOptimize)
+    {
+        int const numOptimized = C_OptimizeCode(apScript, g_scriptInsFlags, g_scriptPtr-apScript);
+
+        if (g_scriptDebug)
+            initprintf("Rewrote %d instructions as superinstructions\n", numOptimized);
+    }
+
+#ifndef CON_JIT
+    DO_FREE_AND_NULL(g_scriptInsFlags);
+#endif
+
+    double const compileTime = timerGetHiTicks() - compileStartTime;
+
     initprintf("Compiled %d bytes in %ums%s\n", (int)((intptr_t)g_scriptPtr - (intptr_t)apScript),
                timerGetTicks() - startcompiletime, C_ScriptVersionString(g_scriptVersion));
 
-    for (auto i : tables_free)
-        hash_free(i);
+    if (g_scriptCacheMode != SCRIPTCACHE_OFF)
+    {
+        double const writeStartTime = timerGetHiTicks();
 
-    for (auto i : inttables)
-        inthash_free(i);
+        C_WriteScriptCache(fileName);
 
-    freehashnames();
-    freesoundhashnames();
+        if (g_scriptCacheMode == SCRIPTCACHE_BENCHMARK)
+        {
+            // loading over the state we just compiled leaves it unchanged
+            double const loadStartTime = timerGetHiTicks();
 
-    if (g_scriptDebug)
-        C_PrintStats();
+            if (C_ReadScriptCache(fileName) && C_RestoreScriptCache())
+            {
+                double const loadTime = timerGetHiTicks() - loadStartTime;
 
-    C_InitQuotes();
+                initprintf("Script cache: compiled in %.2fms, wrote the cache in %.2fms, loaded it in %.2fms (%.1fx faster)\n",
+                           compileTime, loadStartTime - writeStartTime, loadTime, compileTime / max(loadTime, 0.001));
+            }
+            else
+                initprintf("Script cache: could not load the cache back\n");
+        }
+    }
+
+    C_FinishCompile();
 }
 
 void C_ReportError(int error)
@@ -229,6 +229,28 @@ void C_SetCfgName(const char *cfgname);
 void C_ReportError(int error);
 void C_Compile(const char *filenam);
 
+enum
+{
+    SCRIPTCACHE_OFF,
+    SCRIPTCACHE_ON,         // load the compiled script from its cache when the sources match
+    SCRIPTCACHE_BENCHMARK,  // compile anyway, then time writing and reloading the cache
+};
+
+extern int32_t g_scriptCacheMode;
+extern int32_t g_scriptOptimize;
+
+// per-word flags telling C_OptimizeCode() where the instructions it may rewrite begin
+enum
+{
+    SCRIPTINS_START  = 0x01,  // an instruction starts here
+    SCRIPTINS_BODY   = 0x02,  // ...and it is the lone statement of an if, while, for or case, which may run on its own
+    SCRIPTINS_OPCODE = 0x04,  // a keyword was written here, which is all the JIT needs to know
+};
+
+extern uint8_t *g_scriptInsFlags;
+
+int32_t C_OptimizeCode(intptr_t *code, uint8_t const *insFlags, int32_t codeSize);
+
 extern int32_t g_errorLineNum;
 extern int32_t g_tw;
 
@@ -943,6 +965,18 @@ enum IterationTypes_t
     TRANSFORM(CON_WHILEVARN_ACTOR) DELIMITER \
     TRANSFORM(CON_XORVAR_ACTOR) DELIMITER \
 */    \
+/*  superinstructions, only written by C_OptimizeCode() */ \
+    TRANSFORM(CON_ADDVAR_FOLDED) DELIMITER \
+    TRANSFORM(CON_GETTHISSPRITE) DELIMITER \
+    TRANSFORM(CON_IFVARE_SETVAR) DELIMITER \
+    TRANSFORM(CON_IFVARG_SETVAR) DELIMITER \
+    TRANSFORM(CON_IFVARL_SETVAR) DELIMITER \
+    TRANSFORM(CON_IFVARN_SETVAR) DELIMITER \
+    TRANSFORM(CON_SETVAR_FOLDED) DELIMITER \
+    TRANSFORM(CON_SETVAR_SETVAR) DELIMITER \
+    TRANSFORM(CON_SETVARVAR_ADDVAR) DELIMITER \
+    TRANSFORM(CON_SETVARVAR_ADDVARVAR) DELIMITER \
+    \
     TRANSFORM(CON_IFVARVARA) DELIMITER \
     TRANSFORM(CON_IFVARVARAE) DELIMITER \
     TRANSFORM(CON_IFVARVARAND) DELIMITER \
@@ -38,6 +38,25 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "vfs.h"
 
+#ifdef CON_JIT
+# ifdef _WIN32
+#  include "windows_inc.h"
+# else
+#  include <sys/mman.h>
+# endif
+#endif
+
+#ifdef CON_PROFILER
+# include "thread.h"
+# include <atomic>
+# if defined _WIN32
+#  define NEED_MMSYSTEM_H
+#  include "windows_inc.h"
+# elif !defined __PSP__
+#  include <unistd.h>
+# endif
+#endif
+
 #if KRANDDEBUG
 # define GAMEEXEC_INLINE
 # define GAMEEXEC_STATIC
@@ -73,6 +92,56 @@ double g_eventTotalMs[MAXEVENTS], g_actorTotalMs[MAXTILES], g_actorMinMs[MAXTILE
 
 GAMEEXEC_STATIC void VM_Execute(native_t loop);
 
+#ifdef CON_JIT
+typedef struct vmjitunit_ vmjitunit_t;
+
+static vmjitunit_t *g_actorJit[MAXTILES];
+static vmjitunit_t *g_eventJit[MAXEVENTS];
+
+static void VM_ExecuteJit(vmjitunit_t **pUnit, uint32_t numCalls);
+#endif
+
+#ifdef CON_PROFILER
+#define VM_PROFDEPTH 32
+
+enum vmprofframe_t
+{
+    VM_PROFACTOR = 1,
+    VM_PROFEVENT,
+    VM_PROFSTATE,
+};
+
+#define VM_PROFFRAME(type, value) (((type) << 24) | (value))
+
+// the actors, events and states being run, for the sampling thread
+static std::atomic<int32_t> g_vmProfStack[VM_PROFDEPTH];
+static std::atomic<int32_t> g_vmProfDepth;
+static bool g_vmProfRunning;
+
+static FORCE_INLINE void VM_ProfilePush(int32_t const frame)
+{
+    int32_t const depth = g_vmProfDepth.load(std::memory_order_relaxed);
+
+    if (depth < VM_PROFDEPTH)
+        g_vmProfStack[depth].store(frame, std::memory_order_relaxed);
+
+    g_vmProfDepth.store(depth + 1, std::memory_order_release);
+}
+
+static FORCE_INLINE void VM_ProfilePop(void)
+{
+    g_vmProfDepth.store(g_vmProfDepth.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+}
+
+// only while the sampling thread runs; a frame pushed before "con_profile stop" is still popped
+# define VM_PROFILE_PUSH(type, value) \
+    bool const vmProfPushed = g_vmProfRunning && (VM_ProfilePush(VM_PROFFRAME(type, value)), true)
+# define VM_PROFILE_POP() do { if (vmProfPushed) VM_ProfilePop(); } while (0)
+#else
+# define VM_PROFILE_PUSH(type, value)
+# define VM_PROFILE_POP()
+#endif
+
 # include "gamestructures.cpp"
 #endif
 
@@ -182,7 +251,13 @@ static FORCE_INLINE int32_t VM_EventCommon__(int const &eventNum, int const &spr
     if (EDUKE32_PREDICT_FALSE((unsigned)playerNum >= (unsigned)g_mostConcurrentPlayers))
         vm.pPlayer = g_player[0].ps;
 
+    VM_PROFILE_PUSH(VM_PROFEVENT, eventNum);
+#ifdef CON_JIT
+    VM_ExecuteJit(&g_eventJit[eventNum], g_eventCalls[eventNum]);
+#else
     VM_Execute(1);
+#endif
+    VM_PROFILE_POP();
 
     if (vm.flags & VM_KILL)
         VM_DeleteSprite(vm.spriteNum, vm.playerNum);
@@ -1170,6 +1245,42 @@ static int G_StartTrackSlotWrap(int const volumeNum, int const levelNum)
 int G_StartTrack(int const levelNum) { return G_StartTrackSlot(ud.volume_number, levelNum); }
 #endif
 
+#ifndef LUNATIC
+// The sprite the findnear* status list walks would stop at first: of the
+// matches within maxDist (and maxZDist, unless negative), the one in the
+// highest status list that went into it last.
+static int VM_FindNearSprite(int const findPicnum, int const maxDist, int const maxZDist, int const findStatnum, bool const use3D)
+{
+    static int16_t spriteList[MAXSPRITES];
+
+    auto const    pSprite   = &sprite[vm.spriteNum];
+    int32_t const reach     = A_SpriteDistReach(maxDist);
+    int32_t const spriteCnt = spriteGridQuery(pSprite->x - reach, pSprite->y - reach, pSprite->x + reach, pSprite->y + reach, spriteList);
+    int           foundSprite = -1;
+
+    for (bssize_t i = 0; i < spriteCnt; i++)
+    {
+        int const  spriteNum = spriteList[i];
+        auto const pFound    = &sprite[spriteNum];
+
+        if (pFound->picnum != findPicnum || spriteNum == vm.spriteNum || (findStatnum != MAXSTATUS && pFound->statnum != findStatnum))
+            continue;
+
+        if ((use3D ? dist(pSprite, pFound) : ldist(pSprite, pFound)) >= maxDist)
+            continue;
+
+        if (maxZDist >= 0 && klabs(pSprite->z - pFound->z) >= maxZDist)
+            continue;
+
+        if (foundSprite < 0 || pFound->statnum > sprite[foundSprite].statnum
+            || (pFound->statnum == sprite[foundSprite].statnum && spritestatorder[spriteNum] > spritestatorder[foundSprite]))
+            foundSprite = spriteNum;
+    }
+
+    return foundSprite;
+}
+#endif
+
 LUNATIC_EXTERN void G_ShowView(vec3_t vec, fix16_t a, fix16_t horiz, int sect, int x1, int y1, int x2, int y2, bool unbiasedp)
 {
     if (g_screenCapture)
@@ -1259,6 +1370,22 @@ void Screen_Play(void)
 
 #if !defined LUNATIC
 // be careful when changing this--the assignment used as a condition doubles as a null pointer check
+#ifdef CON_JIT
+// with VM_JITPROBE set, the native code only wants to know which way to go, see VM_JitInterpret()
+#define VM_CONDITIONAL(xxx)                                                                            \
+    {                                                                                                  \
+        if (EDUKE32_PREDICT_FALSE(vm.flags & VM_JITPROBE))                                             \
+        {                                                                                              \
+            int const jitTaken = (xxx) ? VM_JITTAKEN : 0;                                              \
+            vm.flags           = (vm.flags & ~VM_JITPROBE) | jitTaken;                                 \
+        }                                                                                              \
+        else if ((xxx) || ((insptr = (intptr_t *)insptr[1]) && ((*insptr & VM_INSTMASK) == CON_ELSE))) \
+        {                                                                                              \
+            insptr += 2;                                                                               \
+            VM_Execute(0);                                                                             \
+        }                                                                                              \
+    }
+#else
 #define VM_CONDITIONAL(xxx)                                                                       \
     {                                                                                             \
         if ((xxx) || ((insptr = (intptr_t *)insptr[1]) && ((*insptr & VM_INSTMASK) == CON_ELSE))) \
@@ -1267,6 +1394,7 @@ void Screen_Play(void)
             VM_Execute(0);                                                                        \
         }                                                                                         \
     }
+#endif
 
 #if defined __GNUC__ || defined __clang__
 # define CON_DIRECT_THREADING_DISPATCH
@@ -1348,7 +1476,9 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
                 {
                     auto tempscrptr = &insptr[2];
                     insptr = (intptr_t *)insptr[1];
+                    VM_PROFILE_PUSH(VM_PROFSTATE, insptr - apScript);
                     VM_Execute(1);
+                    VM_PROFILE_POP();
                     insptr = tempscrptr;
                 }
                 dispatch();
@@ -1478,125 +1608,134 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
 
             vInstruction(CON_IFVARE_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw == *insptr);
                 dispatch();
             vInstruction(CON_IFVARN_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw != *insptr);
                 dispatch();
             vInstruction(CON_IFVARAND_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw & *insptr);
                 dispatch();
             vInstruction(CON_IFVAROR_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw | *insptr);
                 dispatch();
             vInstruction(CON_IFVARXOR_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw ^ *insptr);
                 dispatch();
             vInstruction(CON_IFVAREITHER_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw || *insptr);
                 dispatch();
             vInstruction(CON_IFVARBOTH_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw && *insptr);
                 dispatch();
             vInstruction(CON_IFVARG_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw > *insptr);
                 dispatch();
             vInstruction(CON_IFVARGE_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw >= *insptr);
                 dispatch();
             vInstruction(CON_IFVARL_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw < *insptr);
                 dispatch();
             vInstruction(CON_IFVARLE_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL(tw <= *insptr);
                 dispatch();
             vInstruction(CON_IFVARA_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL((uint32_t)tw > (uint32_t)*insptr);
                 dispatch();
             vInstruction(CON_IFVARAE_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL((uint32_t)tw >= (uint32_t)*insptr);
                 dispatch();
             vInstruction(CON_IFVARB_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL((uint32_t)tw < (uint32_t)*insptr);
                 dispatch();
             vInstruction(CON_IFVARBE_ACTOR):
                 insptr++;
-                tw = aGameVars[*insptr++].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                tw = Gv_GetActorValue(aGameVars[*insptr++], vm.spriteNum & (MAXSPRITES-1));
                 VM_CONDITIONAL((uint32_t)tw <= (uint32_t)*insptr);
                 dispatch();
 
             vInstruction(CON_SETVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] = insptr[1];
+                Gv_SetActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1), insptr[1]);
                 insptr += 2;
                 dispatch();
             vInstruction(CON_ADDVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] += insptr[1];
+                Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1)) += insptr[1];
                 insptr += 2;
                 dispatch();
             vInstruction(CON_SUBVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] -= insptr[1];
+                Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1)) -= insptr[1];
                 insptr += 2;
                 dispatch();
             vInstruction(CON_MULVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] *= insptr[1];
+                Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1)) *= insptr[1];
                 insptr += 2;
                 dispatch();
             vInstruction(CON_ANDVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] &= insptr[1];
+                Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1)) &= insptr[1];
                 insptr += 2;
                 dispatch();
             vInstruction(CON_XORVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] ^= insptr[1];
+                Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1)) ^= insptr[1];
                 insptr += 2;
                 dispatch();
             vInstruction(CON_ORVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] |= insptr[1];
+                Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1)) |= insptr[1];
                 insptr += 2;
                 dispatch();
             vInstruction(CON_SHIFTVARL_ACTOR):
+            {
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] <<= insptr[1];
+                // shifted as intptr_t, so counts of 32-63 stay defined with CON_PAGED_ACTORVARS
+                auto const &var      = aGameVars[*insptr];
+                int const   spriteNum = vm.spriteNum & (MAXSPRITES-1);
+                Gv_SetActorValue(var, spriteNum, (intptr_t)Gv_GetActorValue(var, spriteNum) << (insptr[1] & 63));
                 insptr += 2;
                 dispatch();
+            }
             vInstruction(CON_SHIFTVARR_ACTOR):
+            {
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] >>= insptr[1];
+                auto const &var      = aGameVars[*insptr];
+                int const   spriteNum = vm.spriteNum & (MAXSPRITES-1);
+                Gv_SetActorValue(var, spriteNum, (intptr_t)Gv_GetActorValue(var, spriteNum) >> (insptr[1] & 63));
                 insptr += 2;
                 dispatch();
+            }
 
             vInstruction(CON_IFVARE_PLAYER):
                 insptr++;
@@ -1747,11 +1886,11 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
             vInstruction(CON_WHILEVARN_ACTOR):
             {
                 auto const savedinsptr = &insptr[2];
-                auto &v = aGameVars[savedinsptr[-1]].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                auto const &var = aGameVars[savedinsptr[-1]];
                 do
                 {
                     insptr = savedinsptr;
-                    tw = (v != *insptr);
+                    tw = (Gv_GetActorValue(var, vm.spriteNum & (MAXSPRITES-1)) != *insptr);
                     VM_CONDITIONAL(tw);
                 } while (tw);
 
@@ -1761,11 +1900,11 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
             vInstruction(CON_WHILEVARL_ACTOR):
             {
                 auto const savedinsptr = &insptr[2];
-                auto &v = aGameVars[savedinsptr[-1]].pValues[vm.spriteNum & (MAXSPRITES-1)];
+                auto const &var = aGameVars[savedinsptr[-1]];
                 do
                 {
                     insptr = savedinsptr;
-                    tw = (v < *insptr);
+                    tw = (Gv_GetActorValue(var, vm.spriteNum & (MAXSPRITES-1)) < *insptr);
                     VM_CONDITIONAL(tw);
                 } while (tw);
 
@@ -1807,7 +1946,7 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
                 dispatch();
             vInstruction(CON_MODVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] %= insptr[1];
+                Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1)) %= insptr[1];
                 insptr += 2;
                 dispatch();
             vInstruction(CON_MODVAR_PLAYER):
@@ -1980,7 +2119,7 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
             vInstruction(CON_DIVVAR_ACTOR):
             {
                 insptr++;
-                auto &v = aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES - 1)];
+                auto &v = Gv_ActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES - 1));
 
                 v = tabledivide32(v, insptr[1]);
                 insptr += 2;
@@ -2189,6 +2328,96 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
                 dispatch();
             }
 
+            // superinstructions from C_OptimizeCode(); the pairs step over their second instruction,
+            // which is still in the bytecode right after the first
+            vInstruction(CON_SETVAR_FOLDED):
+                Gv_SetVarX(insptr[1], insptr[2]);
+                insptr += 6;
+                dispatch();
+
+            vInstruction(CON_ADDVAR_FOLDED):
+                Gv_AddVar(insptr[1], insptr[2]);
+                insptr += 6;
+                dispatch();
+
+            vInstruction(CON_SETVAR_SETVAR):
+                aGameVars[insptr[1]].global = (int32_t)insptr[2];
+                aGameVars[insptr[4]].global = (int32_t)insptr[5];
+                insptr += 6;
+                dispatch();
+
+            vInstruction(CON_SETVARVAR_ADDVAR):
+                aGameVars[insptr[1]].global = (int32_t)aGameVars[insptr[2]].global;
+                aGameVars[insptr[4]].global += (int32_t)insptr[5];
+                insptr += 6;
+                dispatch();
+
+            vInstruction(CON_SETVARVAR_ADDVARVAR):
+                aGameVars[insptr[1]].global = (int32_t)aGameVars[insptr[2]].global;
+                aGameVars[insptr[4]].global += (int32_t)aGameVars[insptr[5]].global;
+                insptr += 6;
+                dispatch();
+
+            vInstruction(CON_IFVARE_SETVAR):
+                insptr++;
+                tw = (int32_t)aGameVars[*insptr++].global;
+                if (tw == *insptr)
+                {
+                    aGameVars[insptr[3]].global = (int32_t)insptr[4];
+                    insptr += 5;
+                }
+                else VM_CONDITIONAL(false);
+                dispatch();
+
+            vInstruction(CON_IFVARN_SETVAR):
+                insptr++;
+                tw = (int32_t)aGameVars[*insptr++].global;
+                if (tw != *insptr)
+                {
+                    aGameVars[insptr[3]].global = (int32_t)insptr[4];
+                    insptr += 5;
+                }
+                else VM_CONDITIONAL(false);
+                dispatch();
+
+            vInstruction(CON_IFVARL_SETVAR):
+                insptr++;
+                tw = (int32_t)aGameVars[*insptr++].global;
+                if (tw < *insptr)
+                {
+                    aGameVars[insptr[3]].global = (int32_t)insptr[4];
+                    insptr += 5;
+                }
+                else VM_CONDITIONAL(false);
+                dispatch();
+
+            vInstruction(CON_IFVARG_SETVAR):
+                insptr++;
+                tw = (int32_t)aGameVars[*insptr++].global;
+                if (tw > *insptr)
+                {
+                    aGameVars[insptr[3]].global = (int32_t)insptr[4];
+                    insptr += 5;
+                }
+                else VM_CONDITIONAL(false);
+                dispatch();
+
+            vInstruction(CON_GETTHISSPRITE):
+                insptr++;
+                {
+                    auto const &spriteLabel = ActorLabels[insptr[1]];
+
+                    if (EDUKE32_PREDICT_FALSE((unsigned)vm.spriteNum >= MAXSPRITES))
+                    {
+                        CON_ERRPRINTF("invalid sprite %d\n", vm.spriteNum);
+                        abort_after_error();
+                    }
+
+                    aGameVars[insptr[2]].global = VM_GetStruct(spriteLabel.flags, (intptr_t *)((char *)&sprite[vm.spriteNum] + spriteLabel.offset));
+                    insptr += 3;
+                    dispatch();
+                }
+
             vInstruction(CON_SETVAR):
                 insptr++;
                 Gv_SetVarX(*insptr, insptr[1]);
@@ -2293,7 +2522,7 @@ GAMEEXEC_STATIC void VM_Execute(native_t const poop)
 
             vInstruction(CON_RANDVAR_ACTOR):
                 insptr++;
-                aGameVars[*insptr].pValues[vm.spriteNum & (MAXSPRITES-1)] = mulscale16(krand(), insptr[1] + 1);
+                Gv_SetActorValue(aGameVars[*insptr], vm.spriteNum & (MAXSPRITES-1), mulscale16(krand(), insptr[1] + 1));
                 insptr += 2;
                 dispatch();
 #endif
@@ -5443,6 +5672,13 @@ badindex:
                     if (tw == CON_FINDNEARSPRITE || tw == CON_FINDNEARSPRITE3D)
                         findStatnum = MAXSTATUS - 1;
 
+                    if (spritegrid)
+                    {
+                        Gv_SetVarX(returnVar, VM_FindNearSprite(findPicnum, maxDist, -1, findStatnum == STAT_ACTOR ? STAT_ACTOR : MAXSTATUS,
+                                                                tw == CON_FINDNEARACTOR3D || tw == CON_FINDNEARSPRITE3D));
+                        dispatch();
+                    }
+
                     if (tw == CON_FINDNEARACTOR3D || tw == CON_FINDNEARSPRITE3D)
                     {
                         do
@@ -5507,6 +5743,12 @@ badindex:
                     int foundSprite = -1;
                     int findStatnum = MAXSTATUS - 1;
 
+                    if (spritegrid)
+                    {
+                        Gv_SetVarX(returnVar, VM_FindNearSprite(findPicnum, maxDist, max(maxZDist, 0), tw == CON_FINDNEARACTORZ ? STAT_ACTOR : MAXSTATUS, false));
+                        dispatch();
+                    }
+
                     do
                     {
                         int spriteNum = headspritestat[tw == CON_FINDNEARACTORZ ? STAT_ACTOR : findStatnum];  // all sprites
@@ -6453,145 +6695,1431 @@ badindex:
     } while (loop && (vm.flags & (VM_RETURN|VM_KILL|VM_NOEXECUTE)) == 0);
 }
 
-// NORECURSE
-void A_LoadActor(int32_t spriteNum)
+#ifdef CON_JIT
+// Template JIT: the code of actors and events that have run g_vmJitThreshold times is translated
+// into x86-64 code.  Instructions on plain global gamevars, and the braces and elses around them,
+// become native code; every other instruction calls VM_JitInterpret(), which runs it in the
+// interpreter and returns the native code to continue at.
+//
+// The native code runs the bytecode in the same order as VM_Execute(1).  The lone statement of an
+// if runs in a nested VM_Execute(0) there only so that it ends after one statement, which the
+// straight-line native code gets for free, so the only state it keeps is the loop count (rbx),
+// for the } that ends the code and for handing the rest over to VM_Execute().
+
+int32_t g_vmJit          = 0;
+int32_t g_vmJitThreshold = 64;
+
+#define VM_JIT_MAXLENGTH 65536  // words of bytecode in one actor or event
+
+struct vmjitunit_
 {
-    vm.spriteNum = spriteNum;           // Sprite ID
-    vm.pSprite   = &sprite[spriteNum];  // Pointer to sprite structure
-    vm.pActor    = &actor[spriteNum];
+    intptr_t const *start;
+    int32_t   length;   // words from start to the enda, endevent or ends
+    int32_t  *offsets;  // of the native code for each word an instruction starts at, or -1
+    uint8_t  *code;
+    int32_t   codeSize, exitOfs;
+    int32_t   numNative, numInterpreted;
+};
+
+// could not be compiled, don't try again
+#define VM_JIT_NONE ((vmjitunit_t *)(intptr_t)-1)
+
+typedef struct
+{
+    int32_t at;      // of a rel32
+    int32_t target;  // word of the unit, or -1 for the exit
+} vmjitfixup_t;
 
-    if (g_tile[vm.pSprite->picnum].loadPtr == NULL)
-        return;
+typedef struct
+{
+    vmjitunit_t *unit;
+    uint8_t const *isLabel;
 
-    vm.pData      = &actor[spriteNum].t_data[0];  // Sprite's 'extra' data
-    vm.playerNum  = -1;                           // Player ID
-    vm.playerDist = -1;                           // Distance
-    vm.pPlayer    = g_player[0].ps;
+    GrowArray<uint8_t, 4096> code;
+    GrowArray<vmjitfixup_t, 256> fixups;
+} vmjitcompiler_t;
 
-    vm.flags &= ~(VM_RETURN|VM_KILL|VM_NOEXECUTE);
+enum
+{
+    JIT_RAX = 0, JIT_RCX = 1, JIT_RDX = 2, JIT_RBX = 3, JIT_RSI = 6, JIT_RDI = 7, JIT_R8 = 8,
 
-    if ((unsigned)vm.pSprite->sectnum >= MAXSECTORS)
-    {
-        A_DeleteSprite(vm.spriteNum);
-        return;
-    }
+    // condition codes of jcc
+    JIT_CC_B = 0x2, JIT_CC_AE = 0x3, JIT_CC_E = 0x4, JIT_CC_NE = 0x5, JIT_CC_BE = 0x6, JIT_CC_A = 0x7,
+    JIT_CC_L = 0xc, JIT_CC_GE = 0xd, JIT_CC_LE = 0xe, JIT_CC_G = 0xf,
+    JIT_CC_ALWAYS = 0x10, JIT_CC_NEVER = 0x11,
+};
 
-    insptr = g_tile[vm.pSprite->picnum].loadPtr;
-    VM_Execute(1);
-    insptr = NULL;
+static void VM_JitBytes(vmjitcompiler_t &jit, char const *bytes, int const numBytes)
+{
+    for (int i = 0; i < numBytes; i++)
+        jit.code.append((uint8_t)bytes[i]);
+}
 
-    if (vm.flags & VM_KILL)
-        A_DeleteSprite(vm.spriteNum);
+#define JIT_EMIT(bytes) VM_JitBytes(jit, bytes, sizeof(bytes) - 1)
+
+static void VM_JitImm32(vmjitcompiler_t &jit, int32_t const value)
+{
+    for (int i = 0; i < 4; i++)
+        jit.code.append((uint8_t)((uint32_t)value >> (i << 3)));
 }
-#endif
 
-void VM_UpdateAnim(int spriteNum, int32_t *pData)
+// mov reg, imm64
+static void VM_JitMovImm64(vmjitcompiler_t &jit, int const reg, void const *value)
 {
-#if !defined LUNATIC
-    size_t const actionofs = AC_ACTION_ID(pData);
-    auto const actionptr = (actionofs != 0 && actionofs + (ACTION_PARAM_COUNT-1) < (unsigned) g_scriptSize) ? &apScript[actionofs] : NULL;
+    jit.code.append(0x48 | (reg >> 3));
+    jit.code.append(0xb8 | (reg & 7));
 
-    if (actionptr != NULL)
-#endif
-    {
-#if !defined LUNATIC
-        int const action_frames = actionptr[ACTION_NUMFRAMES];
-        int const action_incval = actionptr[ACTION_INCVAL];
-        int const action_delay  = actionptr[ACTION_DELAY];
+    for (int i = 0; i < 8; i++)
+        jit.code.append((uint8_t)((uintptr_t)value >> (i << 3)));
+}
+
+static void VM_JitRel32(vmjitcompiler_t &jit, int32_t const target)
+{
+    jit.fixups.append({ (int32_t)jit.code.size(), target });
+    VM_JitImm32(jit, 0);
+}
+
+static FORCE_INLINE bool VM_JitHasLabel(vmjitcompiler_t const &jit, intptr_t const *ins)
+{
+    return ins >= jit.unit->start && ins < jit.unit->start + jit.unit->length && jit.isLabel[ins - jit.unit->start];
+}
+
+// calls func(unit, ins, loop) and jumps to the native code it returns
+static void VM_JitCallHelper(vmjitcompiler_t &jit, void const *func, intptr_t const *ins)
+{
+#ifdef _WIN32
+    VM_JitMovImm64(jit, JIT_RCX, jit.unit);
+    VM_JitMovImm64(jit, JIT_RDX, ins);
+    JIT_EMIT("\x49\x89\xd8");  // mov r8, rbx
 #else
-        int const action_frames = actor[spriteNum].ac.numframes;
-        int const action_incval = actor[spriteNum].ac.incval;
-        int const action_delay  = actor[spriteNum].ac.delay;
+    VM_JitMovImm64(jit, JIT_RDI, jit.unit);
+    VM_JitMovImm64(jit, JIT_RSI, ins);
+    JIT_EMIT("\x48\x89\xda");  // mov rdx, rbx
 #endif
-        auto actionticsptr = &AC_ACTIONTICS(&sprite[spriteNum], &actor[spriteNum]);
-        *actionticsptr += TICSPERFRAME;
+    VM_JitMovImm64(jit, JIT_RAX, func);
+    JIT_EMIT("\xff\xd0");  // call rax
+    JIT_EMIT("\xff\xe0");  // jmp rax
+}
 
-        if (*actionticsptr > action_delay)
-        {
-            *actionticsptr = 0;
-            AC_ACTION_COUNT(pData)++;
-            AC_CURFRAME(pData) += action_incval;
-        }
+static void *VM_JitResume(vmjitunit_t const *unit, intptr_t const *ins, native_t loop);
 
-        if (klabs(AC_CURFRAME(pData)) >= klabs(action_frames * action_incval))
-            AC_CURFRAME(pData) = 0;
+// continues at ins, which may not have native code: that happens with instructions the compiler
+// wrote over after marking them, and the interpreter takes the rest from there
+static void VM_JitGoto(vmjitcompiler_t &jit, intptr_t const *ins, intptr_t const *nextLabel)
+{
+    if (!VM_JitHasLabel(jit, ins))
+        VM_JitCallHelper(jit, (void const *)VM_JitResume, ins);
+    else if (ins != nextLabel)
+    {
+        JIT_EMIT("\xe9");  // jmp rel32
+        VM_JitRel32(jit, ins - jit.unit->start);
     }
 }
 
-// NORECURSE
-void A_Execute(int spriteNum, int playerNum, int playerDist)
+static void VM_JitBranch(vmjitcompiler_t &jit, int const cc, intptr_t const *ins)
 {
-    // for some reason this is faster than using the C++ syntax; e.g vm = vmstate_t{ ... }
-    vmstate_t const tempvm
-    = { spriteNum, playerNum, playerDist, 0, &sprite[spriteNum], &actor[spriteNum].t_data[0], g_player[playerNum].ps, &actor[spriteNum] };
-    vm = tempvm;
+    if (cc == JIT_CC_NEVER)
+        return;
 
-#ifdef LUNATIC
-    int32_t killit=0;
-#endif
+    if (cc == JIT_CC_ALWAYS)
+    {
+        VM_JitGoto(jit, ins, NULL);
+        return;
+    }
 
-/*
-    if (g_netClient && A_CheckSpriteFlags(spriteNum, SFLAG_NULL))
+    if (VM_JitHasLabel(jit, ins))
     {
-        A_DeleteSprite(spriteNum);
+        jit.code.append(0x0f);
+        jit.code.append(0x80 | cc);
+        VM_JitRel32(jit, ins - jit.unit->start);
         return;
     }
-*/
 
-    if (g_netClient) // [75] The server should not overwrite its own randomseed
-        randomseed = ticrandomseed;
+    // jump over the call to VM_JitResume() when the condition is false
+    jit.code.append(0x70 | (cc ^ 1));
+    jit.code.append(0);
 
-    if (EDUKE32_PREDICT_FALSE((unsigned)vm.pSprite->sectnum >= MAXSECTORS))
+    int const skipOfs = jit.code.size();
+    VM_JitCallHelper(jit, (void const *)VM_JitResume, ins);
+    jit.code[skipOfs - 1] = (uint8_t)(jit.code.size() - skipOfs);
+}
+
+static bool VM_JitIsGlobalVar(intptr_t const varNum)
+{
+    return (uintptr_t)varNum < (uintptr_t)g_gameVarCount && varNum != g_thisActorVarID
+           && (aGameVars[varNum].flags & (GAMEVAR_USER_MASK | GAMEVAR_PTR_MASK)) == 0;
+}
+
+static FORCE_INLINE bool VM_JitIsInt32(intptr_t const value) { return value == (int32_t)value; }
+
+// op qword [aGameVars[varNum].global], (int32_t)value, as Gv_SetVar() and the VM_GAMEVAR_OPERATOR()s do it
+static bool VM_JitVarOp(vmjitcompiler_t &jit, int const opcode, intptr_t const varNum, intptr_t const value)
+{
+    if (!VM_JitIsGlobalVar(varNum) || !VM_JitIsInt32(value))
+        return false;
+
+    if ((opcode == CON_SHIFTVARL || opcode == CON_SHIFTVARR) && (uintptr_t)value > 63)
+        return false;
+
+    VM_JitMovImm64(jit, JIT_RAX, &aGameVars[varNum].global);
+
+    switch (opcode)
     {
-        if (A_CheckEnemySprite(vm.pSprite))
-            P_AddKills(vm.pPlayer, 1);
+        case CON_SETVAR: JIT_EMIT("\x48\xc7\x00"); break;  // mov qword [rax], imm32
+        case CON_ADDVAR: JIT_EMIT("\x48\x81\x00"); break;  // add qword [rax], imm32
+        case CON_SUBVAR: JIT_EMIT("\x48\x81\x28"); break;  // sub
+        case CON_ANDVAR: JIT_EMIT("\x48\x81\x20"); break;  // and
+        case CON_ORVAR:  JIT_EMIT("\x48\x81\x08"); break;  // or
+        case CON_XORVAR: JIT_EMIT("\x48\x81\x30"); break;  // xor
+        case CON_MULVAR:
+            JIT_EMIT("\x48\x69\x08");  // imul rcx, qword [rax], imm32
+            VM_JitImm32(jit, value);
+            JIT_EMIT("\x48\x89\x08");  // mov qword [rax], rcx
+            return true;
+        case CON_SHIFTVARL:
+            JIT_EMIT("\x48\xc1\x20");  // shl qword [rax], imm8
+            jit.code.append((uint8_t)value);
+            return true;
+        case CON_SHIFTVARR:
+            JIT_EMIT("\x48\xc1\x38");  // sar qword [rax], imm8
+            jit.code.append((uint8_t)value);
+            return true;
+    }
 
-        A_DeleteSprite(vm.spriteNum);
-        return;
+    VM_JitImm32(jit, value);
+    return true;
+}
+
+// op qword [aGameVars[varNum].global], (int32_t)aGameVars[srcVarNum].global
+static bool VM_JitVarVarOp(vmjitcompiler_t &jit, int const opcode, intptr_t const varNum, intptr_t const srcVarNum)
+{
+    if (!VM_JitIsGlobalVar(varNum) || !VM_JitIsGlobalVar(srcVarNum))
+        return false;
+
+    VM_JitMovImm64(jit, JIT_RCX, &aGameVars[srcVarNum].global);
+    JIT_EMIT("\x48\x63\x09");  // movsxd rcx, dword [rcx]
+    VM_JitMovImm64(jit, JIT_RAX, &aGameVars[varNum].global);
+
+    switch (opcode)
+    {
+        case CON_SETVARVAR: JIT_EMIT("\x48\x89\x08"); break;  // mov qword [rax], rcx
+        case CON_ADDVARVAR: JIT_EMIT("\x48\x01\x08"); break;  // add
+        case CON_SUBVARVAR: JIT_EMIT("\x48\x29\x08"); break;  // sub
+        case CON_ANDVARVAR: JIT_EMIT("\x48\x21\x08"); break;  // and
+        case CON_ORVARVAR:  JIT_EMIT("\x48\x09\x08"); break;  // or
+        case CON_XORVARVAR: JIT_EMIT("\x48\x31\x08"); break;  // xor
+        case CON_MULVARVAR:
+            JIT_EMIT("\x48\x0f\xaf\x08");  // imul rcx, qword [rax]
+            JIT_EMIT("\x48\x89\x08");      // mov qword [rax], rcx
+            break;
     }
 
-    VM_UpdateAnim(vm.spriteNum, vm.pData);
+    return true;
+}
 
-    double t = timerGetHiTicks();
-#ifdef LUNATIC
-    int const picnum = vm.pSprite->picnum;
+// the condition code an ifvar<op> or ifvarvar<op> is true for, after comparing the two values
+static int VM_JitConditionCode(int const opcode)
+{
+    switch (opcode)
+    {
+        case CON_IFVARE:  case CON_IFVARVARE:  case CON_IFVARE_SETVAR: return JIT_CC_E;
+        case CON_IFVARN:  case CON_IFVARVARN:  case CON_IFVARN_SETVAR: return JIT_CC_NE;
+        case CON_IFVARG:  case CON_IFVARVARG:  case CON_IFVARG_SETVAR: return JIT_CC_G;
+        case CON_IFVARGE: case CON_IFVARVARGE: return JIT_CC_GE;
+        case CON_IFVARL:  case CON_IFVARVARL:  case CON_IFVARL_SETVAR: return JIT_CC_L;
+        case CON_IFVARLE: case CON_IFVARVARLE: return JIT_CC_LE;
+        case CON_IFVARA:  case CON_IFVARVARA:  return JIT_CC_A;
+        case CON_IFVARAE: case CON_IFVARVARAE: return JIT_CC_AE;
+        case CON_IFVARB:  case CON_IFVARVARB:  return JIT_CC_B;
+        case CON_IFVARBE: case CON_IFVARVARBE: return JIT_CC_BE;
+        case CON_IFVARXOR: case CON_IFVARVARXOR: return JIT_CC_NE;
+    }
 
-    if (L_IsInitialized(&g_ElState) && El_HaveActor(picnum))
-        killit = (El_CallActor(&g_ElState, picnum, spriteNum, playerNum, playerDist)==1);
-#else
-    int const picnum = vm.pSprite->picnum;
-    insptr = 4 + (g_tile[vm.pSprite->picnum].execPtr);
-    VM_Execute(1);
-    insptr = NULL;
-#endif
+    return -1;
+}
 
-    t = timerGetHiTicks()-t;
-    g_actorTotalMs[picnum] += t;
-    g_actorMinMs[picnum] = min(g_actorMinMs[picnum], t);
-    g_actorMaxMs[picnum] = max(g_actorMaxMs[picnum], t);
-    g_actorCalls[picnum]++;
+// tests a global against a constant and returns the condition code that means true
+static int VM_JitVarTest(vmjitcompiler_t &jit, int const opcode, intptr_t const varNum, intptr_t const value)
+{
+    VM_JitMovImm64(jit, JIT_RAX, &aGameVars[varNum].global);
 
-#ifdef LUNATIC
-    if (killit)
-#else
-    if (vm.flags & VM_KILL)
-#endif
+    switch (opcode)
     {
-        VM_DeleteSprite(spriteNum, playerNum);
-        return;
+        case CON_IFVARAND:
+            JIT_EMIT("\xf7\x00");  // test dword [rax], imm32
+            VM_JitImm32(jit, value);
+            return JIT_CC_NE;
+        case CON_IFVAROR:
+        case CON_IFVAREITHER:
+            if (value)
+                return JIT_CC_ALWAYS;
+            JIT_EMIT("\x83\x38\x00");  // cmp dword [rax], 0
+            return JIT_CC_NE;
+        case CON_IFVARBOTH:
+            if (!value)
+                return JIT_CC_NEVER;
+            JIT_EMIT("\x83\x38\x00");
+            return JIT_CC_NE;
     }
 
-    VM_Move();
+    JIT_EMIT("\x81\x38");  // cmp dword [rax], imm32
+    VM_JitImm32(jit, value);
+    return VM_JitConditionCode(opcode);
+}
 
-    if (vm.pSprite->statnum != STAT_ACTOR)
+// tests two globals against each other and returns the condition code that means true
+static int VM_JitVarVarTest(vmjitcompiler_t &jit, int const opcode, intptr_t const varNum, intptr_t const otherVarNum)
+{
+    VM_JitMovImm64(jit, JIT_RAX, &aGameVars[varNum].global);
+    JIT_EMIT("\x8b\x00");  // mov eax, dword [rax]
+    VM_JitMovImm64(jit, JIT_RCX, &aGameVars[otherVarNum].global);
+
+    switch (opcode)
     {
-#ifndef EDUKE32_STANDALONE
-        if (vm.pSprite->statnum == STAT_STANDABLE)
-        {
-            switch (DYNAMICTILEMAP(vm.pSprite->picnum))
-            {
-                case RUBBERCAN__STATIC:
-                case EXPLODINGBARREL__STATIC:
+        case CON_IFVARVARAND:
+            JIT_EMIT("\x85\x01");  // test eax, dword [rcx]
+            return JIT_CC_NE;
+        case CON_IFVARVAROR:
+        case CON_IFVARVAREITHER:
+            JIT_EMIT("\x0b\x01");  // or eax, dword [rcx]
+            return JIT_CC_NE;
+        case CON_IFVARVARBOTH:
+            JIT_EMIT("\x85\xc0");      // test eax, eax
+            JIT_EMIT("\x0f\x95\xc0");  // setnz al
+            JIT_EMIT("\x83\x39\x00");  // cmp dword [rcx], 0
+            JIT_EMIT("\x0f\x95\xc1");  // setnz cl
+            JIT_EMIT("\x84\xc8");      // test al, cl
+            return JIT_CC_NE;
+    }
+
+    JIT_EMIT("\x3b\x01");  // cmp eax, dword [rcx]
+    return VM_JitConditionCode(opcode);
+}
+
+// where an if that is false continues: the fail address, or the statement of its else
+static intptr_t const *VM_JitFailTarget(intptr_t const failPtr)
+{
+    auto const ins = (intptr_t const *)failPtr;
+
+    if (ins < apScript || ins >= g_scriptPtr)
+        return NULL;
+
+    return ((*ins & VM_INSTMASK) == CON_ELSE) ? ins + 2 : ins;
+}
+
+// compiles the instruction at ins and returns false for ones left to the interpreter
+static bool VM_JitInstruction(vmjitcompiler_t &jit, intptr_t const *ins, intptr_t const *nextLabel)
+{
+    int const opcode = *ins & VM_INSTMASK;
+    auto const end = jit.unit->start + jit.unit->length;
+
+    switch (opcode)
+    {
+        case CON_LEFTBRACE:
+            JIT_EMIT("\x48\xff\xc3");  // inc rbx
+            VM_JitGoto(jit, ins + 1, nextLabel);
+            return true;
+
+        case CON_RIGHTBRACE:
+            JIT_EMIT("\x48\xff\xcb");  // dec rbx
+            JIT_EMIT("\x0f\x84");      // jz exit
+            VM_JitRel32(jit, -1);
+            VM_JitGoto(jit, ins + 1, nextLabel);
+            return true;
+
+        case CON_ELSE:
+        {
+            auto const target = (intptr_t const *)ins[1];
+
+            if (ins + 1 >= end || target < apScript || target >= g_scriptPtr)
+                return false;
+
+            VM_JitGoto(jit, target, nextLabel);
+            return true;
+        }
+
+        case CON_NULLOP:
+            VM_JitGoto(jit, ins + 1, nextLabel);
+            return true;
+
+        case CON_ENDA:
+        case CON_ENDEVENT:
+        case CON_ENDS:
+        case CON_BREAK:
+        case CON_ENDSWITCH:
+            JIT_EMIT("\xe9");  // jmp exit
+            VM_JitRel32(jit, -1);
+            return true;
+    }
+
+    if (ins + 3 > end)
+        return false;
+
+    switch (opcode)
+    {
+        case CON_SETVAR:
+        case CON_ADDVAR:
+        case CON_SUBVAR:
+        case CON_MULVAR:
+        case CON_ANDVAR:
+        case CON_ORVAR:
+        case CON_XORVAR:
+        case CON_SHIFTVARL:
+        case CON_SHIFTVARR:
+            if (!VM_JitVarOp(jit, opcode, ins[1], ins[2]))
+                return false;
+            VM_JitGoto(jit, ins + 3, nextLabel);
+            return true;
+
+        case CON_SETVARVAR:
+        case CON_ADDVARVAR:
+        case CON_SUBVARVAR:
+        case CON_MULVARVAR:
+        case CON_ANDVARVAR:
+        case CON_ORVARVAR:
+        case CON_XORVARVAR:
+            if (!VM_JitVarVarOp(jit, opcode, ins[1], ins[2]))
+                return false;
+            VM_JitGoto(jit, ins + 3, nextLabel);
+            return true;
+    }
+
+    if (ins + 7 > end)
+        return false;
+
+    intptr_t const *failTarget;
+
+    switch (opcode)
+    {
+        case CON_IFVARE:
+        case CON_IFVARN:
+        case CON_IFVARG:
+        case CON_IFVARGE:
+        case CON_IFVARL:
+        case CON_IFVARLE:
+        case CON_IFVARA:
+        case CON_IFVARAE:
+        case CON_IFVARB:
+        case CON_IFVARBE:
+        case CON_IFVARAND:
+        case CON_IFVAROR:
+        case CON_IFVARXOR:
+        case CON_IFVAREITHER:
+        case CON_IFVARBOTH:
+            if (!VM_JitIsGlobalVar(ins[1]) || !VM_JitIsInt32(ins[2]) || (failTarget = VM_JitFailTarget(ins[3])) == NULL)
+                return false;
+            VM_JitBranch(jit, VM_JitVarTest(jit, opcode, ins[1], ins[2]) ^ 1, failTarget);
+            VM_JitGoto(jit, ins + 4, nextLabel);
+            return true;
+
+        case CON_IFVARVARE:
+        case CON_IFVARVARN:
+        case CON_IFVARVARG:
+        case CON_IFVARVARGE:
+        case CON_IFVARVARL:
+        case CON_IFVARVARLE:
+        case CON_IFVARVARA:
+        case CON_IFVARVARAE:
+        case CON_IFVARVARB:
+        case CON_IFVARVARBE:
+        case CON_IFVARVARAND:
+        case CON_IFVARVAROR:
+        case CON_IFVARVARXOR:
+        case CON_IFVARVAREITHER:
+        case CON_IFVARVARBOTH:
+            if (!VM_JitIsGlobalVar(ins[1]) || !VM_JitIsGlobalVar(ins[2]) || (failTarget = VM_JitFailTarget(ins[3])) == NULL)
+                return false;
+            VM_JitBranch(jit, VM_JitVarVarTest(jit, opcode, ins[1], ins[2]) ^ 1, failTarget);
+            VM_JitGoto(jit, ins + 4, nextLabel);
+            return true;
+
+        // the superinstructions from C_OptimizeCode()
+        case CON_SETVAR_FOLDED:
+        case CON_ADDVAR_FOLDED:
+            if (!VM_JitVarOp(jit, opcode == CON_SETVAR_FOLDED ? CON_SETVAR : CON_ADDVAR, ins[1], ins[2]))
+                return false;
+            VM_JitGoto(jit, ins + 6, nextLabel);
+            return true;
+
+        case CON_SETVAR_SETVAR:
+            if (!VM_JitIsGlobalVar(ins[1]) || !VM_JitIsGlobalVar(ins[4]))
+                return false;
+            VM_JitVarOp(jit, CON_SETVAR, ins[1], ins[2]);
+            VM_JitVarOp(jit, CON_SETVAR, ins[4], ins[5]);
+            VM_JitGoto(jit, ins + 6, nextLabel);
+            return true;
+
+        case CON_SETVARVAR_ADDVAR:
+        case CON_SETVARVAR_ADDVARVAR:
+            if (!VM_JitIsGlobalVar(ins[1]) || !VM_JitIsGlobalVar(ins[2]) || !VM_JitIsGlobalVar(ins[4])
+                || (opcode == CON_SETVARVAR_ADDVARVAR && !VM_JitIsGlobalVar(ins[5])))
+                return false;
+            VM_JitVarVarOp(jit, CON_SETVARVAR, ins[1], ins[2]);
+            if (opcode == CON_SETVARVAR_ADDVAR)
+                VM_JitVarOp(jit, CON_ADDVAR, ins[4], ins[5]);
+            else
+                VM_JitVarVarOp(jit, CON_ADDVARVAR, ins[4], ins[5]);
+            VM_JitGoto(jit, ins + 6, nextLabel);
+            return true;
+
+        case CON_IFVARE_SETVAR:
+        case CON_IFVARN_SETVAR:
+        case CON_IFVARL_SETVAR:
+        case CON_IFVARG_SETVAR:
+            if (!VM_JitIsGlobalVar(ins[1]) || !VM_JitIsInt32(ins[2]) || !VM_JitIsGlobalVar(ins[5])
+                || (failTarget = VM_JitFailTarget(ins[3])) == NULL)
+                return false;
+            VM_JitMovImm64(jit, JIT_RAX, &aGameVars[ins[1]].global);
+            JIT_EMIT("\x81\x38");  // cmp dword [rax], imm32
+            VM_JitImm32(jit, ins[2]);
+            VM_JitBranch(jit, VM_JitConditionCode(opcode) ^ 1, failTarget);
+            VM_JitVarOp(jit, CON_SETVAR, ins[5], ins[6]);
+            VM_JitGoto(jit, ins + 7, nextLabel);
+            return true;
+    }
+
+    return false;
+}
+
+static void *VM_JitContinue(vmjitunit_t const *unit, native_t loop)
+{
+    if (vm.flags & (VM_RETURN|VM_KILL|VM_NOEXECUTE))
+        return unit->code + unit->exitOfs;
+
+    intptr_t const ofs = insptr - unit->start;
+
+    if ((uintptr_t)ofs < (uintptr_t)unit->length && unit->offsets[ofs] >= 0)
+        return unit->code + unit->offsets[ofs];
+
+    // the code the JIT doesn't know about, e.g. another event's after a jump
+    VM_Execute(loop);
+    return unit->code + unit->exitOfs;
+}
+
+static void *VM_JitResume(vmjitunit_t const *unit, intptr_t const *ins, native_t loop)
+{
+    insptr = ins;
+    return VM_JitContinue(unit, loop);
+}
+
+// the ifs whose handler is only VM_CONDITIONAL(), so the native code can take their branch itself
+static bool VM_JitIsCondition(int const opcode)
+{
+    switch (opcode)
+    {
+        case CON_IFACTION:     case CON_IFACTIONCOUNT:   case CON_IFACTOR:         case CON_IFACTORNOTSTAYPUT:
+        case CON_IFACTORSOUND: case CON_IFAI:            case CON_IFANGDIFFL:      case CON_IFAWAYFROMWALL:
+        case CON_IFBULLETNEAR: case CON_IFCEILINGDISTL:  case CON_IFCLIENT:        case CON_IFCOUNT:
+        case CON_IFDEAD:       case CON_IFFLOORDISTL:    case CON_IFGAPZL:         case CON_IFHITSPACE:
+        case CON_IFHITWEAPON:  case CON_IFINOUTERSPACE:  case CON_IFINSPACE:       case CON_IFINWATER:
+        case CON_IFMOVE:       case CON_IFMULTIPLAYER:   case CON_IFNOSOUNDS:      case CON_IFNOTMOVING:
+        case CON_IFONWATER:    case CON_IFOUTSIDE:       case CON_IFP:             case CON_IFPHEALTHL:
+        case CON_IFPINVENTORY: case CON_IFPLAYBACKON:    case CON_IFPLAYERSL:      case CON_IFRESPAWN:
+        case CON_IFRND:        case CON_IFSERVER:        case CON_IFSOUND:         case CON_IFSPAWNEDBY:
+        case CON_IFSPRITEPAL:  case CON_IFSQUISHED:      case CON_IFSTRENGTH:      case CON_IFWASWEAPON:
+        case CON_IFVARE:       case CON_IFVARN:          case CON_IFVARG:          case CON_IFVARGE:
+        case CON_IFVARL:       case CON_IFVARLE:         case CON_IFVARA:          case CON_IFVARAE:
+        case CON_IFVARB:       case CON_IFVARBE:         case CON_IFVARAND:        case CON_IFVAROR:
+        case CON_IFVARXOR:     case CON_IFVAREITHER:     case CON_IFVARBOTH:       case CON_IFVARVARE:
+        case CON_IFVARVARN:    case CON_IFVARVARG:       case CON_IFVARVARGE:      case CON_IFVARVARL:
+        case CON_IFVARVARLE:   case CON_IFVARVARA:       case CON_IFVARVARAE:      case CON_IFVARVARB:
+        case CON_IFVARVARBE:   case CON_IFVARVARAND:     case CON_IFVARVAROR:      case CON_IFVARVARXOR:
+        case CON_IFVARVAREITHER: case CON_IFVARVARBOTH:
+            return true;
+    }
+
+    return false;
+}
+
+// runs the instruction at ins in the interpreter
+static void *VM_JitInterpret(vmjitunit_t const *unit, intptr_t const *ins, native_t loop)
+{
+    insptr = ins;
+
+    if (!VM_JitIsCondition(*ins & VM_INSTMASK))
+    {
+        VM_Execute(0);
+        return VM_JitContinue(unit, loop);
+    }
+
+    vm.flags |= VM_JITPROBE;
+    VM_Execute(0);
+
+    // the handler gave up before getting to its condition
+    if (vm.flags & VM_JITPROBE)
+    {
+        vm.flags &= ~VM_JITPROBE;
+        return VM_JitContinue(unit, loop);
+    }
+
+    bool const isTrue = vm.flags & VM_JITTAKEN;
+    vm.flags &= ~(VM_JITPROBE|VM_JITTAKEN);
+
+    // insptr is at the last operand, as VM_CONDITIONAL() would have it
+    if (isTrue || ((insptr = (intptr_t *)insptr[1]) && (*insptr & VM_INSTMASK) == CON_ELSE))
+    {
+        insptr += 2;
+
+        // VM_CONDITIONAL() runs the statement even if the condition itself failed or killed the sprite
+        if (vm.flags & (VM_RETURN|VM_KILL|VM_NOEXECUTE))
+            VM_Execute(0);
+    }
+
+    return VM_JitContinue(unit, loop);
+}
+
+static uint8_t *VM_JitAllocCode(uint8_t const *code, int32_t const codeSize)
+{
+#ifdef _WIN32
+    auto mem = (uint8_t *)VirtualAlloc(NULL, codeSize, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+    DWORD oldProtect;
+
+    if (mem == NULL)
+        return NULL;
+
+    Bmemcpy(mem, code, codeSize);
+
+    if (!VirtualProtect(mem, codeSize, PAGE_EXECUTE_READ, &oldProtect))
+    {
+        VirtualFree(mem, 0, MEM_RELEASE);
+        return NULL;
+    }
+#else
+    auto mem = (uint8_t *)mmap(NULL, codeSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED)
+        return NULL;
+
+    Bmemcpy(mem, code, codeSize);
+
+    if (mprotect(mem, codeSize, PROT_READ|PROT_EXEC))
+    {
+        munmap(mem, codeSize);
+        return NULL;
+    }
+#endif
+
+    return mem;
+}
+
+static void VM_JitFreeUnit(vmjitunit_t *unit)
+{
+    if (unit == NULL || unit == VM_JIT_NONE)
+        return;
+
+#ifdef _WIN32
+    VirtualFree(unit->code, 0, MEM_RELEASE);
+#else
+    munmap(unit->code, unit->codeSize);
+#endif
+
+    Bfree(unit->offsets);
+    Bfree(unit);
+}
+
+// translates the actor or event starting at start, through the first enda, endevent or ends the
+// compiler marked as an instruction
+static vmjitunit_t *VM_JitCompile(intptr_t const *start)
+{
+    if (g_scriptInsFlags == NULL || start < apScript || start >= g_scriptPtr)
+        return VM_JIT_NONE;
+
+    int const maxLength = min<intptr_t>(g_scriptPtr - start, VM_JIT_MAXLENGTH);
+    int       length    = 0;
+    auto      insFlags  = &g_scriptInsFlags[start - apScript];
+
+    while (length < maxLength)
+    {
+        int const opcode = start[length] & VM_INSTMASK;
+
+        if ((insFlags[length++] & (SCRIPTINS_START|SCRIPTINS_OPCODE)) && (opcode == CON_ENDA || opcode == CON_ENDEVENT || opcode == CON_ENDS))
+            break;
+
+        if (length == maxLength)
+            return VM_JIT_NONE;
+    }
+
+    auto isLabel = (uint8_t *)Xmalloc(length);
+
+    for (int i = 0; i < length; i++)
+        isLabel[i] = (i == 0 || (insFlags[i] & (SCRIPTINS_START|SCRIPTINS_OPCODE)));
+
+    auto unit = (vmjitunit_t *)Xcalloc(1, sizeof(vmjitunit_t));
+
+    unit->start   = start;
+    unit->length  = length;
+    unit->offsets = (int32_t *)Xmalloc(length * sizeof(int32_t));
+
+    vmjitcompiler_t jit;
+
+    jit.unit    = unit;
+    jit.isLabel = isLabel;
+
+    JIT_EMIT("\x53");                  // push rbx
+    JIT_EMIT("\xbb\x01\x00\x00\x00");  // mov ebx, 1, the loop count of VM_Execute(1)
+#ifdef _WIN32
+    JIT_EMIT("\x48\x83\xec\x20");  // sub rsp, 32 for the callee's home space
+#endif
+
+    for (int i = 0; i < length; i++)
+    {
+        unit->offsets[i] = -1;
+
+        if (!isLabel[i])
+            continue;
+
+        int nextLabel = i + 1;
+
+        while (nextLabel < length && !isLabel[nextLabel])
+            nextLabel++;
+
+        unit->offsets[i] = jit.code.size();
+
+        if (VM_JitInstruction(jit, start + i, start + nextLabel))
+            unit->numNative++;
+        else
+        {
+            VM_JitCallHelper(jit, (void const *)VM_JitInterpret, start + i);
+            unit->numInterpreted++;
+        }
+    }
+
+    unit->exitOfs = jit.code.size();
+
+#ifdef _WIN32
+    JIT_EMIT("\x48\x83\xc4\x20");  // add rsp, 32
+#endif
+    JIT_EMIT("\x5b");  // pop rbx
+    JIT_EMIT("\xc3");  // ret
+
+    for (auto const &fixup : jit.fixups)
+    {
+        int32_t const target = (fixup.target < 0) ? unit->exitOfs : unit->offsets[fixup.target];
+        int32_t const rel    = target - (fixup.at + 4);
+
+        Bmemcpy(&jit.code[fixup.at], &rel, sizeof(rel));
+    }
+
+    unit->codeSize = jit.code.size();
+    unit->code     = VM_JitAllocCode(jit.code.begin(), unit->codeSize);
+
+    jit.code.clear();
+    jit.fixups.clear();
+    Bfree(isLabel);
+
+    if (unit->code == NULL)
+    {
+        OSD_Printf("VM_JitCompile(): could not allocate %d bytes of executable memory\n", unit->codeSize);
+        Bfree(unit->offsets);
+        Bfree(unit);
+        return VM_JIT_NONE;
+    }
+
+    return unit;
+}
+
+// stands in for VM_Execute(1) on the code of an actor or event at insptr
+static void VM_ExecuteJit(vmjitunit_t **pUnit, uint32_t numCalls)
+{
+    if (g_vmJit && *pUnit == NULL && numCalls >= (uint32_t)g_vmJitThreshold)
+        *pUnit = VM_JitCompile(insptr);
+
+    auto const unit = *pUnit;
+
+    if (!g_vmJit || unit == NULL || unit == VM_JIT_NONE || unit->start != insptr)
+    {
+        VM_Execute(1);
+        return;
+    }
+
+    ((void (*)(void))unit->code)();
+}
+
+void VM_JitReset(void)
+{
+    for (auto &unit : g_actorJit)
+    {
+        VM_JitFreeUnit(unit);
+        unit = NULL;
+    }
+
+    for (auto &unit : g_eventJit)
+    {
+        VM_JitFreeUnit(unit);
+        unit = NULL;
+    }
+}
+
+void VM_JitPrintStats(void)
+{
+    int numUnits = 0, numFailed = 0, numNative = 0, numInterpreted = 0;
+    int64_t codeSize = 0, scriptSize = 0;
+
+    auto const countUnit = [&](vmjitunit_t const *unit) {
+        if (unit == NULL)
+            return;
+
+        if (unit == VM_JIT_NONE)
+        {
+            numFailed++;
+            return;
+        }
+
+        numUnits++;
+        numNative += unit->numNative;
+        numInterpreted += unit->numInterpreted;
+        codeSize += unit->codeSize;
+        scriptSize += unit->length * sizeof(intptr_t);
+    };
+
+    for (auto const unit : g_actorJit)
+        countUnit(unit);
+
+    for (auto const unit : g_eventJit)
+        countUnit(unit);
+
+    OSD_Printf("CON JIT is %s, compiling after %d calls.\n", g_vmJit ? "on" : "off", g_vmJitThreshold);
+    OSD_Printf("%d actors and events compiled from %d bytes of bytecode into %d bytes, %d could not be compiled.\n", numUnits,
+               (int)scriptSize, (int)codeSize, numFailed);
+    OSD_Printf("%d instructions run natively, %d through the interpreter (%.1f%% native).\n", numNative, numInterpreted,
+               (numNative + numInterpreted) ? 100.0 * numNative / (numNative + numInterpreted) : 0.0);
+}
+#endif
+
+#ifdef CON_PROFILER
+// A thread wakes up g_vmProfileRate times per second and records the CON line being run along with
+// the actors, events and states it was reached through, so that the time spent in a heavy actor can
+// be pinned on single lines.  With con_jit, lines run natively count as the last interpreted one.
+#define VM_PROFMAXSAMPLES (1 << 16)
+
+typedef struct
+{
+    int32_t frames[VM_PROFDEPTH];
+    int32_t depth;
+    int32_t line;
+    int32_t tw;
+} vmprofsample_t;
+
+typedef struct
+{
+    int32_t line;
+    int32_t tw;
+    int32_t numSamples;
+} vmprofline_t;
+
+int32_t g_vmProfileRate = 1000;
+
+static vmprofsample_t *g_vmProfSamples;
+static std::atomic<int32_t> g_vmProfNumSamples;
+static std::atomic<uint32_t> g_vmProfIdle, g_vmProfDropped;
+static std::atomic<bool> g_vmProfQuit;
+static thread_t g_vmProfThread;
+static double g_vmProfStartTime, g_vmProfElapsed;
+
+static void VM_ProfileSleep(int32_t const usec)
+{
+#if defined _WIN32
+    Sleep(max(usec / 1000, 1));
+#elif defined __PSP__
+    sceKernelDelayThread(usec);
+#else
+    usleep(usec);
+#endif
+}
+
+static void VM_ProfileSample(void)
+{
+    int32_t const depth = g_vmProfDepth.load(std::memory_order_acquire);
+
+    if (depth <= 0)
+    {
+        g_vmProfIdle.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int32_t const sampleNum = g_vmProfNumSamples.load(std::memory_order_relaxed);
+
+    if (sampleNum >= VM_PROFMAXSAMPLES)
+    {
+        g_vmProfDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto &sample = g_vmProfSamples[sampleNum];
+
+    sample.depth = min(depth, VM_PROFDEPTH);
+
+    for (native_t i = 0; i < sample.depth; i++)
+        sample.frames[i] = g_vmProfStack[i].load(std::memory_order_relaxed);
+
+    // written by the VM for every instruction without synchronization: a stale
+    // value only moves the sample to a neighbouring instruction
+    sample.line = *(int32_t volatile *)&g_errorLineNum;
+    sample.tw   = *(int32_t volatile *)&g_tw;
+
+    g_vmProfNumSamples.store(sampleNum + 1, std::memory_order_release);
+}
+
+static int32_t VM_ProfileThread(void *arg)
+{
+    int32_t const interval = (intptr_t)arg;
+
+#ifdef _WIN32
+    // Sleep() otherwise rounds up to the system timer tick, 15.6 ms by default
+    timeBeginPeriod(1);
+#endif
+
+    while (!g_vmProfQuit.load(std::memory_order_acquire))
+    {
+        VM_ProfileSleep(interval);
+        VM_ProfileSample();
+    }
+
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+
+    return 0;
+}
+
+void VM_ProfileStart(void)
+{
+    if (g_vmProfRunning)
+        return;
+
+    if (g_vmProfSamples == NULL)
+        g_vmProfSamples = (vmprofsample_t *)Xmalloc(VM_PROFMAXSAMPLES * sizeof(vmprofsample_t));
+
+    g_vmProfQuit.store(false, std::memory_order_relaxed);
+
+    if (thread_create(&g_vmProfThread, VM_ProfileThread, (void *)(intptr_t)(1000000 / max(g_vmProfileRate, 1)), "con_profile"))
+    {
+        OSD_Printf(OSD_ERROR "Couldn't start the CON profiler thread.\n");
+        return;
+    }
+
+    g_vmProfRunning   = true;
+    g_vmProfStartTime = timerGetHiTicks();
+    OSD_Printf("CON profiler sampling %d times per second.\n", g_vmProfileRate);
+}
+
+void VM_ProfileStop(void)
+{
+    if (!g_vmProfRunning)
+        return;
+
+    g_vmProfQuit.store(true, std::memory_order_release);
+    thread_join(&g_vmProfThread);
+    g_vmProfRunning = false;
+    g_vmProfElapsed += timerGetHiTicks() - g_vmProfStartTime;
+}
+
+// also called when the scripts are recompiled, which makes the recorded states meaningless
+void VM_ProfileReset(void)
+{
+    bool const wasRunning = g_vmProfRunning;
+
+    VM_ProfileStop();
+
+    g_vmProfNumSamples.store(0, std::memory_order_relaxed);
+    g_vmProfIdle.store(0, std::memory_order_relaxed);
+    g_vmProfDropped.store(0, std::memory_order_relaxed);
+    g_vmProfElapsed = 0;
+
+    if (wasRunning)
+        VM_ProfileStart();
+}
+
+static int32_t VM_ProfileGetSamples(void)
+{
+    int32_t const numSamples = g_vmProfNumSamples.load(std::memory_order_acquire);
+
+    if (numSamples == 0)
+        OSD_Printf("No CON profiler samples%s.\n", g_vmProfRunning ? " yet" : ", use \"con_profile start\" first");
+
+    return numSamples;
+}
+
+static int VM_ProfileCompareLines(void const *a, void const *b)
+{
+    auto const &l1 = *(vmprofline_t const *)a;
+    auto const &l2 = *(vmprofline_t const *)b;
+
+    return (l1.line != l2.line) ? l1.line - l2.line : l1.tw - l2.tw;
+}
+
+static int VM_ProfileCompareCounts(void const *a, void const *b)
+{
+    return ((vmprofline_t const *)b)->numSamples - ((vmprofline_t const *)a)->numSamples;
+}
+
+void VM_ProfilePrintTop(int32_t const numLines)
+{
+    int32_t const numSamples = VM_ProfileGetSamples();
+
+    if (numSamples == 0)
+        return;
+
+    auto const lines = (vmprofline_t *)Xmalloc(numSamples * sizeof(vmprofline_t));
+
+    for (native_t i = 0; i < numSamples; i++)
+        lines[i] = { g_vmProfSamples[i].line, g_vmProfSamples[i].tw, 1 };
+
+    qsort(lines, numSamples, sizeof(vmprofline_t), VM_ProfileCompareLines);
+
+    int numUnique = 0;
+
+    for (native_t i = 0; i < numSamples; i++)
+    {
+        if (numUnique > 0 && !VM_ProfileCompareLines(&lines[numUnique - 1], &lines[i]))
+            lines[numUnique - 1].numSamples++;
+        else
+            lines[numUnique++] = lines[i];
+    }
+
+    qsort(lines, numUnique, sizeof(vmprofline_t), VM_ProfileCompareCounts);
+
+    OSD_Printf("samples      %%   line  instruction\n");
+
+    for (native_t i = 0; i < min(numLines, numUnique); i++)
+        OSD_Printf("%7d %5.1f%% %6d  %s\n", lines[i].numSamples, 100.0 * lines[i].numSamples / numSamples, lines[i].line,
+                   VM_GetKeywordForID(lines[i].tw));
+
+    uint32_t const numIdle    = g_vmProfIdle.load(std::memory_order_relaxed);
+    uint32_t const numDropped = g_vmProfDropped.load(std::memory_order_relaxed);
+
+    OSD_Printf("%d samples in CON code on %d instructions, %u outside of it, %u dropped.\n", numSamples, numUnique, numIdle, numDropped);
+
+    // the sleep granularity of the platform can keep this well below con_profilerate
+    double const elapsed = g_vmProfElapsed + (g_vmProfRunning ? timerGetHiTicks() - g_vmProfStartTime : 0.0);
+
+    if (elapsed > 0.0)
+        OSD_Printf("Sampled %.0f times per second (con_profilerate %d).\n", (numSamples + numIdle + numDropped) * 1000.0 / elapsed,
+                   g_vmProfileRate);
+
+    Bfree(lines);
+}
+
+static int VM_ProfileCompareStacks(void const *a, void const *b)
+{
+    auto const &s1 = *(vmprofsample_t const *)a;
+    auto const &s2 = *(vmprofsample_t const *)b;
+
+    if (s1.depth != s2.depth)
+        return s1.depth - s2.depth;
+
+    if (int const cmp = Bmemcmp(s1.frames, s2.frames, s1.depth * sizeof(int32_t)))
+        return cmp;
+
+    return (s1.line != s2.line) ? s1.line - s2.line : s1.tw - s2.tw;
+}
+
+static void VM_ProfileWriteFrame(buildvfs_FILE fp, inthashtable_t const *h_frameLabels, int32_t const frame)
+{
+    int32_t const value = frame & 0xFFFFFF;
+    intptr_t const labelNum = inthash_find(h_frameLabels, frame);
+
+    switch (frame >> 24)
+    {
+        case VM_PROFACTOR:
+            if (labelNum >= 0)
+                Bsnprintf(tempbuf, sizeof(tempbuf), "actor %s;", label + (labelNum << 6));
+            else
+                Bsnprintf(tempbuf, sizeof(tempbuf), "actor %d;", value);
+            break;
+        case VM_PROFEVENT:
+            Bsnprintf(tempbuf, sizeof(tempbuf), "%s;", (unsigned)value < MAXEVENTS ? EventNames[value] : "EVENT_?");
+            break;
+        case VM_PROFSTATE:
+            if (labelNum >= 0)
+                Bsnprintf(tempbuf, sizeof(tempbuf), "state %s;", label + (labelNum << 6));
+            else
+                Bsnprintf(tempbuf, sizeof(tempbuf), "state @%d;", value);
+            break;
+        default:
+            Bstrcpy(tempbuf, "?;");
+            break;
+    }
+
+    buildvfs_fputstrptr(fp, tempbuf);
+}
+
+// Writes one line per distinct call stack in the "collapsed" format read by flame graph tools, e.g.
+// "actor APLAYER;state checkweapons;line 1234 ifvarg 57", with the frames separated by semicolons.
+void VM_ProfileWriteFolded(const char *fileName)
+{
+    int32_t const numSamples = VM_ProfileGetSamples();
+
+    if (numSamples == 0)
+        return;
+
+    buildvfs_FILE fp = buildvfs_fopen_write_text(fileName);
+
+    if (!fp)
+    {
+        OSD_Printf("Couldn't open \"%s\" for writing.\n", fileName);
+        return;
+    }
+
+    // the samples after numSamples may still be written by the thread, but never those before
+    qsort(g_vmProfSamples, numSamples, sizeof(vmprofsample_t), VM_ProfileCompareStacks);
+
+    inthashtable_t h_frameLabels = { NULL, INTHASH_SIZE(g_labelCnt) };
+    inthash_init(&h_frameLabels);
+
+    for (native_t i = 0; i < g_labelCnt; i++)
+    {
+        if (labeltype[i] & LABEL_STATE)
+            inthash_add(&h_frameLabels, VM_PROFFRAME(VM_PROFSTATE, labelcode[i]), i, 0);
+        else if (labeltype[i] & LABEL_ACTOR)
+            inthash_add(&h_frameLabels, VM_PROFFRAME(VM_PROFACTOR, labelcode[i]), i, 0);
+    }
+
+    int numStacks = 0;
+
+    for (native_t i = 0, j; i < numSamples; i = j)
+    {
+        auto const &sample = g_vmProfSamples[i];
+
+        for (j = i + 1; j < numSamples && !VM_ProfileCompareStacks(&sample, &g_vmProfSamples[j]); j++) { }
+
+        for (native_t k = 0; k < sample.depth; k++)
+            VM_ProfileWriteFrame(fp, &h_frameLabels, sample.frames[k]);
+
+        Bsnprintf(tempbuf, sizeof(tempbuf), "line %d %s %d\n", sample.line, VM_GetKeywordForID(sample.tw), (int32_t)(j - i));
+        buildvfs_fputstrptr(fp, tempbuf);
+        numStacks++;
+    }
+
+    inthash_free(&h_frameLabels);
+    buildvfs_fclose(fp);
+
+    OSD_Printf("Wrote %d samples in %d stacks to \"%s\".\n", numSamples, numStacks, fileName);
+}
+#endif
+
+// NORECURSE
+void A_LoadActor(int32_t spriteNum)
+{
+    vm.spriteNum = spriteNum;           // Sprite ID
+    vm.pSprite   = &sprite[spriteNum];  // Pointer to sprite structure
+    vm.pActor    = &actor[spriteNum];
+
+    if (g_tile[vm.pSprite->picnum].loadPtr == NULL)
+        return;
+
+    vm.pData      = &actor[spriteNum].t_data[0];  // Sprite's 'extra' data
+    vm.playerNum  = -1;                           // Player ID
+    vm.playerDist = -1;                           // Distance
+    vm.pPlayer    = g_player[0].ps;
+
+    vm.flags &= ~(VM_RETURN|VM_KILL|VM_NOEXECUTE);
+
+    if ((unsigned)vm.pSprite->sectnum >= MAXSECTORS)
+    {
+        A_DeleteSprite(vm.spriteNum);
+        return;
+    }
+
+    insptr = g_tile[vm.pSprite->picnum].loadPtr;
+    VM_PROFILE_PUSH(VM_PROFACTOR, vm.pSprite->picnum);
+    VM_Execute(1);
+    VM_PROFILE_POP();
+    insptr = NULL;
+
+    if (vm.flags & VM_KILL)
+        A_DeleteSprite(vm.spriteNum);
+}
+
+// operands of the benchmark sequences below: VMBENCH_VAR + n is benchmark variable n and
+// VMBENCH_NEXT is the address of the next repetition, for the fail location of an if
+#define VMBENCH_VAR  0x40000000
+#define VMBENCH_NEXT 0x50000000
+#define VMBENCH_END  0x60000000
+
+#define VMBENCH_REPEAT 64
+
+typedef struct
+{
+    char const *name;
+    int32_t     numInstructions;
+    intptr_t    code[12];
+} vmbenchmark_t;
+
+// common instruction sequences that C_OptimizeCode() rewrites
+static vmbenchmark_t const g_vmBenchmarks[] =
+{
+    { "setvar, addvar", 2, { CON_SETVAR, VMBENCH_VAR, 5, CON_ADDVAR, VMBENCH_VAR, 3, VMBENCH_END } },
+    { "addvar, subvar", 2, { CON_ADDVAR, VMBENCH_VAR, 7, CON_SUBVAR, VMBENCH_VAR, 2, VMBENCH_END } },
+    { "setvar, setvar", 2, { CON_SETVAR, VMBENCH_VAR, 1, CON_SETVAR, VMBENCH_VAR + 1, 2, VMBENCH_END } },
+    { "setvarvar, addvar", 2, { CON_SETVARVAR, VMBENCH_VAR + 1, VMBENCH_VAR, CON_ADDVAR, VMBENCH_VAR + 1, 7, VMBENCH_END } },
+    { "setvarvar, addvarvar", 2,
+      { CON_SETVARVAR, VMBENCH_VAR + 2, VMBENCH_VAR, CON_ADDVARVAR, VMBENCH_VAR + 2, VMBENCH_VAR + 1, VMBENCH_END } },
+    { "ifvarl setvar (taken)", 2,
+      { CON_IFVARL, VMBENCH_VAR, 1000000, VMBENCH_NEXT, CON_SETVAR, VMBENCH_VAR + 1, 1, VMBENCH_END } },
+    { "ifvarg setvar (not taken)", 1,
+      { CON_IFVARG, VMBENCH_VAR, 1000000, VMBENCH_NEXT, CON_SETVAR, VMBENCH_VAR + 1, 1, VMBENCH_END } },
+    { "getactor[THISACTOR].x", 1, { CON_GETSPRITESTRUCT, VMBENCH_VAR + 3, ACTOR_X, VMBENCH_VAR, VMBENCH_END } },
+};
+
+static int32_t VM_BenchmarkLength(vmbenchmark_t const &benchmark)
+{
+    int32_t length = 0;
+
+    while (benchmark.code[length] != VMBENCH_END)
+        length++;
+
+    return length;
+}
+
+// repeats the sequence to fill the block and marks its instructions the way the compiler does
+static void VM_BuildBenchmark(vmbenchmark_t const &benchmark, int32_t const *vars, intptr_t *code, uint8_t *insFlags)
+{
+    int32_t const length = VM_BenchmarkLength(benchmark);
+    int32_t pos = 0;
+
+    Bmemset(insFlags, 0, (VMBENCH_REPEAT * length + 1) * sizeof(uint8_t));
+
+    for (int repeat = 0; repeat < VMBENCH_REPEAT; repeat++)
+    {
+        uint8_t flags = SCRIPTINS_START;
+
+        for (int i = 0; i < length;)
+        {
+            int const opcode = benchmark.code[i];
+            int const insLength = (opcode == CON_IFVARL || opcode == CON_IFVARG || opcode == CON_GETSPRITESTRUCT) ? 4 : 3;
+
+            insFlags[pos + i] = flags;
+            code[pos + i] = opcode;
+
+            // the instruction after an if is its lone body
+            flags = (insLength == 4 && opcode != CON_GETSPRITESTRUCT) ? SCRIPTINS_START | SCRIPTINS_BODY : SCRIPTINS_START;
+
+            for (int j = 1; j < insLength; j++)
+            {
+                intptr_t const operand = benchmark.code[i + j];
+
+                if (operand == VMBENCH_NEXT)
+                    code[pos + i + j] = (intptr_t)&code[pos + length];
+                else if (operand >= VMBENCH_VAR && operand < VMBENCH_NEXT)
+                    code[pos + i + j] = vars[operand - VMBENCH_VAR];
+                else
+                    code[pos + i + j] = operand;
+            }
+
+            i += insLength;
+        }
+
+        pos += length;
+    }
+
+    code[pos] = CON_ENDEVENT;
+}
+
+static double VM_RunBenchmark(intptr_t *code, int32_t const *vars, int32_t numIterations)
+{
+    double const startTime = timerGetHiTicks();
+
+    for (int i = 0; i < numIterations; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            aGameVars[vars[j]].global = 0;
+
+        insptr = code;
+        VM_Execute(1);
+    }
+
+    return timerGetHiTicks() - startTime;
+}
+
+void VM_BenchmarkScript(int32_t numIterations)
+{
+    static char const *const varNames[] = { "LOTAG", "HITAG", "TEXTURE" };
+
+    int32_t vars[4];
+    intptr_t savedValues[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        vars[i] = hash_find(&h_gamevars, varNames[i]);
+        savedValues[i] = aGameVars[vars[i]].global;
+    }
+
+    vars[3] = g_thisActorVarID;
+
+    int const spriteNum = (g_player[myconnectindex].ps->gm & MODE_GAME) ? g_player[myconnectindex].ps->i : 0;
+    vmstate_t const tempvm = { spriteNum, myconnectindex, 0, 0, &sprite[spriteNum], &actor[spriteNum].t_data[0],
+                               g_player[myconnectindex].ps, &actor[spriteNum] };
+    vmstate_t const backupvm = vm;
+    auto const backupinsptr = insptr;
+
+    int32_t maxLength = 0;
+
+    for (auto const &benchmark : g_vmBenchmarks)
+        maxLength = max(maxLength, VM_BenchmarkLength(benchmark));
+
+    int32_t const codeSize = VMBENCH_REPEAT * maxLength + 1;
+    auto code = (intptr_t *)Xmalloc(codeSize * sizeof(intptr_t));
+    auto optimizedCode = (intptr_t *)Xmalloc(codeSize * sizeof(intptr_t));
+    auto insFlags = (uint8_t *)Xmalloc(codeSize * sizeof(uint8_t));
+
+    vm = tempvm;
+
+    OSD_Printf("%d runs of each sequence, in millions of CON instructions per second:\n", numIterations);
+    OSD_Printf("  %-26s %8s %8s\n", "", "as is", "rewritten");
+
+    for (auto const &benchmark : g_vmBenchmarks)
+    {
+        int32_t const length = VMBENCH_REPEAT * VM_BenchmarkLength(benchmark) + 1;
+        int32_t results[2][3];
+
+        VM_BuildBenchmark(benchmark, vars, optimizedCode, insFlags);
+        int const numOptimized = C_OptimizeCode(optimizedCode, insFlags, length);
+        VM_BuildBenchmark(benchmark, vars, code, insFlags);
+
+        // run each version once from the same state to check that they agree
+        VM_RunBenchmark(code, vars, 1);
+        for (int i = 0; i < 3; i++)
+            results[0][i] = aGameVars[vars[i]].global;
+
+        VM_RunBenchmark(optimizedCode, vars, 1);
+        for (int i = 0; i < 3; i++)
+            results[1][i] = aGameVars[vars[i]].global;
+
+        double const numInstructions = (double)numIterations * VMBENCH_REPEAT * benchmark.numInstructions / 1000.0;
+        double const baseTime = VM_RunBenchmark(code, vars, numIterations);
+        double const optimizedTime = VM_RunBenchmark(optimizedCode, vars, numIterations);
+
+        OSD_Printf("  %-26s %8.1f %8.1f  %.2fx%s%s\n", benchmark.name, numInstructions / max(baseTime, 0.001),
+                   numInstructions / max(optimizedTime, 0.001), baseTime / max(optimizedTime, 0.001),
+                   numOptimized ? "" : ", not rewritten", Bmemcmp(results[0], results[1], sizeof(results[0])) ? ", RESULTS DIFFER" : "");
+    }
+
+    DO_FREE_AND_NULL(code);
+    DO_FREE_AND_NULL(optimizedCode);
+    DO_FREE_AND_NULL(insFlags);
+
+    for (int i = 0; i < 3; i++)
+        aGameVars[vars[i]].global = savedValues[i];
+
+    vm     = backupvm;
+    insptr = backupinsptr;
+}
+#endif
+
+void VM_UpdateAnim(int spriteNum, int32_t *pData)
+{
+#if !defined LUNATIC
+    size_t const actionofs = AC_ACTION_ID(pData);
+    auto const actionptr = (actionofs != 0 && actionofs + (ACTION_PARAM_COUNT-1) < (unsigned) g_scriptSize) ? &apScript[actionofs] : NULL;
+
+    if (actionptr != NULL)
+#endif
+    {
+#if !defined LUNATIC
+        int const action_frames = actionptr[ACTION_NUMFRAMES];
+        int const action_incval = actionptr[ACTION_INCVAL];
+        int const action_delay  = actionptr[ACTION_DELAY];
+#else
+        int const action_frames = actor[spriteNum].ac.numframes;
+        int const action_incval = actor[spriteNum].ac.incval;
+        int const action_delay  = actor[spriteNum].ac.delay;
+#endif
+        auto actionticsptr = &AC_ACTIONTICS(&sprite[spriteNum], &actor[spriteNum]);
+        *actionticsptr += TICSPERFRAME;
+
+        if (*actionticsptr > action_delay)
+        {
+            *actionticsptr = 0;
+            AC_ACTION_COUNT(pData)++;
+            AC_CURFRAME(pData) += action_incval;
+        }
+
+        if (klabs(AC_CURFRAME(pData)) >= klabs(action_frames * action_incval))
+            AC_CURFRAME(pData) = 0;
+    }
+}
+
+// NORECURSE
+void A_Execute(int spriteNum, int playerNum, int playerDist)
+{
+    // for some reason this is faster than using the C++ syntax; e.g vm = vmstate_t{ ... }
+    vmstate_t const tempvm
+    = { spriteNum, playerNum, playerDist, 0, &sprite[spriteNum], &actor[spriteNum].t_data[0], g_player[playerNum].ps, &actor[spriteNum] };
+    vm = tempvm;
+
+#ifdef LUNATIC
+    int32_t killit=0;
+#endif
+
+/*
+    if (g_netClient && A_CheckSpriteFlags(spriteNum, SFLAG_NULL))
+    {
+        A_DeleteSprite(spriteNum);
+        return;
+    }
+*/
+
+    if (g_netClient) // [75] The server should not overwrite its own randomseed
+        randomseed = ticrandomseed;
+
+    if (EDUKE32_PREDICT_FALSE((unsigned)vm.pSprite->sectnum >= MAXSECTORS))
+    {
+        if (A_CheckEnemySprite(vm.pSprite))
+            P_AddKills(vm.pPlayer, 1);
+
+        A_DeleteSprite(vm.spriteNum);
+        return;
+    }
+
+    VM_UpdateAnim(vm.spriteNum, vm.pData);
+
+    double t = timerGetHiTicks();
+#ifdef LUNATIC
+    int const picnum = vm.pSprite->picnum;
+
+    if (L_IsInitialized(&g_ElState) && El_HaveActor(picnum))
+        killit = (El_CallActor(&g_ElState, picnum, spriteNum, playerNum, playerDist)==1);
+#else
+    int const picnum = vm.pSprite->picnum;
+    insptr = 4 + (g_tile[vm.pSprite->picnum].execPtr);
+    VM_PROFILE_PUSH(VM_PROFACTOR, picnum);
+#ifdef CON_JIT
+    VM_ExecuteJit(&g_actorJit[picnum], g_actorCalls[picnum]);
+#else
+    VM_Execute(1);
+#endif
+    VM_PROFILE_POP();
+    insptr = NULL;
+#endif
+
+    t = timerGetHiTicks()-t;
+    g_actorTotalMs[picnum] += t;
+    g_actorMinMs[picnum] = min(g_actorMinMs[picnum], t);
+    g_actorMaxMs[picnum] = max(g_actorMaxMs[picnum], t);
+    g_actorCalls[picnum]++;
+
+#ifdef LUNATIC
+    if (killit)
+#else
+    if (vm.flags & VM_KILL)
+#endif
+    {
+        VM_DeleteSprite(spriteNum, playerNum);
+        return;
+    }
+
+    VM_Move();
+
+    if (vm.pSprite->statnum != STAT_ACTOR)
+    {
+#ifndef EDUKE32_STANDALONE
+        if (vm.pSprite->statnum == STAT_STANDABLE)
+        {
+            switch (DYNAMICTILEMAP(vm.pSprite->picnum))
+            {
+                case RUBBERCAN__STATIC:
+                case EXPLODINGBARREL__STATIC:
                 case WOODENHORSE__STATIC:
                 case HORSEONSIDE__STATIC:
                 case CANWITHSOMETHING__STATIC:
@@ -6733,9 +8261,15 @@ void G_SaveMapState(void)
         }
         else if (aGameVars[i].flags & GAMEVAR_PERACTOR)
         {
+#ifdef CON_PAGED_ACTORVARS
+            // only holds the pages in use, so its size changes with every save
+            ALIGNED_FREE_AND_NULL(save->vars[i]);
+            save->vars[i] = Gv_SaveActorVar(aGameVars[i]);
+#else
             if (!save->vars[i])
                 save->vars[i] = (intptr_t *)Xaligned_alloc(ACTOR_VAR_ALIGNMENT, MAXSPRITES * sizeof(intptr_t));
             Bmemcpy(&save->vars[i][0], aGameVars[i].pValues, sizeof(intptr_t) * MAXSPRITES);
+#endif
         }
         else
             save->vars[i] = (intptr_t *)aGameVars[i].global;
@@ -6868,7 +8402,11 @@ void G_RestoreMapState(void)
             {
                 if (!pSavedState->vars[i])
                     continue;
+#ifdef CON_PAGED_ACTORVARS
+                Gv_RestoreActorVar(aGameVars[i], pSavedState->vars[i]);
+#else
                 Bmemcpy(aGameVars[i].pValues, pSavedState->vars[i], sizeof(intptr_t) * MAXSPRITES);
+#endif
             }
             else
                 aGameVars[i].global = (intptr_t)pSavedState->vars[i];
@@ -36,11 +36,26 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 extern "C" {
 #endif
 
+// native code for hot actors and events, built when CON_JIT is defined, see VM_JitCompile()
+#if defined CON_JIT && (defined LUNATIC || !(defined __x86_64__ || defined _M_X64) || \
+                        !(defined __linux__ || defined EDUKE32_BSD || defined __APPLE__ || defined _WIN32))
+# undef CON_JIT
+#endif
+
+// sampling profiler for CON lines, built when CON_PROFILER is defined, see VM_ProfileStart()
+#if defined CON_PROFILER && defined LUNATIC
+# undef CON_PROFILER
+#endif
+
 enum vmflags_t
 {
     VM_RETURN       = 0x00000001,
     VM_KILL         = 0x00000002,
     VM_NOEXECUTE    = 0x00000004,
+#ifdef CON_JIT
+    VM_JITPROBE     = 0x00000008,  // the next if only reports which way it goes, see VM_CONDITIONAL()
+    VM_JITTAKEN     = 0x00000010,
+#endif
 };
 
 extern int32_t ticrandomseed;
@@ -52,6 +67,24 @@ extern int32_t g_errorLineNum;
 extern int32_t g_currentEvent;
 
 void A_LoadActor(int32_t spriteNum);
+void VM_BenchmarkScript(int32_t numIterations);
+#endif
+
+#ifdef CON_JIT
+extern int32_t g_vmJit, g_vmJitThreshold;
+
+void VM_JitReset(void);
+void VM_JitPrintStats(void);
+#endif
+
+#ifdef CON_PROFILER
+extern int32_t g_vmProfileRate;
+
+void VM_ProfileStart(void);
+void VM_ProfileStop(void);
+void VM_ProfileReset(void);
+void VM_ProfilePrintTop(int32_t numLines);
+void VM_ProfileWriteFolded(const char *fileName);
 #endif
 
 extern uint32_t g_eventCalls[MAXEVENTS], g_actorCalls[MAXTILES];
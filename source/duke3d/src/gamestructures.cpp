@@ -54,7 +54,7 @@ int32_t __fastcall VM_GetPalData(int const palNum, int32_t labelNum);
 
 const memberlabel_t SectorLabels[] = {
     { "wallptr",                         SECTOR_WALLPTR, sizeof(sector[0].wallptr) | LABEL_WRITEFUNC, 0, offsetof(usectortype, wallptr) },
-    LABEL_SETUP(sector, wallnum,         SECTOR_WALLNUM),
+    { "wallnum",                         SECTOR_WALLNUM, sizeof(sector[0].wallnum) | LABEL_WRITEFUNC, 0, offsetof(usectortype, wallnum) },
 
     LABEL_SETUP(sector, ceilingz,        SECTOR_CEILINGZ),
     { "ceilingzgoal",                    SECTOR_CEILINGZGOAL, 0, 0, -1 },
@@ -149,6 +149,9 @@ void __fastcall VM_SetSector(int const sectNum, int const labelNum, int32_t newV
         case SECTOR_WALLPTR:
             setfirstwall(sectNum, newValue); break;
 
+        case SECTOR_WALLNUM:
+            pvsInvalidate(); s.wallnum = newValue; break;
+
         case SECTOR_CEILINGZVEL:
             s.extra = newValue;
             if ((newValue = GetAnimationGoal(&s.ceilingz)) != -1)
@@ -177,11 +180,12 @@ void __fastcall VM_SetSector(int const sectNum, int const labelNum, int32_t newV
 
 const memberlabel_t WallLabels[]=
 {
-    LABEL_SETUP(wall, x,          WALL_X),
-    LABEL_SETUP(wall, y,          WALL_Y),
-    LABEL_SETUP(wall, point2,     WALL_POINT2),
-    LABEL_SETUP(wall, nextwall,   WALL_NEXTWALL),
-    LABEL_SETUP(wall, nextsector, WALL_NEXTSECTOR),
+    // geometry goes through VM_SetWall() so the PVS can see it change
+    { "x",          WALL_X,          sizeof(wall[0].x) | LABEL_WRITEFUNC,          0, offsetof(uwalltype, x) },
+    { "y",          WALL_Y,          sizeof(wall[0].y) | LABEL_WRITEFUNC,          0, offsetof(uwalltype, y) },
+    { "point2",     WALL_POINT2,     sizeof(wall[0].point2) | LABEL_WRITEFUNC,     0, offsetof(uwalltype, point2) },
+    { "nextwall",   WALL_NEXTWALL,   sizeof(wall[0].nextwall) | LABEL_WRITEFUNC,   0, offsetof(uwalltype, nextwall) },
+    { "nextsector", WALL_NEXTSECTOR, sizeof(wall[0].nextsector) | LABEL_WRITEFUNC, 0, offsetof(uwalltype, nextsector) },
     LABEL_SETUP(wall, cstat,      WALL_CSTAT),
     LABEL_SETUP(wall, picnum,     WALL_PICNUM),
     LABEL_SETUP(wall, overpicnum, WALL_OVERPICNUM),
@@ -233,8 +237,17 @@ void __fastcall VM_SetWall(int const wallNum, int const labelNum, int32_t const
         return;
     }
 
+    auto &w = wall[wallNum];
+
     switch (labelNum)
     {
+        case WALL_X: pvsCheckWall(wallNum); w.x = newValue; break;
+        case WALL_Y: pvsCheckWall(wallNum); w.y = newValue; break;
+
+        case WALL_POINT2:     pvsInvalidate(); w.point2 = newValue; break;
+        case WALL_NEXTWALL:   pvsInvalidate(); w.nextwall = newValue; break;
+        case WALL_NEXTSECTOR: pvsInvalidate(); w.nextsector = newValue; break;
+
         case WALL_BLEND:
 #ifdef NEW_MAP_FORMAT
             w.blend = newValue;
@@ -248,9 +261,9 @@ void __fastcall VM_SetWall(int const wallNum, int const labelNum, int32_t const
 
 const memberlabel_t ActorLabels[]=
 {
-    LABEL_SETUP(sprite, x,        ACTOR_X),
-    LABEL_SETUP(sprite, y,        ACTOR_Y),
-    LABEL_SETUP(sprite, z,        ACTOR_Z),
+    { "x", ACTOR_X, sizeof(sprite[0].x) | LABEL_WRITEFUNC, 0, offsetof(uspritetype, x) },
+    { "y", ACTOR_Y, sizeof(sprite[0].y) | LABEL_WRITEFUNC, 0, offsetof(uspritetype, y) },
+    { "z", ACTOR_Z, sizeof(sprite[0].z) | LABEL_WRITEFUNC, 0, offsetof(uspritetype, z) },
     LABEL_SETUP(sprite, cstat,    ACTOR_CSTAT),
     LABEL_SETUP(sprite, picnum,   ACTOR_PICNUM),
     LABEL_SETUP(sprite, shade,    ACTOR_SHADE),
@@ -327,6 +340,10 @@ void __fastcall VM_SetSprite(int const spriteNum, int const labelNum, int const
 
     switch (labelNum)
     {
+        // keep the sprite grid in step, A_RadiusDamage() relies on it
+        case ACTOR_X: sprite[spriteNum].x = newValue; spriteGridUpdate(spriteNum); break;
+        case ACTOR_Y: sprite[spriteNum].y = newValue; spriteGridUpdate(spriteNum); break;
+        case ACTOR_Z: sprite[spriteNum].z = newValue; spriteGridUpdate(spriteNum); break;
         case ACTOR_SECTNUM: changespritesect(spriteNum, newValue); break;
         case ACTOR_STATNUM: changespritestat(spriteNum, newValue); break;
         case ACTOR_HTG_T: a.t_data[lParm2] = newValue; break;
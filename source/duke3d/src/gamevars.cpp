@@ -61,6 +61,241 @@ intptr_t *aplWeaponWorksLike[MAX_WEAPONS];      // What original the weapon work
 
 # include "gamestructures.cpp"
 
+#ifdef CON_PAGED_ACTORVARS
+static gameactorblock_t g_packedActorBlock;  // shared by the GAMEVAR_PACKED vars
+
+int32_t *Gv_AllocActorPage(gameactorblock_t &block, int const pageNum)
+{
+    int const stride = block.stride;
+    auto const page = (int32_t *)Xaligned_alloc(ACTOR_VAR_ALIGNMENT, GV_ACTORPAGESIZE * stride * sizeof(int32_t));
+
+    for (native_t i = 0; i < GV_ACTORPAGESIZE; i++)
+        Bmemcpy(&page[i * stride], block.defaults, stride * sizeof(int32_t));
+
+    block.numPages++;
+    return block.pages[pageNum] = page;
+}
+
+// Gives a per-actor var its slot.  The pages a packed var shares with others are widened to make room.
+static void Gv_AttachActorVar(gamevar_t &var)
+{
+    auto const block  = (var.flags & GAMEVAR_PACKED) ? &g_packedActorBlock : (gameactorblock_t *)Xcalloc(1, sizeof(gameactorblock_t));
+    int const  slot   = block->stride;
+    int const  stride = slot + 1;
+
+    for (auto &page : block->pages)
+    {
+        if (page == NULL)
+            continue;
+
+        auto const newPage = (int32_t *)Xaligned_alloc(ACTOR_VAR_ALIGNMENT, GV_ACTORPAGESIZE * stride * sizeof(int32_t));
+
+        for (native_t i = 0; i < GV_ACTORPAGESIZE; i++)
+        {
+            Bmemcpy(&newPage[i * stride], &page[i * slot], slot * sizeof(int32_t));
+            newPage[i * stride + slot] = var.defaultValue;
+        }
+
+        Baligned_free(page);
+        page = newPage;
+    }
+
+    block->defaults       = (int32_t *)Xrealloc(block->defaults, stride * sizeof(int32_t));
+    block->defaults[slot] = var.defaultValue;
+    block->stride         = stride;
+
+    var.pActorBlock = block;
+    var.actorSlot   = slot;
+}
+
+// Sets every sprite back to the default value.
+static void Gv_ResetActorVar(gamevar_t const &var)
+{
+    auto &block = *var.pActorBlock;
+
+    block.defaults[var.actorSlot] = var.defaultValue;
+
+    for (auto &page : block.pages)
+    {
+        if (page == NULL)
+            continue;
+
+        if (block.stride == 1)
+        {
+            ALIGNED_FREE_AND_NULL(page);
+            block.numPages--;
+            continue;
+        }
+
+        for (native_t i = 0; i < GV_ACTORPAGESIZE; i++)
+            page[i * block.stride + var.actorSlot] = var.defaultValue;
+    }
+}
+
+// The packed vars are only ever freed all together, so this frees the whole shared block.
+static void Gv_FreeActorVar(gamevar_t &var)
+{
+    auto const block = var.pActorBlock;
+
+    if (block == NULL)
+        return;
+
+    for (auto &page : block->pages)
+        ALIGNED_FREE_AND_NULL(page);
+
+    DO_FREE_AND_NULL(block->defaults);
+    block->numPages = 0;
+    block->stride   = 0;
+
+    if (block != &g_packedActorBlock)
+        Bfree(block);
+
+    var.pActorBlock = NULL;
+}
+
+void Gv_CopyActorValues(gamevar_t const &var, int32_t *outValues)
+{
+    for (native_t i = 0; i < MAXSPRITES; i++)
+        outValues[i] = Gv_GetActorValue(var, i);
+}
+
+void Gv_SetActorValues(gamevar_t const &var, int32_t const *values)
+{
+    for (native_t i = 0; i < MAXSPRITES; i++)
+        Gv_SetActorValue(var, i, values[i]);
+}
+
+// The saved values of a per-actor var are its page count, which pages are allocated, then the var's
+// values in those pages only.
+#define GV_ACTORSAVEHEADER (sizeof(int32_t) + GV_ACTORPAGES)
+
+static FORCE_INLINE size_t Gv_ActorSaveSize(int32_t const numPages)
+{
+    return GV_ACTORSAVEHEADER + numPages * GV_ACTORPAGESIZE * sizeof(int32_t);
+}
+
+intptr_t *Gv_SaveActorVar(gamevar_t const &var)
+{
+    auto const &block = *var.pActorBlock;
+    auto const  pSave = (int32_t *)Xaligned_alloc(ACTOR_VAR_ALIGNMENT, Gv_ActorSaveSize(block.numPages));
+    auto const  mask  = (uint8_t *)&pSave[1];
+    auto        value = (int32_t *)((uint8_t *)pSave + GV_ACTORSAVEHEADER);
+
+    pSave[0] = block.numPages;
+
+    for (native_t p = 0; p < GV_ACTORPAGES; p++)
+    {
+        auto const page = block.pages[p];
+
+        mask[p] = (page != NULL);
+
+        if (page == NULL)
+            continue;
+
+        for (native_t i = 0; i < GV_ACTORPAGESIZE; i++)
+            *value++ = page[i * block.stride + var.actorSlot];
+    }
+
+    return (intptr_t *)pSave;
+}
+
+void Gv_RestoreActorVar(gamevar_t const &var, intptr_t const *pSave)
+{
+    auto &     block = *var.pActorBlock;
+    auto const mask  = (uint8_t const *)pSave + sizeof(int32_t);
+    auto       value = (int32_t const *)((uint8_t const *)pSave + GV_ACTORSAVEHEADER);
+
+    for (native_t p = 0; p < GV_ACTORPAGES; p++)
+    {
+        auto page = block.pages[p];
+
+        if (mask[p])
+        {
+            if (page == NULL)
+                page = Gv_AllocActorPage(block, p);
+
+            for (native_t i = 0; i < GV_ACTORPAGESIZE; i++)
+                page[i * block.stride + var.actorSlot] = *value++;
+        }
+        else if (page != NULL)
+        {
+            if (block.stride == 1)
+            {
+                ALIGNED_FREE_AND_NULL(block.pages[p]);
+                block.numPages--;
+                continue;
+            }
+
+            for (native_t i = 0; i < GV_ACTORPAGESIZE; i++)
+                page[i * block.stride + var.actorSlot] = var.defaultValue;
+        }
+    }
+}
+
+static void Gv_WriteActorVar(intptr_t const *pSave, buildvfs_FILE fil)
+{
+    int32_t const numPages = *(int32_t const *)pSave;
+
+    dfwrite_LZ4(pSave, GV_ACTORSAVEHEADER, 1, fil);
+
+    if (numPages > 0)
+        dfwrite_LZ4((uint8_t const *)pSave + GV_ACTORSAVEHEADER, Gv_ActorSaveSize(numPages) - GV_ACTORSAVEHEADER, 1, fil);
+}
+
+static intptr_t *Gv_ReadActorVar(buildvfs_kfd kFile)
+{
+    uint8_t header[GV_ACTORSAVEHEADER];
+
+    if (kdfread_LZ4(header, GV_ACTORSAVEHEADER, 1, kFile) != 1)
+        return NULL;
+
+    int32_t const numPages = *(int32_t *)header;
+
+    if (EDUKE32_PREDICT_FALSE((unsigned)numPages > GV_ACTORPAGES))
+        return NULL;
+
+    auto const pSave = (uint8_t *)Xaligned_alloc(ACTOR_VAR_ALIGNMENT, Gv_ActorSaveSize(numPages));
+
+    Bmemcpy(pSave, header, GV_ACTORSAVEHEADER);
+
+    if (numPages > 0 && kdfread_LZ4(pSave + GV_ACTORSAVEHEADER, Gv_ActorSaveSize(numPages) - GV_ACTORSAVEHEADER, 1, kFile) != 1)
+    {
+        Baligned_free(pSave);
+        return NULL;
+    }
+
+    return (intptr_t *)pSave;
+}
+
+void Gv_PrintMemoryUsage(bool const showAll)
+{
+    int    numVars    = 0;
+    size_t totalBytes = 0;
+
+    for (bssize_t i = 0; i < g_gameVarCount; i++)
+    {
+        auto const &var = aGameVars[i];
+
+        if ((var.flags & (GAMEVAR_PERACTOR|GAMEVAR_RESET)) != GAMEVAR_PERACTOR)
+            continue;
+
+        // a packed var's share of the pages it is in
+        auto const & block = *var.pActorBlock;
+        size_t const bytes = block.numPages * GV_ACTORPAGESIZE * sizeof(int32_t);
+
+        numVars++;
+        totalBytes += bytes;
+
+        if (showAll || bytes)
+            OSD_Printf("%-32s %-6s %4d/%d pages %8u bytes\n", var.szLabel, (var.flags & GAMEVAR_PACKED) ? "packed" : "",
+                       block.numPages, GV_ACTORPAGES, (unsigned)bytes);
+    }
+
+    OSD_Printf("%d per-actor gamevars using %u bytes (%u without paging)\n", numVars, (unsigned)totalBytes,
+               (unsigned)(numVars * MAXSPRITES * sizeof(intptr_t)));
+}
+#endif
+
 // Frees the memory for the *values* of game variables and arrays. Resets their
 // counts to zero. Call this function as many times as needed.
 //
@@ -69,7 +304,13 @@ int Gv_Free(void)
 {
     for (auto &gameVar : aGameVars)
     {
+#ifdef CON_PAGED_ACTORVARS
+        if (gameVar.flags & GAMEVAR_PERACTOR)
+            Gv_FreeActorVar(gameVar);
+        else if (gameVar.flags & GAMEVAR_PERPLAYER)
+#else
         if (gameVar.flags & GAMEVAR_USER_MASK)
+#endif
             ALIGNED_FREE_AND_NULL(gameVar.pValues);
         gameVar.flags |= GAMEVAR_RESET;
     }
@@ -139,8 +380,17 @@ int Gv_ReadSave(buildvfs_kfd kFile)
         }
         else if (aGameVars[i].flags & GAMEVAR_PERACTOR)
         {
+#ifdef CON_PAGED_ACTORVARS
+            intptr_t *const pSave = Gv_ReadActorVar(kFile);
+            if (pSave == NULL) goto corrupt;
+            aGameVars[i].pActorBlock = NULL;
+            Gv_AttachActorVar(aGameVars[i]);
+            Gv_RestoreActorVar(aGameVars[i], pSave);
+            Baligned_free(pSave);
+#else
             aGameVars[i].pValues = (intptr_t*)Xaligned_alloc(ACTOR_VAR_ALIGNMENT, MAXSPRITES * sizeof(intptr_t));
             if (kdfread_LZ4(aGameVars[i].pValues,sizeof(intptr_t) * MAXSPRITES, 1, kFile) != 1) goto corrupt;
+#endif
         }
     }
 
@@ -202,8 +452,13 @@ int Gv_ReadSave(buildvfs_kfd kFile)
             }
             else if (aGameVars[j].flags & GAMEVAR_PERACTOR)
             {
+#ifdef CON_PAGED_ACTORVARS
+                sv.vars[j] = Gv_ReadActorVar(kFile);
+                if (sv.vars[j] == NULL) return -10;
+#else
                 sv.vars[j] = (intptr_t *) Xaligned_alloc(ACTOR_VAR_ALIGNMENT, MAXSPRITES * sizeof(intptr_t));
                 if (kdfread_LZ4(sv.vars[j], sizeof(intptr_t) * MAXSPRITES, 1, kFile) != 1) return -10;
+#endif
             }
         }
 
@@ -243,7 +498,15 @@ void Gv_WriteSave(buildvfs_FILE fil)
         if (aGameVars[i].flags & GAMEVAR_PERPLAYER)
             dfwrite_LZ4(aGameVars[i].pValues, sizeof(intptr_t) * MAXPLAYERS, 1, fil);
         else if (aGameVars[i].flags & GAMEVAR_PERACTOR)
+        {
+#ifdef CON_PAGED_ACTORVARS
+            intptr_t *const pSave = Gv_SaveActorVar(aGameVars[i]);
+            Gv_WriteActorVar(pSave, fil);
+            Baligned_free(pSave);
+#else
             dfwrite_LZ4(aGameVars[i].pValues, sizeof(intptr_t) * MAXSPRITES, 1, fil);
+#endif
+        }
     }
 
     dfwrite_LZ4(&g_gameArrayCount,sizeof(g_gameArrayCount),1,fil);
@@ -281,7 +544,11 @@ void Gv_WriteSave(buildvfs_FILE fil)
             if (aGameVars[j].flags & GAMEVAR_PERPLAYER)
                 dfwrite_LZ4(sv.vars[j], sizeof(intptr_t) * MAXPLAYERS, 1, fil);
             else if (aGameVars[j].flags & GAMEVAR_PERACTOR)
+#ifdef CON_PAGED_ACTORVARS
+                Gv_WriteActorVar(sv.vars[j], fil);
+#else
                 dfwrite_LZ4(sv.vars[j], sizeof(intptr_t) * MAXSPRITES, 1, fil);
+#endif
         }
 
         dfwrite_LZ4(sv.arraysiz, sizeof(sv.arraysiz), 1, fil);
@@ -494,12 +761,25 @@ void Gv_NewVar(const char *pszLabel, intptr_t lValue, uint32_t dwFlags)
         if (aGameVars[gV].szLabel != pszLabel)
             Bstrcpy(aGameVars[gV].szLabel,pszLabel);
 
+#ifdef CON_PAGED_ACTORVARS
+        // only free if per-{actor,player}
+        if (aGameVars[gV].flags & GAMEVAR_PERACTOR)
+            Gv_FreeActorVar(aGameVars[gV]);
+        else if (aGameVars[gV].flags & GAMEVAR_PERPLAYER)
+            ALIGNED_FREE_AND_NULL(aGameVars[gV].pValues);
+        else
+            aGameVars[gV].global = 0;
+
+        // and the flags
+        aGameVars[gV].flags = (dwFlags & GAMEVAR_PERACTOR) ? dwFlags : (dwFlags & ~GAMEVAR_PACKED);
+#else
         // and the flags
         aGameVars[gV].flags=dwFlags;
 
         // only free if per-{actor,player}
         if (aGameVars[gV].flags & GAMEVAR_USER_MASK)
             ALIGNED_FREE_AND_NULL(aGameVars[gV].pValues);
+#endif
     }
 
     // if existing is system, they only get to change default value....
@@ -525,6 +805,13 @@ void Gv_NewVar(const char *pszLabel, intptr_t lValue, uint32_t dwFlags)
     }
     else if (aGameVars[gV].flags & GAMEVAR_PERACTOR)
     {
+#ifdef CON_PAGED_ACTORVARS
+        // no pages until a sprite gets another value than the default
+        if (!aGameVars[gV].pActorBlock)
+            Gv_AttachActorVar(aGameVars[gV]);
+        else
+            Gv_ResetActorVar(aGameVars[gV]);
+#else
         if (!aGameVars[gV].pValues)
         {
             aGameVars[gV].pValues = (intptr_t *) Xaligned_alloc(ACTOR_VAR_ALIGNMENT, MAXSPRITES * sizeof(intptr_t));
@@ -532,6 +819,7 @@ void Gv_NewVar(const char *pszLabel, intptr_t lValue, uint32_t dwFlags)
         }
         for (bssize_t j=MAXSPRITES-1; j>=0; --j)
             aGameVars[gV].pValues[j]=lValue;
+#endif
     }
     else aGameVars[gV].global = lValue;
 }
@@ -762,7 +1050,7 @@ static FORCE_INLINE int __fastcall Gv_GetVar__(int &gameVar, int &spriteNum, int
         {
             if (EDUKE32_PREDICT_FALSE((unsigned)spriteNum >= MAXSPRITES))
                 goto badindex;
-            returnValue = var.pValues[spriteNum];
+            returnValue = Gv_GetActorValue(var, spriteNum);
         }
         else if (!varFlags) returnValue = var.global;
         else if (varFlags == GAMEVAR_PERPLAYER)
@@ -816,7 +1104,7 @@ static FORCE_INLINE void __fastcall Gv_SetVar__(int const &gameVar, int const &n
     else if (varFlags == GAMEVAR_PERACTOR)
     {
         if (EDUKE32_PREDICT_FALSE((unsigned) spriteNum > MAXSPRITES-1)) goto badindex;
-        var.pValues[spriteNum] = newValue;
+        Gv_SetActorValue(var, spriteNum, newValue);
     }
     else if (varFlags == GAMEVAR_PERPLAYER)
     {
@@ -859,6 +1147,14 @@ static intptr_t *Gv_GetVarDataPtr(const char *szGameLabel)
 
     gamevar_t &var = aGameVars[gameVar];
 
+#ifdef CON_PAGED_ACTORVARS
+    if (EDUKE32_PREDICT_FALSE(var.flags & GAMEVAR_PERACTOR))
+    {
+        CON_ERRPRINTF("Gv_GetVarDataPtr(): per-actor gamevar %s has no flat array\n", szGameLabel);
+        return NULL;
+    }
+#endif
+
     if (var.flags & (GAMEVAR_USER_MASK|GAMEVAR_PTR_MASK))
     {
         if (EDUKE32_PREDICT_FALSE(!var.pValues))
@@ -54,6 +54,7 @@ enum GamevarFlags_t
     GAMEVAR_SPECIAL   = 0x00040000,  // flag for structure member shortcut vars
     GAMEVAR_NOMULTI   = 0x00080000,  // don't attach to multiplayer packets
     GAMEVAR_Q16PTR    = 0x00100000,  // plValues is a pointer to a q16.16
+    GAMEVAR_PACKED    = 0x00200000,  // per-actor values kept next to the other packed vars of the same sprite
     GAMEVAR_PTR_MASK  = (GAMEVAR_INT32PTR | GAMEVAR_INT16PTR | GAMEVAR_UINT8PTR | GAMEVAR_Q16PTR),
 };
 
@@ -65,6 +66,17 @@ enum GamevarFlags_t
 
 #define ARRAY_ALIGNMENT 16
 
+#ifdef CON_PAGED_ACTORVARS
+// Per-actor values are 32-bit and live in pages of GV_ACTORPAGESIZE sprites.  A page is only
+// allocated once one of its sprites gets a value other than the default; until then they all read
+// the default.  The vars declared GAMEVAR_PACKED share one set of pages, with the values of each
+// sprite next to each other, for vars that are always used together.  Without CON_PAGED_ACTORVARS,
+// each per-actor var has a flat array of MAXSPRITES intptr_t and GAMEVAR_PACKED does nothing.
+#define GV_ACTORPAGESHIFT 7
+#define GV_ACTORPAGESIZE (1 << GV_ACTORPAGESHIFT)
+#define GV_ACTORPAGES (MAXSPRITES >> GV_ACTORPAGESHIFT)
+#endif
+
 # define MAXGAMEARRAYS (MAXGAMEVARS>>2) // must be strictly smaller than MAXGAMEVARS
 # define MAXARRAYLABEL MAXVARLABEL
 
@@ -90,16 +102,34 @@ enum GamearrayFlags_t
     GAMEARRAY_TYPE_MASK = GAMEARRAY_UNSIGNED | GAMEARRAY_INT8 | GAMEARRAY_INT16 | GAMEARRAY_BITMAP,
 };
 
+#ifdef CON_PAGED_ACTORVARS
+typedef struct
+{
+    int32_t *pages[GV_ACTORPAGES];
+    int32_t *defaults;  // of each slot, what the sprites of a page read before it is allocated
+    int32_t  stride;    // slots of each sprite, one for each var using the block
+    int32_t  numPages;
+} gameactorblock_t;
+#endif
+
 #pragma pack(push,1)
 typedef struct
 {
     union {
         intptr_t  global;
+#ifdef CON_PAGED_ACTORVARS
+        intptr_t *pValues;  // array of values when 'per-player'
+        gameactorblock_t *pActorBlock;  // where the values are when 'per-actor'
+#else
         intptr_t *pValues;  // array of values when 'per-player', or 'per-actor'
+#endif
     };
     intptr_t  defaultValue;
     uintptr_t flags;
     char *    szLabel;
+#ifdef CON_PAGED_ACTORVARS
+    int32_t   actorSlot;  // of the var in each sprite's values in pActorBlock
+#endif
 } gamevar_t;
 
 typedef struct
@@ -139,6 +169,68 @@ int Gv_GetVarByLabel(const char *szGameLabel,int defaultValue,int spriteNum,int
 void Gv_NewArray(const char *pszLabel,void *arrayptr,intptr_t asize,uint32_t dwFlags);
 void Gv_NewVar(const char *pszLabel,intptr_t lValue,uint32_t dwFlags);
 
+#ifdef CON_PAGED_ACTORVARS
+int32_t *Gv_AllocActorPage(gameactorblock_t &block, int const pageNum);
+
+static FORCE_INLINE int32_t Gv_GetActorValue(gamevar_t const &var, int const spriteNum)
+{
+    auto const &block = *var.pActorBlock;
+    auto const  page  = block.pages[spriteNum >> GV_ACTORPAGESHIFT];
+
+    return page ? page[(spriteNum & (GV_ACTORPAGESIZE-1)) * block.stride + var.actorSlot] : (int32_t)var.defaultValue;
+}
+
+// for writing, allocates the page if needed
+static FORCE_INLINE int32_t &Gv_ActorValue(gamevar_t const &var, int const spriteNum)
+{
+    auto &block = *var.pActorBlock;
+    auto  page  = block.pages[spriteNum >> GV_ACTORPAGESHIFT];
+
+    if (EDUKE32_PREDICT_FALSE(page == NULL))
+        page = Gv_AllocActorPage(block, spriteNum >> GV_ACTORPAGESHIFT);
+
+    return page[(spriteNum & (GV_ACTORPAGESIZE-1)) * block.stride + var.actorSlot];
+}
+
+static FORCE_INLINE void Gv_SetActorValue(gamevar_t const &var, int const spriteNum, int32_t const value)
+{
+    auto &block = *var.pActorBlock;
+    auto  page  = block.pages[spriteNum >> GV_ACTORPAGESHIFT];
+
+    if (page == NULL)
+    {
+        if (value == (int32_t)var.defaultValue)
+            return;
+
+        page = Gv_AllocActorPage(block, spriteNum >> GV_ACTORPAGESHIFT);
+    }
+
+    page[(spriteNum & (GV_ACTORPAGESIZE-1)) * block.stride + var.actorSlot] = value;
+}
+
+static FORCE_INLINE void A_ResetVars(int const spriteNum)
+{
+    for (auto &gv : aGameVars)
+    {
+        if ((gv.flags & (GAMEVAR_PERACTOR|GAMEVAR_NODEFAULT|GAMEVAR_RESET)) == GAMEVAR_PERACTOR && gv.pActorBlock->pages[spriteNum >> GV_ACTORPAGESHIFT])
+            Gv_ActorValue(gv, spriteNum) = gv.defaultValue;
+    }
+}
+
+void Gv_CopyActorValues(gamevar_t const &var, int32_t *outValues);
+void Gv_SetActorValues(gamevar_t const &var, int32_t const *values);
+intptr_t *Gv_SaveActorVar(gamevar_t const &var);
+void Gv_RestoreActorVar(gamevar_t const &var, intptr_t const *pSave);
+void Gv_PrintMemoryUsage(bool showAll);
+#else
+static FORCE_INLINE intptr_t Gv_GetActorValue(gamevar_t const &var, int const spriteNum) { return var.pValues[spriteNum]; }
+static FORCE_INLINE intptr_t &Gv_ActorValue(gamevar_t const &var, int const spriteNum) { return var.pValues[spriteNum]; }
+
+static FORCE_INLINE void Gv_SetActorValue(gamevar_t const &var, int const spriteNum, intptr_t const value)
+{
+    var.pValues[spriteNum] = value;
+}
+
 static FORCE_INLINE void A_ResetVars(int const spriteNum)
 {
     for (auto &gv : aGameVars)
@@ -147,6 +239,8 @@ static FORCE_INLINE void A_ResetVars(int const spriteNum)
             gv.pValues[spriteNum] = gv.defaultValue;
     }
 }
+#endif
+
 void scriptInitStructTables(void);
 void Gv_DumpValues(void);
 void Gv_InitWeaponPointers(void);
@@ -217,10 +311,15 @@ static FORCE_INLINE void __fastcall VM_SetStruct(uint32_t const flags, intptr_t
                 var.pValues[vm.playerNum] operator operand;                                  \
                 break;                                                                       \
             case GAMEVAR_PERACTOR:                                                           \
+            {                                                                                \
                 if (EDUKE32_PREDICT_FALSE((unsigned)vm.spriteNum > MAXSPRITES - 1))          \
                     break;                                                                   \
-                var.pValues[vm.spriteNum] operator operand;                                  \
+                /* widened so shifts by 32-63 behave as they do on the other vars */         \
+                intptr_t value = Gv_GetActorValue(var, vm.spriteNum);                        \
+                value operator operand;                                                      \
+                Gv_SetActorValue(var, vm.spriteNum, value);                                  \
                 break;                                                                       \
+            }                                                                                \
             case GAMEVAR_INT32PTR: *(int32_t *)var.pValues operator(int32_t) operand; break; \
             case GAMEVAR_INT16PTR: *(int16_t *)var.pValues operator(int16_t) operand; break; \
             case GAMEVAR_UINT8PTR: *(uint8_t *)var.pValues operator(uint8_t) operand; break; \
@@ -256,7 +355,9 @@ static FORCE_INLINE void __fastcall Gv_DivVar(int const id, int32_t const operan
 skip:
     switch (var.flags & (GAMEVAR_USER_MASK | GAMEVAR_PTR_MASK))
     {
-        case GAMEVAR_PERACTOR: iptr = &var.pValues[vm.spriteNum]; break;
+        case GAMEVAR_PERACTOR:
+            Gv_SetActorValue(var, vm.spriteNum, libdivide_s32_do(Gv_GetActorValue(var, vm.spriteNum), dptr));
+            return;
         case GAMEVAR_PERPLAYER: iptr = &var.pValues[vm.playerNum];
         default: break;
 
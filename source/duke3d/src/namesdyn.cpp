@@ -1266,6 +1266,25 @@ void freehashnames(void)
 {
     hash_free(&h_names);
 }
+
+// Copies the current remapped values out to (or, below, back in from) the
+// compiled script cache. Returns the number of entries.
+int32_t G_GetDynamicTileMapping(int32_t *values)
+{
+    if (values)
+    {
+        for (int i=0; i < ARRAY_SSIZE(g_dynTileList); i++)
+            values[i] = *g_dynTileList[i].dynvalptr;
+    }
+
+    return ARRAY_SSIZE(g_dynTileList);
+}
+
+void G_SetDynamicTileMapping(int32_t const *values)
+{
+    for (int i=0; i < ARRAY_SSIZE(g_dynTileList); i++)
+        *g_dynTileList[i].dynvalptr = values[i];
+}
 #endif
 #endif
 
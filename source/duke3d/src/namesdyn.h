@@ -632,6 +632,9 @@ void G_ProcessDynamicTileMapping(const char *szLabel, int32_t lValue);
 #if !defined LUNATIC
 void inithashnames(void);
 void freehashnames(void);
+
+int32_t G_GetDynamicTileMapping(int32_t *values);
+void G_SetDynamicTileMapping(int32_t const *values);
 #endif
 
 extern int32_t ACCESS_ICON;
@@ -1237,6 +1240,9 @@ extern int32_t XXXSTACY;
 #define inithashnames() ((void)0)
 #define freehashnames() ((void)0)
 
+#define G_GetDynamicTileMapping(x) (0)
+#define G_SetDynamicTileMapping(x) ((void)0)
+
 #include "names.h"
 #undef SPACESHUTTLE
 #undef CANNON
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "cheats.h"
 #include "cmdline.h"
 #include "demo.h"  // g_firstDemoFile[]
+#include "drivers.h"
 #include "duke3d.h"
 #include "menus.h"
 #include "osdcmds.h"
@@ -668,6 +669,68 @@ static int osdcmd_setactorvar(osdcmdptr_t parm)
     OSD_Printf("Script variable \"%s\" set to %d (input: %d)\n", aGameVars[i].szLabel, Gv_GetVar(i, g_player[myconnectindex].ps->i, myconnectindex), newValue);
     return OSDCMD_OK;
 }
+
+static int osdcmd_conbench(osdcmdptr_t parm)
+{
+    int const numIterations = (parm->numparms > 0) ? clamp(Batol(parm->parms[0]), 1, 1000000) : 20000;
+
+    if (numplayers > 1)
+    {
+        OSD_Printf("Command not allowed in multiplayer\n");
+        return OSDCMD_OK;
+    }
+
+    VM_BenchmarkScript(numIterations);
+    return OSDCMD_OK;
+}
+
+#ifdef CON_PAGED_ACTORVARS
+static int osdcmd_convarmem(osdcmdptr_t parm)
+{
+    Gv_PrintMemoryUsage(parm->numparms > 0 && !Bstrcasecmp(parm->parms[0], "all"));
+    return OSDCMD_OK;
+}
+#endif
+
+#ifdef CON_PROFILER
+static int osdcmd_conprofile(osdcmdptr_t parm)
+{
+    if (parm->numparms != 1)
+        return OSDCMD_SHOWHELP;
+
+    if (!Bstrcasecmp(parm->parms[0], "start"))
+        VM_ProfileStart();
+    else if (!Bstrcasecmp(parm->parms[0], "stop"))
+        VM_ProfileStop();
+    else if (!Bstrcasecmp(parm->parms[0], "reset"))
+        VM_ProfileReset();
+    else
+        return OSDCMD_SHOWHELP;
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_conprofiletop(osdcmdptr_t parm)
+{
+    VM_ProfilePrintTop((parm->numparms > 0) ? clamp(Batol(parm->parms[0]), 1, 1000) : 20);
+    return OSDCMD_OK;
+}
+
+static int osdcmd_conprofiledump(osdcmdptr_t parm)
+{
+    VM_ProfileWriteFolded((parm->numparms > 0) ? parm->parms[0] : "con_profile.folded");
+    return OSDCMD_OK;
+}
+#endif
+
+#ifdef CON_JIT
+static int osdcmd_conjitstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+    VM_JitPrintStats();
+    return OSDCMD_OK;
+}
+#endif
 #else
 static int osdcmd_lua(osdcmdptr_t parm)
 {
@@ -1339,6 +1402,261 @@ static int osdcmd_kickban(osdcmdptr_t parm)
 }
 #endif
 
+static char const *const interpolationNames[MV_INTERP_COUNT] = { "nearest", "linear", "cubic", "sinc" };
+
+static int osdcmd_mixbench(osdcmdptr_t parm)
+{
+    int const numVoices = (parm->numparms > 0) ? clamp(Batol(parm->parms[0]), 1, 1024) : 64;
+    int const numBuffers = 256;
+    int const savedInterpolation = MV_Interpolation;
+
+    double ms[1 + MV_INTERP_COUNT];
+
+    for (int i = 0; i < 1 + MV_INTERP_COUNT; i++)
+    {
+        MV_Interpolation = max(i - 1, 0);
+
+        double const startTime = timerGetHiTicks();
+
+        if (MV_BenchmarkMix(numVoices, numBuffers, i > 0) != MV_Ok)
+        {
+            MV_Interpolation = savedInterpolation;
+            OSD_Printf("Sound is not initialized.\n");
+            return OSDCMD_OK;
+        }
+
+        ms[i] = max(timerGetHiTicks() - startTime, 0.001);
+    }
+
+    MV_Interpolation = savedInterpolation;
+
+    OSD_Printf("%d voices, %d buffers:\n", numVoices, numBuffers);
+    OSD_Printf("  clamp per voice: %.3f ms, %.1f voices/ms\n", ms[0], numVoices * numBuffers / ms[0]);
+
+    for (int i = 0; i < MV_INTERP_COUNT; i++)
+        OSD_Printf("  32-bit bus, %s: %.3f ms, %.1f voices/ms (%.2fx)\n", interpolationNames[i], ms[i + 1],
+                   numVoices * numBuffers / ms[i + 1], ms[0] / ms[i + 1]);
+
+    double const startTime = timerGetHiTicks();
+
+    if (MV_BenchmarkReverb(numBuffers) == MV_Ok)
+    {
+        double const reverbMs = timerGetHiTicks() - startTime;
+        OSD_Printf("  reverb: %.3f ms, %.1f us per buffer\n", reverbMs, reverbMs * 1000.0 / numBuffers);
+    }
+
+    double hrtfMs[2];
+
+    for (int moving = 0; moving < 2; moving++)
+    {
+        double const hrtfStart = timerGetHiTicks();
+
+        if (MV_BenchmarkHrtf(numVoices, numBuffers, moving) != MV_Ok)
+            return OSDCMD_OK;
+
+        hrtfMs[moving] = max(timerGetHiTicks() - hrtfStart, 0.001);
+    }
+
+    OSD_Printf("  hrtf: %.3f ms, %.2f us per voice per buffer, %.2f us while turning\n", hrtfMs[0],
+               hrtfMs[0] * 1000.0 / (numVoices * numBuffers), hrtfMs[1] * 1000.0 / (numVoices * numBuffers));
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_updatebench(osdcmdptr_t parm)
+{
+    int const numUpdates = (parm->numparms > 0) ? clamp(Batol(parm->parms[0]), 1, 100000) : 1000;
+
+    if ((g_player[myconnectindex].ps->gm & MODE_GAME) == 0)
+    {
+        OSD_Printf("Start a map first.\n");
+        return OSDCMD_OK;
+    }
+
+    double const startTime = timerGetHiTicks();
+    int const numVoices = S_BenchmarkUpdate(numUpdates);
+    double const us = (timerGetHiTicks() - startTime) * 1000.0 / numUpdates;
+
+    OSD_Printf("%d voices, %d updates: %.2f us per update, %.3f us per voice (%d ambient)\n", numVoices, numUpdates, us,
+               us / max(numVoices, 1), g_numEnvSoundsPlaying);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_resamplertest(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    // source frames stepped per output sample: pitched down, unchanged and pitched up
+    static float const rates[] = { 0.46f, 1.f, 1.4f };
+
+    OSD_Printf("Alias energy of a 0.02 - 0.44 cycles/frame sine sweep, mean / worst dB:\n");
+
+    for (int interp = 0; interp < MV_INTERP_COUNT; interp++)
+    {
+        char buf[128];
+        int len = Bsnprintf(buf, sizeof(buf), "  %-8s", interpolationNames[interp]);
+
+        for (float const rate : rates)
+        {
+            float sum = 0.f, worst = -200.f;
+            int count = 0;
+
+            for (float frequency = 0.02f; frequency < 0.45f; frequency += 0.03f, count++)
+            {
+                float alias;
+
+                if (MV_MeasureResampler(interp, frequency, rate, &alias) != MV_Ok)
+                {
+                    OSD_Printf("Sound is not initialized.\n");
+                    return OSDCMD_OK;
+                }
+
+                sum += alias;
+                worst = max(worst, alias);
+            }
+
+            len += Bsnprintf(buf + len, sizeof(buf) - len, "  x%.2f: %6.1f / %6.1f", rate, sum / count, worst);
+        }
+
+        OSD_Printf("%s\n", buf);
+    }
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_decodestats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    decodecachestats_t stats;
+    MV_GetDecodeCacheStats(&stats);
+
+    uint32_t const lookups = max(stats.hits + stats.misses, 1u);
+
+    OSD_Printf("Decoded sound cache: %u entries, %u of %d KB\n", stats.entries, stats.bytes >> 10, MV_DecodeCacheSize);
+    OSD_Printf("  %u hits, %u misses (%.1f%% hit rate), %u evictions\n", stats.hits, stats.misses, 100.0 * stats.hits / lookups,
+               stats.evictions);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_profilestats(osdcmdptr_t parm)
+{
+    static char const *const formatNames[FMT_MAX] = { "unknown", "raw", "VOC", "WAV", "Vorbis", "FLAC", "XA", "XMP", "stream" };
+
+    if (parm->numparms == 1 && !Bstrcasecmp(parm->parms[0], "reset"))
+    {
+        MV_ResetProfile();
+        OSD_Printf("Audio profile reset.\n");
+        return OSDCMD_OK;
+    }
+
+    if (parm->numparms > 0)
+        return OSDCMD_SHOWHELP;
+
+    mvprofile_t profile;
+    MV_GetProfile(&profile);
+
+    if (!MV_Profile)
+        OSD_Printf("Profiling is off, set snd_profile 1 to start.\n");
+
+    if (!profile.buffers)
+        return OSDCMD_OK;
+
+    OSD_Printf("Mixer: %u buffers of %.0f us, %.0f us on average, %.0f us at worst, %u late\n", profile.buffers, profile.period,
+               profile.average, profile.worst, profile.misses);
+
+    uint32_t most = 1;
+
+    for (uint32_t const count : profile.histogram)
+        most = max(most, count);
+
+    for (int i = 0; i < MV_PROFILEBUCKETS; i++)
+    {
+        char bar[41] = {};
+        Bmemset(bar, '#', (size_t)((uint64_t)profile.histogram[i] * 40 / most));
+
+        if (i < MV_PROFILEBUCKETS - 1)
+            OSD_Printf("  <%3d%% %8u %s\n", (i + 1) * 10, profile.histogram[i], bar);
+        else
+            OSD_Printf("  more  %8u %s\n", profile.histogram[i], bar);
+    }
+
+    OSD_Printf("  format     decode/buf   mix/buf   stream thread/buf\n");
+
+    for (int i = 0; i < FMT_MAX; i++)
+    {
+        if (profile.decode[i] > 0.f || profile.mix[i] > 0.f || profile.streamdecode[i] > 0.f)
+            OSD_Printf("  %-8s %9.1f us %6.1f us %9.1f us\n", formatNames[i], profile.decode[i] / profile.buffers,
+                       profile.mix[i] / profile.buffers, profile.streamdecode[i] / profile.buffers);
+    }
+
+    OSD_Printf("Driver: %u callbacks, %.0f us on average, %.0f us at worst, %u late\n", profile.callbacks, profile.callbackaverage,
+               profile.callbackworst, profile.callbackmisses);
+
+    voiceprofile_t voices[8];
+    int const numVoices = MV_GetVoiceProfile(voices, ARRAY_SIZE(voices));
+
+    if (numVoices)
+        OSD_Printf("Costliest voices playing:\n");
+
+    for (int i = 0; i < numVoices; i++)
+        OSD_Printf("  voice %3d %-8s decode %8.0f us, mix %8.0f us\n", voices[i].handle, formatNames[voices[i].wavetype],
+                   voices[i].decode, voices[i].mix);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_voicestats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    voicestats_t stats;
+    MV_GetVoiceStats(&stats);
+
+    OSD_Printf("Voices: %d real (%d binaural), %d virtual, %d at most of %d (snd_realvoices %d, snd_hrtf %d)\n", stats.real,
+               stats.binaural, stats.virtualized, stats.peak, ud.config.NumVoices, MV_RealVoices, MV_HrtfVoices);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_renderstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    if (!g_soundRenderFile && g_soundRenderMode == ASS_RENDER_NONE)
+    {
+        OSD_Printf("Sound goes to the sound card (see -wavout and -wavmode).\n");
+        return OSDCMD_OK;
+    }
+
+    soundrenderstats_t stats;
+    NoSoundDrv_GetRenderStats(&stats);
+
+    OSD_Printf("Mixed %.1f s of sound in %.2f s of mixing (%.1fx real time) and %.1f s of wall time\n", stats.seconds,
+               stats.mixseconds, stats.seconds / max(stats.mixseconds, 1e-6), stats.wallseconds);
+
+    return OSDCMD_OK;
+}
+
+static int osdcmd_streamstats(osdcmdptr_t UNUSED(parm))
+{
+    UNREFERENCED_CONST_PARAMETER(parm);
+
+    streamstats_t stats;
+    MV_GetStreamStats(&stats);
+
+    if (MV_StreamLead <= 0)
+        OSD_Printf("Music is decoded in the mixer (snd_streamlead 0)\n");
+    else
+        OSD_Printf("Music streams: %d, %d ms decoded ahead of %d ms\n", stats.streams, stats.buffered, MV_StreamLead);
+
+    OSD_Printf("  %u blocks played, %u underruns\n", stats.blocks, stats.underruns);
+
+    return OSDCMD_OK;
+}
+
 static int osdcmd_purgesaves(osdcmdptr_t UNUSED(parm))
 {
     UNREFERENCED_CONST_PARAMETER(parm);
@@ -1588,6 +1906,14 @@ int32_t registerosdcommands(void)
 
         { "color", "changes player palette", (void *)&ud.color, CVAR_INT|CVAR_MULTI, 0, MAXPALOOKUPS-1 },
 
+#ifdef CON_PROFILER
+        { "con_profilerate", "samples per second taken by con_profile from its next start", (void *)&g_vmProfileRate, CVAR_INT, 10, 10000 },
+#endif
+#ifdef CON_JIT
+        { "con_jit", "enable/disable translating hot CON actors and events into native code", (void *)&g_vmJit, CVAR_BOOL, 0, 1 },
+        { "con_jitthreshold", "number of runs of an actor or event before it is translated by con_jit", (void *)&g_vmJitThreshold, CVAR_INT, 0, 1000000 },
+#endif
+
         { "crosshairscale","changes the size of the crosshair", (void *)&ud.crosshairscale, CVAR_INT, 10, 100 },
 
         { "demorec_diffs","enable/disable diff recording in demos",(void *)&demorec_diffs_cvar, CVAR_BOOL, 0, 1 },
@@ -1663,13 +1989,20 @@ int32_t registerosdcommands(void)
         { "skill","changes the game skill setting", (void *)&ud.m_player_skill, CVAR_INT|CVAR_FUNCPTR|CVAR_NOSAVE/*|CVAR_NOMULTI*/, 0, 5 },
 
         { "snd_ambience", "enables/disables ambient sounds", (void *)&ud.config.AmbienceToggle, CVAR_BOOL, 0, 1 },
+        { "snd_decodecache", "memory in KB for sound effects decoded from Vorbis, FLAC and XA (0 decodes them as they play)", (void *)&MV_DecodeCacheSize, CVAR_INT, 0, 262144 },
         { "snd_enabled", "enables/disables sound effects", (void *)&ud.config.SoundToggle, CVAR_BOOL, 0, 1 },
         { "snd_fxvolume", "controls volume for sound effects", (void *)&ud.config.FXVolume, CVAR_INT, 0, 255 },
+        { "snd_hrtf", "binaural sound for headphones: the number of loudest sounds placed with an HRTF instead of panned (needs snd_mixbus)", (void *)&MV_HrtfVoices, CVAR_INT, 0, 64 },
+        { "snd_interpolation", "sound resampling: 0 = nearest, 1 = linear, 2 = cubic, 3 = windowed sinc (with snd_mixbus)", (void *)&MV_Interpolation, CVAR_INT, 0, MV_INTERP_COUNT - 1 },
+        { "snd_mixbus", "mix sounds into a 32-bit bus and clamp once instead of after every sound", (void *)&MV_MixBus, CVAR_BOOL, 0, 1 },
         { "snd_mixrate", "sound mixing rate", (void *)&ud.config.MixRate, CVAR_INT, 0, 48000 },
         { "snd_numchannels", "the number of sound channels", (void *)&ud.config.NumChannels, CVAR_INT, 0, 2 },
-        { "snd_numvoices", "the number of concurrent sounds", (void *)&ud.config.NumVoices, CVAR_INT, 1, 128 },
+        { "snd_numvoices", "the number of concurrent sounds", (void *)&ud.config.NumVoices, CVAR_INT, 1, 512 },
+        { "snd_profile", "times the audio thread: 0 = off, 1 = on, 2 = on with an overlay (see snd_profilestats)", (void *)&MV_Profile, CVAR_INT, 0, 2 },
+        { "snd_realvoices", "the number of sounds mixed at once, the least audible others play silently (0 mixes all)", (void *)&MV_RealVoices, CVAR_INT, 0, 512 },
         { "snd_reversestereo", "reverses the stereo channels", (void *)&ud.config.ReverseStereo, CVAR_BOOL, 0, 1 },
         { "snd_speech", "enables/disables player speech", (void *)&ud.config.VoiceToggle, CVAR_INT, 0, 5 },
+        { "snd_streamlead", "milliseconds of music decoded ahead on its own thread (0 decodes music in the mixer)", (void *)&MV_StreamLead, CVAR_INT, 0, 2000 },
 
         { "team","change team in multiplayer", (void *)&ud.team, CVAR_INT|CVAR_MULTI, 0, 3 },
 
@@ -1769,9 +2102,29 @@ int32_t registerosdcommands(void)
 
     OSD_RegisterFunction("restartmap", "restartmap: restarts the current map", osdcmd_restartmap);
     OSD_RegisterFunction("restartsound","restartsound: reinitializes the sound system",osdcmd_restartsound);
+    OSD_RegisterFunction("snd_decodestats","snd_decodestats: shows how often sounds were played from the decoded sound cache",osdcmd_decodestats);
+    OSD_RegisterFunction("snd_mixbench","snd_mixbench [voices]: measures mixing throughput with and without the 32-bit bus, and the cost of the reverb and the HRTF",osdcmd_mixbench);
+    OSD_RegisterFunction("snd_profilestats","snd_profilestats [reset]: shows where the audio thread spent its time while snd_profile is on",osdcmd_profilestats);
+    OSD_RegisterFunction("snd_renderstats","snd_renderstats: shows how fast sound is mixed without a sound card, with -wavout or -wavmode",osdcmd_renderstats);
+    OSD_RegisterFunction("snd_resamplertest","snd_resamplertest: measures the aliasing of each snd_interpolation mode",osdcmd_resamplertest);
+    OSD_RegisterFunction("snd_updatebench","snd_updatebench [updates]: times the per-tic update of sound positions on the current map",osdcmd_updatebench);
+    OSD_RegisterFunction("snd_streamstats","snd_streamstats: shows how far music is decoded ahead and how often the mixer ran dry",osdcmd_streamstats);
+    OSD_RegisterFunction("snd_voicestats","snd_voicestats: shows how many sounds were mixed and how many played silently",osdcmd_voicestats);
     OSD_RegisterFunction("restartvid","restartvid: reinitializes the video mode",osdcmd_restartvid);
 #if !defined LUNATIC
     OSD_RegisterFunction("addlogvar","addlogvar <gamevar>: prints the value of a gamevar", osdcmd_addlogvar);
+    OSD_RegisterFunction("con_bench","con_bench [runs]: times common CON instruction sequences before and after they are rewritten as superinstructions", osdcmd_conbench);
+#ifdef CON_PAGED_ACTORVARS
+    OSD_RegisterFunction("con_varmem","con_varmem [all]: shows the memory used by the values of each per-actor gamevar", osdcmd_convarmem);
+#endif
+#ifdef CON_PROFILER
+    OSD_RegisterFunction("con_profile","con_profile <start|stop|reset>: samples which CON lines are run, con_profilerate times per second", osdcmd_conprofile);
+    OSD_RegisterFunction("con_profiledump","con_profiledump [file]: writes the CON profiler samples as collapsed stacks for flame graph tools", osdcmd_conprofiledump);
+    OSD_RegisterFunction("con_profiletop","con_profiletop [lines]: lists the CON lines with the most profiler samples", osdcmd_conprofiletop);
+#endif
+#ifdef CON_JIT
+    OSD_RegisterFunction("con_jitstats","con_jitstats: shows how much of the CON code con_jit has translated into native code", osdcmd_conjitstats);
+#endif
     OSD_RegisterFunction("setvar","setvar <gamevar> <value>: sets the value of a gamevar", osdcmd_setvar);
     OSD_RegisterFunction("setvarvar","setvarvar <gamevar1> <gamevar2>: sets the value of <gamevar1> to <gamevar2>", osdcmd_setvar);
     OSD_RegisterFunction("setactorvar","setactorvar <actor#> <gamevar> <value>: sets the value of <actor#>'s <gamevar> to <value>", osdcmd_setactorvar);
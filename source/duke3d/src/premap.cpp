@@ -545,6 +545,120 @@ void G_CacheMapData(void)
     OSD_Printf("Cache time: %dms\n", timerGetTicks() - cacheStartTime);
 }
 
+static void prefetchTile(int tileNum)
+{
+    if ((unsigned)tileNum >= MAXTILES)
+        return;
+
+    int firstTile = tileNum, lastTile = tileNum;
+
+    if ((picanm[tileNum].sf & PICANM_ANIMTYPE_MASK) == PICANM_ANIMTYPE_BACK)
+        firstTile -= picanm[tileNum].num;
+    else if (picanm[tileNum].sf & PICANM_ANIMTYPE_MASK)
+        lastTile += picanm[tileNum].num;
+
+    for (; firstTile <= lastTile; firstTile++)
+        tilePrefetch(firstTile);
+}
+
+static void prefetchSectorTiles(int sectNum)
+{
+    usectortype const *const pSector = (usectortype const *)&sector[sectNum];
+
+    prefetchTile(pSector->ceilingpicnum);
+    prefetchTile(pSector->floorpicnum);
+
+    for (int wallNum = pSector->wallptr, endWall = wallNum + pSector->wallnum; wallNum < endWall; wallNum++)
+    {
+        prefetchTile(wall[wallNum].picnum);
+
+        if (wall[wallNum].cstat & (16|32))
+            prefetchTile(wall[wallNum].overpicnum);
+    }
+
+    for (int spriteNum = headspritesect[sectNum]; spriteNum >= 0; spriteNum = nextspritesect[spriteNum])
+    {
+        int const picnum = sprite[spriteNum].picnum;
+
+        if (sprite[spriteNum].cstat & 32768)
+            continue;
+
+        prefetchTile(picnum);
+
+        for (int j = picnum + 1; j <= g_tile[picnum].cacherange; j++)
+            tilePrefetch(j);
+
+#if !defined LUNATIC
+        // the frames of the action the actor is in
+        if (G_HaveActor(picnum))
+        {
+            int const actionOfs = AC_ACTION_ID(actor[spriteNum].t_data);
+
+            if ((unsigned)actionOfs + ACTION_VIEWTYPE >= (unsigned)g_scriptSize)
+                continue;
+
+            int const firstFrame = picnum + apScript[actionOfs + ACTION_STARTFRAME];
+            int const numFrames  = min<int>(apScript[actionOfs + ACTION_NUMFRAMES] * max<int>(klabs(apScript[actionOfs + ACTION_VIEWTYPE]), 1), 64);
+
+            for (int j = firstFrame; j < firstFrame + numFrames; j++)
+                tilePrefetch(j);
+        }
+#endif
+    }
+}
+
+static int g_prefetchSectNum = -1;
+
+// Called whenever a map is loaded, so the view's first sector is queued even
+// if it has the same number as the last one of the previous map.
+void G_ResetPrefetchTiles(void)
+{
+    g_prefetchSectNum = -1;
+}
+
+// Queues the tiles of the sector the view is in and its neighbors for loading
+// in the background whenever the view moves to another sector.
+void G_PrefetchTiles(int sectNum)
+{
+    if (!r_tilestream || (unsigned)sectNum >= (unsigned)numsectors || sectNum == g_prefetchSectNum)
+        return;
+
+    g_prefetchSectNum = sectNum;
+
+    prefetchSectorTiles(sectNum);
+
+    for (int wallNum = sector[sectNum].wallptr, endWall = wallNum + sector[sectNum].wallnum; wallNum < endWall; wallNum++)
+    {
+        if (wall[wallNum].nextsector >= 0)
+            prefetchSectorTiles(wall[wallNum].nextsector);
+    }
+}
+
+// Loads or builds the PVS of the current map. Sector effectors may move the
+// walls of their sector, and so do sliding doors through SetAnimation(), so
+// those are left out of the visibility clipping.
+void G_LoadPVS(const char *mapFile)
+{
+    pvsInvalidate();
+
+    for (int SPRITES_OF(STAT_EFFECTOR, spriteNum))
+        pvsMarkDynamicSector(sprite[spriteNum].sectnum);
+
+    for (int sectNum = 0; sectNum < numsectors; sectNum++)
+    {
+        // G_OperateSectors() runs split sliding doors as ST_9 too
+        switch (sector[sectNum].lotag & (uint16_t)~49152u)
+        {
+            case ST_9_SLIDING_ST_DOOR:
+            case ST_26_SPLITTING_ST_DOOR:
+                pvsMarkDynamicSector(sectNum);
+                break;
+        }
+    }
+
+    engineLoadPVS(mapFile);
+}
+
 int fragbarheight(void)
 {
     if (ud.screen_size > 0 && !(ud.statusbarflags & STATUSBAR_NOFRAGBAR)
@@ -1958,6 +2072,9 @@ int G_EnterLevel(int gameMode)
 
     ud.playerbest = CONFIG_GetMapBestTime(Menu_HaveUserMap() ? boardfilename : m.filename, g_loadedMapHack.md4);
 
+    G_LoadPVS((!VOLUMEONE && G_HaveUserMap()) ? boardfilename : m.filename);
+    G_ResetPrefetchTiles();
+
     // G_FadeLoad(0,0,0, 252,0, -28, 4, -1);
     G_CacheMapData();
     // G_FadeLoad(0,0,0, 0,252, 28, 4, -2);
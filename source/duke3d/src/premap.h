@@ -34,6 +34,9 @@ void G_SetupFilenameBasedMusic(char *nameBuf, const char *fileName, int levelNum
 int G_EnterLevel(int gameMode);
 int G_FindLevelByFile(const char *fileName);
 void G_CacheMapData(void);
+void G_PrefetchTiles(int sectNum);
+void G_ResetPrefetchTiles(void);
+void G_LoadPVS(const char *mapFile);
 void G_FreeMapState(int levelNum);
 void G_NewGame(int volumeNum, int levelNum, int skillNum);
 void G_ResetTimers(bool saveMoveCnt);
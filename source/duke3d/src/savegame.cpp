@@ -1308,13 +1308,54 @@ static uint8_t *svdiff;
 #define SV_SKIPMASK (/*GAMEVAR_SYSTEM|*/ GAMEVAR_READONLY | GAMEVAR_PTR_MASK | /*GAMEVAR_NORESET |*/ GAMEVAR_SPECIAL)
 
 static char svgm_vars_string [] = "blK:vars";
+
+#ifdef CON_PAGED_ACTORVARS
+// The per-actor gamevars are paged, so the spec points at copies of their values
+// that are brought up to date around each use of it.
+static int32_t (*svgm_actorvars)[MAXSPRITES];
+
+static void sv_copyactorvars(void)
+{
+    int vcnt = 0;
+
+    for (int i = 0; i < g_gameVarCount; i++)
+        if ((aGameVars[i].flags & (SV_SKIPMASK|GAMEVAR_PERACTOR)) == GAMEVAR_PERACTOR)
+            Gv_CopyActorValues(aGameVars[i], svgm_actorvars[vcnt++]);
+}
+
+static void sv_restoreactorvars(void)
+{
+    int vcnt = 0;
+
+    for (int i = 0; i < g_gameVarCount; i++)
+        if ((aGameVars[i].flags & (SV_SKIPMASK|GAMEVAR_PERACTOR)) == GAMEVAR_PERACTOR)
+            Gv_SetActorValues(aGameVars[i], svgm_actorvars[vcnt++]);
+}
+#else
+static FORCE_INLINE void sv_copyactorvars(void) {}
+static FORCE_INLINE void sv_restoreactorvars(void) {}
+#endif
+
 // setup gamevar data spec for snapshotting and diffing... gamevars must be loaded when called
 static void sv_makevarspec()
 {
+#ifdef CON_PAGED_ACTORVARS
+    int vcnt = 0, acnt = 0;
+
+    for (int i = 0; i < g_gameVarCount; i++)
+    {
+        vcnt += (aGameVars[i].flags & SV_SKIPMASK) ? 0 : 1;
+        acnt += (aGameVars[i].flags & (SV_SKIPMASK|GAMEVAR_PERACTOR)) == GAMEVAR_PERACTOR;
+    }
+
+    svgm_actorvars = (int32_t (*)[MAXSPRITES])Xrealloc(svgm_actorvars, max(acnt, 1) * sizeof(svgm_actorvars[0]));
+    acnt = 0;
+#else
     int vcnt = 0;
 
     for (int i = 0; i < g_gameVarCount; i++)
         vcnt += (aGameVars[i].flags & SV_SKIPMASK) ? 0 : 1;
+#endif
 
     for (int i=0; i<g_gameArrayCount; i++)
         vcnt += !(aGameArrays[i].flags & (GAMEARRAY_SYSTEM|GAMEARRAY_READONLY));  // SYSTEM_GAMEARRAY
@@ -1335,9 +1376,24 @@ static void sv_makevarspec()
         unsigned const per = aGameVars[i].flags & GAMEVAR_USER_MASK;
 
         svgm_vars[vcnt].flags = 0;
+#ifdef CON_PAGED_ACTORVARS
+        if (per == GAMEVAR_PERACTOR)
+        {
+            svgm_vars[vcnt].ptr  = svgm_actorvars[acnt++];
+            svgm_vars[vcnt].size = sizeof(int32_t);
+            svgm_vars[vcnt].cnt  = MAXSPRITES;
+        }
+        else
+        {
+            svgm_vars[vcnt].ptr  = (per == 0) ? &aGameVars[i].global : aGameVars[i].pValues;
+            svgm_vars[vcnt].size = sizeof(intptr_t);
+            svgm_vars[vcnt].cnt  = (per == 0) ? 1 : MAXPLAYERS;
+        }
+#else
         svgm_vars[vcnt].ptr   = (per == 0) ? &aGameVars[i].global : aGameVars[i].pValues;
         svgm_vars[vcnt].size  = sizeof(intptr_t);
         svgm_vars[vcnt].cnt   = (per == 0) ? 1 : (per == GAMEVAR_PERPLAYER ? MAXPLAYERS : MAXSPRITES);
+#endif
 
         ++vcnt;
     }
@@ -1678,6 +1734,7 @@ uint32_t sv_writediff(buildvfs_FILE fil)
     cmpspecdata(svgm_script, &p, &d);
     cmpspecdata(svgm_anmisc, &p, &d);
 #if !defined LUNATIC
+    sv_copyactorvars();
     cmpspecdata((const dataspec_t *)svgm_vars, &p, &d);
 #endif
 
@@ -2005,6 +2062,8 @@ static uint8_t *dosaveplayer2(buildvfs_FILE fil, uint8_t *mem)
 
 #if !defined LUNATIC
     Gv_WriteSave(fil);  // gamevars
+    if (mem)
+        sv_copyactorvars();
     mem=writespecdata((const dataspec_t *)svgm_vars, 0, mem);
     PRINTSIZE("vars");
 #endif
@@ -2107,6 +2166,7 @@ static int32_t doloadplayer2(buildvfs_kfd fil, uint8_t **memptr)
         int32_t i;
 
         sv_makevarspec();
+        sv_copyactorvars();
         for (i=1; svgm_vars[i].flags!=DS_END; i++)
         {
             Bmemcpy(mem, svgm_vars[i].ptr, svgm_vars[i].size*svgm_vars[i].cnt);  // careful! works because there are no DS_DYNAMIC's!
@@ -2135,6 +2195,7 @@ int32_t sv_updatestate(int32_t frominit)
 
 #if !defined LUNATIC
     if (readspecdata((const dataspec_t *)svgm_vars, buildvfs_kfd_invalid, &p)) return -8;
+    sv_restoreactorvars();
 #endif
 
     if (p != pbeg+svsnapsiz)
@@ -2168,6 +2229,13 @@ static void postloadplayer(int32_t savegamep)
     //2
     screenpeek = myconnectindex;
 
+    //2.2
+    G_LoadPVS(boardfilename[0] ? boardfilename : g_mapInfo[ud.volume_number*MAXLEVELS + ud.level_number].filename);
+    G_ResetPrefetchTiles();
+
+    //2.3
+    spriteGridRebuild();
+
     //2.5
     if (savegamep)
     {
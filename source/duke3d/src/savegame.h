@@ -36,7 +36,11 @@ extern "C" {
 #else
 # define SV_MAJOR_VER 1
 #endif
-#define SV_MINOR_VER 7
+#ifdef CON_PAGED_ACTORVARS
+# define SV_MINOR_VER 8  // per-actor gamevars saved as their allocated pages
+#else
+# define SV_MINOR_VER 7
+#endif
 
 #pragma pack(push,1)
 typedef struct
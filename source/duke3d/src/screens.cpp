@@ -891,6 +891,42 @@ static void G_PrintFPS(void)
     lastFrameTime = frameTime;
 }
 
+// snd_profile 2: the audio thread's timing, with the mixing time histogram
+// drawn as one character per tenth of the buffer period
+static void G_PrintAudioProfile(void)
+{
+    if (MV_Profile < 2)
+        return;
+
+    static char const ramp[] = " .:-=+*#%@";
+
+    mvprofile_t profile;
+    MV_GetProfile(&profile);
+
+    int32_t const x = windowxy1.x + 2, y = windowxy1.y + 2 + FPS_YOFFSET;
+    uint32_t most = 1;
+
+    for (uint32_t const count : profile.histogram)
+        most = max(most, count);
+
+    char histogram[MV_PROFILEBUCKETS + 1] = {};
+
+    for (int i = 0; i < MV_PROFILEBUCKETS; i++)
+        histogram[i] = ramp[profile.histogram[i] ? 1 + (int)((uint64_t)profile.histogram[i] * (ARRAY_SIZE(ramp) - 3) / most) : 0];
+
+    Bsprintf(tempbuf, "audio: %.0f/%.0f of %.0f us, %u late", profile.average, profile.worst, profile.period, profile.misses);
+    printext256(x + 1, y + 1, 0, -1, tempbuf, 1);
+    printext256(x, y, FPS_COLOR(profile.misses), -1, tempbuf, 1);
+
+    Bsprintf(tempbuf, "0%% [%s] 110%%+", histogram);
+    printext256(x + 1, y + 9, 0, -1, tempbuf, 1);
+    printext256(x, y + 8, COLOR_WHITE, -1, tempbuf, 1);
+
+    Bsprintf(tempbuf, "driver: %.0f/%.0f us, %u late", profile.callbackaverage, profile.callbackworst, profile.callbackmisses);
+    printext256(x + 1, y + 17, 0, -1, tempbuf, 1);
+    printext256(x, y + 16, FPS_COLOR(profile.callbackmisses), -1, tempbuf, 1);
+}
+
 #undef FPS_COLOR
 
 void G_DisplayRest(int32_t smoothratio)
@@ -1290,6 +1326,7 @@ void G_DisplayRest(int32_t smoothratio)
 #endif
 
     G_PrintFPS();
+    G_PrintAudioProfile();
 
     // JBF 20040124: display level stats in screen corner
     if (ud.overhead_on != 2 && ud.levelstats && VM_OnEvent(EVENT_DISPLAYLEVELSTATS, g_player[screenpeek].ps->i, screenpeek) == 0)
@@ -369,6 +369,12 @@ int SetAnimation(int sectNum, int32_t *animPtr, int goalVal, int animVel)
     if (animNum == g_animateCnt)
         g_animateCnt++;
 
+    // sliding doors: G_LoadPVS() marks their sectors, unless a script made the door later
+    uintptr_t const wallOfs = (uintptr_t)animPtr - (uintptr_t)wall;
+
+    if (wallOfs < sizeof(wall))
+        pvsCheckWall(wallOfs / sizeof(walltype));
+
     G_SetInterpolation(animPtr);
 
     return animNum;
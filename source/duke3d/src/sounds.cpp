@@ -27,8 +27,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <atomic>
 
 #include "vfs.h"
+#include "drivers.h"
 
-#define DQSIZE 256
+#define DQSIZE 1024
 
 int32_t g_numEnvSoundsPlaying, g_highestSoundIdx = 0;
 
@@ -42,6 +43,34 @@ std::atomic<uint32_t> dnum;
 uint32_t dq[DQSIZE];
 static mutex_t m_callback;
 
+char *g_soundRenderFile;
+int32_t g_soundRenderMode = ASS_RENDER_NONE;
+static int32_t s_renderMode;  // as the sound system was started
+
+// every voice in g_sounds[].voices[] with an id, as (sound * MAXSOUNDINSTANCES) + slot,
+// so that S_Update() does not have to look through all sounds
+static uint16_t s_activeVoices[MAXSOUNDS * MAXSOUNDINSTANCES];
+static int32_t  s_numActiveVoices;
+
+EDUKE32_STATIC_ASSERT(MAXSOUNDS * MAXSOUNDINSTANCES <= UINT16_MAX + 1);
+
+static void S_TrackVoice(int num)
+{
+    s_activeVoices[s_numActiveVoices++] = num;
+}
+
+static void S_UntrackVoice(int num)
+{
+    for (int i = 0; i < s_numActiveVoices; i++)
+    {
+        if (s_activeVoices[i] == num)
+        {
+            s_activeVoices[i] = s_activeVoices[--s_numActiveVoices];
+            return;
+        }
+    }
+}
+
 void S_SoundStartup(void)
 {
 #ifdef MIXERTYPEWIN
@@ -52,6 +81,24 @@ void S_SoundStartup(void)
 
     initprintf("Initializing sound... ");
 
+    // headless runs must not depend on an audio device being present
+    if (headless)
+        ASS_PreferredSoundDriver = ASS_NoSound;
+
+    s_renderMode = ASS_RENDER_NONE;
+
+    if (g_soundRenderFile || g_soundRenderMode != ASS_RENDER_NONE)
+    {
+        // headless runs follow the game clock, so that a demo always mixes the same
+        s_renderMode = g_soundRenderMode;
+
+        if (s_renderMode == ASS_RENDER_NONE)
+            s_renderMode = headless ? ASS_RENDER_STEPPED : ASS_RENDER_REALTIME;
+
+        ASS_PreferredSoundDriver = ASS_NoSound;
+        NoSoundDrv_SetRender(s_renderMode, g_soundRenderFile);
+    }
+
     if (FX_Init(ud.config.NumVoices, ud.config.NumChannels, ud.config.MixRate, initdata) != FX_Ok)
     {
         initprintf("failed! %s\n", FX_ErrorString(FX_Error));
@@ -75,6 +122,8 @@ void S_SoundStartup(void)
         g_soundlocks[i] = 199;
     }
 
+    s_numActiveVoices = 0;
+
     cacheAllSounds();
 
     FX_SetVolume(ud.config.FXVolume);
@@ -86,6 +135,19 @@ void S_SoundStartup(void)
     FX_SetPrintf(OSD_Printf);
 }
 
+// With -wavout in stepped mode, mixes the sound of one game tic.
+void S_RenderTic(void)
+{
+    if (s_renderMode != ASS_RENDER_STEPPED)
+        return;
+
+    static int32_t frames;
+
+    frames += ud.config.MixRate;
+    NoSoundDrv_Render(frames / REALGAMETICSPERSEC);
+    frames %= REALGAMETICSPERSEC;
+}
+
 void S_SoundShutdown(void)
 {
     if (MusicVoice >= 0)
@@ -252,6 +314,10 @@ static int S_PlayMusic(const char *fn)
     }
     else
     {
+        // the stream thread decodes on its own clock, so stepped mixing decodes music in the mixer
+        if (s_renderMode == ASS_RENDER_STEPPED)
+            MV_StreamLead = 0;
+
         int MyMusicVoice = FX_Play(MyMusicPtr, MusicLen, 0, 0, 0, ud.config.MusicVolume, ud.config.MusicVolume, ud.config.MusicVolume,
                                    FX_MUSIC_PRIORITY, 1.f, MUSIC_ID);
 
@@ -365,6 +431,7 @@ void S_StopMusic(void)
 {
     MusicPaused = 0;
 
+    // returns once the stream thread is done decoding from MusicPtr
     if (MusicIsWaveform && MusicVoice >= 0)
     {
         FX_StopSound(MusicVoice);
@@ -422,6 +489,9 @@ void S_Cleanup(void)
         if (spriteNum != -1 && S_IsAmbientSFX(spriteNum) && sector[SECT(spriteNum)].lotag < 3)  // ST_2_UNDERWATER
             actor[spriteNum].t_data[0] = 0;
 
+        if (voice.id)
+            S_UntrackVoice((num * MAXSOUNDINSTANCES) + vidx);
+
         voice.owner = -1;
         voice.id    = 0;
         voice.dist  = UINT16_MAX;
@@ -454,6 +524,9 @@ int32_t S_LoadSound(int num)
     l = kread(fp, snd.ptr, l);
     kclose(fp);
 
+    if (l == snd.siz)
+        FX_PrecacheSound(snd.ptr, l);
+
     return l;
 }
 
@@ -532,18 +605,23 @@ static inline int S_GetAngle(int ang, const vec3_t *cam, const vec3_t *pos)
     return (2048 + ang - getangle(cam->x - pos->x, cam->y - pos->y)) & 2047;
 }
 
-static bool S_CalcDistAndAng(int32_t spriteNum, int32_t soundNum, int32_t sectNum, int32_t angle,
-                                const vec3_t *cam, const vec3_t *pos,
-                                int32_t *distPtr, int32_t *angPtr)
+// <sndist> and <sndang> are the plain distance and angle from the camera to <pos>
+static bool S_AdjustDistAndAng(int32_t spriteNum, int32_t soundNum, int32_t sectNum, int32_t angle,
+                               const vec3_t *cam, const vec3_t *pos, int32_t sndist, int32_t sndang,
+                               int32_t *distPtr, int32_t *angPtr)
 {
-    int32_t sndang = 0, sndist = 0;
+#ifndef SPLITSCREEN_MOD_HACKS
+    UNREFERENCED_PARAMETER(angle);
+    UNREFERENCED_PARAMETER(pos);
+#endif
+
     bool explosion = false;
 
     if (PN(spriteNum) == APLAYER && P_Get(spriteNum) == screenpeek)
+    {
+        sndang = sndist = 0;
         goto sound_further_processing;
-
-    sndang = S_GetAngle(angle, cam, pos);
-    sndist = FindDistance3D(cam->x-pos->x, cam->y-pos->y, (cam->z-pos->z));
+    }
 
 #ifdef SPLITSCREEN_MOD_HACKS
     if (g_fakeMultiMode==2)
@@ -608,6 +686,15 @@ sound_further_processing:
     return explosion;
 }
 
+static bool S_CalcDistAndAng(int32_t spriteNum, int32_t soundNum, int32_t sectNum, int32_t angle,
+                                const vec3_t *cam, const vec3_t *pos,
+                                int32_t *distPtr, int32_t *angPtr)
+{
+    return S_AdjustDistAndAng(spriteNum, soundNum, sectNum, angle, cam, pos,
+                              FindDistance3D(cam->x-pos->x, cam->y-pos->y, (cam->z-pos->z)), S_GetAngle(angle, cam, pos),
+                              distPtr, angPtr);
+}
+
 int S_PlaySound3D(int num, int spriteNum, const vec3_t *pos)
 {
     int32_t j = VM_OnEventWithReturn(EVENT_SOUND, spriteNum, screenpeek, num);
@@ -744,6 +831,8 @@ int S_PlaySound3D(int num, int spriteNum, const vec3_t *pos)
     snd.voices[sndSlot].dist  = sndist >> 6;
     snd.voices[sndSlot].clock = 0;
 
+    S_TrackVoice((sndNum * MAXSOUNDINSTANCES) + sndSlot);
+
     return voice;
 }
 
@@ -797,6 +886,8 @@ int S_PlaySound(int num)
     snd.voices[sndnum].dist  = 255 - LOUDESTVOLUME;
     snd.voices[sndnum].clock = 0;
 
+    S_TrackVoice((num * MAXSOUNDINSTANCES) + sndnum);
+
     return voice;
 }
 
@@ -864,6 +955,65 @@ void S_ChangeSoundPitch(int soundNum, int spriteNum, int pitchoffset)
     }
 }
 
+#define S_UPDATEBATCH 256
+
+// Pans up to S_UPDATEBATCH of the voices in s_activeVoices[]: first the plain
+// distances and angles of all of them, then the per-sound adjustments, then
+// one batch of pans to the mixer.
+static void S_UpdateVoices(uint16_t const *voices, int count, int32_t sectNum, int32_t angle, const vec3_t *cam)
+{
+    static uint16_t     placed[S_UPDATEBATCH];
+    static int32_t      dx[S_UPDATEBATCH], dy[S_UPDATEBATCH], dz[S_UPDATEBATCH];
+    static int32_t      dist[S_UPDATEBATCH], ang[S_UPDATEBATCH];
+    static voicepan3d_t pans[S_UPDATEBATCH];
+
+    int numPlaced = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        auto const &voice = g_sounds[voices[i] / MAXSOUNDINSTANCES].voices[voices[i] & (MAXSOUNDINSTANCES - 1)];
+        int const spriteNum = voice.owner;
+
+        if ((unsigned)spriteNum >= MAXSPRITES || voice.id <= FX_Ok || !FX_SoundActive(voice.id))
+            continue;
+
+        placed[numPlaced] = voices[i];
+        dx[numPlaced]     = cam->x - sprite[spriteNum].x;
+        dy[numPlaced]     = cam->y - sprite[spriteNum].y;
+        dz[numPlaced]     = cam->z - sprite[spriteNum].z;
+        numPlaced++;
+    }
+
+    for (int i = 0; i < numPlaced; i++)
+        dist[i] = sepdist(dx[i], dy[i], dz[i]);
+
+    for (int i = 0; i < numPlaced; i++)
+        ang[i] = (2048 + angle - getangle(dx[i], dy[i])) & 2047;
+
+    for (int i = 0; i < numPlaced; i++)
+    {
+        int const sndNum = placed[i] / MAXSOUNDINSTANCES;
+
+        auto &voice = g_sounds[sndNum].voices[placed[i] & (MAXSOUNDINSTANCES - 1)];
+        int const spriteNum = voice.owner;
+
+        int32_t sndist, sndang;
+
+        S_AdjustDistAndAng(spriteNum, sndNum, sectNum, angle, cam, (const vec3_t *)&sprite[spriteNum], dist[i], ang[i],
+                           &sndist, &sndang);
+
+        if (S_IsAmbientSFX(spriteNum))
+            g_numEnvSoundsPlaying++;
+
+        // AMBIENT_SOUND
+        pans[i] = { voice.id, sndang >> 4, sndist >> 6 };
+        voice.dist = sndist >> 6;
+        voice.clock++;
+    }
+
+    FX_Pan3DBatch(pans, numPlaced);
+}
+
 void S_Update(void)
 {
     if ((g_player[myconnectindex].ps->gm & (MODE_GAME|MODE_DEMO)) == 0)
@@ -887,36 +1037,18 @@ void S_Update(void)
         ca = sprite[ud.camerasprite].ang;
     }
 
-    int       sndnum  = 0;
-    int const highest = g_highestSoundIdx;
-
-    do
-    {
-        if (g_sounds[sndnum].num == 0)
-            continue;
-
-        S_Cleanup();
-
-        for (auto &voice : g_sounds[sndnum].voices)
-        {
-            int const spriteNum = voice.owner;
-
-            if ((unsigned)spriteNum >= MAXSPRITES || voice.id <= FX_Ok || !FX_SoundActive(voice.id))
-                continue;
-
-            int32_t sndist, sndang;
+    S_Cleanup();
 
-            S_CalcDistAndAng(spriteNum, sndnum, cs, ca, c, (const vec3_t *)&sprite[spriteNum], &sndist, &sndang);
+    for (int i = 0; i < s_numActiveVoices; i += S_UPDATEBATCH)
+        S_UpdateVoices(&s_activeVoices[i], min(s_numActiveVoices - i, S_UPDATEBATCH), cs, ca, c);
+}
 
-            if (S_IsAmbientSFX(spriteNum))
-                g_numEnvSoundsPlaying++;
+int32_t S_BenchmarkUpdate(int32_t numUpdates)
+{
+    for (int i = 0; i < numUpdates; i++)
+        S_Update();
 
-            // AMBIENT_SOUND
-            FX_Pan3D(voice.id, sndang >> 4, sndist >> 6);
-            voice.dist = sndist >> 6;
-            voice.clock++;
-        }
-    } while (++sndnum <= highest);
+    return s_numActiveVoices;
 }
 
 // S_Callback() can be called from either the audio thread when a sound ends, or the main thread
@@ -59,6 +59,8 @@ typedef struct
     char      pr, m;                         // 2b
 } sound_t;
 
+extern char *g_soundRenderFile;    // -wavout
+extern int32_t g_soundRenderMode;  // -wavmode, ASS_RENDER_*
 extern char g_soundlocks[MAXSOUNDS];
 extern sound_t g_sounds[MAXSOUNDS];
 extern int32_t g_numEnvSoundsPlaying,g_highestSoundIdx;
@@ -92,6 +94,8 @@ void S_StopEnvSound(int32_t num,int32_t i);
 void S_StopAllSounds(void);
 void S_StopMusic(void);
 void S_Update(void);
+int32_t S_BenchmarkUpdate(int32_t numUpdates);
+void S_RenderTic(void);
 void S_ChangeSoundPitch(int soundNum, int spriteNum, int pitchoffset);
 int32_t S_GetMusicPosition(void);
 void S_SetMusicPosition(int32_t position);
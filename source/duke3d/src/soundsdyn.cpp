@@ -359,6 +359,25 @@ void freesoundhashnames(void)
 {
     hash_free(&h_names);
 }
+
+// Copies the current remapped values out to (or, below, back in from) the
+// compiled script cache. Returns the number of entries.
+int32_t G_GetDynamicSoundMapping(int32_t *values)
+{
+    if (values)
+    {
+        for (int i=0; i < ARRAY_SSIZE(g_dynSoundList); i++)
+            values[i] = *g_dynSoundList[i].dynvalptr;
+    }
+
+    return ARRAY_SSIZE(g_dynSoundList);
+}
+
+void G_SetDynamicSoundMapping(int32_t const *values)
+{
+    for (int i=0; i < ARRAY_SSIZE(g_dynSoundList); i++)
+        *g_dynSoundList[i].dynvalptr = values[i];
+}
 #endif
 #endif
 
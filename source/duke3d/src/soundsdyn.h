@@ -175,6 +175,9 @@ void G_ProcessDynamicSoundMapping(const char *szLabel, int32_t lValue);
 #if !defined LUNATIC
 void initsoundhashnames(void);
 void freesoundhashnames(void);
+
+int32_t G_GetDynamicSoundMapping(int32_t *values);
+void G_SetDynamicSoundMapping(int32_t const *values);
 #endif
 
 extern int32_t ALIEN_SWITCH1;
@@ -325,6 +328,9 @@ extern int32_t WIND_REPEAT;
 #define initsoundhashnames() ((void)0)
 #define freesoundhashnames() ((void)0)
 
+#define G_GetDynamicSoundMapping(x) (0)
+#define G_SetDynamicSoundMapping(x) ((void)0)
+
 #include "soundefs.h"
 
 #define DYNAMICSOUNDMAP(Soundnum) (Soundnum)